@@ -21,6 +21,7 @@
 #include "Rtsp/RtspSession.h"
 #include "Rtmp/RtmpSession.h"
 #include "Http/HttpSession.h"
+#include "Common/TlsContext.h"
 #include "Shell/ShellSession.h"
 using namespace std;
 using namespace toolkit;
@@ -154,7 +155,7 @@ API_EXPORT void API_CALL mk_env_init2(int thread_num,
         if (ssl && ssl[0]) {
             // 设置ssl证书  [AUTO-TRANSLATED:e441027c]
             // Set SSL certificate
-            SSL_Initor::Instance().loadCertificate(ssl, true, ssl_pwd ? ssl_pwd : "", ssl_is_path);
+            TlsContext::loadCertificate(ssl, ssl_pwd ? ssl_pwd : "", ssl_is_path);
         }
     });
 }
@@ -195,7 +196,7 @@ API_EXPORT uint16_t API_CALL mk_http_server_start(uint16_t port, int ssl) {
     try {
         http_server[ssl] = std::make_shared<TcpServer>();
         if(ssl){
-            http_server[ssl]->start<SessionWithSSL<HttpSession> >(port);
+            http_server[ssl]->start<HttpsSession>(port);
         } else{
             http_server[ssl]->start<HttpSession>(port);
         }
@@ -212,7 +213,7 @@ API_EXPORT uint16_t API_CALL mk_rtsp_server_start(uint16_t port, int ssl) {
     try {
         rtsp_server[ssl] = std::make_shared<TcpServer>();
         if(ssl){
-            rtsp_server[ssl]->start<SessionWithSSL<RtspSession> >(port);
+            rtsp_server[ssl]->start<RtspSessionWithSSL>(port);
         }else{
             rtsp_server[ssl]->start<RtspSession>(port);
         }
@@ -229,7 +230,7 @@ API_EXPORT uint16_t API_CALL mk_rtmp_server_start(uint16_t port, int ssl) {
     try {
         rtmp_server[ssl] = std::make_shared<TcpServer>();
         if(ssl){
-            rtmp_server[ssl]->start<SessionWithSSL<RtmpSession> >(port);
+            rtmp_server[ssl]->start<RtmpSessionWithSSL>(port);
         }else{
             rtmp_server[ssl]->start<RtmpSession>(port);
         }
@@ -0,0 +1,325 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+#include <cstdio>
+#include <sstream>
+#include "AbrTranscoder.h"
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Record/Recorder.h"
+#include "Thread/WorkThreadPool.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+vector<AbrRendition> AbrRendition::parse(const string &str) {
+    vector<AbrRendition> ret;
+    for (auto &item : split(str, ",")) {
+        trim(item);
+        if (item.empty()) {
+            continue;
+        }
+        AbrRendition rendition;
+        int kbps = 0;
+        if (sscanf(item.data(), "%dx%d@%d", &rendition.width, &rendition.height, &kbps) != 3 || rendition.width <= 0 || rendition.height <= 0 || kbps <= 0) {
+            throw std::invalid_argument("invalid rendition: " + item);
+        }
+        // yuv420p要求宽高为偶数
+        // yuv420p requires an even width and height
+        rendition.width &= ~1;
+        rendition.height &= ~1;
+        rendition.bitrate = kbps * 1000;
+        rendition.name = to_string(rendition.height) + "p";
+        for (auto &other : ret) {
+            if (other.name == rendition.name) {
+                throw std::invalid_argument("duplicate rendition: " + item);
+            }
+        }
+        ret.emplace_back(std::move(rendition));
+    }
+    if (ret.empty()) {
+        throw std::invalid_argument("empty renditions");
+    }
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AbrEncoder::AbrEncoder(const MediaTuple &tuple, const AbrRendition &rendition, float fps, const Track::Ptr &audio) : _rendition(rendition) {
+    _sws = std::make_shared<FFmpegSws>(AV_PIX_FMT_YUV420P, rendition.width, rendition.height);
+
+    ProtocolOption option;
+    option.enable_hls = true;
+    option.hls_demand = false;
+    _dev = std::make_shared<DevChannel>(tuple, 0, option);
+
+    VideoInfo info;
+    info.codecId = CodecH264;
+    info.iWidth = rendition.width;
+    info.iHeight = rendition.height;
+    info.iFrameRate = fps;
+    info.iBitRate = rendition.bitrate;
+    info.bExternalKey = true;
+    _dev->initVideo(info);
+    if (audio) {
+        _dev->addTrack(audio->clone());
+    }
+    _dev->addTrackCompleted();
+
+    startThread("abr " + rendition.name);
+}
+
+AbrEncoder::~AbrEncoder() {
+    stopThread(true);
+}
+
+void AbrEncoder::inputFrame(const FFmpegFrame::Ptr &frame, uint64_t pts, bool key_frame) {
+    // 积压时丢弃非关键帧直到下一个对齐的关键帧
+    // Drop non key frames until the next aligned key frame when tasks pile up
+    addDecodeTask(key_frame, [this, frame, pts, key_frame]() {
+        auto out = _sws->inputFrame(frame);
+        if (out) {
+            _dev->inputYUV((char **)out->get()->data, out->get()->linesize, pts, key_frame);
+        }
+    });
+}
+
+void AbrEncoder::inputAudio(const Frame::Ptr &frame) {
+    // 音频不作为关键帧，不会结束视频的积压丢帧状态
+    // Audio is not treated as a key frame, so it never ends the frame dropping of the video
+    auto cacheable = Frame::getCacheAbleFrame(frame);
+    addDecodeTask(false, [this, cacheable]() { _dev->inputFrame(cacheable); });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AbrTranscoder::AbrTranscoder(const MediaTuple &tuple, const string &url, vector<AbrRendition> renditions, uint32_t gop_ms) {
+    _tuple = tuple;
+    _url = url;
+    _renditions = std::move(renditions);
+    _gop_ms = MAX(gop_ms, 100u);
+    ProtocolOption option;
+    auto m3u8 = Recorder::getRecordPath(Recorder::type_hls, _tuple, option.hls_save_path);
+    _master_path = m3u8.substr(0, m3u8.rfind('/') + 1) + "master.m3u8";
+}
+
+AbrTranscoder::~AbrTranscoder() {
+    // 先停止解码线程，之后不会再触发onDecode
+    // Stop the decode thread first, onDecode will not be triggered afterwards
+    if (_decoder) {
+        _decoder->stopThread(true);
+    }
+    _player.reset();
+    _decoder.reset();
+    _encoders.clear();
+    File::delete_file(_master_path);
+}
+
+void AbrTranscoder::start() {
+    writeMasterPlaylist();
+    play();
+}
+
+void AbrTranscoder::writeMasterPlaylist() {
+    stringstream ss;
+    ss << "#EXTM3U\n"
+       << "#EXT-X-VERSION:3\n";
+    for (auto &rendition : _renditions) {
+        // 主播放列表与各路输出的hls.m3u8位于同级目录
+        // The master playlist and the hls.m3u8 of each rendition are in sibling directories
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << rendition.bitrate << ",RESOLUTION=" << rendition.width << "x" << rendition.height << "\n"
+           << "../" << _tuple.stream << "_" << rendition.name << "/hls.m3u8\n";
+    }
+    File::create_path(_master_path, 0777);
+    if (!File::saveFile(ss.str(), _master_path)) {
+        WarnL << "write master playlist failed: " << _master_path;
+    }
+}
+
+void AbrTranscoder::play() {
+    _player = std::make_shared<MediaPlayer>();
+    (*_player)[Client::kWaitTrackReady] = true;
+    (*_player)[Client::kRtpType] = Rtsp::RTP_TCP;
+
+    weak_ptr<AbrTranscoder> weak_self = shared_from_this();
+    _player->setOnPlayResult([weak_self](const SockException &ex) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onPlayResult(ex);
+        }
+    });
+    _player->setOnShutdown([weak_self](const SockException &ex) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onShutdown(ex);
+        }
+    });
+    _player->play(_url);
+}
+
+void AbrTranscoder::rePlay() {
+    ++_failed_count;
+    auto delay = MAX(2 * 1000, MIN(_failed_count * 3 * 1000, 60 * 1000));
+    weak_ptr<AbrTranscoder> weak_self = shared_from_this();
+    _timer = std::make_shared<Timer>(delay / 1000.0f, [weak_self]() {
+        if (auto strong_self = weak_self.lock()) {
+            WarnL << "abr replay [" << strong_self->_failed_count << "]:" << strong_self->_url;
+            strong_self->_player->play(strong_self->_url);
+        }
+        return false;
+    }, _player->getPoller());
+}
+
+void AbrTranscoder::onShutdown(const SockException &ex) {
+    WarnL << "abr input shutdown: " << _url << ", " << ex.what();
+    rePlay();
+}
+
+void AbrTranscoder::onPlayResult(const SockException &ex) {
+    if (ex) {
+        WarnL << "abr play failed: " << _url << ", " << ex.what();
+        rePlay();
+        return;
+    }
+    _timer.reset();
+    _failed_count = 0;
+
+    auto track = dynamic_pointer_cast<VideoTrack>(_player->getTrack(TrackVideo, false));
+    if (!track) {
+        WarnL << "abr input has no video track: " << _url;
+        return;
+    }
+    auto audio = _player->getTrack(TrackAudio, false);
+    if (_encoders.empty()) {
+        auto fps = track->getVideoFps();
+        if (fps <= 0) {
+            fps = 25;
+        }
+        for (auto &rendition : _renditions) {
+            auto tuple = _tuple;
+            tuple.stream += "_" + rendition.name;
+            _encoders.emplace_back(std::make_shared<AbrEncoder>(tuple, rendition, fps, audio));
+        }
+    }
+    if (audio) {
+        // 音频透传到每一路输出，重连后的新track也需要重新监听
+        // The audio is passed through to every rendition, the new track after reconnecting must be listened to again
+        weak_ptr<AbrTranscoder> weak_self = shared_from_this();
+        audio->addDelegate([weak_self](const Frame::Ptr &frame) {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return false;
+            }
+            for (auto &encoder : strong_self->_encoders) {
+                encoder->inputAudio(frame);
+            }
+            return true;
+        });
+    }
+
+    // 重连后重新创建解码器，旧解码器线程退出后才会重置关键帧计时
+    // Recreate the decoder after reconnecting, the key frame timing is reset only after the old decoder thread exits
+    if (_decoder) {
+        _decoder->stopThread(true);
+    }
+    _last_key_pts = -1;
+    _decoder = std::make_shared<FFmpegDecoder>(track);
+    _decoder->setOnDecode([this](const FFmpegFrame::Ptr &frame) {
+        // 析构前会先停止解码线程，此处可以安全访问this
+        // The decode thread is stopped before destruction, so it is safe to access this here
+        onDecode(frame);
+    });
+    weak_ptr<FFmpegDecoder> weak_decoder = _decoder;
+    track->addDelegate([weak_decoder](const Frame::Ptr &frame) {
+        if (auto decoder = weak_decoder.lock()) {
+            return decoder->inputFrame(frame, true, true);
+        }
+        return false;
+    });
+}
+
+void AbrTranscoder::onDecode(const FFmpegFrame::Ptr &frame) {
+    auto pts = frame->get()->pts;
+    if (pts == AV_NOPTS_VALUE) {
+        pts = frame->get()->best_effort_timestamp;
+    }
+    // 只在此处决定一次是否为关键帧，所有输出在相同时间戳上编码IDR，保证客户端可以无缝切换
+    // Whether it is a key frame is decided only once here and all renditions encode an IDR at the same timestamp,
+    // so clients can switch between them seamlessly
+    bool key_frame = _last_key_pts < 0 || pts < _last_key_pts || pts - _last_key_pts >= _gop_ms;
+    if (key_frame) {
+        _last_key_pts = pts;
+    }
+    for (auto &encoder : _encoders) {
+        encoder->inputFrame(frame, pts, key_frame);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AbrTranscoderManager &AbrTranscoderManager::Instance() {
+    static AbrTranscoderManager instance;
+    return instance;
+}
+
+string AbrTranscoderManager::start(const MediaTuple &tuple, const string &url, const string &ladder, uint32_t gop_ms) {
+    auto renditions = AbrRendition::parse(ladder);
+    auto key = tuple.shortUrl();
+    lock_guard<recursive_mutex> lck(_mtx);
+    if (_transcoders.find(key) != _transcoders.end()) {
+        throw std::invalid_argument("abr transcoder already exists: " + key);
+    }
+    if (_stopping.find(key) != _stopping.end()) {
+        // 旧任务的输出流尚未注销
+        // The output streams of the old task are not unregistered yet
+        throw std::invalid_argument("abr transcoder is stopping: " + key);
+    }
+    auto transcoder = std::make_shared<AbrTranscoder>(tuple, url, std::move(renditions), gop_ms);
+    transcoder->start();
+    _transcoders.emplace(key, std::move(transcoder));
+    return key;
+}
+
+bool AbrTranscoderManager::stop(const string &key) {
+    AbrTranscoder::Ptr transcoder;
+    {
+        lock_guard<recursive_mutex> lck(_mtx);
+        auto it = _transcoders.find(key);
+        if (it == _transcoders.end()) {
+            return false;
+        }
+        transcoder = std::move(it->second);
+        _transcoders.erase(it);
+        _stopping.emplace(key);
+    }
+    // 析构时需等待解码与编码线程退出，放到后台线程执行，不阻塞调用者(http线程)
+    // Destruction waits for the decode and encode threads to exit, so it runs in a background thread
+    // instead of blocking the caller (the http thread)
+    WorkThreadPool::Instance().getExecutor()->async([transcoder, key]() mutable {
+        transcoder.reset();
+        auto &self = Instance();
+        lock_guard<recursive_mutex> lck(self._mtx);
+        self._stopping.erase(key);
+    });
+    return true;
+}
+
+void AbrTranscoderManager::clear() {
+    decltype(_transcoders) transcoders;
+    {
+        lock_guard<recursive_mutex> lck(_mtx);
+        transcoders.swap(_transcoders);
+    }
+}
+
+} // namespace mediakit
+#endif // defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
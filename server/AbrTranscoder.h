@@ -0,0 +1,172 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_ABRTRANSCODER_H
+#define ZLMEDIAKIT_ABRTRANSCODER_H
+
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "Codec/Transcode.h"
+#include "Common/Device.h"
+#include "Player/MediaPlayer.h"
+#include "Poller/Timer.h"
+
+namespace mediakit {
+
+/**
+ * 码率阶梯中的一路输出
+ * A rendition of the bitrate ladder
+ */
+struct AbrRendition {
+    // 输出流id后缀，例如720p
+    // The suffix of the output stream id, such as 720p
+    std::string name;
+    int width = 0;
+    int height = 0;
+    // 单位bps
+    // In bps
+    int bitrate = 0;
+
+    /**
+     * 解析"1920x1080@4000,1280x720@2000"格式的码率阶梯，码率单位kbps
+     * 输出流id后缀为高度加p，例如1080p
+     * Parse a ladder in the format "1920x1080@4000,1280x720@2000", the bitrate is in kbps;
+     * the suffix of the output stream id is the height followed by p, such as 1080p
+     */
+    static std::vector<AbrRendition> parse(const std::string &str);
+};
+
+/**
+ * 一路输出的缩放与编码线程，多路输出在各自线程并行处理
+ * The scale and encode thread of a rendition, the renditions run in parallel in their own threads
+ */
+class AbrEncoder : public TaskManager {
+public:
+    using Ptr = std::shared_ptr<AbrEncoder>;
+
+    /**
+     * @param audio 输入的音频track，不为空时原样透传到本路输出
+     * @param audio The audio track of the input, passed through to this rendition as is when not null
+     */
+    AbrEncoder(const MediaTuple &tuple, const AbrRendition &rendition, float fps, const Track::Ptr &audio);
+    ~AbrEncoder() override;
+
+    /**
+     * 输入解码后的帧，所有输出使用相同的时间戳与关键帧标记，保证切片边界对齐
+     * 任务积压时丢帧直到下一个关键帧，不会破坏关键帧对齐
+     * Input a decoded frame, all renditions use the same timestamp and key frame flag so that segment boundaries are aligned;
+     * when tasks pile up frames are dropped until the next key frame, which keeps the key frames aligned
+     */
+    void inputFrame(const FFmpegFrame::Ptr &frame, uint64_t pts, bool key_frame);
+
+    /**
+     * 输入透传的音频帧，与视频在同一队列中串行写入，积压丢帧期间音频同样丢弃
+     * Input an audio frame to pass through, it is written in the same queue as the video,
+     * and it is dropped as well while frames are dropped because tasks pile up
+     */
+    void inputAudio(const Frame::Ptr &frame);
+
+    const AbrRendition &getRendition() const { return _rendition; }
+
+private:
+    AbrRendition _rendition;
+    FFmpegSws::Ptr _sws;
+    DevChannel::Ptr _dev;
+};
+
+/**
+ * 自适应码率转码：拉流后只解码一次，并行缩放编码成多路分辨率，
+ * 每路作为独立的流(流id为原id加后缀)发布，并生成分组所有输出的hls主播放列表；
+ * 音频不转码，原样透传到每一路输出
+ * Adaptive bitrate transcoding: the input is pulled and decoded only once, then scaled and encoded into several
+ * resolutions in parallel; each rendition is published as an independent stream (the stream id plus a suffix),
+ * and an hls master playlist grouping all renditions is generated; the audio is not transcoded but passed
+ * through to every rendition as is
+ */
+class AbrTranscoder : public std::enable_shared_from_this<AbrTranscoder> {
+public:
+    using Ptr = std::shared_ptr<AbrTranscoder>;
+
+    /**
+     * @param tuple 输出流，各路输出流id为tuple.stream + "_" + 后缀
+     * @param url 输入拉流地址
+     * @param gop_ms 关键帧间隔，单位毫秒
+     * @param tuple The output stream, the stream id of each rendition is tuple.stream + "_" + suffix
+     * @param url The input url
+     * @param gop_ms The key frame interval in milliseconds
+     */
+    AbrTranscoder(const MediaTuple &tuple, const std::string &url, std::vector<AbrRendition> renditions, uint32_t gop_ms);
+    ~AbrTranscoder();
+
+    void start();
+
+    /**
+     * 获取主播放列表路径
+     * Get the path of the master playlist
+     */
+    const std::string &getMasterPath() const { return _master_path; }
+
+private:
+    void play();
+    void rePlay();
+    void onPlayResult(const toolkit::SockException &ex);
+    void onShutdown(const toolkit::SockException &ex);
+    void onDecode(const FFmpegFrame::Ptr &frame);
+    void writeMasterPlaylist();
+
+private:
+    int _failed_count = 0;
+    uint32_t _gop_ms;
+    int64_t _last_key_pts = -1;
+    MediaTuple _tuple;
+    std::string _url;
+    std::string _master_path;
+    std::vector<AbrRendition> _renditions;
+    toolkit::Timer::Ptr _timer;
+    MediaPlayer::Ptr _player;
+    FFmpegDecoder::Ptr _decoder;
+    std::vector<AbrEncoder::Ptr> _encoders;
+};
+
+class AbrTranscoderManager {
+public:
+    static AbrTranscoderManager &Instance();
+
+    /**
+     * 创建转码任务
+     * @return 任务id，即输出流的vhost/app/stream
+     * Create a transcoding task
+     * @return The task id, that is vhost/app/stream of the output stream
+     */
+    std::string start(const MediaTuple &tuple, const std::string &url, const std::string &ladder, uint32_t gop_ms);
+
+    /**
+     * 停止转码任务，任务在后台线程中销毁，销毁完成前不能创建同名任务
+     * Stop a transcoding task, it is destroyed in a background thread and a task with the same key
+     * can not be created before that finishes
+     */
+    bool stop(const std::string &key);
+
+    void clear();
+
+private:
+    std::recursive_mutex _mtx;
+    std::unordered_map<std::string, AbrTranscoder::Ptr> _transcoders;
+    // 正在后台销毁的任务 / tasks being destroyed in the background
+    std::unordered_set<std::string> _stopping;
+};
+
+} // namespace mediakit
+#endif // defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+#endif // ZLMEDIAKIT_ABRTRANSCODER_H
@@ -360,6 +360,7 @@ void FFmpegSource::onGetMediaSource(const MediaSource::Ptr &src) {
 }
 
 #if defined(ENABLE_FFMPEG)
+#include <thread>
 #include "Player/MediaPlayer.h"
 #include "Codec/Transcode.h"
 
@@ -401,10 +402,220 @@ static void makeSnapAsync(const string &play_url, const string &save_path, float
     holder->player = std::move(player);
 }
 
+// 本机直播流截图：直接解码MultiMediaSourceMuxer缓存的最近关键帧，无需拉流与等待下一个gop
+// 同一个流的并发请求合并为一次解码，相同关键帧的截图结果会被缓存复用
+// Snapshot of a local live stream: decode the latest key frame cached by MultiMediaSourceMuxer directly, without pulling
+// the stream or waiting for the next gop; concurrent requests of the same stream share one decode, and the snapshot of the
+// same key frame is cached and reused
+class LocalSnap {
+public:
+    // 截图缓存最长保留时间
+    // The longest time a cached snapshot is kept
+    static constexpr uint64_t kCacheMS = 60 * 1000;
+
+    static LocalSnap &Instance() {
+        static LocalSnap instance;
+        return instance;
+    }
+
+    bool makeSnap(const string &play_url, const string &save_path, float timeout_sec, const FFmpegSnap::onSnap &cb) {
+        MediaInfo info;
+        try {
+            info.parse(play_url);
+        } catch (std::exception &ex) {
+            return false;
+        }
+        if (!is_local_ip(info.host)) {
+            return false;
+        }
+        auto src = MediaSource::find(info.vhost, info.app, info.stream);
+        auto muxer = src ? src->getMuxer() : nullptr;
+        auto track = src ? src->getTrack(TrackVideo) : nullptr;
+        if (!muxer || !track) {
+            return false;
+        }
+        auto frames = muxer->getLastKeyFrame();
+        if (frames.empty()) {
+            // 首次请求只登记截图消费者，muxer从下一个关键帧开始缓存，本次仍走拉流截图
+            // The first request only registers a snapshot consumer and the muxer caches from the next key frame,
+            // this request still takes a snapshot by pulling the stream
+            return false;
+        }
+
+        auto key = info.shortUrl();
+        auto key_dts = frames.back()->dts();
+        uint64_t generation = 0;
+        string jpeg;
+        {
+            lock_guard<mutex> lck(_mtx);
+            for (auto it = _cache.begin(); it != _cache.end();) {
+                if (!it->second.pending && it->second.ticker.elapsedTime() > kCacheMS) {
+                    it = _cache.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            auto &entry = _cache[key];
+            if (entry.pending) {
+                // 已有同一个流的截图正在进行，等待其结果
+                // A snapshot of the same stream is in progress, wait for its result
+                entry.waiters.emplace_back(Waiter { save_path, cb });
+                return true;
+            }
+            if (!entry.jpeg.empty() && entry.key_dts == key_dts) {
+                // 关键帧未变化，复用缓存的截图
+                // The key frame is unchanged, reuse the cached snapshot
+                jpeg = entry.jpeg;
+            } else {
+                entry.pending = true;
+                entry.key_dts = key_dts;
+                entry.waiters.emplace_back(Waiter { save_path, cb });
+                generation = ++_generation;
+                entry.generation = generation;
+            }
+        }
+        if (!jpeg.empty()) {
+            reply(save_path, cb, true, jpeg);
+            return true;
+        }
+
+        // 同一个流总是由同一个队列处理，队列共享转码线程池
+        // The same stream is always handled by the same queue, and the queues share the transcode thread pool
+        auto &worker = _workers[std::hash<string>()(key) % _workers.size()];
+        worker->addTask([this, worker, key, generation, track, frames]() {
+            string err;
+            string out;
+            if (worker->snap(track, frames, out, err)) {
+                onDone(key, generation, true, out);
+            } else {
+                onDone(key, generation, false, err);
+            }
+        });
+        // 防止任务被丢弃或解码失败导致请求无法回复
+        // Prevent the requests from never being replied if the task is dropped or decoding fails
+        EventPollerPool::Instance().getPoller()->doDelayTask(timeout_sec * 1000, [this, key, generation]() {
+            onDone(key, generation, false, "decode frame timeout");
+            return 0;
+        });
+        return true;
+    }
+
+private:
+    struct Waiter {
+        string save_path;
+        FFmpegSnap::onSnap cb;
+    };
+
+    struct Entry {
+        bool pending = false;
+        uint64_t key_dts = 0;
+        uint64_t generation = 0;
+        Ticker ticker;
+        string jpeg;
+        vector<Waiter> waiters;
+    };
+
+    class Worker : public TaskManager {
+    public:
+        using Ptr = std::shared_ptr<Worker>;
+
+        Worker(size_t index) {
+            setMaxTaskSize(1000);
+            startThread("snap " + to_string(index));
+        }
+
+        ~Worker() override {
+            stopThread(true);
+        }
+
+        void addTask(function<void()> task) {
+            addEncodeTask(std::move(task));
+        }
+
+        bool snap(const Track::Ptr &track, const vector<Frame::Ptr> &frames, string &out, string &err) {
+            FFmpegFrame::Ptr image;
+            auto decoder = std::make_shared<FFmpegDecoder>(track, 1);
+            decoder->setOnDecode([&](const FFmpegFrame::Ptr &frame) {
+                if (!image) {
+                    image = frame;
+                }
+            });
+            // 合并关键帧的各个slice与配置帧后一次送入解码器
+            // Merge the slices and config frames of the key frame and feed them to the decoder at once
+            FrameMerger merger(FrameMerger::h264_prefix);
+            auto codec = track->getCodecId();
+            for (auto &frame : frames) {
+                merger.inputFrame(frame, [&](uint64_t dts, uint64_t pts, const Buffer::Ptr &buffer, bool have_key_frame) {
+                    decoder->inputFrame(std::make_shared<FrameFromPtr>(codec, buffer->data(), buffer->size(), dts, pts, 0, have_key_frame), false, false, false);
+                });
+            }
+            merger.flush();
+            decoder->flush();
+            if (!image) {
+                err = "decode key frame failed";
+                return false;
+            }
+            auto ret = _encoder.encode(image, out);
+            err = std::get<1>(ret);
+            return std::get<0>(ret);
+        }
+
+    private:
+        FFmpegJpegEncoder _encoder;
+    };
+
+    LocalSnap() {
+        auto size = MAX(std::thread::hardware_concurrency(), 1u);
+        for (size_t i = 0; i < size; ++i) {
+            _workers.emplace_back(std::make_shared<Worker>(i));
+        }
+    }
+
+    void onDone(const string &key, uint64_t generation, bool success, const string &data) {
+        vector<Waiter> waiters;
+        {
+            lock_guard<mutex> lck(_mtx);
+            auto it = _cache.find(key);
+            if (it == _cache.end() || !it->second.pending || it->second.generation != generation) {
+                return;
+            }
+            auto &entry = it->second;
+            entry.pending = false;
+            entry.ticker.resetTime();
+            entry.jpeg = success ? data : "";
+            waiters.swap(entry.waiters);
+        }
+        for (auto &waiter : waiters) {
+            reply(waiter.save_path, waiter.cb, success, data);
+        }
+    }
+
+    static void reply(const string &save_path, const FFmpegSnap::onSnap &cb, bool success, const string &data) {
+        if (!success) {
+            cb(false, data);
+            return;
+        }
+        if (!File::saveFile(data, save_path)) {
+            cb(false, "save snap file failed: " + save_path);
+            return;
+        }
+        cb(true, "");
+    }
+
+private:
+    uint64_t _generation = 0;
+    mutex _mtx;
+    unordered_map<string, Entry> _cache;
+    vector<Worker::Ptr> _workers;
+};
+
 #endif
 
 void FFmpegSnap::makeSnap(bool async, const string &play_url, const string &save_path, float timeout_sec, const onSnap &cb) {
 #if defined(ENABLE_FFMPEG)
+    if (LocalSnap::Instance().makeSnap(play_url, save_path, timeout_sec, cb)) {
+        return;
+    }
     if (async) {
         makeSnapAsync(play_url, save_path, timeout_sec, cb);
         return;
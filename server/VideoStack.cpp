@@ -1,6 +1,7 @@
 ﻿#if defined(ENABLE_VIDEOSTACK) && defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
 #include "VideoStack.h"
 #include "Codec/Transcode.h"
+#include "Codec/VideoCompositor.h"
 #include "Common/Device.h"
 #include "Util/logger.h"
 #include "Util/util.h"
@@ -21,14 +22,6 @@
 #define RGB_TO_U(R, G, B) (((-26 * (R) - 87 * (G) + 112 * (B) + 128) >> 8) + 128)
 #define RGB_TO_V(R, G, B) (((112 * (R) - 102 * (G) - 10 * (B) + 128) >> 8) + 128)
 
-static void fill_yuv_func(const mediakit::FFmpegFrame::Ptr &frame, int y, int u, int v) {
-    const auto& yuv = frame->get();
-    memset(yuv->data[0], y, yuv->linesize[0] * yuv->height);
-    memset(yuv->data[1], u, yuv->linesize[1] * ((yuv->height + 1) / 2));
-    memset(yuv->data[2], v, yuv->linesize[2] * ((yuv->height + 1) / 2));
-}
-
-
 INSTANCE_IMP(VideoStackManager)
 
 Param::~Param() {
@@ -59,68 +52,36 @@ Channel::Channel(const std::string& id, int width, int height, AVPixelFormat pix
     resizeFrame(frame);
 }
 
-void Channel::addParam(const std::weak_ptr<Param>& p) {
-    std::lock_guard<std::recursive_mutex> lock(_mx);
-    _params.push_back(p);
-}
-
 void Channel::onFrame(const mediakit::FFmpegFrame::Ptr& frame) {
+    std::lock_guard<std::recursive_mutex> lock(_mx);
+    auto scheduled = _pending != nullptr;
+    _pending = frame;
+    if (scheduled) {
+        // 已有缩放任务在排队，它会处理最新的一帧
+        // A scaling task is already queued, it will process the latest frame
+        return;
+    }
     std::weak_ptr<Channel> weakSelf = shared_from_this();
     _poller = _poller ? _poller : toolkit::WorkThreadPool::Instance().getPoller();
-    _poller->async([weakSelf, frame]() {
+    _poller->async([weakSelf]() {
         auto self = weakSelf.lock();
         if (!self) { return; }
-        self->resizeFrame(frame);
-        self->forEachParam([self](const Param::Ptr& p) { self->fillBuffer(p); });
+        mediakit::FFmpegFrame::Ptr frame;
+        {
+            std::lock_guard<std::recursive_mutex> lock(self->_mx);
+            frame.swap(self->_pending);
+        }
+        if (frame) { self->resizeFrame(frame); }
     });
 }
 
-void Channel::forEachParam(const std::function<void(const Param::Ptr&)>& func) {
-    for (auto& wp : _params) {
-        if (auto sp = wp.lock()) { func(sp); }
-    }
-}
-
-void Channel::fillBuffer(const Param::Ptr& p) {
-    if (auto buf = p->weak_buf.lock()) { copyData(buf, p); }
-}
-
-void Channel::copyData(const mediakit::FFmpegFrame::Ptr& buf, const Param::Ptr& p) {
-
-    switch (p->pixfmt) {
-        case AV_PIX_FMT_YUV420P: {
-            for (int i = 0; i < p->height; i++) {
-                memcpy(buf->get()->data[0] + buf->get()->linesize[0] * (i + p->posY) + p->posX,
-                       _tmp->get()->data[0] + _tmp->get()->linesize[0] * i, _tmp->get()->width);
-            }
-            // 确保height为奇数时，也能正确的复制到最后一行uv数据  [AUTO-TRANSLATED:69895ea5]
-            // Ensure that the uv data can be copied to the last line correctly when height is odd
-            for (int i = 0; i < (p->height + 1) / 2; i++) {
-                // U平面  [AUTO-TRANSLATED:8b73dc2d]
-                // U plane
-                memcpy(buf->get()->data[1] + buf->get()->linesize[1] * (i + p->posY / 2) +
-                           p->posX / 2,
-                       _tmp->get()->data[1] + _tmp->get()->linesize[1] * i, _tmp->get()->width / 2);
-
-                // V平面  [AUTO-TRANSLATED:8fa72cc7]
-                // V plane
-                memcpy(buf->get()->data[2] + buf->get()->linesize[2] * (i + p->posY / 2) +
-                           p->posX / 2,
-                       _tmp->get()->data[2] + _tmp->get()->linesize[2] * i, _tmp->get()->width / 2);
-            }
-            break;
-        }
-        case AV_PIX_FMT_NV12: {
-            // TODO: 待实现  [AUTO-TRANSLATED:247ec1df]
-            // TODO: To be implemented
-            break;
-        }
-
-        default: WarnL << "No support pixformat: " << av_get_pix_fmt_name(p->pixfmt); break;
-    }
+mediakit::FFmpegFrame::Ptr Channel::getFrame() {
+    std::lock_guard<std::recursive_mutex> lock(_mx);
+    return _tmp;
 }
 
 void Channel::resizeFrame(const mediakit::FFmpegFrame::Ptr &frame) {
+    if (!frame) { return; }
     if (_keepAspectRatio) {
         resizeFrameImplWithAspectRatio(frame);
     } else {
@@ -136,10 +97,10 @@ void Channel::resizeFrameImplWithAspectRatio(const mediakit::FFmpegFrame::Ptr &f
     }
 
     // 当新frame宽高变化时，重新初始化sws
-    if (srcWidth != _lastWidht || srcHeight != _lastHeight) {
+    auto reset = srcWidth != _lastWidht || srcHeight != _lastHeight;
+    if (reset) {
         _lastWidht = srcWidth;
         _lastHeight = srcHeight;
-        fill_yuv_func(_tmp, 16, 128, 128);
 
         int dstWidth = _width;
         int dstHeight = _height;
@@ -162,33 +123,59 @@ void Channel::resizeFrameImplWithAspectRatio(const mediakit::FFmpegFrame::Ptr &f
     }
 
     auto scaledFrame = _sws->inputFrame(frame);
+    if (!scaledFrame) { return; }
+
+    // 写入期间把画面从通道中取出，正被拼接流读取时写入新的帧
+    // Take the picture out of the channel while writing, write into a new frame if the stacks are still reading it
+    mediakit::FFmpegFrame::Ptr out;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mx);
+        out.swap(_tmp);
+    }
+    if (!out || out.use_count() > 1) {
+        out = std::make_shared<mediakit::FFmpegFrame>();
+        out->fillPicture(_pixfmt, _width, _height);
+        out->get()->width = _width;
+        out->get()->height = _height;
+        out->get()->format = _pixfmt;
+        reset = true;
+    }
+    if (reset) {
+        mediakit::VideoCompositor::fill(out, 16, 128, 128);
+    }
 
     int copyWidth = ((_width) < (scaledFrame->get()->width) ? (_width) : (scaledFrame->get()->width));
     int copyHeight = ((_height) < (scaledFrame->get()->height) ? (_height) : (scaledFrame->get()->height));
 
     for (int i = 0; i < copyHeight; i++) {
         memcpy(
-            _tmp->get()->data[0] + (i + _offsetY) * _tmp->get()->linesize[0] + _offsetX, scaledFrame->get()->data[0] + i * scaledFrame->get()->linesize[0],
+            out->get()->data[0] + (i + _offsetY) * out->get()->linesize[0] + _offsetX, scaledFrame->get()->data[0] + i * scaledFrame->get()->linesize[0],
             copyWidth);
     }
 
     for (int i = 0; i < (copyHeight + 1) / 2; i++) {
         memcpy(
-            _tmp->get()->data[1] + (i + _offsetY / 2) * _tmp->get()->linesize[1] + _offsetX / 2,
+            out->get()->data[1] + (i + _offsetY / 2) * out->get()->linesize[1] + _offsetX / 2,
             scaledFrame->get()->data[1] + i * scaledFrame->get()->linesize[1], copyWidth / 2);
         memcpy(
-            _tmp->get()->data[2] + (i + _offsetY / 2) * _tmp->get()->linesize[2] + _offsetX / 2,
+            out->get()->data[2] + (i + _offsetY / 2) * out->get()->linesize[2] + _offsetX / 2,
             scaledFrame->get()->data[2] + i * scaledFrame->get()->linesize[2], copyWidth / 2);
     }
 
+    std::lock_guard<std::recursive_mutex> lock(_mx);
+    _tmp = std::move(out);
 }
 
 void Channel::resizeFrameImplWithoutAspectRatio(const mediakit::FFmpegFrame::Ptr &frame) {
     if (!_sws) {
-        fill_yuv_func(_tmp, 16, 128, 128);
         _sws = std::make_shared<mediakit::FFmpegSws>(_pixfmt, _width, _height);
     }
-    _tmp = _sws->inputFrame(frame);
+    // sws输出来自帧池，被拼接流引用期间不会被复用
+    // The sws output comes from a frame pool and is not reused while the stacks still reference it
+    auto out = _sws->inputFrame(frame);
+    if (!out) { return; }
+    std::lock_guard<std::recursive_mutex> lock(_mx);
+    _tmp = std::move(out);
 }
 
 void StackPlayer::addChannel(const std::weak_ptr<Channel>& chn) {
@@ -332,22 +319,8 @@ VideoStack::~VideoStack() {
 }
 
 void VideoStack::setParam(const Params& params) {
-    if (_params) {
-        for (auto& p : (*_params)) {
-            if (!p) continue;
-            p->weak_buf.reset();
-        }
-    }
-
+    std::lock_guard<std::mutex> lock(_mtx);
     initBgColor();
-    for (auto& p : (*params)) {
-        if (!p) continue;
-        p->weak_buf = _buffer;
-        if (auto chn = p->weak_chn.lock()) {
-            chn->addParam(p);
-            chn->fillBuffer(p);
-        }
-    }
     _params = params;
 }
 
@@ -361,6 +334,22 @@ void VideoStack::start() {
                 std::chrono::milliseconds(frameInterval)) {
                 lastEncTP = std::chrono::steady_clock::now();
 
+                // 每帧按布局取各通道最新画面合成，通道解码帧率再高也只拷贝一次
+                // Composite the latest picture of every channel per output frame, each one is copied once however fast the channel decodes
+                std::lock_guard<std::mutex> lock(_mtx);
+                std::vector<mediakit::VideoCompositor::Tile> tiles;
+                if (_params) {
+                    tiles.reserve(_params->size());
+                    for (auto& p : (*_params)) {
+                        if (!p || p->pixfmt != AV_PIX_FMT_YUV420P) continue;
+                        auto chn = p->weak_chn.lock();
+                        auto frame = chn ? chn->getFrame() : nullptr;
+                        if (!frame) continue;
+                        tiles.push_back({ p->posX, p->posY, std::move(frame) });
+                    }
+                }
+                mediakit::VideoCompositor::compose(_buffer, tiles);
+
                 _dev->inputYUV((char**)_buffer->get()->data, _buffer->get()->linesize, pts);
                 pts += frameInterval;
             } else {
@@ -381,7 +370,7 @@ void VideoStack::initBgColor() {
     double U = RGB_TO_U(R, G, B);
     double V = RGB_TO_V(R, G, B);
 
-    fill_yuv_func(_buffer, Y, U, V);
+    mediakit::VideoCompositor::fill(_buffer, Y, U, V);
 }
 
 Channel::Ptr VideoStackManager::getChannel(const std::string& id, int width, int height,
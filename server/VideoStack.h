@@ -38,7 +38,6 @@ struct Param {
 
     // runtime
     std::weak_ptr<Channel> weak_chn;
-    std::weak_ptr<mediakit::FFmpegFrame> weak_buf;
 
     ~Param();
 };
@@ -51,17 +50,13 @@ public:
 
     Channel(const std::string& id, int width, int height, AVPixelFormat pixfmt);
 
-    void addParam(const std::weak_ptr<Param>& p);
-
     void onFrame(const mediakit::FFmpegFrame::Ptr& frame);
 
-    void fillBuffer(const Param::Ptr& p);
+    // 获取最新的缩放后画面，所有引用该通道的拼接流共享
+    // Get the latest scaled picture, shared by all the stacks referencing this channel
+    mediakit::FFmpegFrame::Ptr getFrame();
 
 protected:
-    void forEachParam(const std::function<void(const Param::Ptr&)>& func);
-
-    void copyData(const mediakit::FFmpegFrame::Ptr& buf, const Param::Ptr& p);
-
     void resizeFrame(const mediakit::FFmpegFrame::Ptr &frame);
 
     void resizeFrameImplWithAspectRatio(const mediakit::FFmpegFrame::Ptr &frame);
@@ -81,9 +76,11 @@ private:
     int _offsetY;
 
     mediakit::FFmpegFrame::Ptr _tmp;
+    // 等待缩放的最新解码帧，缩放跟不上解码时只处理最新的一帧
+    // The latest decoded frame waiting to be scaled, only the latest one is processed when scaling falls behind decoding
+    mediakit::FFmpegFrame::Ptr _pending;
 
     std::recursive_mutex _mx;
-    std::vector<std::weak_ptr<Param>> _params;
 
     mediakit::FFmpegSws::Ptr _sws;
     toolkit::EventPoller::Ptr _poller;
@@ -151,6 +148,10 @@ private:
 
     mediakit::DevChannel::Ptr _dev;
 
+    // 保护_params与_buffer，切换布局与合成画面互斥
+    // Protects _params and _buffer, switching the layout and compositing are mutually exclusive
+    std::mutex _mtx;
+
     bool _isExit;
 
     std::thread _thread;
@@ -22,6 +22,7 @@
 #include <functional>
 #include <unordered_map>
 #include <regex>
+#include <algorithm>
 #include "Util/MD5.h"
 #include "Util/util.h"
 #include "Util/File.h"
@@ -48,6 +49,7 @@
 #include "Pusher/PusherProxy.h"
 #include "Rtp/RtpProcess.h"
 #include "Record/MP4Reader.h"
+#include "Record/RecordIndex.h"
 
 #if defined(ENABLE_RTPPROXY)
 #include "Rtp/RtpServer.h"
@@ -63,6 +65,11 @@
 #include "../webrtc/WebRtcProxyPlayerImp.h"
 #endif
 
+#if defined(ENABLE_SRT)
+#include "../srt/SrtTransport.hpp"
+#include "../srt/SrtCaller.h"
+#endif
+
 #if defined(ENABLE_VERSION)
 #include "ZLMVersion.h"
 #endif
@@ -71,6 +78,14 @@
 #include "VideoStack.h"
 #endif
 
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+#include "AbrTranscoder.h"
+#endif
+
+#if defined(ENABLE_FFMPEG)
+#include "Codec/Transcode.h"
+#endif
+
 using namespace std;
 using namespace Json;
 using namespace toolkit;
@@ -114,6 +129,35 @@ static void responseApi(int code, const string &msg, const HttpSession::HttpResp
 
 static ApiArgsType getAllArgs(const Parser &parser);
 
+// 大列表使用无缩进的json，序列化更快且体积更小
+// Large lists use json without indentation, which serializes faster and is smaller
+static string toCompactString(const Json::Value &val) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, val);
+}
+
+// 列表类接口按key排序后分页，count为0时返回全部，cursor为上一页返回的next_cursor
+// List apis are sorted by key and paged, all items are returned if count is 0, cursor is the next_cursor returned by the previous page
+template <typename T>
+static void pageList(vector<pair<string, T>> &items, const ArgsMap &allArgs, Json::Value &val) {
+    auto count = allArgs["count"].as<size_t>();
+    auto cursor = allArgs["cursor"];
+    val["total"] = (Json::UInt64)items.size();
+    std::sort(items.begin(), items.end(), [](const pair<string, T> &a, const pair<string, T> &b) { return a.first < b.first; });
+    auto begin = items.begin();
+    if (!cursor.empty()) {
+        begin = std::upper_bound(items.begin(), items.end(), (string)cursor, [](const string &key, const pair<string, T> &item) { return key < item.first; });
+    }
+    auto end = items.end();
+    if (count && (size_t)(end - begin) > count) {
+        end = begin + count;
+        val["next_cursor"] = (end - 1)->first;
+    }
+    items.erase(end, items.end());
+    items.erase(items.begin(), begin);
+}
+
 static HttpApi toApi(const function<void(API_ARGS_MAP_ASYNC)> &cb) {
     return [cb](const Parser &parser, const HttpSession::HttpResponseInvoker &invoker, SockInfo &sender) {
         GET_CONFIG(string, charSet, Http::kCharSet);
@@ -514,6 +558,27 @@ void getStatisticJson(const function<void(Value &val)> &cb) {
 
     val["RtpPacket"] = (Json::UInt64)(ObjectStatistic<RtpPacket>::count());
     val["RtmpPacket"] = (Json::UInt64)(ObjectStatistic<RtmpPacket>::count());
+    val["HookAuthCache"] = getHookAuthCacheStatistic();
+    val["HookBatch"] = getHookBatchStatistic();
+#if defined(ENABLE_FFMPEG)
+    {
+        // ffmpeg编解码任务线程池与各任务队列的积压、执行与丢弃数
+        // The ffmpeg decode/encode task thread pool and the pending, executed and dropped tasks of each queue
+        auto statistic = TaskManager::getStatistic();
+        auto &transcode = val["TranscodeTask"];
+        transcode["threads"] = (Json::UInt64)statistic.threads;
+        transcode["ready"] = (Json::UInt64)statistic.ready;
+        transcode["queues"] = Json::arrayValue;
+        for (auto &queue : statistic.queues) {
+            Value item;
+            item["name"] = queue.name;
+            item["pending"] = (Json::UInt64)queue.pending;
+            item["executed"] = (Json::UInt64)queue.executed;
+            item["dropped"] = (Json::UInt64)queue.dropped;
+            transcode["queues"].append(std::move(item));
+        }
+    }
+#endif
 #ifdef ENABLE_MEM_DEBUG
     auto bytes = getTotalMemUsage();
     val["totalMemUsage"] = (Json::UInt64) bytes;
@@ -909,27 +974,46 @@ void installWebApi() {
     // Test url1 (get streams with virtual host "__defaultVost__") http://127.0.0.1/index/api/getMediaList?vhost=__defaultVost__
     // 测试url2(获取rtsp类型的流) http://127.0.0.1/index/api/getMediaList?schema=rtsp  [AUTO-TRANSLATED:21c2c15d]
     // Test url2 (get rtsp type streams) http://127.0.0.1/index/api/getMediaList?schema=rtsp
+    // 测试url3(分页获取观看人数不少于1的拉流代理) http://127.0.0.1/index/api/getMediaList?origin_type=4&min_reader=1&count=100&cursor=
+    // Test url3 (page through the pulled streams with at least 1 reader) http://127.0.0.1/index/api/getMediaList?origin_type=4&min_reader=1&count=100&cursor=
     api_regist("/index/api/getMediaList",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
+        int origin_type = allArgs["origin_type"].empty() ? -1 : allArgs["origin_type"].as<int>();
+        int min_reader = allArgs["min_reader"].empty() ? -1 : allArgs["min_reader"].as<int>();
+        int max_reader = allArgs["max_reader"].empty() ? -1 : allArgs["max_reader"].as<int>();
         // 获取所有MediaSource列表  [AUTO-TRANSLATED:7bf16dc2]
         // Get all MediaSource lists
-        std::list<MediaSource::Ptr> lst;
+        vector<pair<string, MediaSource::Ptr>> lst;
         MediaSource::for_each_media([&](const MediaSource::Ptr &media) {
-            lst.emplace_back(media);
+            if (origin_type >= 0 && (int)media->getOriginType() != origin_type) {
+                return;
+            }
+            if (min_reader >= 0 || max_reader >= 0) {
+                auto reader = media->totalReaderCount();
+                if ((min_reader >= 0 && reader < min_reader) || (max_reader >= 0 && reader > max_reader)) {
+                    return;
+                }
+            }
+            lst.emplace_back(media->getSchema() + "/" + media->getMediaTuple().shortUrl(), media);
         }, allArgs["schema"], allArgs["vhost"], allArgs["app"], allArgs["stream"]);
+        pageList(lst, allArgs, val);
 
         if (lst.size() == 1) {
             // 如果是搜索单一流，那么在它的归属线程中执行，用于获取丢包率参数
-            auto front = std::move(lst.front());
+            auto front = std::move(lst.front().second);
             front->getOwnerPoller()->async([=]() mutable {
                 val["data"].append(makeMediaSourceJson(*front));
-                invoker(200, headerOut, val.toStyledString());
+                invoker(200, headerOut, toCompactString(val));
             });
         } else {
-            for (auto &media : lst) {
-                val["data"].append(makeMediaSourceJson(*media));
-            }
-            invoker(200, headerOut, val.toStyledString());
+            // 快照已在锁外获取，生成与序列化json放在后台线程，避免阻塞本线程
+            // The snapshot is taken outside the lock, building and serializing json runs in a background thread to not block this thread
+            WorkThreadPool::Instance().getExecutor()->async([=]() mutable {
+                for (auto &pr : lst) {
+                    val["data"].append(makeMediaSourceJson(*pr.second));
+                }
+                invoker(200, headerOut, toCompactString(val));
+            });
         }
     });
 
@@ -1061,12 +1145,17 @@ void installWebApi() {
     // You can filter by local port and remote ip
     // 测试url(筛选某端口下的tcp会话) http://127.0.0.1/index/api/getAllSession?local_port=1935  [AUTO-TRANSLATED:ef845193]
     // Test url (filter tcp session under a certain port) http://127.0.0.1/index/api/getAllSession?local_port=1935
-    api_regist("/index/api/getAllSession",[](API_ARGS_MAP){
+    // 测试url(分页获取rtmp会话) http://127.0.0.1/index/api/getAllSession?typeid=RtmpSession&count=1000&cursor=
+    // Test url (page through the rtmp sessions) http://127.0.0.1/index/api/getAllSession?typeid=RtmpSession&count=1000&cursor=
+    api_regist("/index/api/getAllSession",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
-        Value jsession;
         uint16_t local_port = allArgs["local_port"].as<uint16_t>();
         string peer_ip = allArgs["peer_ip"];
+        string type_id = allArgs["typeid"];
 
+        // 持有SessionMap锁期间只做筛选与拷贝指针
+        // Only filter and copy the pointers while holding the SessionMap lock
+        vector<pair<string, Session::Ptr>> lst;
         SessionMap::Instance().for_each_session([&](const string &id,const Session::Ptr &session){
             if(local_port != 0 && local_port != session->get_local_port()){
                 return;
@@ -1074,10 +1163,22 @@ void installWebApi() {
             if(!peer_ip.empty() && peer_ip != session->get_peer_ip()){
                 return;
             }
-            fillSockInfo(jsession, session.get());
-            jsession["id"] = id;
-            jsession["typeid"] = toolkit::demangle(typeid(*session).name());
-            val["data"].append(jsession);
+            if (!type_id.empty() && toolkit::demangle(typeid(*session).name()).find(type_id) == string::npos) {
+                return;
+            }
+            lst.emplace_back(id, session);
+        });
+        pageList(lst, allArgs, val);
+
+        WorkThreadPool::Instance().getExecutor()->async([=]() mutable {
+            Value jsession;
+            for (auto &pr : lst) {
+                fillSockInfo(jsession, pr.second.get());
+                jsession["id"] = pr.first;
+                jsession["typeid"] = toolkit::demangle(typeid(*pr.second).name());
+                val["data"].append(jsession);
+            }
+            invoker(200, headerOut, toCompactString(val));
         });
     });
 
@@ -1953,6 +2054,74 @@ void installWebApi() {
         val["data"]["paths"] = paths;
     });
 
+    // 按时间段查询录像文件，基于录像索引，不遍历目录；type=0为hls，1为mp4；start/end为unix时间戳，单位毫秒
+    // hls录像且format=m3u8时直接返回点播m3u8，否则返回文件列表以及第一个文件内的seek位置
+    // Query the record files in a time range based on the record index without scanning directories; type 0 is hls, 1 is mp4;
+    // start/end are unix timestamps in milliseconds; returns a vod m3u8 directly for hls records with format=m3u8,
+    // otherwise returns the file list and the seek position in the first file
+    // http://127.0.0.1/index/api/queryRecord?vhost=__defaultVhost__&app=live&stream=ss&type=1&start=1700000000000&end=1700003600000
+    api_regist("/index/api/queryRecord", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("vhost", "app", "stream", "start", "end");
+        auto type = allArgs["type"].empty() ? Recorder::type_mp4 : (Recorder::type)allArgs["type"].as<int>();
+        if (type != Recorder::type_mp4 && type != Recorder::type_hls) {
+            throw InvalidArgsException("type must be 0(hls) or 1(mp4)");
+        }
+        auto start_ms = allArgs["start"].as<uint64_t>();
+        auto end_ms = allArgs["end"].as<uint64_t>();
+        if (end_ms <= start_ms) {
+            throw InvalidArgsException("end must be greater than start");
+        }
+        auto tuple = MediaTuple{allArgs["vhost"], allArgs["app"], allArgs["stream"], ""};
+        auto folder = Recorder::getRecordPath(type, tuple, allArgs["customized_path"]);
+        if (type == Recorder::type_hls) {
+            folder = folder.substr(0, folder.rfind('/') + 1);
+        }
+        GET_CONFIG(string, record_app_name, Record::kAppName);
+        auto url_prefix = "/" + (type == Recorder::type_mp4 ? record_app_name + "/" : "") + tuple.app + "/" + tuple.stream + "/";
+        auto format = allArgs["format"];
+        // 首次查询可能需要读取或重建索引，放在后台线程执行
+        // The first query may need to load or rebuild the index, run it in a background thread
+        WorkThreadPool::Instance().getExecutor()->async([=]() mutable {
+            auto items = RecordIndex::Instance().query(type, folder, start_ms, end_ms);
+            if (type == Recorder::type_hls && format == "m3u8") {
+                uint64_t max_duration = 0;
+                string body;
+                for (auto &item : items) {
+                    max_duration = std::max(max_duration, item.end_ms - item.start_ms);
+                    body += "#EXTINF:" + to_string((item.end_ms - item.start_ms) / 1000.0) + ",\n" + url_prefix + item.file_name + "\n";
+                }
+                string m3u8 = "#EXTM3U\n#EXT-X-VERSION:4\n#EXT-X-PLAYLIST-TYPE:VOD\n#EXT-X-TARGETDURATION:" + to_string((max_duration + 999) / 1000)
+                    + "\n#EXT-X-MEDIA-SEQUENCE:0\n";
+                if (!items.empty() && end_with(items.front().file_name, ".mp4")) {
+                    m3u8 += "#EXT-X-MAP:URI=\"" + url_prefix + items.front().file_name.substr(0, items.front().file_name.rfind('/') + 1) + "init.mp4\"\n";
+                }
+                m3u8 += body + "#EXT-X-ENDLIST\n";
+                headerOut["Content-Type"] = HttpFileManager::getContentType(".m3u8");
+                invoker(200, headerOut, m3u8);
+                return;
+            }
+
+            Json::Value files(arrayValue);
+            for (auto &item : items) {
+                Json::Value obj;
+                obj["start_ms"] = (Json::UInt64)item.start_ms;
+                obj["end_ms"] = (Json::UInt64)item.end_ms;
+                obj["file_size"] = (Json::UInt64)item.file_size;
+                obj["file_name"] = item.file_name;
+                obj["url"] = url_prefix + item.file_name;
+                files.append(obj);
+            }
+            val["code"] = API::Success;
+            val["data"]["rootPath"] = folder;
+            val["data"]["files"] = files;
+            // 第一个文件内不晚于start的最近关键帧位置
+            // The nearest key frame not later than start in the first file
+            val["data"]["seek_ms"] = items.empty() ? 0 : (Json::UInt64)items.front().getSeekMS(start_ms);
+            invoker(200, headerOut, val.toStyledString());
+        });
+    });
+
     static auto responseSnap = [](const string &snap_path,
                                   const HttpSession::KeyValue &headerIn,
                                   const HttpSession::HttpResponseInvoker &invoker,
@@ -2232,6 +2401,57 @@ void installWebApi() {
     });
 #endif
 
+#if defined(ENABLE_SRT)
+    // 获取srt连接统计信息(发送码率、rtt、重传与丢包等)，socket_id为空时返回全部连接，包括srt拉流代理与推流代理(is_caller为true)
+    // Get srt connection statistics (send rate, rtt, retransmits, drops...), all connections are returned without socket_id,
+    // including srt pull and push proxies (is_caller is true)
+    // 测试url http://127.0.0.1/index/api/getSrtInfo
+    api_regist("/index/api/getSrtInfo", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        auto socket_id = allArgs["socket_id"].as<uint32_t>();
+        std::vector<SRT::SrtTransport::Ptr> transports;
+        SRT::SrtTransportManager::Instance().for_each([&](const SRT::SrtTransport::Ptr &transport) {
+            if (!socket_id || transport->getSocketId() == socket_id) {
+                transports.emplace_back(transport);
+            }
+        });
+        std::vector<SrtCaller::Ptr> callers;
+        SrtCaller::for_each([&](const SrtCaller::Ptr &caller) {
+            if (!socket_id || caller->getSocketId() == socket_id) {
+                callers.emplace_back(caller);
+            }
+        });
+        if (socket_id && transports.empty() && callers.empty()) {
+            throw ApiRetException("can not find the srt connection", API::NotFound);
+        }
+
+        // 每个连接在自己的线程采集，全部完成后回复
+        // Each connection is sampled on its own thread, reply once all of them finished
+        auto infos = std::make_shared<vector<Value>>(transports.size() + callers.size());
+        shared_ptr<void> finished(nullptr, [infos, val, headerOut, invoker](void *) {
+            auto ret = val;
+            ret["data"] = Value(arrayValue);
+            for (auto &info : *infos) {
+                if (!info.isMember("error")) {
+                    ret["data"].append(std::move(info));
+                }
+            }
+            invoker(200, headerOut, ret.toStyledString());
+        });
+        for (size_t i = 0; i < transports.size(); ++i) {
+            transports[i]->getTransportInfo([infos, i, finished](Value info) {
+                (*infos)[i] = std::move(info);
+            });
+        }
+        for (size_t i = 0; i < callers.size(); ++i) {
+            auto index = transports.size() + i;
+            callers[i]->getCallerInfo([infos, index, finished](Value info) {
+                (*infos)[index] = std::move(info);
+            });
+        }
+    });
+#endif
+
 #if defined(ENABLE_VERSION)
     api_regist("/index/api/version",[](API_ARGS_MAP_ASYNC){
         CHECK_SECRET();
@@ -2245,42 +2465,79 @@ void installWebApi() {
 #endif
 
 #if ENABLE_MP4
-    api_regist("/index/api/loadMP4File", [](API_ARGS_MAP) {
-        CHECK_SECRET();
-        CHECK_ARGS("vhost", "app", "stream", "file_path");
-
-        ProtocolOption option;
-        // mp4支持多track  [AUTO-TRANSLATED:b9688762]
-        // mp4 supports multiple tracks
-        option.max_track = 16;
-        // 默认解复用mp4不生成mp4  [AUTO-TRANSLATED:11f2dcee]
-        // By default, demultiplexing mp4 does not generate mp4
-        option.enable_mp4 = false;
-        // 但是如果参数明确指定开启mp4, 那么也允许之  [AUTO-TRANSLATED:b143a9e3]
-        // But if the parameter explicitly specifies to enable mp4, then it is also allowed
-        option.load(allArgs);
-        // 强制无人观看时自动关闭  [AUTO-TRANSLATED:f7c85948]
-        // Force automatic shutdown when no one is watching
-        option.auto_close = true;
-        auto tuple = MediaTuple{allArgs["vhost"], allArgs["app"], allArgs["stream"], ""};
-        auto reader = std::make_shared<MP4Reader>(tuple, allArgs["file_path"], option);
-        // sample_ms设置为0，从配置文件加载；file_repeat可以指定，如果配置文件也指定循环解复用，那么强制开启  [AUTO-TRANSLATED:23e826b4]
-        // sample_ms is set to 0, loaded from the configuration file; file_repeat can be specified, if the configuration file also specifies loop demultiplexing, then force it to be enabled
-        reader->startReadMP4(0, true, allArgs["file_repeat"]);
-        auto seek_ms = allArgs["seek_ms"].as<uint32_t>();
-        auto speed = allArgs["speed"].as<float>();
-        if (seek_ms || speed) {
-            auto p = static_pointer_cast<MediaSourceEvent>(reader);
-            p->getOwnerPoller(MediaSource::NullMediaSource())->async([seek_ms, speed, p]() {
-                if (seek_ms) {
-                    p->seekTo(MediaSource::NullMediaSource(), seek_ms);
+    api_regist("/index/api/loadMP4File", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("vhost", "app", "stream");
+        if (allArgs["file_path"].empty()) {
+            CHECK_ARGS("start", "end");
+        }
+        // 查询录像索引与打开mp4文件都涉及磁盘io，放在后台线程执行
+        // Querying the record index and opening the mp4 files both do disk io, run them in a background thread
+        WorkThreadPool::Instance().getExecutor()->async([=]() mutable {
+            try {
+                auto file_path = allArgs["file_path"];
+                auto seek_ms = allArgs["seek_ms"].as<uint32_t>();
+                if (file_path.empty()) {
+                    // 未指定文件时按时间段从录像索引中查找多个mp4文件连续播放，录像流默认与本流同名
+                    // Without a file, look up the mp4 files of a time range in the record index and play them continuously,
+                    // the recorded stream defaults to the same name as this stream
+                    auto record_app = allArgs["record_app"].empty() ? allArgs["app"] : allArgs["record_app"];
+                    auto record_stream = allArgs["record_stream"].empty() ? allArgs["stream"] : allArgs["record_stream"];
+                    auto folder = Recorder::getRecordPath(Recorder::type_mp4, MediaTuple{allArgs["vhost"], record_app, record_stream, ""}, allArgs["customized_path"]);
+                    auto start_ms = allArgs["start"].as<uint64_t>();
+                    auto items = RecordIndex::Instance().query(Recorder::type_mp4, folder, start_ms, allArgs["end"].as<uint64_t>());
+                    if (items.empty()) {
+                        val["code"] = API::NotFound;
+                        val["msg"] = "can not find any record file in the time range";
+                        invoker(200, headerOut, val.toStyledString());
+                        return;
+                    }
+                    for (auto &item : items) {
+                        file_path += (file_path.empty() ? "" : ";") + folder + item.file_name;
+                    }
+                    if (!seek_ms) {
+                        seek_ms = items.front().getSeekMS(start_ms);
+                    }
                 }
-                if (speed && speed != 1.0) {
-                    p->speed(MediaSource::NullMediaSource(), speed);
+
+                ProtocolOption option;
+                // mp4支持多track  [AUTO-TRANSLATED:b9688762]
+                // mp4 supports multiple tracks
+                option.max_track = 16;
+                // 默认解复用mp4不生成mp4  [AUTO-TRANSLATED:11f2dcee]
+                // By default, demultiplexing mp4 does not generate mp4
+                option.enable_mp4 = false;
+                // 但是如果参数明确指定开启mp4, 那么也允许之  [AUTO-TRANSLATED:b143a9e3]
+                // But if the parameter explicitly specifies to enable mp4, then it is also allowed
+                option.load(allArgs);
+                // 强制无人观看时自动关闭  [AUTO-TRANSLATED:f7c85948]
+                // Force automatic shutdown when no one is watching
+                option.auto_close = true;
+                auto tuple = MediaTuple{allArgs["vhost"], allArgs["app"], allArgs["stream"], ""};
+                auto reader = std::make_shared<MP4Reader>(tuple, file_path, option);
+                // sample_ms设置为0，从配置文件加载；file_repeat可以指定，如果配置文件也指定循环解复用，那么强制开启  [AUTO-TRANSLATED:23e826b4]
+                // sample_ms is set to 0, loaded from the configuration file; file_repeat can be specified, if the configuration file also specifies loop demultiplexing, then force it to be enabled
+                reader->startReadMP4(0, true, allArgs["file_repeat"]);
+                auto speed = allArgs["speed"].as<float>();
+                if (seek_ms || speed) {
+                    auto p = static_pointer_cast<MediaSourceEvent>(reader);
+                    p->getOwnerPoller(MediaSource::NullMediaSource())->async([seek_ms, speed, p]() {
+                        if (seek_ms) {
+                            p->seekTo(MediaSource::NullMediaSource(), seek_ms);
+                        }
+                        if (speed && speed != 1.0) {
+                            p->speed(MediaSource::NullMediaSource(), speed);
+                        }
+                    });
                 }
-            });
-        }
-        val["data"]["duration_ms"] = (Json::UInt64)reader->getDemuxer()->getDurationMS();
+                val["data"]["duration_ms"] = (Json::UInt64)reader->getDemuxer()->getDurationMS();
+                invoker(200, headerOut, val.toStyledString());
+            } catch (std::exception &ex) {
+                val["code"] = API::Exception;
+                val["msg"] = ex.what();
+                invoker(200, headerOut, val.toStyledString());
+            }
+        });
     });
 #endif
 
@@ -2381,6 +2638,30 @@ void installWebApi() {
         invoker(200, headerOut, val.toStyledString());
     });
 #endif
+
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+    // 拉流解码一次，转码成多路分辨率并生成hls主播放列表，音频原样透传到每一路
+    // Pull and decode once, transcode into several resolutions and generate an hls master playlist, the audio is passed through to every rendition
+    // 测试url http://127.0.0.1/index/api/abr/start?vhost=__defaultVhost__&app=live&stream=abr&url=rtsp://127.0.0.1/live/test&renditions=1920x1080@4000,1280x720@2000,854x480@800
+    api_regist("/index/api/abr/start", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("vhost", "app", "stream", "url", "renditions");
+        GET_CONFIG(float, segment_duration, Hls::kSegmentDuration);
+        // 默认关键帧间隔与hls切片时长一致，各路输出切片边界对齐
+        // The key frame interval defaults to the hls segment duration so that segment boundaries of all renditions are aligned
+        uint32_t gop_ms = allArgs["gop_ms"].empty() ? segment_duration * 1000 : allArgs["gop_ms"].as<uint32_t>();
+        auto key = AbrTranscoderManager::Instance().start(MediaTuple(allArgs["vhost"], allArgs["app"], allArgs["stream"]), allArgs["url"], allArgs["renditions"], gop_ms);
+        val["data"]["key"] = key;
+        invoker(200, headerOut, val.toStyledString());
+    });
+
+    api_regist("/index/api/abr/stop", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("key");
+        val["data"]["flag"] = AbrTranscoderManager::Instance().stop(allArgs["key"]);
+        invoker(200, headerOut, val.toStyledString());
+    });
+#endif
 }
 
 void unInstallWebApi(){
@@ -2393,6 +2674,9 @@ void unInstallWebApi(){
 #if defined(ENABLE_VIDEOSTACK) && defined(ENABLE_FFMPEG) && defined(ENABLE_X264)
     VideoStackManager::Instance().clear();
 #endif
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+    AbrTranscoderManager::Instance().clear();
+#endif
 
     NoticeCenter::Instance().delListener(&web_api_tag);
 }
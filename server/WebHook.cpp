@@ -16,7 +16,9 @@
 #include "Common/MediaSource.h"
 #include "Http/HttpSession.h"
 #include "Http/HttpRequester.h"
+#include "Http/HttpClientPool.h"
 #include "Network/Session.h"
+#include "Network/sockutil.h"
 #include "Rtsp/RtspSession.h"
 #include "WebHook.h"
 #include "WebApi.h"
@@ -49,9 +51,16 @@ const string kOnServerExited = HOOK_FIELD "on_server_exited";
 const string kOnServerKeepalive = HOOK_FIELD "on_server_keepalive";
 const string kOnSendRtpStopped = HOOK_FIELD "on_send_rtp_stopped";
 const string kOnRtpServerTimeout = HOOK_FIELD "on_rtp_server_timeout";
+const string kOnPlayerCountChanged = HOOK_FIELD "on_player_count_changed";
 const string kAliveInterval = HOOK_FIELD "alive_interval";
 const string kRetry = HOOK_FIELD "retry";
 const string kRetryDelay = HOOK_FIELD "retry_delay";
+const string kAuthCacheSec = HOOK_FIELD "auth_cache_sec";
+const string kAuthCacheFailSec = HOOK_FIELD "auth_cache_fail_sec";
+const string kAuthCacheSubnet = HOOK_FIELD "auth_cache_subnet";
+const string kBatchIntervalMS = HOOK_FIELD "batch_interval_ms";
+const string kBatchMaxSize = HOOK_FIELD "batch_max_size";
+const string kBatchMaxBacklog = HOOK_FIELD "batch_max_backlog";
 
 static onceToken token([]() {
     mINI::Instance()[kEnable] = false;
@@ -75,9 +84,16 @@ static onceToken token([]() {
     mINI::Instance()[kOnServerKeepalive] = "";
     mINI::Instance()[kOnSendRtpStopped] = "";
     mINI::Instance()[kOnRtpServerTimeout] = "";
+    mINI::Instance()[kOnPlayerCountChanged] = "";
     mINI::Instance()[kAliveInterval] = 30.0;
     mINI::Instance()[kRetry] = 1;
     mINI::Instance()[kRetryDelay] = 3.0;
+    mINI::Instance()[kAuthCacheSec] = 0;
+    mINI::Instance()[kAuthCacheFailSec] = 0;
+    mINI::Instance()[kAuthCacheSubnet] = 24;
+    mINI::Instance()[kBatchIntervalMS] = 0;
+    mINI::Instance()[kBatchMaxSize] = 100;
+    mINI::Instance()[kBatchMaxBacklog] = 10000;
     mINI::Instance()[kStreamChangedSchemas] = "rtsp/rtmp/fmp4/ts/hls/hls.fmp4";
 });
 } // namespace Hook
@@ -178,45 +194,68 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
     const_cast<ArgsType &>(body)["mediaServerId"] = mediaServerId;
     const_cast<ArgsType &>(body)["hook_index"] = (Json::UInt64)(s_hook_index++);
 
-    auto requester = std::make_shared<HttpRequester>();
-    requester->setMethod("POST");
     auto bodyStr = to_string(body);
-    requester->setBody(bodyStr);
-    requester->addHeader("Content-Type", getContentType(body));
     auto vhost = getVhost(body);
-    if (!vhost.empty()) {
-        requester->addHeader("X-VHOST", vhost);
-    }
+    auto key = HttpClientPool::getKey(url);
     Ticker ticker;
-    requester->startRequester(url, [url, func, bodyStr, body, requester, ticker, retry](const SockException &ex, const Parser &res) mutable {
-        onceToken token(nullptr, [&]() mutable { requester.reset(); });
-        parse_http_response(ex, res, [&](const Value &obj, const string &err, bool should_retry) {
-            if (!err.empty()) {
-                // hook失败  [AUTO-TRANSLATED:68231f46]
-                // Hook failed
-                WarnL << "hook " << url << " " << ticker.elapsedTime() << "ms,failed" << err << ":" << bodyStr;
-
-                if (retry-- > 0 && should_retry) {
-                    requester->getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, func, retry] {
-                        do_http_hook(url, body, func, retry);
-                        return 0;
-                    });
-                    // 重试不需要触发回调  [AUTO-TRANSLATED:41917311]
-                    // Retry does not need to trigger callback
-                    return;
-                }
-
-            } else if (ticker.elapsedTime() > 500) {
-                // hook成功，但是hook响应超过500ms，打印警告日志  [AUTO-TRANSLATED:e03557aa]
-                // Hook succeeded, but hook response exceeded 500ms, print warning log
-                DebugL << "hook " << url << " " << ticker.elapsedTime() << "ms,success:" << bodyStr;
-            }
-
+    // 复用到hook服务器的keep-alive连接，避免每次hook都重新握手
+    // Reuse keep-alive connections to the hook server instead of a new handshake for every hook
+    // 排队等待连接的时间同样受hook超时限制，hook服务器无响应时不会无限堆积
+    // The time waiting for a connection is bounded by the hook timeout too, hooks never pile up when the hook server is unresponsive
+    HttpClientPool::Instance().getClient(key, hook_timeoutSec, []() {
+        auto requester = std::make_shared<HttpRequester>();
+        requester->setAllowResendRequest(true);
+        return requester;
+    }, [url, func, bodyStr, body, vhost, key, ticker, retry](const SockException &ex, const HttpClient::Ptr &client) {
+        if (ex) {
+            WarnL << "hook " << url << " " << ticker.elapsedTime() << "ms,failed" << ex.what() << ":" << bodyStr;
             if (func) {
-                func(obj, err);
+                func(Json::nullValue, ex.what());
             }
-        });
-    }, hook_timeoutSec);
+            return;
+        }
+        auto requester = std::static_pointer_cast<HttpRequester>(client);
+        requester->clear();
+        requester->setMethod("POST");
+        requester->setBody(bodyStr);
+        requester->addHeader("Content-Type", getContentType(body));
+        if (!vhost.empty()) {
+            requester->addHeader("X-VHOST", vhost);
+        }
+        requester->startRequester(url, [url, func, bodyStr, body, key, requester, ticker, retry](const SockException &ex, const Parser &res) mutable {
+            onceToken token(nullptr, [&]() mutable {
+                auto reusable = !ex && strcasecmp(res["Connection"].data(), "close") && requester->alive();
+                HttpClientPool::Instance().putClient(key, requester, reusable);
+                requester.reset();
+            });
+            parse_http_response(ex, res, [&](const Value &obj, const string &err, bool should_retry) {
+                if (!err.empty()) {
+                    // hook失败  [AUTO-TRANSLATED:68231f46]
+                    // Hook failed
+                    WarnL << "hook " << url << " " << ticker.elapsedTime() << "ms,failed" << err << ":" << bodyStr;
+
+                    if (retry-- > 0 && should_retry) {
+                        requester->getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, func, retry] {
+                            do_http_hook(url, body, func, retry);
+                            return 0;
+                        });
+                        // 重试不需要触发回调  [AUTO-TRANSLATED:41917311]
+                        // Retry does not need to trigger callback
+                        return;
+                    }
+
+                } else if (ticker.elapsedTime() > 500) {
+                    // hook成功，但是hook响应超过500ms，打印警告日志  [AUTO-TRANSLATED:e03557aa]
+                    // Hook succeeded, but hook response exceeded 500ms, print warning log
+                    DebugL << "hook " << url << " " << ticker.elapsedTime() << "ms,success:" << bodyStr;
+                }
+
+                if (func) {
+                    func(obj, err);
+                }
+            });
+        }, hook_timeoutSec);
+    });
 }
 
 void do_http_hook(const string &url, const ArgsType &body, const function<void(const Value &, const string &)> &func) {
@@ -224,6 +263,397 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
     do_http_hook(url, body, func, hook_retry);
 }
 
+/**
+ * on_play/on_publish鉴权结果缓存，相同流、参数与客户端网段的鉴权在有效期内直接复用结果，
+ * 并发的相同鉴权只发起一次hook
+ * Cache of on_play/on_publish auth decisions, the decision for the same stream, params and client subnet is reused while it is valid,
+ * and concurrent identical auths trigger only one hook
+ */
+class HookAuthCache {
+public:
+    using onResult = function<void(const Value &obj, const string &err)>;
+
+    static HookAuthCache &Instance() {
+        static HookAuthCache instance;
+        return instance;
+    }
+
+    static bool enabled() {
+        GET_CONFIG(float, ok_sec, Hook::kAuthCacheSec);
+        GET_CONFIG(float, fail_sec, Hook::kAuthCacheFailSec);
+        return ok_sec > 0 || fail_sec > 0;
+    }
+
+    static string makeKey(const string &url, const MediaInfo &args, const string &ip) {
+        _StrPrinter printer;
+        printer << url << '\n' << args.schema << '\n' << args.vhost << '\n' << args.app << '\n' << args.stream << '\n' << args.params << '\n' << getSubnet(ip);
+        return std::move(printer);
+    }
+
+    void doHook(const string &url, const string &key, const ArgsType &body, const onResult &cb) {
+        Value obj;
+        string err;
+        bool hit = false;
+        {
+            lock_guard<mutex> lck(_mtx);
+            auto now = getCurrentMillisecond();
+            auto it = _entries.find(key);
+            if (it != _entries.end() && it->second.pending) {
+                // 相同鉴权正在进行，等待其结果
+                // An identical auth is in progress, wait for its result
+                ++_coalesced;
+                it->second.waiters.emplace_back(cb);
+                return;
+            }
+            if (it != _entries.end() && now < it->second.expire_ms) {
+                ++_hit;
+                hit = true;
+                obj = it->second.obj;
+                err = it->second.err;
+            } else {
+                ++_miss;
+                sweep_l(now);
+                auto &entry = _entries[key];
+                entry.pending = true;
+                entry.waiters.emplace_back(cb);
+            }
+        }
+        if (hit) {
+            cb(obj, err);
+            return;
+        }
+        do_http_hook(url, body, [key](const Value &obj, const string &err) { Instance().onHookResult(key, obj, err); });
+    }
+
+    Value getStatistic() {
+        Value ret;
+        lock_guard<mutex> lck(_mtx);
+        ret["hit"] = (Json::UInt64)_hit;
+        ret["miss"] = (Json::UInt64)_miss;
+        ret["coalesced"] = (Json::UInt64)_coalesced;
+        ret["size"] = (Json::UInt64)_entries.size();
+        return ret;
+    }
+
+private:
+    struct Entry {
+        bool pending = false;
+        uint64_t expire_ms = 0;
+        Value obj;
+        string err;
+        vector<onResult> waiters;
+    };
+
+    void onHookResult(const string &key, const Value &obj, const string &err) {
+        GET_CONFIG(float, ok_sec, Hook::kAuthCacheSec);
+        GET_CONFIG(float, fail_sec, Hook::kAuthCacheFailSec);
+        vector<onResult> waiters;
+        {
+            lock_guard<mutex> lck(_mtx);
+            auto it = _entries.find(key);
+            if (it == _entries.end()) {
+                return;
+            }
+            waiters.swap(it->second.waiters);
+            // 只缓存鉴权通过与明确拒绝，网络错误等临时失败不缓存
+            // Only cache the granted and explicitly denied decisions, transient failures such as network errors are not cached
+            auto ttl = err.empty() ? ok_sec : (err.find("[auth failed]") == 0 ? fail_sec : 0);
+            if (ttl > 0) {
+                it->second.pending = false;
+                it->second.expire_ms = getCurrentMillisecond() + ttl * 1000;
+                it->second.obj = obj;
+                it->second.err = err;
+            } else {
+                _entries.erase(it);
+            }
+        }
+        for (auto &cb : waiters) {
+            try {
+                cb(obj, err);
+            } catch (std::exception &ex) {
+                WarnL << "hook auth invoker failed: " << ex.what();
+            }
+        }
+    }
+
+    // 清理过期的鉴权结果，最多每秒一次
+    // Remove the expired decisions, at most once per second
+    void sweep_l(uint64_t now) {
+        if (now - _last_sweep < 1000) {
+            return;
+        }
+        _last_sweep = now;
+        for (auto it = _entries.begin(); it != _entries.end();) {
+            if (!it->second.pending && now >= it->second.expire_ms) {
+                it = _entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // ipv4按配置的前缀长度取网段，ipv6取/64
+    // The subnet of an ipv4 address uses the configured prefix length, ipv6 uses /64
+    static string getSubnet(const string &ip) {
+        GET_CONFIG(int, prefix, Hook::kAuthCacheSubnet);
+        if (SockUtil::is_ipv4(ip.data())) {
+            in_addr addr;
+            if (inet_pton(AF_INET, ip.data(), &addr) != 1) {
+                return ip;
+            }
+            auto bits = MAX(0, MIN(32, prefix));
+            auto mask = bits ? htonl(0xFFFFFFFF << (32 - bits)) : 0;
+            addr.s_addr &= mask;
+            char buf[INET_ADDRSTRLEN] = { 0 };
+            inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+            return string(buf) + "/" + to_string(bits);
+        }
+        in6_addr addr;
+        if (inet_pton(AF_INET6, ip.data(), &addr) != 1) {
+            return ip;
+        }
+        memset((uint8_t *)&addr + 8, 0, 8);
+        char buf[INET6_ADDRSTRLEN] = { 0 };
+        inet_ntop(AF_INET6, &addr, buf, sizeof(buf));
+        return string(buf) + "/64";
+    }
+
+private:
+    mutex _mtx;
+    uint64_t _last_sweep = 0;
+    uint64_t _hit = 0;
+    uint64_t _miss = 0;
+    uint64_t _coalesced = 0;
+    unordered_map<string, Entry> _entries;
+};
+
+Value getHookAuthCacheStatistic() {
+    return HookAuthCache::Instance().getStatistic();
+}
+
+/**
+ * 批量hook，on_flow_report与on_player_count_changed事件先缓存在各poller的队列中，
+ * 每batch_interval_ms或积攒batch_max_size个事件后合并为一个json数组发送；
+ * 发送失败的事件重新入队(至少一次送达)，积压超过batch_max_backlog时丢弃最旧的事件
+ * Batched hooks, on_flow_report and on_player_count_changed events are buffered in a queue per poller and
+ * sent as one json array every batch_interval_ms or once batch_max_size events are buffered;
+ * events of a failed post are queued again (at least once delivery), the oldest ones are dropped once the backlog exceeds batch_max_backlog
+ */
+class HookBatcher {
+public:
+    static HookBatcher &Instance() {
+        static HookBatcher instance;
+        return instance;
+    }
+
+    static bool enabled() {
+        GET_CONFIG(uint32_t, interval_ms, Hook::kBatchIntervalMS);
+        return interval_ms > 0;
+    }
+
+    /**
+     * 加入一个事件
+     * @param key 不为空时，同一url下相同key的未发送事件只保留最新的一个
+     * Add an event
+     * @param key If not empty, only the latest one of the unsent events with the same key under the url is kept
+     */
+    void add(const string &url, Value event, const string &key = "") {
+        auto poller = EventPoller::getCurrentPoller();
+        if (!poller) {
+            poller = EventPollerPool::Instance().getPoller();
+        }
+        auto batch = getBatch(poller);
+        bool flush_now;
+        {
+            lock_guard<mutex> lck(batch->mtx);
+            auto &queue = batch->queues[url];
+            push_l(queue, key, std::move(event), false);
+            GET_CONFIG(uint32_t, max_size, Hook::kBatchMaxSize);
+            flush_now = queue.events.size() >= MAX(max_size, 1u);
+        }
+        if (flush_now) {
+            flush(batch);
+        } else {
+            schedule(batch);
+        }
+    }
+
+    Value getStatistic() {
+        Value ret;
+        size_t backlog = 0;
+        {
+            lock_guard<mutex> lck(_mtx);
+            for (auto &pr : _batches) {
+                lock_guard<mutex> batch_lck(pr.second->mtx);
+                for (auto &queue : pr.second->queues) {
+                    backlog += queue.second.events.size();
+                }
+            }
+        }
+        ret["backlog"] = (Json::UInt64)backlog;
+        ret["sent"] = (Json::UInt64)_sent;
+        ret["batches"] = (Json::UInt64)_batches_sent;
+        ret["failed"] = (Json::UInt64)_failed;
+        ret["retried"] = (Json::UInt64)_retried;
+        ret["dropped"] = (Json::UInt64)_dropped;
+        return ret;
+    }
+
+private:
+    using EventList = list<pair<string, Value>>;
+
+    struct Queue {
+        EventList events;
+        unordered_map<string, EventList::iterator> index;
+    };
+
+    struct Batch {
+        using Ptr = std::shared_ptr<Batch>;
+        mutex mtx;
+        bool scheduled = false;
+        EventPoller::Ptr poller;
+        unordered_map<string, Queue> queues;
+    };
+
+    Batch::Ptr getBatch(const EventPoller::Ptr &poller) {
+        lock_guard<mutex> lck(_mtx);
+        auto &batch = _batches[poller.get()];
+        if (!batch) {
+            batch = std::make_shared<Batch>();
+            batch->poller = poller;
+        }
+        return batch;
+    }
+
+    // 入队，front为true时放到队首(重发)，此时若已有相同key的更新事件则丢弃旧事件
+    // Push an event, to the front if front is true (resending), in which case an old event is discarded if a newer one with the same key exists
+    void push_l(Queue &queue, const string &key, Value event, bool front) {
+        GET_CONFIG(uint32_t, max_backlog, Hook::kBatchMaxBacklog);
+        if (!key.empty()) {
+            auto it = queue.index.find(key);
+            if (it != queue.index.end()) {
+                if (!front) {
+                    it->second->second = std::move(event);
+                }
+                return;
+            }
+        }
+        auto it = queue.events.emplace(front ? queue.events.begin() : queue.events.end(), key, std::move(event));
+        if (!key.empty()) {
+            queue.index.emplace(key, it);
+        }
+        while (max_backlog && queue.events.size() > max_backlog) {
+            // 积压过多，丢弃最旧的事件
+            // Too many events are backlogged, drop the oldest one
+            if (!queue.events.front().first.empty()) {
+                queue.index.erase(queue.events.front().first);
+            }
+            queue.events.pop_front();
+            ++_dropped;
+        }
+    }
+
+    void schedule(const Batch::Ptr &batch) {
+        GET_CONFIG(uint32_t, interval_ms, Hook::kBatchIntervalMS);
+        {
+            lock_guard<mutex> lck(batch->mtx);
+            if (batch->scheduled) {
+                return;
+            }
+            batch->scheduled = true;
+        }
+        std::weak_ptr<Batch> weak_batch = batch;
+        batch->poller->doDelayTask(MAX(interval_ms, 1u), [weak_batch]() {
+            if (auto batch = weak_batch.lock()) {
+                {
+                    lock_guard<mutex> lck(batch->mtx);
+                    batch->scheduled = false;
+                }
+                Instance().flush(batch);
+            }
+            return 0;
+        });
+    }
+
+    void flush(const Batch::Ptr &batch) {
+        GET_CONFIG(uint32_t, max_size, Hook::kBatchMaxSize);
+        bool remain = false;
+        list<pair<string, std::shared_ptr<EventList>>> posts;
+        {
+            lock_guard<mutex> lck(batch->mtx);
+            for (auto &pr : batch->queues) {
+                auto &queue = pr.second;
+                if (queue.events.empty()) {
+                    continue;
+                }
+                auto events = std::make_shared<EventList>();
+                auto end = queue.events.begin();
+                for (size_t i = 0; i < MAX(max_size, 1u) && end != queue.events.end(); ++i) {
+                    if (!end->first.empty()) {
+                        queue.index.erase(end->first);
+                    }
+                    ++end;
+                }
+                events->splice(events->end(), queue.events, queue.events.begin(), end);
+                remain = remain || !queue.events.empty();
+                posts.emplace_back(pr.first, std::move(events));
+            }
+        }
+        for (auto &post : posts) {
+            send(batch, post.first, post.second);
+        }
+        if (remain) {
+            schedule(batch);
+        }
+    }
+
+    void send(const Batch::Ptr &batch, const string &url, const std::shared_ptr<EventList> &events) {
+        ArgsType body;
+        auto &arr = body["events"] = Value(arrayValue);
+        for (auto &pr : *events) {
+            arr.append(pr.second);
+        }
+        std::weak_ptr<Batch> weak_batch = batch;
+        do_http_hook(url, body, [weak_batch, url, events](const Value &obj, const string &err) {
+            auto &self = Instance();
+            // 服务器明确回复了非0的code视为已送达，只有网络错误等情况重发
+            // An explicit non-zero code from the server counts as delivered, only failures such as network errors are resent
+            if (err.empty() || err.find("[auth failed]") == 0) {
+                self._sent += events->size();
+                ++self._batches_sent;
+                return;
+            }
+            ++self._failed;
+            auto batch = weak_batch.lock();
+            if (!batch) {
+                return;
+            }
+            {
+                lock_guard<mutex> lck(batch->mtx);
+                auto &queue = batch->queues[url];
+                for (auto it = events->rbegin(); it != events->rend(); ++it) {
+                    self.push_l(queue, it->first, std::move(it->second), true);
+                }
+            }
+            self._retried += events->size();
+            self.schedule(batch);
+        });
+    }
+
+private:
+    mutex _mtx;
+    unordered_map<EventPoller *, Batch::Ptr> _batches;
+    atomic<uint64_t> _sent { 0 };
+    atomic<uint64_t> _batches_sent { 0 };
+    atomic<uint64_t> _failed { 0 };
+    atomic<uint64_t> _retried { 0 };
+    atomic<uint64_t> _dropped { 0 };
+};
+
+Value getHookBatchStatistic() {
+    return HookBatcher::Instance().getStatistic();
+}
+
 void dumpMediaTuple(const MediaTuple &tuple, Json::Value& item);
 
 static ArgsType make_json(const MediaInfo &args) {
@@ -371,9 +801,7 @@ void installWebHook() {
         body["id"] = sender.getIdentifier();
         body["originType"] = (int)type;
         body["originTypeStr"] = getOriginTypeString(type);
-        // 执行hook  [AUTO-TRANSLATED:1df68201]
-        // Execute hook
-        do_http_hook(hook_publish, body, [invoker](const Value &obj, const string &err) mutable {
+        auto on_result = [invoker](const Value &obj, const string &err) mutable {
             if (err.empty()) {
                 // 推流鉴权成功  [AUTO-TRANSLATED:e4285dab]
                 // Push stream authentication succeeded
@@ -383,7 +811,15 @@ void installWebHook() {
                 // Push stream authentication failed
                 invoker(err, ProtocolOption());
             }
-        });
+        };
+        if (HookAuthCache::enabled()) {
+            auto key = HookAuthCache::makeKey(hook_publish, args, sender.get_peer_ip()) + '\n' + to_string((int)type);
+            HookAuthCache::Instance().doHook(hook_publish, key, body, on_result);
+            return;
+        }
+        // 执行hook  [AUTO-TRANSLATED:1df68201]
+        // Execute hook
+        do_http_hook(hook_publish, body, on_result);
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastMediaPlayed, [](BroadcastMediaPlayedArgs) {
@@ -396,9 +832,14 @@ void installWebHook() {
         body["ip"] = sender.get_peer_ip();
         body["port"] = sender.get_peer_port();
         body["id"] = sender.getIdentifier();
+        auto on_result = [invoker](const Value &obj, const string &err) { invoker(err); };
+        if (HookAuthCache::enabled()) {
+            HookAuthCache::Instance().doHook(hook_play, HookAuthCache::makeKey(hook_play, args, sender.get_peer_ip()), body, on_result);
+            return;
+        }
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
-        do_http_hook(hook_play, body, [invoker](const Value &obj, const string &err) { invoker(err); });
+        do_http_hook(hook_play, body, on_result);
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastFlowReport, [](BroadcastFlowReportArgs) {
@@ -413,11 +854,35 @@ void installWebHook() {
         body["ip"] = sender.get_peer_ip();
         body["port"] = sender.get_peer_port();
         body["id"] = sender.getIdentifier();
+        if (HookBatcher::enabled()) {
+            HookBatcher::Instance().add(hook_flowreport, std::move(body));
+            return;
+        }
         // 执行hook  [AUTO-TRANSLATED:1df68201]
         // Execute hook
         do_http_hook(hook_flowreport, body, nullptr);
     });
 
+    // 需要开启general.broadcast_player_count_changed
+    // general.broadcast_player_count_changed must be enabled
+    NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastPlayerCountChanged, [](BroadcastPlayerCountChangedArgs) {
+        GET_CONFIG(string, hook_player_count, Hook::kOnPlayerCountChanged);
+        if (!hook_enable || hook_player_count.empty()) {
+            return;
+        }
+        ArgsType body;
+        dumpMediaTuple(args, body);
+        body["count"] = count;
+        if (HookBatcher::enabled()) {
+            // 同一个流在一个批次内只上报最新的观看人数
+            // Only the latest player count of a stream is reported within a batch
+            auto key = args.shortUrl();
+            HookBatcher::Instance().add(hook_player_count, std::move(body), key);
+            return;
+        }
+        do_http_hook(hook_player_count, body, nullptr);
+    });
+
     static const string unAuthedRealm = "unAuthedRealm";
 
     // 监听kBroadcastOnGetRtspRealm事件决定rtsp链接是否需要鉴权(传统的rtsp鉴权方案)才能访问  [AUTO-TRANSLATED:00dc9fa3]
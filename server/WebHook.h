@@ -48,4 +48,16 @@ void onProcessExited();
  * [AUTO-TRANSLATED:8ffdd09b]
  */
 void do_http_hook(const std::string &url, const ArgsType &body, const std::function<void(const Json::Value &, const std::string &)> &func = nullptr);
+
+/**
+ * 获取on_play/on_publish鉴权缓存的命中、未命中、合并请求次数与缓存条数
+ * Get the hits, misses, coalesced requests and entries of the on_play/on_publish auth cache
+ */
+Json::Value getHookAuthCacheStatistic();
+
+/**
+ * 获取批量hook的积压、已送达、失败、重发与丢弃的事件数
+ * Get the backlogged, delivered, failed, resent and dropped events of the batched hooks
+ */
+Json::Value getHookBatchStatistic();
 #endif //ZLMEDIAKIT_WEBHOOK_H
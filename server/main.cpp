@@ -19,11 +19,13 @@
 #include "Network/UdpServer.h"
 #include "Poller/EventPoller.h"
 #include "Common/config.h"
+#include "Common/TlsContext.h"
 #include "Rtsp/RtspSession.h"
 #include "Rtmp/RtmpSession.h"
 #include "Shell/ShellSession.h"
 #include "Http/WebSocketSession.h"
 #include "Rtp/RtpServer.h"
+#include "Record/RecordIndex.h"
 #include "WebApi.h"
 #include "WebHook.h"
 
@@ -289,7 +291,7 @@ int start_main(int argc,char *argv[]) {
             // 不是文件夹，加载证书，证书包含公钥和私钥  [AUTO-TRANSLATED:5d3a5e49]
             // Not a folder, load certificate, certificate contains public key and private key
             g_reload_certificates = [ssl_file] () {
-                SSL_Initor::Instance().loadCertificate(ssl_file.data());
+                TlsContext::loadCertificate(ssl_file);
             };
         } else {
             // 加载文件夹下的所有证书  [AUTO-TRANSLATED:0e1f9b20]
@@ -299,7 +301,7 @@ int start_main(int argc,char *argv[]) {
                     if (!isDir) {
                         // 最后的一个证书会当做默认证书(客户端ssl握手时未指定主机)  [AUTO-TRANSLATED:b242685c]
                         // The last certificate will be used as the default certificate (client ssl handshake does not specify the host)
-                        SSL_Initor::Instance().loadCertificate(path.data());
+                        TlsContext::loadCertificate(path);
                     }
                     return true;
                 });
@@ -358,6 +360,16 @@ int start_main(int argc,char *argv[]) {
         // webrtc udp服务器  [AUTO-TRANSLATED:157a64e5]
         // webrtc udp server
         auto rtcSrv_udp = std::make_shared<UdpServer>();
+        // UdpServer在每个poller上各有一个监听socket(同一SO_REUSEPORT组)，内核默认按四元组hash选择，同一对端总落在同一个socket；
+        // 首个binding request按ufrag找到transport后，该对端的已连接socket直接创建在transport所在poller上，此后STUN/DTLS/SRTP不再跨线程。
+        // 这里不挂载reuseport BPF：cBPF只能看到udp负载(五元组只能拿到与内核默认相同的流hash)，DTLS/SRTP负载中也没有能对应到transport poller的字段，
+        // 能对应的只有STUN USERNAME，而它的偏移不固定，且只出现在已由上述流程处理的首包中
+        // UdpServer has one listening socket per poller (one SO_REUSEPORT group) and the kernel's default 4-tuple hash keeps a peer on one socket;
+        // once the first binding request finds its transport by ufrag, the peer's connected socket is created on the transport's poller,
+        // after which STUN/DTLS/SRTP never cross threads.
+        // No reuseport BPF is attached: cBPF only sees the udp payload (for the 5-tuple it only gets the same flow hash the kernel already uses),
+        // and no DTLS/SRTP payload field maps to the transport's poller; only the STUN USERNAME does, at no fixed offset,
+        // and only in the first packets, which the path above already handles
         rtcSrv_udp->setOnCreateSocket([](const EventPoller::Ptr &poller, const Buffer::Ptr &buf, struct sockaddr *, int) {
             if (!buf) {
                 return Socket::createSocket(poller, false);
@@ -407,6 +419,13 @@ int start_main(int argc,char *argv[]) {
         installWebHook();
         InfoL << "已启动http hook 接口";
 
+        if (mINI::Instance()[Record::kEnableIndex].as<bool>()) {
+            // 在后台为没有索引的录像目录重建录像索引
+            // Rebuild the record index of the record folders without one in background threads
+            RecordIndex::Instance().rebuildAll(Recorder::type_mp4, File::absolutePath("", mINI::Instance()[Protocol::kMP4SavePath]));
+            RecordIndex::Instance().rebuildAll(Recorder::type_hls, File::absolutePath("", mINI::Instance()[Protocol::kHlsSavePath]));
+        }
+
         try {
             // rtsp服务器，端口默认554  [AUTO-TRANSLATED:07937d81]
             // rtsp server, default port 554
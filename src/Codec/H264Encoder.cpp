@@ -382,7 +382,7 @@ Value的值就是fps。
  * [AUTO-TRANSLATED:b730fe72]
 } x264_param_t;*/
 
-bool H264Encoder::init(int iWidth, int iHeight, int iFps, int iBitRate) {
+bool H264Encoder::init(int iWidth, int iHeight, int iFps, int iBitRate, bool bExternalKey) {
     if (_pX264Handle) {
         return true;
     }
@@ -484,6 +484,14 @@ bool H264Encoder::init(int iWidth, int iHeight, int iFps, int iBitRate) {
     pX264Param->b_annexb = 1; //1前面为0x00000001,0为nal长度
     pX264Param->b_repeat_headers = 1; //关键帧前面是否放sps跟pps帧，0 否 1，放
 
+    if (bExternalKey) {
+        // 关键帧由调用者决定，不按gop与场景切换插入
+        // Key frames are decided by the caller, not inserted by gop or scene cut
+        pX264Param->i_keyint_max = X264_KEYINT_MAX_INFINITE;
+        pX264Param->i_keyint_min = 1;
+        pX264Param->i_scenecut_threshold = 0;
+    }
+
     // * 设置Profile.使用baseline  [AUTO-TRANSLATED:c451b8a5]
     // * Set Profile. Use baseline
     x264_param_apply_profile(pX264Param, "high");
@@ -505,7 +513,7 @@ bool H264Encoder::init(int iWidth, int iHeight, int iFps, int iBitRate) {
     return true;
 }
 
-int H264Encoder::inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame **out_frame) {
+int H264Encoder::inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame **out_frame, bool key_frame) {
     //TimeTicker1(5);
     _pPicIn->img.i_stride[0] = linesize[0];
     _pPicIn->img.i_stride[1] = linesize[1];
@@ -514,6 +522,7 @@ int H264Encoder::inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame
     _pPicIn->img.plane[1] = (uint8_t *) yuv[1];
     _pPicIn->img.plane[2] = (uint8_t *) yuv[2];
     _pPicIn->i_pts = cts;
+    _pPicIn->i_type = key_frame ? X264_TYPE_IDR : X264_TYPE_AUTO;
     int iNal;
     x264_nal_t *pNals;
 
@@ -35,8 +35,23 @@ public:
     H264Encoder();
     ~H264Encoder();
 
-    bool init(int iWidth, int iHeight, int iFps, int iBitRate);
-    int inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame **out_frame);
+    /**
+     * 初始化编码器
+     * @param bExternalKey 为true时关闭按gop与场景切换自动插入关键帧，关键帧完全由inputData的key_frame参数决定，
+     *                     用于多路编码输出间的关键帧对齐
+     * Initialize the encoder
+     * @param bExternalKey If true, automatic key frames by gop and scene cut are disabled and key frames are decided
+     *                     by the key_frame argument of inputData only, used to align key frames among several encoders
+     */
+    bool init(int iWidth, int iHeight, int iFps, int iBitRate, bool bExternalKey = false);
+
+    /**
+     * 编码一帧yuv420p
+     * @param key_frame 是否强制编码为IDR帧
+     * Encode a yuv420p frame
+     * @param key_frame Whether to force an IDR frame
+     */
+    int inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame **out_frame, bool key_frame = false);
 
 private:
     x264_t *_pX264Handle = nullptr;
@@ -12,6 +12,10 @@
 #if !defined(_WIN32)
 #include <dlfcn.h>
 #endif
+#include <list>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 #include "Util/File.h"
 #include "Util/uv_errno.h"
 #include "Transcode.h"
@@ -108,38 +112,246 @@ static bool checkIfSupportedNvidia() {
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
+struct TaskManager::Queue {
+    std::string name;
+    std::mutex mtx;
+    std::condition_variable cond;
+    toolkit::List<std::function<void()> > tasks;
+    bool decode_drop_start = false;
+    // 已在运行队列中或正在被工作线程处理
+    // In the run queue or being processed by a worker thread
+    bool scheduled = false;
+    // 正在执行任务
+    // A task is running
+    bool running = false;
+    std::atomic<bool> exit { false };
+    uint64_t executed = 0;
+    uint64_t dropped = 0;
+};
+
+// 当前线程正在执行的队列
+// The queue whose task is running in the current thread
+static thread_local TaskManager::Queue *s_current_queue = nullptr;
+
+class TaskScheduler {
+public:
+    // 每次调度最多连续执行的任务数，之后让出给其他队列，保证公平
+    // The maximum number of tasks run in a row per schedule, then the worker yields to other queues for fairness
+    static constexpr size_t kMaxBatch = 8;
+
+    static TaskScheduler &Instance() {
+        static TaskScheduler instance;
+        return instance;
+    }
+
+    ~TaskScheduler() {
+        {
+            lock_guard<mutex> lck(_mtx);
+            _exit = true;
+        }
+        _cond.notify_all();
+        for (auto &thread : _threads) {
+            thread.join();
+        }
+    }
+
+    void add(const std::shared_ptr<TaskManager::Queue> &queue) {
+        lock_guard<mutex> lck(_mtx);
+        for (auto it = _queues.begin(); it != _queues.end();) {
+            if (it->expired()) {
+                it = _queues.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        _queues.emplace_back(queue);
+    }
+
+    void post(std::shared_ptr<TaskManager::Queue> queue) {
+        {
+            lock_guard<mutex> lck(_mtx);
+            _ready.emplace_back(std::move(queue));
+        }
+        _cond.notify_one();
+    }
+
+    TaskManager::Statistic getStatistic() {
+        TaskManager::Statistic ret;
+        std::vector<std::shared_ptr<TaskManager::Queue> > queues;
+        {
+            lock_guard<mutex> lck(_mtx);
+            ret.threads = _threads.size();
+            ret.ready = _ready.size();
+            for (auto &weak_queue : _queues) {
+                if (auto queue = weak_queue.lock()) {
+                    queues.emplace_back(std::move(queue));
+                }
+            }
+        }
+        for (auto &queue : queues) {
+            lock_guard<mutex> lck(queue->mtx);
+            if (queue->exit) {
+                continue;
+            }
+            TaskManager::QueueStatistic item;
+            item.name = queue->name;
+            item.pending = queue->tasks.size();
+            item.executed = queue->executed;
+            item.dropped = queue->dropped;
+            ret.queues.emplace_back(std::move(item));
+        }
+        return ret;
+    }
+
+    static void runTask(TaskManager::Queue &queue, const std::function<void()> &task) {
+        s_current_queue = &queue;
+        try {
+            TimeTicker2(50, TraceL);
+            task();
+        } catch (std::exception &ex) {
+            WarnL << queue.name << ": " << ex.what();
+        } catch (...) {
+            // 未知异常(例如线程取消)不能吞掉，与原先每队列一个线程时的行为一致
+            // Unknown exceptions (such as thread cancellation) must not be swallowed, the same as when each queue had its own thread
+            WarnL << queue.name << ": catch one unknown exception";
+            s_current_queue = nullptr;
+            throw;
+        }
+        s_current_queue = nullptr;
+    }
+
+private:
+    TaskScheduler() {
+        GET_CONFIG(size_t, thread_num, General::kTranscodeThreadNum);
+        auto size = thread_num ? thread_num : std::thread::hardware_concurrency();
+        size = MAX(size, (size_t)1);
+        for (size_t i = 0; i < size; ++i) {
+            _threads.emplace_back([this, i]() { onThreadRun(i); });
+        }
+        InfoL << "transcode task thread pool size: " << size;
+    }
+
+    void onThreadRun(size_t index) {
+        setThreadName(("transcode " + to_string(index)).data());
+        for (;;) {
+            std::shared_ptr<TaskManager::Queue> queue;
+            {
+                unique_lock<mutex> lck(_mtx);
+                _cond.wait(lck, [&]() { return _exit || !_ready.empty(); });
+                if (_exit) {
+                    break;
+                }
+                queue = std::move(_ready.front());
+                _ready.pop_front();
+            }
+            if (runQueue(*queue)) {
+                // 还有任务，排到运行队列末尾
+                // There are tasks left, append to the end of the run queue
+                post(std::move(queue));
+            }
+        }
+    }
+
+    // 返回true表示需要重新调度
+    // Returns true if the queue needs to be scheduled again
+    bool runQueue(TaskManager::Queue &queue) {
+        for (size_t i = 0;; ++i) {
+            std::function<void()> task;
+            {
+                lock_guard<mutex> lck(queue.mtx);
+                if (queue.exit || queue.running || queue.tasks.empty()) {
+                    // 已停止、正被停止线程执行或没有任务
+                    // Stopped, being drained by the stopping thread or no tasks
+                    queue.scheduled = false;
+                    return false;
+                }
+                if (i == kMaxBatch) {
+                    return true;
+                }
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queue.running = true;
+            }
+            runTask(queue, task);
+            task = nullptr;
+            {
+                lock_guard<mutex> lck(queue.mtx);
+                queue.running = false;
+                ++queue.executed;
+            }
+            queue.cond.notify_all();
+        }
+    }
+
+private:
+    bool _exit = false;
+    std::mutex _mtx;
+    std::condition_variable _cond;
+    std::list<std::shared_ptr<TaskManager::Queue> > _ready;
+    std::list<std::weak_ptr<TaskManager::Queue> > _queues;
+    std::vector<std::thread> _threads;
+};
+
+TaskManager::Statistic TaskManager::getStatistic() {
+    return TaskScheduler::Instance().getStatistic();
+}
+
 bool TaskManager::addEncodeTask(function<void()> task) {
+    auto queue = _queue;
+    if (!queue) {
+        return false;
+    }
     {
-        lock_guard<mutex> lck(_task_mtx);
-        _task.emplace_back(std::move(task));
-        if (_task.size() > _max_task) {
+        lock_guard<mutex> lck(queue->mtx);
+        if (queue->exit) {
+            return false;
+        }
+        queue->tasks.emplace_back(std::move(task));
+        if (queue->tasks.size() > _max_task) {
             WarnL << "encoder thread task is too more, now drop frame!";
-            _task.pop_front();
+            queue->tasks.pop_front();
+            ++queue->dropped;
+        }
+        if (queue->scheduled) {
+            return true;
         }
+        queue->scheduled = true;
     }
-    _sem.post();
+    TaskScheduler::Instance().post(std::move(queue));
     return true;
 }
 
 bool TaskManager::addDecodeTask(bool key_frame, function<void()> task) {
+    auto queue = _queue;
+    if (!queue) {
+        return false;
+    }
     {
-        lock_guard<mutex> lck(_task_mtx);
-        if (_decode_drop_start) {
+        lock_guard<mutex> lck(queue->mtx);
+        if (queue->exit) {
+            return false;
+        }
+        if (queue->decode_drop_start) {
             if (!key_frame) {
                 TraceL << "decode thread drop frame";
+                ++queue->dropped;
                 return false;
             }
-            _decode_drop_start = false;
+            queue->decode_drop_start = false;
             InfoL << "decode thread stop drop frame";
         }
 
-        _task.emplace_back(std::move(task));
-        if (_task.size() > _max_task) {
-            _decode_drop_start = true;
+        queue->tasks.emplace_back(std::move(task));
+        if (queue->tasks.size() > _max_task) {
+            queue->decode_drop_start = true;
             WarnL << "decode thread start drop frame";
         }
+        if (queue->scheduled) {
+            return true;
+        }
+        queue->scheduled = true;
     }
-    _sem.post();
+    TaskScheduler::Instance().post(std::move(queue));
     return true;
 }
 
@@ -149,33 +361,54 @@ void TaskManager::setMaxTaskSize(size_t size) {
 }
 
 void TaskManager::startThread(const string &name) {
-    _thread.reset(new thread([this, name]() {
-        onThreadRun(name);
-    }), [](thread *ptr) {
-        if (ptr->joinable()) {
-            ptr->join();
-        }
-        delete ptr;
-    });
+    if (isEnabled()) {
+        return;
+    }
+    auto queue = std::make_shared<Queue>();
+    queue->name = name;
+    TaskScheduler::Instance().add(queue);
+    _queue = std::move(queue);
 }
 
 void TaskManager::stopThread(bool drop_task) {
     TimeTicker();
-    if (!_thread) {
+    auto queue = _queue;
+    if (!queue || queue->exit) {
         return;
     }
-    {
-        lock_guard<mutex> lck(_task_mtx);
-        if (drop_task) {
-            _exit = true;
-            _task.clear();
+    unique_lock<mutex> lck(queue->mtx);
+    if (drop_task) {
+        queue->dropped += queue->tasks.size();
+        queue->tasks.clear();
+        queue->exit = true;
+    }
+    if (s_current_queue == queue.get()) {
+        // 在本队列的任务中停止，不能等待自己；未丢弃的任务由当前工作线程继续执行
+        // Stopped inside a task of this queue, it cannot wait for itself; the tasks left are run by the current worker
+        queue->exit = drop_task;
+        return;
+    }
+    for (;;) {
+        if (queue->running) {
+            queue->cond.wait(lck);
+            continue;
         }
-        _task.emplace_back([]() {
-            throw ThreadExitException();
-        });
+        if (queue->exit || queue->tasks.empty()) {
+            break;
+        }
+        // 在当前线程执行剩余任务，不依赖线程池是否空闲
+        // Run the remaining tasks in the current thread, not depending on whether the pool is idle
+        auto task = std::move(queue->tasks.front());
+        queue->tasks.pop_front();
+        queue->running = true;
+        lck.unlock();
+        TaskScheduler::runTask(*queue, task);
+        task = nullptr;
+        lck.lock();
+        queue->running = false;
+        ++queue->executed;
     }
-    _sem.post(10);
-    _thread = nullptr;
+    queue->exit = true;
 }
 
 TaskManager::~TaskManager() {
@@ -183,39 +416,7 @@ TaskManager::~TaskManager() {
 }
 
 bool TaskManager::isEnabled() const {
-    return _thread.operator bool();
-}
-
-void TaskManager::onThreadRun(const string &name) {
-    setThreadName(name.data());
-    function<void()> task;
-    _exit = false;
-    while (!_exit) {
-        _sem.wait();
-        {
-            unique_lock<mutex> lck(_task_mtx);
-            if (_task.empty()) {
-                continue;
-            }
-            task = _task.front();
-            _task.pop_front();
-        }
-
-        try {
-            TimeTicker2(50, TraceL);
-            task();
-            task = nullptr;
-        } catch (ThreadExitException &ex) {
-            break;
-        } catch (std::exception &ex) {
-            WarnL << ex.what();
-            continue;
-        } catch (...) {
-            WarnL << "catch one unknown exception";
-            throw;
-        }
-    }
-    InfoL << name << " exited!";
+    return _queue && !_queue->exit;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -756,6 +957,58 @@ FFmpegFrame::Ptr FFmpegSws::inputFrame(const FFmpegFrame::Ptr &frame, int &ret,
     return nullptr;
 }
 
+std::tuple<bool, std::string> FFmpegJpegEncoder::encode(const FFmpegFrame::Ptr &frame, std::string &out) {
+    _StrPrinter ss;
+    if (!_context || _width != frame->get()->width || _height != frame->get()->height) {
+        _context = nullptr;
+        _sws = nullptr;
+        auto jpeg_codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        std::shared_ptr<AVCodecContext> context(jpeg_codec ? avcodec_alloc_context3(jpeg_codec) : nullptr, [](AVCodecContext *ctx) {
+            avcodec_free_context(&ctx);
+        });
+        if (!context) {
+            ss << "Could not allocate JPEG codec context";
+            return make_tuple<bool, std::string>(false, ss.data());
+        }
+        context->width = frame->get()->width;
+        context->height = frame->get()->height;
+        context->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        context->time_base = { 1, 1 };
+        auto ret = avcodec_open2(context.get(), jpeg_codec, NULL);
+        if (ret < 0) {
+            ss << "Could not open JPEG codec, " << ffmpeg_err(ret);
+            return make_tuple<bool, std::string>(false, ss.data());
+        }
+        _width = frame->get()->width;
+        _height = frame->get()->height;
+        _context = std::move(context);
+        _sws = std::make_shared<FFmpegSws>(AV_PIX_FMT_YUVJ420P, _width, _height);
+    }
+
+    auto new_frame = _sws->inputFrame(frame);
+    if (!new_frame) {
+        ss << "Could not scale the frame";
+        return make_tuple<bool, std::string>(false, ss.data());
+    }
+    auto ret = avcodec_send_frame(_context.get(), new_frame->get());
+    if (ret < 0) {
+        ss << "Error sending a frame for encoding, " << ffmpeg_err(ret);
+        _context = nullptr;
+        return make_tuple<bool, std::string>(false, ss.data());
+    }
+    out.clear();
+    auto pkt = alloc_av_packet();
+    while (avcodec_receive_packet(_context.get(), pkt.get()) == 0) {
+        out.append((char *)pkt->data, pkt->size);
+        av_packet_unref(pkt.get());
+    }
+    if (out.empty()) {
+        ss << "Empty jpeg packet";
+        return make_tuple<bool, std::string>(false, ss.data());
+    }
+    return make_tuple<bool, std::string>(true, "");
+}
+
 std::tuple<bool, std::string> FFmpegUtils::saveFrame(const FFmpegFrame::Ptr &frame, const char *filename, AVPixelFormat fmt) {
     _StrPrinter ss;
     const AVCodec *jpeg_codec = avcodec_find_encoder(fmt == AV_PIX_FMT_YUVJ420P ? AV_CODEC_ID_MJPEG : AV_CODEC_ID_PNG);
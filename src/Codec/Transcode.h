@@ -80,36 +80,65 @@ private:
     toolkit::ResourcePool<FFmpegFrame> _swr_frame_pool;
 };
 
+/**
+ * 串行任务队列，所有队列共享固定大小的工作线程池(线程数默认为cpu核数)，
+ * 同一队列的任务按顺序执行且不会并发，不同队列在线程池中轮流调度
+ * A serial task queue, all queues share a fixed size worker thread pool (the number of cpu cores by default);
+ * tasks of the same queue run in order and never concurrently, and different queues take turns on the pool
+ */
 class TaskManager {
 public:
+    struct QueueStatistic {
+        std::string name;
+        size_t pending = 0;
+        uint64_t executed = 0;
+        uint64_t dropped = 0;
+    };
+
+    struct Statistic {
+        // 工作线程数
+        // Number of worker threads
+        size_t threads = 0;
+        // 等待调度的队列数
+        // Number of queues waiting to be scheduled
+        size_t ready = 0;
+        std::vector<QueueStatistic> queues;
+    };
+
+    /**
+     * 获取线程池与所有队列的统计信息
+     * Get the statistics of the thread pool and all queues
+     */
+    static Statistic getStatistic();
+
     virtual ~TaskManager();
 
     void setMaxTaskSize(size_t size);
+
+    /**
+     * 停止队列，返回后不会再执行该队列的任何任务
+     * @param drop_task 是否丢弃未执行的任务，否则在当前线程执行完剩余任务
+     * Stop the queue, no task of the queue will run after it returns
+     * @param drop_task Whether to drop the pending tasks, otherwise the remaining tasks are run in the current thread
+     */
     void stopThread(bool drop_task);
 
 protected:
+    /**
+     * 启用队列，不再为每个队列创建线程
+     * Enable the queue, a thread is no longer created for each queue
+     */
     void startThread(const std::string &name);
     bool addEncodeTask(std::function<void()> task);
     bool addDecodeTask(bool key_frame, std::function<void()> task);
     bool isEnabled() const;
 
-private:
-    void onThreadRun(const std::string &name);
-
-private:
-    class ThreadExitException : public std::runtime_error {
-    public:
-        ThreadExitException() : std::runtime_error("exit") {}
-    };
+public:
+    struct Queue;
 
 private:
-    bool _decode_drop_start = false;
-    bool _exit = false;
     size_t _max_task = 30;
-    std::mutex _task_mtx;
-    toolkit::semaphore _sem;
-    toolkit::List<std::function<void()> > _task;
-    std::shared_ptr<std::thread> _thread;
+    std::shared_ptr<Queue> _queue;
 };
 
 class FFmpegDecoder : public TaskManager {
@@ -163,6 +192,31 @@ private:
     toolkit::ResourcePool<FFmpegFrame> _sws_frame_pool;
 };
 
+/**
+ * jpeg编码器，输出到内存，分辨率不变时复用编码器上下文与格式转换上下文
+ * A jpeg encoder writing to memory, the codec context and the scale context are reused while the resolution is unchanged
+ */
+class FFmpegJpegEncoder {
+public:
+    using Ptr = std::shared_ptr<FFmpegJpegEncoder>;
+
+    /**
+     * 编码一帧为jpeg
+     * @param out 编码后的jpeg数据
+     * @return 是否成功与错误信息
+     * Encode a frame into jpeg
+     * @param out The encoded jpeg data
+     * @return Whether it succeeded and the error message
+     */
+    std::tuple<bool, std::string> encode(const FFmpegFrame::Ptr &frame, std::string &out);
+
+private:
+    int _width = 0;
+    int _height = 0;
+    std::shared_ptr<AVCodecContext> _context;
+    std::shared_ptr<FFmpegSws> _sws;
+};
+
 class FFmpegUtils {
 public:
     /**
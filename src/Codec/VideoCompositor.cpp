@@ -0,0 +1,217 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_FFMPEG)
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <condition_variable>
+#include "VideoCompositor.h"
+#include "Util/util.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 每个行带的最小行数，太小时线程调度开销大于拷贝本身
+// The minimum rows of a band, below it the scheduling overhead exceeds the copy itself
+static constexpr int kMinBandRows = 64;
+
+class BandPool {
+public:
+    static BandPool &Instance() {
+        static BandPool instance;
+        return instance;
+    }
+
+    ~BandPool() {
+        {
+            lock_guard<mutex> lck(_mtx);
+            _exit = true;
+        }
+        _cond.notify_all();
+        for (auto &thread : _threads) {
+            thread.join();
+        }
+    }
+
+    size_t size() const { return _threads.size() + 1; }
+
+    void run(size_t count, const function<void(size_t)> &func) {
+        if (count <= 1 || _threads.empty()) {
+            for (size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+        auto job = std::make_shared<Job>();
+        job->func = &func;
+        job->count = count;
+        {
+            lock_guard<mutex> lck(_mtx);
+            _jobs.emplace_back(job);
+        }
+        _cond.notify_all();
+        work(*job);
+        unique_lock<mutex> lck(job->mtx);
+        job->cond.wait(lck, [&]() { return job->done == job->count; });
+    }
+
+private:
+    struct Job {
+        const function<void(size_t)> *func = nullptr;
+        size_t count = 0;
+        atomic<size_t> next { 0 };
+        atomic<size_t> done { 0 };
+        mutex mtx;
+        condition_variable cond;
+    };
+
+    BandPool() {
+        auto size = MAX(thread::hardware_concurrency(), 1u);
+        for (size_t i = 1; i < size; ++i) {
+            _threads.emplace_back([this, i]() {
+                setThreadName(("compositor " + to_string(i)).data());
+                onThreadRun();
+            });
+        }
+    }
+
+    static void work(Job &job) {
+        size_t index;
+        while ((index = job.next++) < job.count) {
+            (*job.func)(index);
+            if (++job.done == job.count) {
+                lock_guard<mutex> lck(job.mtx);
+                job.cond.notify_all();
+            }
+        }
+    }
+
+    void onThreadRun() {
+        for (;;) {
+            shared_ptr<Job> job;
+            {
+                unique_lock<mutex> lck(_mtx);
+                _cond.wait(lck, [&]() { return _exit || !_jobs.empty(); });
+                if (_exit) {
+                    break;
+                }
+                job = _jobs.front();
+                if (job->next >= job->count) {
+                    // 所有行带都已被领取
+                    // All bands have been taken
+                    _jobs.pop_front();
+                    continue;
+                }
+            }
+            work(*job);
+        }
+    }
+
+private:
+    bool _exit = false;
+    mutex _mtx;
+    condition_variable _cond;
+    list<shared_ptr<Job>> _jobs;
+    vector<thread> _threads;
+};
+
+void VideoCompositor::parallelFor(size_t count, const function<void(size_t)> &func) {
+    BandPool::Instance().run(count, func);
+}
+
+size_t VideoCompositor::concurrency() {
+    return BandPool::Instance().size();
+}
+
+// 把画布高度切分成偶数行对齐的行带，保证色度平面的行带互不重叠
+// Split the canvas height into bands aligned to even rows, so that the bands of the chroma planes never overlap
+static void forEachBand(int height, const function<void(int y0, int y1)> &func) {
+    auto bands = (size_t)MAX(1, MIN((int)VideoCompositor::concurrency(), height / kMinBandRows));
+    auto rows = ((height + (int)bands - 1) / (int)bands + 1) & ~1;
+    VideoCompositor::parallelFor(bands, [&](size_t index) {
+        auto y0 = MIN(height, (int)index * rows);
+        auto y1 = MIN(height, y0 + rows);
+        if (y0 < y1) {
+            func(y0, y1);
+        }
+    });
+}
+
+// 拷贝平面的一个矩形区域，行宽等于步长时合并为一次拷贝
+// Copy a rectangle of a plane, merged into one copy when the row width equals the strides
+static void copyRect(uint8_t *dst, int dst_stride, const uint8_t *src, int src_stride, int width, int rows) {
+    if (width <= 0 || rows <= 0) {
+        return;
+    }
+    if (width == dst_stride && width == src_stride) {
+        memcpy(dst, src, (size_t)width * rows);
+        return;
+    }
+    for (int i = 0; i < rows; ++i) {
+        memcpy(dst + (size_t)dst_stride * i, src + (size_t)src_stride * i, width);
+    }
+}
+
+void VideoCompositor::fill(const FFmpegFrame::Ptr &canvas, uint8_t y, uint8_t u, uint8_t v) {
+    auto frame = canvas->get();
+    forEachBand(frame->height, [&](int y0, int y1) {
+        memset(frame->data[0] + (size_t)frame->linesize[0] * y0, y, (size_t)frame->linesize[0] * (y1 - y0));
+        auto c0 = y0 / 2;
+        auto c1 = (y1 + 1) / 2;
+        memset(frame->data[1] + (size_t)frame->linesize[1] * c0, u, (size_t)frame->linesize[1] * (c1 - c0));
+        memset(frame->data[2] + (size_t)frame->linesize[2] * c0, v, (size_t)frame->linesize[2] * (c1 - c0));
+    });
+}
+
+void VideoCompositor::compose(const FFmpegFrame::Ptr &canvas, const vector<Tile> &tiles) {
+    auto dst = canvas->get();
+    auto chroma_width = (dst->width + 1) / 2;
+    forEachBand(dst->height, [&](int y0, int y1) {
+        auto c0 = y0 / 2;
+        auto c1 = (y1 + 1) / 2;
+        for (auto &tile : tiles) {
+            auto src = tile.frame->get();
+            if (tile.x < 0 || tile.y < 0 || tile.x >= dst->width) {
+                continue;
+            }
+            // 亮度平面
+            // Luma plane
+            auto width = MIN(src->width, dst->width - tile.x);
+            auto top = MAX(y0, tile.y);
+            auto bottom = MIN(y1, tile.y + src->height);
+            if (top < bottom) {
+                copyRect(dst->data[0] + (size_t)dst->linesize[0] * top + tile.x, dst->linesize[0],
+                         src->data[0] + (size_t)src->linesize[0] * (top - tile.y), src->linesize[0], width, bottom - top);
+            }
+
+            // 色度平面，高度为奇数时也能复制到最后一行
+            // Chroma planes, the last row is copied too when the height is odd
+            auto cx = tile.x / 2;
+            auto cy = tile.y / 2;
+            auto cwidth = MIN((src->width + 1) / 2, chroma_width - cx);
+            top = MAX(c0, cy);
+            bottom = MIN(c1, cy + (src->height + 1) / 2);
+            if (top < bottom) {
+                for (int plane = 1; plane < 3; ++plane) {
+                    copyRect(dst->data[plane] + (size_t)dst->linesize[plane] * top + cx, dst->linesize[plane],
+                             src->data[plane] + (size_t)src->linesize[plane] * (top - cy), src->linesize[plane], cwidth, bottom - top);
+                }
+            }
+        }
+    });
+}
+
+} // namespace mediakit
+#endif // defined(ENABLE_FFMPEG)
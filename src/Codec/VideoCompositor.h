@@ -0,0 +1,64 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_VIDEOCOMPOSITOR_H
+#define ZLMEDIAKIT_VIDEOCOMPOSITOR_H
+
+#if defined(ENABLE_FFMPEG)
+#include <vector>
+#include <functional>
+#include "Transcode.h"
+
+namespace mediakit {
+
+/**
+ * yuv420p画面合成，画布按行带切分后在共享线程池并行处理
+ * Yuv420p picture compositing, the canvas is split into row bands which are processed in parallel on a shared thread pool
+ */
+class VideoCompositor {
+public:
+    struct Tile {
+        // 在画布中的位置
+        // Position in the canvas
+        int x;
+        int y;
+        // 已缩放到格子大小的yuv420p帧
+        // A yuv420p frame already scaled to the size of the tile
+        FFmpegFrame::Ptr frame;
+    };
+
+    /**
+     * 以纯色填充画布
+     * Fill the canvas with a solid color
+     */
+    static void fill(const FFmpegFrame::Ptr &canvas, uint8_t y, uint8_t u, uint8_t v);
+
+    /**
+     * 把所有格子拷贝到画布，超出画布的部分会被裁剪
+     * Copy all tiles into the canvas, the parts outside the canvas are clipped
+     */
+    static void compose(const FFmpegFrame::Ptr &canvas, const std::vector<Tile> &tiles);
+
+    /**
+     * 并行执行func(0) ~ func(count - 1)，调用线程也参与执行，返回时全部执行完毕
+     * Run func(0) ~ func(count - 1) in parallel, the calling thread takes part too, all of them have finished when it returns
+     */
+    static void parallelFor(size_t count, const std::function<void(size_t)> &func);
+
+    /**
+     * 并行线程数(包括调用线程)
+     * Number of parallel threads (including the calling thread)
+     */
+    static size_t concurrency();
+};
+
+} // namespace mediakit
+#endif // defined(ENABLE_FFMPEG)
+#endif // ZLMEDIAKIT_VIDEOCOMPOSITOR_H
@@ -24,19 +24,19 @@ using namespace std;
 
 namespace mediakit {
 
-bool DevChannel::inputYUV(char *yuv[3], int linesize[3], uint64_t cts) {
+bool DevChannel::inputYUV(char *yuv[3], int linesize[3], uint64_t cts, bool key_frame) {
 #ifdef ENABLE_X264
     //TimeTicker1(50);
     if (!_pH264Enc) {
         _pH264Enc.reset(new H264Encoder());
-        if (!_pH264Enc->init(_video->iWidth, _video->iHeight, _video->iFrameRate, _video->iBitRate)) {
+        if (!_pH264Enc->init(_video->iWidth, _video->iHeight, _video->iFrameRate, _video->iBitRate, _video->bExternalKey)) {
             _pH264Enc.reset();
             WarnL << "H264Encoder init failed!";
         }
     }
     if (_pH264Enc) {
         H264Encoder::H264Frame *out_frames;
-        int frames = _pH264Enc->inputData(yuv, linesize, cts, &out_frames);
+        int frames = _pH264Enc->inputData(yuv, linesize, cts, &out_frames, key_frame);
         bool ret = false;
         for (int i = 0; i < frames; i++) {
             ret = inputH264((char *) out_frames[i].pucData, out_frames[i].iLength, out_frames[i].dts, out_frames[i].pts) ? true : ret;
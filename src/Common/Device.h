@@ -29,6 +29,9 @@ public:
     int iHeight;
     float iFrameRate;
     int iBitRate = 2 * 1024 * 1024;
+    // 为true时inputYUV只在key_frame参数为true时编码关键帧，用于多路输出间的关键帧对齐
+    // If true, inputYUV encodes a key frame only when the key_frame argument is true, used to align key frames among several outputs
+    bool bExternalKey = false;
 };
 
 class AudioInfo {
@@ -151,8 +154,10 @@ public:
      * @param cts Capture timestamp, in milliseconds
      
      * [AUTO-TRANSLATED:1b945575]
+     * @param key_frame 是否强制编码为关键帧
+     * @param key_frame Whether to force a key frame
      */
-    bool inputYUV(char *yuv[3], int linesize[3], uint64_t cts);
+    bool inputYUV(char *yuv[3], int linesize[3], uint64_t cts, bool key_frame = false);
 
     /**
      * 输入pcm数据，内部会完成编码并调用inputAAC方法
@@ -0,0 +1,579 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "KTlsBox.h"
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/tls.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include "Util/logger.h"
+#include "Util/onceToken.h"
+#include "Util/uv_errno.h"
+#include "Common/config.h"
+
+// tls1.3与aes-256-gcm需要linux 5.1及以上的内核头文件
+// Tls1.3 and aes-256-gcm need the kernel headers of linux 5.1 or later
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && defined(TLS_1_3_VERSION) && defined(TLS_CIPHER_AES_GCM_256)
+#define ENABLE_KTLS_OFFLOAD
+#endif
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static constexpr size_t kBufferSize = 32 * 1024;
+static constexpr uint8_t kChangeCipherSpec = 20;
+static constexpr uint8_t kAlert = 21;
+static constexpr uint8_t kHandshake = 22;
+static constexpr uint8_t kKeyUpdate = 24;
+
+static string getSSLError() {
+    char buf[256] = { 0 };
+    ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+    return buf;
+}
+
+static int getExIndex() {
+    static int s_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return s_index;
+}
+
+KTlsBox::KTlsBox() {
+    GET_CONFIG(bool, enable_ktls, General::kEnableKTLS);
+    std::shared_ptr<SSL_CTX> ctx;
+    if (enable_ktls) {
+        ctx = SSL_Initor::Instance().getSSLCtx("", true);
+    }
+    if (ctx) {
+        _ssl.reset(SSL_new(ctx.get()), [](SSL *ssl) { SSL_free(ssl); });
+    }
+    if (!_ssl) {
+        _ssl_box.reset(new SSL_Box(true));
+        // 回调可能在构造后才设置，转发到本对象的回调
+        // The callbacks may be set after construction, forward to the callbacks of this object
+        _ssl_box->setOnDecData([this](const Buffer::Ptr &buffer) {
+            if (_on_dec) {
+                _on_dec(buffer);
+            }
+        });
+        _ssl_box->setOnEncData([this](const Buffer::Ptr &buffer) {
+            if (_on_enc) {
+                _on_enc(buffer);
+            }
+        });
+        return;
+    }
+    _read_bio = BIO_new(BIO_s_mem());
+    _write_bio = BIO_new(BIO_s_mem());
+    SSL_set_bio(_ssl.get(), _read_bio, _write_bio);
+    SSL_set_accept_state(_ssl.get());
+#ifdef SSL_OP_NO_RENEGOTIATION
+    // 发送装入内核后openssl不能再发送握手消息
+    // Openssl cannot send handshake messages any more after sending is offloaded to the kernel
+    SSL_set_options(_ssl.get(), SSL_OP_NO_RENEGOTIATION);
+#endif
+    SSL_set_ex_data(_ssl.get(), getExIndex(), this);
+    SSL_set_msg_callback(_ssl.get(), onMessage);
+}
+
+KTlsBox::~KTlsBox() = default;
+
+void KTlsBox::setupContext(SSL_CTX *ctx) {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    // 获取tls1.3流量密钥依赖keylog回调，不覆盖其他模块设置的回调
+    // Getting the tls1.3 traffic secret relies on the keylog callback, a callback set by others is not overwritten
+    if (ctx && !SSL_CTX_get_keylog_callback(ctx)) {
+        SSL_CTX_set_keylog_callback(ctx, onKeyLog);
+    }
+#endif
+}
+
+void KTlsBox::onKeyLog(const SSL *ssl, const char *line) {
+    auto box = (KTlsBox *)SSL_get_ex_data(ssl, getExIndex());
+    static const string kPrefix = "SERVER_TRAFFIC_SECRET_0 ";
+    if (!box || strncmp(line, kPrefix.data(), kPrefix.size())) {
+        return;
+    }
+    // 格式为: SERVER_TRAFFIC_SECRET_0 <client_random> <secret>，均为16进制
+    // The format is: SERVER_TRAFFIC_SECRET_0 <client_random> <secret>, both in hex
+    auto hex = strrchr(line, ' ') + 1;
+    box->_tx_secret.clear();
+    for (auto len = strlen(hex); len >= 2; len -= 2, hex += 2) {
+        box->_tx_secret.push_back((char)stoi(string(hex, 2), nullptr, 16));
+    }
+}
+
+void KTlsBox::onMessage(int write_p, int version, int content_type, const void *buf, size_t len, SSL *ssl, void *arg) {
+    auto box = (KTlsBox *)SSL_get_ex_data(ssl, getExIndex());
+    if (!box || !box->_offloaded || !write_p || !len || (content_type != kAlert && content_type != kHandshake)) {
+        return;
+    }
+    // 装入内核后openssl的加密状态已失效，记录其要发送的明文(例如KeyUpdate或告警)，改由内核加密发送
+    // The encryption state of openssl is stale after offloading, keep the plain message it wants to send (such as KeyUpdate or an alert)
+    // and let the kernel encrypt and send it instead
+    box->_control_records.emplace_back((uint8_t)content_type, string((const char *)buf, len));
+}
+
+void KTlsBox::onRecv(const Buffer::Ptr &buffer) {
+    if (_ssl_box) {
+        _ssl_box->onRecv(buffer);
+        return;
+    }
+    size_t offset = 0;
+    while (offset < buffer->size()) {
+        auto nwrite = BIO_write(_read_bio, buffer->data() + offset, buffer->size() - offset);
+        if (nwrite > 0) {
+            offset += nwrite;
+            flush();
+            continue;
+        }
+        ErrorL << "Ssl error on BIO_write: " << getSSLError();
+        shutdown();
+        break;
+    }
+}
+
+void KTlsBox::onSend(Buffer::Ptr buffer) {
+    if (_ssl_box) {
+        _ssl_box->onSend(std::move(buffer));
+        return;
+    }
+    if (!buffer->size()) {
+        return;
+    }
+    _buffer_send.emplace_back(std::move(buffer));
+    flush();
+}
+
+void KTlsBox::shutdown() {
+    if (_ssl_box) {
+        _ssl_box->shutdown();
+        return;
+    }
+    _buffer_send.clear();
+    if (_offloaded) {
+        // close_notify由onMessage捕获，由调用者通过sendControlRecords经内核发送
+        // close_notify is captured by onMessage and sent through the kernel by the caller with sendControlRecords
+        SSL_shutdown(_ssl.get());
+        flushWriteBio();
+        return;
+    }
+    if (SSL_shutdown(_ssl.get()) != 1) {
+        ErrorL << "Ssl error on SSL_shutdown: " << getSSLError();
+    } else {
+        flush();
+    }
+}
+
+void KTlsBox::flush() {
+    if (_ssl_box) {
+        _ssl_box->flush();
+        return;
+    }
+    if (_is_flush) {
+        return;
+    }
+    onceToken token([&] { _is_flush = true; }, [&] { _is_flush = false; });
+
+    flushReadBio();
+#if defined(ENABLE_KTLS_OFFLOAD)
+    if (_offloaded && SSL_get_key_update_type(_ssl.get()) != SSL_KEY_UPDATE_NONE) {
+        // 对端要求更新密钥时openssl在下次SSL_write才回应KeyUpdate，装入内核后不再调用SSL_write，用空写入触发
+        // Openssl only answers a KeyUpdate requested by the peer on the next SSL_write, which is no longer called after offloading,
+        // trigger it with an empty write
+        SSL_write(_ssl.get(), "", 0);
+        ERR_clear_error();
+    }
+#endif
+    if (!_handshake_done || _buffer_send.empty()) {
+        flushWriteBio();
+        return;
+    }
+
+    // 加密数据并发送
+    // Encrypt and send the data
+    while (!_buffer_send.empty()) {
+        auto &front = _buffer_send.front();
+        size_t offset = 0;
+        while (offset < front->size()) {
+            auto nwrite = SSL_write(_ssl.get(), front->data() + offset, front->size() - offset);
+            if (nwrite > 0) {
+                offset += nwrite;
+                flushWriteBio();
+                continue;
+            }
+            break;
+        }
+        if (offset != front->size()) {
+            ErrorL << "Ssl error on SSL_write: " << getSSLError();
+            shutdown();
+            break;
+        }
+        _buffer_send.pop_front();
+    }
+}
+
+void KTlsBox::flushReadBio() {
+    while (true) {
+        auto buffer = _buffer_pool.obtain2();
+        buffer->setCapacity(kBufferSize);
+        if (!_handshake_done) {
+            _records_in_read = 0;
+        }
+        auto nread = SSL_read(_ssl.get(), buffer->data(), kBufferSize - 1);
+        if (!_handshake_done) {
+            // 握手期间每次读取后立即发送产生的数据，以便区分握手结束时的记录
+            // During the handshake the data produced by each read is sent immediately, so that the records at the end of the handshake can be told apart
+            flushWriteBio();
+            if (SSL_is_init_finished(_ssl.get())) {
+                onHandshakeDone();
+            }
+        }
+        if (nread <= 0) {
+            break;
+        }
+        buffer->setSize(nread);
+        if (_on_dec) {
+            _on_dec(buffer);
+        }
+    }
+}
+
+void KTlsBox::flushWriteBio() {
+    while (BIO_pending(_write_bio) > 0) {
+        auto buffer = _buffer_pool.obtain2();
+        buffer->setCapacity(kBufferSize);
+        auto nread = BIO_read(_write_bio, buffer->data(), kBufferSize - 1);
+        if (nread <= 0) {
+            break;
+        }
+        if (_offloaded) {
+            // openssl用失效的密钥加密的记录不能发送，其明文已由onMessage捕获
+            // The records encrypted by openssl with a stale key must not be sent, their plain content has been captured by onMessage
+            continue;
+        }
+        buffer->setSize(nread);
+        countRecords((uint8_t *)buffer->data(), nread);
+        if (_on_enc) {
+            _on_enc(buffer);
+        }
+    }
+}
+
+bool KTlsBox::sendControlRecords() {
+    if (_fd == -1) {
+        // 连接已因控制记录发送失败而断开
+        // The connection has been closed because a control record failed to be sent
+        _control_records.clear();
+        return true;
+    }
+    while (!_control_records.empty()) {
+        auto &record = _control_records.front();
+        auto sent = sendRecord(record.first, record.second.data() + _control_offset, record.second.size() - _control_offset);
+        if (sent < 0 && get_uv_error(true) == UV_EAGAIN) {
+            return false;
+        }
+        if (sent < 0) {
+            // 控制记录发送失败后双方状态无法保持一致(例如KeyUpdate)，只能断开连接
+            // The two sides can not stay in sync after failing to send a control record (such as KeyUpdate), the connection has to be closed
+            WarnL << "Send tls record of type " << (int)record.first << " through kTLS failed: " << get_uv_errmsg();
+            closeSocket();
+            return true;
+        }
+        _control_offset += sent;
+        if (_control_offset < record.second.size()) {
+            // socket缓冲区已满，剩余部分稍后以相同的记录类型发送
+            // The socket buffer is full, the remainder is sent later with the same record type
+            return false;
+        }
+        _control_offset = 0;
+        auto key_update = record.first == kHandshake && (uint8_t)record.second[0] == kKeyUpdate;
+        _control_records.pop_front();
+        if (key_update && !updateTxKey()) {
+            closeSocket();
+            return true;
+        }
+    }
+    return true;
+}
+
+void KTlsBox::closeSocket() {
+    _control_records.clear();
+    _control_offset = 0;
+    ::shutdown(_fd, SHUT_RDWR);
+    _fd = -1;
+}
+
+void KTlsBox::countRecords(const uint8_t *data, size_t size) {
+    while (size) {
+        if (_record_remain) {
+            auto len = std::min(_record_remain, size);
+            _record_remain -= len;
+            data += len;
+            size -= len;
+            continue;
+        }
+        _record_header[_record_header_size++] = *data++;
+        --size;
+        if (_record_header_size < sizeof(_record_header)) {
+            continue;
+        }
+        _record_header_size = 0;
+        _record_remain = (_record_header[3] << 8) | _record_header[4];
+        if (_handshake_done) {
+            ++_tx_seq;
+            continue;
+        }
+        ++_records_in_read;
+        _records_after_ccs = _record_header[0] == kChangeCipherSpec ? 0 : _records_after_ccs + 1;
+    }
+}
+
+void KTlsBox::onHandshakeDone() {
+    _handshake_done = true;
+    // tls1.3服务端在收到客户端Finished的那次读取中只会发送NewSessionTicket(使用应用流量密钥)，
+    // tls1.2服务端在ChangeCipherSpec之后的记录都使用新的密钥
+    // The tls1.3 server only sends NewSessionTicket (with the application traffic secret) in the read receiving the client Finished,
+    // the tls1.2 server uses the new key for all the records after ChangeCipherSpec
+    _tx_seq = SSL_version(_ssl.get()) == TLS1_3_VERSION ? _records_in_read : _records_after_ccs;
+}
+
+bool KTlsBox::offloadable() const {
+    GET_CONFIG(bool, enable_ktls, General::kEnableKTLS);
+    return enable_ktls && _ssl && _handshake_done && !_offload_tried && _buffer_send.empty();
+}
+
+bool KTlsBox::offload(int fd) {
+    _offload_tried = true;
+    string err;
+    if (!installTxKey(fd, true, err)) {
+        DebugL << "kTLS offload failed, fallback to userspace tls: " << err;
+        return false;
+    }
+    _fd = fd;
+    _offloaded = true;
+    return true;
+}
+
+#if defined(ENABLE_KTLS_OFFLOAD)
+// rfc8446 7.1 HKDF-Expand-Label，context为空
+// rfc8446 7.1 HKDF-Expand-Label with an empty context
+static bool hkdfExpandLabel(const EVP_MD *md, const string &secret, const string &label, size_t size, string &out) {
+    string info;
+    auto full_label = "tls13 " + label;
+    info.push_back((char)(size >> 8));
+    info.push_back((char)(size & 0xFF));
+    info.push_back((char)full_label.size());
+    info.append(full_label);
+    info.push_back(0);
+
+    std::shared_ptr<EVP_PKEY_CTX> ctx(EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr), EVP_PKEY_CTX_free);
+    out.resize(size);
+    return ctx && EVP_PKEY_derive_init(ctx.get()) > 0
+        && EVP_PKEY_CTX_hkdf_mode(ctx.get(), EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0
+        && EVP_PKEY_CTX_set_hkdf_md(ctx.get(), md) > 0
+        && EVP_PKEY_CTX_set1_hkdf_key(ctx.get(), (const unsigned char *)secret.data(), secret.size()) > 0
+        && EVP_PKEY_CTX_add1_hkdf_info(ctx.get(), (const unsigned char *)info.data(), info.size()) > 0
+        && EVP_PKEY_derive(ctx.get(), (unsigned char *)&out[0], &size) > 0;
+}
+
+// rfc5246 6.3 key_block = PRF(master_secret, "key expansion", server_random + client_random)
+static bool tls12KeyBlock(const EVP_MD *md, SSL *ssl, size_t size, string &out) {
+    unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+    unsigned char client_random[SSL3_RANDOM_SIZE];
+    unsigned char server_random[SSL3_RANDOM_SIZE];
+    auto master_size = SSL_SESSION_get_master_key(SSL_get_session(ssl), master, sizeof(master));
+    SSL_get_client_random(ssl, client_random, sizeof(client_random));
+    SSL_get_server_random(ssl, server_random, sizeof(server_random));
+    static const string kLabel = "key expansion";
+
+    std::shared_ptr<EVP_PKEY_CTX> ctx(EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr), EVP_PKEY_CTX_free);
+    out.resize(size);
+    return ctx && master_size && EVP_PKEY_derive_init(ctx.get()) > 0
+        && EVP_PKEY_CTX_set_tls1_prf_md(ctx.get(), md) > 0
+        && EVP_PKEY_CTX_set1_tls1_prf_secret(ctx.get(), master, master_size) > 0
+        && EVP_PKEY_CTX_add1_tls1_prf_seed(ctx.get(), (const unsigned char *)kLabel.data(), kLabel.size()) > 0
+        && EVP_PKEY_CTX_add1_tls1_prf_seed(ctx.get(), server_random, sizeof(server_random)) > 0
+        && EVP_PKEY_CTX_add1_tls1_prf_seed(ctx.get(), client_random, sizeof(client_random)) > 0
+        && EVP_PKEY_derive(ctx.get(), (unsigned char *)&out[0], &size) > 0;
+}
+
+template <typename CryptoInfo>
+static void fillCryptoInfo(CryptoInfo &info, const string &key, const string &salt, const string &iv, const uint8_t *rec_seq) {
+    memcpy(info.key, key.data(), sizeof(info.key));
+    memcpy(info.salt, salt.data(), sizeof(info.salt));
+    memcpy(info.iv, iv.data(), sizeof(info.iv));
+    memcpy(info.rec_seq, rec_seq, sizeof(info.rec_seq));
+}
+#endif
+
+ssize_t KTlsBox::sendRecord(uint8_t type, const char *data, size_t size) {
+#if defined(ENABLE_KTLS_OFFLOAD)
+    // 内核按cmsg指定的记录类型加密，类型不同时会先结束当前的应用数据记录
+    // The kernel encrypts with the record type given by the cmsg, the current application data record is closed first when the type differs
+    char control[CMSG_SPACE(sizeof(uint8_t))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov;
+    iov.iov_base = (void *)data;
+    iov.iov_len = size;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint8_t));
+    *CMSG_DATA(cmsg) = type;
+    return sendmsg(_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+bool KTlsBox::updateTxKey() {
+#if defined(ENABLE_KTLS_OFFLOAD)
+    // rfc8446 7.2 application_traffic_secret_N+1 = HKDF-Expand-Label(application_traffic_secret_N, "traffic upd", "", Hash.length)，
+    // 新密钥的记录序号从0开始；需要linux 6.14及以上的内核支持再次设置TLS_TX
+    // rfc8446 7.2 application_traffic_secret_N+1 = HKDF-Expand-Label(application_traffic_secret_N, "traffic upd", "", Hash.length),
+    // the record sequence number restarts from 0 with the new key; setting TLS_TX again needs linux 6.14 or later
+    auto md = SSL_CIPHER_get_handshake_digest(SSL_get_current_cipher(_ssl.get()));
+    string secret;
+    string err;
+    if (!hkdfExpandLabel(md, _tx_secret, "traffic upd", EVP_MD_size(md), secret)) {
+        err = "derive tls1.3 next traffic secret failed: " + getSSLError();
+    } else {
+        _tx_secret = std::move(secret);
+        _tx_seq = 0;
+        installTxKey(_fd, false, err);
+    }
+    if (!err.empty()) {
+        WarnL << "kTLS KeyUpdate failed, close the connection: " << err;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool KTlsBox::installTxKey(int fd, bool set_ulp, string &err) {
+#if defined(ENABLE_KTLS_OFFLOAD)
+    auto cipher = SSL_get_current_cipher(_ssl.get());
+    auto nid = SSL_CIPHER_get_cipher_nid(cipher);
+    size_t key_size = 0;
+    if (nid == NID_aes_128_gcm) {
+        key_size = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+    } else if (nid == NID_aes_256_gcm) {
+        key_size = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+    } else {
+        err = string("unsupported cipher ") + SSL_CIPHER_get_name(cipher);
+        return false;
+    }
+
+    uint8_t rec_seq[8];
+    for (int i = 0; i < 8; ++i) {
+        rec_seq[i] = (uint8_t)(_tx_seq >> (56 - 8 * i));
+    }
+
+    auto md = SSL_CIPHER_get_handshake_digest(cipher);
+    auto version = SSL_version(_ssl.get());
+    string key, salt, iv;
+    if (version == TLS1_3_VERSION) {
+        string write_iv;
+        if (_tx_secret.empty()) {
+            err = "tls1.3 traffic secret is not available";
+            return false;
+        }
+        if (!hkdfExpandLabel(md, _tx_secret, "key", key_size, key) || !hkdfExpandLabel(md, _tx_secret, "iv", 12, write_iv)) {
+            err = "derive tls1.3 key failed: " + getSSLError();
+            return false;
+        }
+        // 12字节的iv由4字节salt与8字节iv组成，内核与记录序号异或得到nonce
+        // The 12 bytes iv consists of the 4 bytes salt and the 8 bytes iv, the kernel xors it with the record sequence number to get the nonce
+        salt = write_iv.substr(0, 4);
+        iv = write_iv.substr(4);
+    } else if (version == TLS1_2_VERSION) {
+        // key_block依次为client_write_key、server_write_key、client_write_IV(4字节)、server_write_IV(4字节)
+        // key_block consists of client_write_key, server_write_key, client_write_IV (4 bytes) and server_write_IV (4 bytes)
+        string key_block;
+        if (!tls12KeyBlock(md, _ssl.get(), 2 * key_size + 8, key_block)) {
+            err = "derive tls1.2 key failed: " + getSSLError();
+            return false;
+        }
+        key = key_block.substr(key_size, key_size);
+        salt = key_block.substr(2 * key_size + 4, 4);
+        // 显式nonce与openssl一样使用记录序号
+        // The explicit nonce uses the record sequence number like openssl
+        iv.assign((char *)rec_seq, sizeof(rec_seq));
+    } else {
+        err = "unsupported tls version " + to_string(version);
+        return false;
+    }
+
+    union {
+        tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+        tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+    } crypto_info;
+    memset(&crypto_info, 0, sizeof(crypto_info));
+    socklen_t crypto_info_size;
+    if (key_size == TLS_CIPHER_AES_GCM_128_KEY_SIZE) {
+        crypto_info.aes_gcm_128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        fillCryptoInfo(crypto_info.aes_gcm_128, key, salt, iv, rec_seq);
+        crypto_info_size = sizeof(crypto_info.aes_gcm_128);
+    } else {
+        crypto_info.aes_gcm_256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        fillCryptoInfo(crypto_info.aes_gcm_256, key, salt, iv, rec_seq);
+        crypto_info_size = sizeof(crypto_info.aes_gcm_256);
+    }
+    // info位于两个结构体开头
+    // info is at the beginning of both structs
+    crypto_info.aes_gcm_128.info.version = version == TLS1_3_VERSION ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+
+    if (set_ulp && setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+        err = string("setsockopt TCP_ULP failed: ") + get_uv_errmsg();
+        return false;
+    }
+    // 失败时socket仍按普通tcp发送，可以继续用户态加密
+    // On failure the socket still sends as plain tcp, so userspace encryption can continue
+    if (setsockopt(fd, SOL_TLS, TLS_TX, &crypto_info, crypto_info_size) != 0) {
+        err = string("setsockopt TLS_TX failed: ") + get_uv_errmsg();
+        return false;
+    }
+    return true;
+#else
+    err = "openssl 1.1.1 and linux 5.1 headers or later are required";
+    return false;
+#endif
+}
+
+} // namespace mediakit
+#endif // defined(ENABLE_OPENSSL) && defined(__linux__)
@@ -0,0 +1,301 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_KTLSBOX_H
+#define ZLMEDIAKIT_KTLSBOX_H
+
+#include "Network/Session.h"
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__)
+#include <list>
+#include <memory>
+#include <string>
+#include <functional>
+#include "Util/SSLBox.h"
+#include "Util/ResourcePool.h"
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct bio_st BIO;
+
+namespace mediakit {
+
+/**
+ * 服务端tls加解密，握手完成后尝试把协商出的AES-GCM发送密钥装入socket(linux kTLS)，
+ * 此后明文由内核加密，多个连接共享的缓存可以直接send/writev，不再在poller线程逐连接加密拷贝；
+ * 接收方向仍由openssl解密；内核或加密套件不支持时透明回退为用户态加密，general.enable_ktls关闭时等同于toolkit::SSL_Box
+ * Server side tls, after the handshake it tries to install the negotiated AES-GCM send key into the socket (linux kTLS),
+ * after that plain data is encrypted by the kernel and buffers shared by many connections can be sent by send/writev directly,
+ * instead of being encrypted and copied per connection on the poller thread;
+ * the receiving direction is still decrypted by openssl; it falls back to userspace encryption transparently
+ * if the kernel or the cipher suite does not support it, and behaves as toolkit::SSL_Box when general.enable_ktls is off
+ */
+class KTlsBox {
+public:
+    using onData = std::function<void(const toolkit::Buffer::Ptr &)>;
+
+    KTlsBox();
+    ~KTlsBox();
+
+    /**
+     * 给服务端SSL_CTX设置获取tls1.3流量密钥所需的keylog回调，加载证书时对每个SSL_CTX(包括sni证书)调用一次
+     * Set the keylog callback needed to get the tls1.3 traffic secret on a server SSL_CTX,
+     * called once per SSL_CTX (sni certificates included) when the certificate is loaded
+     */
+    static void setupContext(SSL_CTX *ctx);
+
+    /**
+     * 收到密文
+     * Received cipher text
+     */
+    void onRecv(const toolkit::Buffer::Ptr &buffer);
+
+    /**
+     * 加密并发送明文，发送已装入内核后不应再调用
+     * Encrypt and send plain text, it should not be called after sending has been offloaded to the kernel
+     */
+    void onSend(toolkit::Buffer::Ptr buffer);
+
+    void setOnDecData(onData cb) { _on_dec = std::move(cb); }
+    void setOnEncData(onData cb) { _on_enc = std::move(cb); }
+
+    void flush();
+
+    /**
+     * 发送close_notify，发送已装入内核时也通过内核发送
+     * Send close_notify, through the kernel as well when sending has been offloaded
+     */
+    void shutdown();
+
+    /**
+     * 握手已完成且尚未尝试装入内核，调用者应在已加密数据全部写入socket后调用offload
+     * The handshake is done and offloading has not been tried, the caller should call offload
+     * after all the encrypted data has been written to the socket
+     */
+    bool offloadable() const;
+
+    /**
+     * 发送是否已由内核加密
+     * Whether sending is encrypted by the kernel
+     */
+    bool offloaded() const { return _offloaded; }
+
+    /**
+     * 把发送密钥装入socket，只尝试一次，失败后继续用户态加密
+     * @param fd socket文件描述符
+     * Install the send key into the socket, it is tried only once and userspace encryption continues on failure
+     * @param fd Socket file descriptor
+     */
+    bool offload(int fd);
+
+    /**
+     * 是否有待由内核发送的控制记录(告警或握手消息)，此时后续明文须排在其后发送
+     * Whether there are control records (alerts or handshake messages) waiting to be sent by the kernel,
+     * the following plain data must be sent after them
+     */
+    bool hasControlRecords() const { return !_control_records.empty(); }
+
+    /**
+     * 通过内核发送控制记录，调用者须保证此前的明文已全部写入socket；
+     * socket缓冲区已满时保留剩余部分并返回false，调用者稍后重试
+     * @return 是否已全部发送(发送失败断开连接时清空并返回true)
+     * Send the control records through the kernel, the caller must make sure the plain data before has all been written to the socket;
+     * when the socket buffer is full the remainder is kept and false is returned, the caller retries later
+     * @return Whether all have been sent (they are dropped and true is returned when sending fails and the connection is closed)
+     */
+    bool sendControlRecords();
+
+private:
+    void flushReadBio();
+    void flushWriteBio();
+    void countRecords(const uint8_t *data, size_t size);
+    void onHandshakeDone();
+    bool installTxKey(int fd, bool set_ulp, std::string &err);
+    ssize_t sendRecord(uint8_t type, const char *data, size_t size);
+    void closeSocket();
+    bool updateTxKey();
+    static void onKeyLog(const SSL *ssl, const char *line);
+    static void onMessage(int write_p, int version, int content_type, const void *buf, size_t len, SSL *ssl, void *arg);
+
+private:
+    bool _is_flush = false;
+    bool _handshake_done = false;
+    bool _offload_tried = false;
+    bool _offloaded = false;
+    // 装入内核后的socket
+    // The socket after offloading
+    int _fd = -1;
+    // 配置关闭或者创建SSL失败时使用
+    // Used when the option is off or creating the SSL fails
+    std::unique_ptr<toolkit::SSL_Box> _ssl_box;
+    std::shared_ptr<SSL> _ssl;
+    BIO *_read_bio = nullptr;
+    BIO *_write_bio = nullptr;
+
+    // 已发送的tls记录计数，用于确定装入内核时的记录序号；
+    // 握手期间统计最后一次读取产生的记录数(tls1.3)与最后一个ChangeCipherSpec之后的记录数(tls1.2)
+    // Counting of the sent tls records to find the record sequence number for the kernel;
+    // during the handshake the records produced by the last read (tls1.3) and the records after the last ChangeCipherSpec (tls1.2) are counted
+    uint64_t _tx_seq = 0;
+    uint32_t _records_in_read = 0;
+    uint32_t _records_after_ccs = 0;
+    uint8_t _record_header[5];
+    size_t _record_header_size = 0;
+    size_t _record_remain = 0;
+    // tls1.3服务端发送方向的流量密钥，由keylog回调获取
+    // The tls1.3 server traffic secret, obtained from the keylog callback
+    std::string _tx_secret;
+    // 装入内核后openssl产生的告警与握手消息明文(类型, 内容)，由内核按对应记录类型加密发送
+    // Plain alerts and handshake messages produced by openssl after offloading (type, content), encrypted and sent by the kernel with their record type
+    std::list<std::pair<uint8_t, std::string>> _control_records;
+    // 第一个控制记录已写入socket的字节数
+    // The bytes of the first control record written to the socket
+    size_t _control_offset = 0;
+
+    onData _on_dec;
+    onData _on_enc;
+    std::list<toolkit::Buffer::Ptr> _buffer_send;
+    toolkit::ResourcePool<toolkit::BufferRaw> _buffer_pool;
+};
+
+/**
+ * 支持kTLS的ssl会话，用法与toolkit::SessionWithSSL相同
+ * Ssl session supporting kTLS, used the same way as toolkit::SessionWithSSL
+ */
+template <typename SessionType>
+class SessionWithKTLS : public SessionType {
+public:
+    template <typename... ArgsType>
+    SessionWithKTLS(ArgsType &&...args) : SessionType(std::forward<ArgsType>(args)...) {
+        _tls_box.setOnEncData([&](const toolkit::Buffer::Ptr &buf) { public_send(buf); });
+        _tls_box.setOnDecData([&](const toolkit::Buffer::Ptr &buf) { public_onRecv(buf); });
+    }
+
+    ~SessionWithKTLS() override {
+        if (_tls_box.offloaded() && SessionType::getSock()->rawFD() != -1) {
+            // 内核加密时openssl不会再发送任何数据，先写出已排队的明文再通过内核发送close_notify；
+            // socket仍然繁忙时不再等待，直接关闭连接
+            // Openssl sends nothing once the kernel encrypts, write out the queued plain data first and then send close_notify through the kernel;
+            // if the socket is still busy it is not waited for and the connection is just closed
+            if (sendControlRecords()) {
+                SessionType::flushAll();
+                if (!SessionType::isSocketBusy()) {
+                    _tls_box.shutdown();
+                    _tls_box.sendControlRecords();
+                }
+            }
+        }
+        _tls_box.flush();
+    }
+
+    void onRecv(const toolkit::Buffer::Ptr &buf) override {
+        _tls_box.onRecv(buf);
+        tryOffload();
+        flushControlRecords();
+    }
+
+    // 添加public_onRecv和public_send函数是解决较低版本gcc一个lambad中不能访问protected或private方法的bug
+    // The public_onRecv and public_send functions work around a bug of old gcc versions that a lambda cannot access protected or private methods
+    inline void public_onRecv(const toolkit::Buffer::Ptr &buf) { SessionType::onRecv(buf); }
+    inline void public_send(const toolkit::Buffer::Ptr &buf) { SessionType::send(buf); }
+
+    bool overSsl() const override { return true; }
+
+protected:
+    ssize_t send(toolkit::Buffer::Ptr buf) override {
+        tryOffload();
+        if (_tls_box.offloaded()) {
+            auto size = buf->size();
+            if (!_held.empty() || _tls_box.hasControlRecords()) {
+                // 控制记录(例如KeyUpdate)发送前明文不能写入socket，否则会先于控制记录或使用旧密钥加密
+                // Plain data must not be written to the socket before the control records (such as KeyUpdate) are sent,
+                // otherwise it would go out before them or be encrypted with the old key
+                _held.emplace_back(std::move(buf));
+                return size;
+            }
+            // 由内核加密，直接发送明文
+            // Encrypted by the kernel, send the plain text directly
+            return SessionType::send(std::move(buf));
+        }
+        auto size = buf->size();
+        _tls_box.onSend(std::move(buf));
+        return size;
+    }
+
+private:
+    void tryOffload() {
+        if (!_tls_box.offloadable()) {
+            return;
+        }
+        // 用户态加密的数据必须全部写入内核后才能装入密钥，否则会被内核再次加密
+        // All the data encrypted in userspace must be written to the kernel before installing the key, otherwise it would be encrypted again
+        SessionType::flushAll();
+        if (!SessionType::isSocketBusy()) {
+            _tls_box.offload(SessionType::getSock()->rawFD());
+        }
+    }
+
+    // 控制记录排在已排队的明文之后发送，全部发送后再发送暂存的明文
+    // The control records are sent after the queued plain data, the held plain data is sent after all of them
+    bool sendControlRecords() {
+        if (_tls_box.hasControlRecords()) {
+            SessionType::flushAll();
+            if (SessionType::isSocketBusy() || !_tls_box.sendControlRecords()) {
+                return false;
+            }
+        }
+        while (!_held.empty()) {
+            SessionType::send(std::move(_held.front()));
+            _held.pop_front();
+        }
+        return true;
+    }
+
+    void flushControlRecords() {
+        if (_retrying || sendControlRecords()) {
+            return;
+        }
+        // socket可写回调已被会话(例如HttpSession的异步发送)占用，定时重试直到发送完成
+        // The socket flush callback is taken by the session (such as the async sender of HttpSession), retry with a timer until sent
+        _retrying = true;
+        std::weak_ptr<SessionWithKTLS> weak_self = std::static_pointer_cast<SessionWithKTLS>(SessionType::shared_from_this());
+        SessionType::getPoller()->doDelayTask(kRetryMS, [weak_self]() -> uint64_t {
+            auto strong_self = weak_self.lock();
+            if (!strong_self || strong_self->sendControlRecords()) {
+                if (strong_self) {
+                    strong_self->_retrying = false;
+                }
+                return 0;
+            }
+            return kRetryMS;
+        });
+    }
+
+private:
+    static constexpr uint64_t kRetryMS = 10;
+
+    bool _retrying = false;
+    // 等待控制记录发送期间暂存的明文
+    // Plain data held while waiting for the control records to be sent
+    std::list<toolkit::Buffer::Ptr> _held;
+    KTlsBox _tls_box;
+};
+
+} // namespace mediakit
+
+#else
+
+namespace mediakit {
+template <typename SessionType>
+using SessionWithKTLS = toolkit::SessionWithSSL<SessionType>;
+} // namespace mediakit
+
+#endif // defined(ENABLE_OPENSSL) && defined(__linux__)
+#endif // ZLMEDIAKIT_KTLSBOX_H
@@ -292,6 +292,9 @@ public:
     // mp4录制保存路径  [AUTO-TRANSLATED:6d860f27]
     // MP4 recording save path
     std::string mp4_save_path;
+    // startRecord回溯录制的磁盘缓存时长，单位秒，置0则关闭
+    // The duration of the disk look-back buffer for startRecord, in seconds, 0 disables it
+    size_t pre_record_second;
 
     // hls录制保存路径  [AUTO-TRANSLATED:cfa90719]
     // HLS recording save path
@@ -337,6 +340,7 @@ public:
         GET_OPT_VALUE(mp4_max_second);
         GET_OPT_VALUE(mp4_as_player);
         GET_OPT_VALUE(mp4_save_path);
+        GET_OPT_VALUE(pre_record_second);
 
         GET_OPT_VALUE(hls_save_path);
         GET_OPT_VALUE(stream_replace);
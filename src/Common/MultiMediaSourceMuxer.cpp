@@ -12,6 +12,7 @@
 #include "Common/config.h"
 #include "MultiMediaSourceMuxer.h"
 #include "Thread/WorkThreadPool.h"
+#include "Util/File.h"
 
 using namespace std;
 using namespace toolkit;
@@ -405,7 +406,7 @@ std::string MultiMediaSourceMuxer::startRecord(const std::string &file_path, uin
 #if !defined(ENABLE_MP4)
     throw std::invalid_argument("mp4相关功能未打开，请开启ENABLE_MP4宏后编译再测试");
 #else
-    if (!_ring) {
+    if (!_ring && !_pre_record) {
         throw std::runtime_error("frame gop cache disabled, start record event video failed");
     }
     auto path = Recorder::getRecordPath(Recorder::type_mp4, _tuple, _option.mp4_save_path);
@@ -419,8 +420,22 @@ std::string MultiMediaSourceMuxer::startRecord(const std::string &file_path, uin
     }
     muxer->addTrackCompleted();
 
+    // 磁盘缓存的回溯数据在其写线程读取(排在已缓存数据的写入之后)，后续数据也切换到该线程写入以保证顺序
+    // The look-back data of the disk buffer is read in its writer thread (after the buffered data has been written),
+    // the following data is switched to that thread too to keep the order
+    EventPoller::Ptr work_poller;
     std::list<Frame::Ptr> history;
-    _ring->flushGop([&](const Frame::Ptr &frame) { history.emplace_back(frame); });
+    if (_pre_record) {
+        work_poller = _pre_record->getPoller();
+        auto pre_record = _pre_record->getReader(back_time_ms);
+        InfoL << "start record: " << path << ", start_dts: " << pre_record->getStartDts() << ", from pre-record buffer";
+        work_poller->async([muxer, pre_record]() {
+            auto count = pre_record->read([&](const Frame::Ptr &frame) { muxer->inputFrame(frame); });
+            DebugL << "read " << count << " frames from pre-record buffer";
+        });
+    } else {
+        _ring->flushGop([&](const Frame::Ptr &frame) { history.emplace_back(frame); });
+    }
     if (!history.empty()) {
         auto now_dts = history.back()->dts();
 
@@ -454,22 +469,39 @@ std::string MultiMediaSourceMuxer::startRecord(const std::string &file_path, uin
         }
     }
 
-    auto reader = _ring->attach(MultiMediaSourceMuxer::getOwnerPoller(MediaSource::NullMediaSource()), false);
     uint64_t now_dts = 0;
     int selected_index = -1;
-    reader->setReadCB([muxer, now_dts, selected_index, forward_time_ms, reader, path](const Frame::Ptr &frame) mutable {
-        // 循环引用自身
+    auto on_frame = [muxer, now_dts, selected_index, forward_time_ms, path, work_poller](const Frame::Ptr &frame) mutable -> bool {
         if (!now_dts) {
             now_dts = frame->dts();
             selected_index = frame->getIndex();
         }
         if (frame->getIndex() == selected_index && now_dts + forward_time_ms < frame->dts()) {
             InfoL << "stop record: " << path << ", end dts: " << frame->dts();
-            WorkThreadPool::Instance().getPoller()->async([muxer]() { muxer->closeMP4(); });
+            (work_poller ? work_poller : WorkThreadPool::Instance().getPoller())->async([muxer]() { muxer->closeMP4(); });
+            return false;
+        }
+        if (work_poller) {
+            work_poller->async([muxer, frame]() { muxer->inputFrame(frame); }, false);
+        } else {
+            muxer->inputFrame(frame);
+        }
+        return true;
+    };
+
+    if (_pre_record) {
+        // 后续数据由onTrackFrame直接转发，不为此创建常驻内存的gop缓存
+        // The following data is forwarded by onTrackFrame directly, no gop cache is kept in memory for it
+        _event_writers.emplace_back(std::move(on_frame));
+        return path;
+    }
+
+    auto reader = _ring->attach(MultiMediaSourceMuxer::getOwnerPoller(MediaSource::NullMediaSource()), false);
+    reader->setReadCB([on_frame, reader](const Frame::Ptr &frame) mutable {
+        // 循环引用自身
+        if (!on_frame(frame)) {
             reader = nullptr;
-            return;
         }
-        muxer->inputFrame(frame);
     });
     std::weak_ptr<RingType::RingReader> weak_reader = reader;
     reader->setDetachCB([weak_reader]() {
@@ -689,6 +721,21 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
         listener->onAllTrackReady();
     }
 
+#if defined(ENABLE_MP4)
+    if (_option.pre_record_second && !_pre_record) {
+        GET_CONFIG(string, pre_record_path, Record::kPreRecordPath);
+        GET_CONFIG(size_t, pre_record_max_mb, Record::kPreRecordMaxMB);
+        auto root = File::absolutePath("", pre_record_path);
+        // 进程内首次使用时清理异常退出残留的分段文件，此后每个缓存使用独立的子目录，互不删除
+        // Clean up the segment files left behind by an abnormal exit on first use in the process,
+        // after that every buffer has its own sub directory and never deletes the others
+        static onceToken s_token([&]() { File::delete_file(root); });
+        static atomic<uint64_t> s_instance { 0 };
+        auto dir = File::absolutePath(_tuple.shortUrl() + "/" + to_string(s_instance++), root) + "/";
+        _pre_record = std::make_shared<PreRecordBuffer>(dir, _option.pre_record_second * 1000, pre_record_max_mb * 1024 * 1024);
+    }
+#endif
+
 #if defined(ENABLE_RTPPROXY)
     GET_CONFIG(size_t, gop_cache, RtpProxy::kGopCache);
     if (gop_cache > 0) {
@@ -724,8 +771,72 @@ void MultiMediaSourceMuxer::createGopCacheIfNeed(size_t gop_count) {
     }, gop_count);
 }
 
+#if defined(ENABLE_FFMPEG)
+void MultiMediaSourceMuxer::cacheKeyFrame(const Frame::Ptr &frame) {
+    auto request_ms = _key_frame_request_ms.load(std::memory_order_relaxed);
+    if (!request_ms) {
+        // 没有截图消费者，不复制帧数据
+        // There is no snapshot consumer, do not copy the frame data
+        return;
+    }
+    if (getCurrentMillisecond() - request_ms > kKeyFrameKeepMS) {
+        // 长时间没有截图请求，停止缓存并释放
+        // No snapshot has been requested for a long time, stop caching and release the frames
+        _key_frame_request_ms.compare_exchange_strong(request_ms, 0);
+        clearKeyFrame();
+        return;
+    }
+    auto have_key = [&]() {
+        for (auto &item : _cur_key_frame) {
+            if (item->keyFrame()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto key_or_config = frame->keyFrame() || frame->configFrame();
+    if (!_cur_key_frame.empty()) {
+        if (have_key()) {
+            // 收到非关键帧、新的配置帧或不同时间戳的关键帧时，当前关键帧已完整
+            // The current key frame is complete when a non key frame, a new config frame or a key frame with another timestamp arrives
+            if (!key_or_config || frame->configFrame() || frame->dts() != _cur_key_frame.back()->dts()) {
+                lock_guard<mutex> lck(_key_frame_mtx);
+                _last_key_frame = std::move(_cur_key_frame);
+                _cur_key_frame.clear();
+            }
+        } else if (!key_or_config) {
+            // 配置帧后没有跟随关键帧
+            // The config frames are not followed by a key frame
+            _cur_key_frame.clear();
+        }
+    }
+    if (key_or_config) {
+        _cur_key_frame.emplace_back(Frame::getCacheAbleFrame(frame));
+    }
+}
+
+std::vector<Frame::Ptr> MultiMediaSourceMuxer::getLastKeyFrame() {
+    _key_frame_request_ms = getCurrentMillisecond();
+    lock_guard<mutex> lck(_key_frame_mtx);
+    return _last_key_frame;
+}
+
+void MultiMediaSourceMuxer::clearKeyFrame() {
+    _cur_key_frame.clear();
+    lock_guard<mutex> lck(_key_frame_mtx);
+    _last_key_frame.clear();
+}
+#endif
+
 void MultiMediaSourceMuxer::resetTracks() {
     MediaSink::resetTracks();
+#if defined(ENABLE_FFMPEG)
+    clearKeyFrame();
+#endif
+
+    if (_pre_record) {
+        _pre_record->clear();
+    }
 
     if (_rtmp) {
         _rtmp->resetTracks();
@@ -763,6 +874,11 @@ bool MultiMediaSourceMuxer::onTrackFrame(const Frame::Ptr &frame_in) {
 bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     auto frame = frame_in;
     bool ret = false;
+#if defined(ENABLE_FFMPEG)
+    if (frame->getTrackType() == TrackVideo) {
+        cacheKeyFrame(frame);
+    }
+#endif
     if (_rtmp) {
         ret = _rtmp->inputFrame(frame) ? true : ret;
     }
@@ -787,22 +903,34 @@ bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     if (_fmp4) {
         ret = _fmp4->inputFrame(frame) ? true : ret;
     }
-    if (_ring) {
-        // 此场景由于直接转发，可能存在切换线程引起的数据被缓存在管道，所以需要CacheAbleFrame  [AUTO-TRANSLATED:528afbb7]
-        // In this scenario, due to direct forwarding, there may be data cached in the pipeline due to thread switching, so CacheAbleFrame is needed
-        frame = Frame::getCacheAbleFrame(frame);
+    if (_ring || _pre_record) {
+        bool key_pos;
         if (frame->getTrackType() == TrackVideo) {
             // 视频时，遇到第一帧配置帧或关键帧则标记为gop开始处  [AUTO-TRANSLATED:66247aa8]
             // When it is a video, if the first frame configuration frame or key frame is encountered, it is marked as the beginning of the GOP
             auto video_key_pos = frame->keyFrame() || frame->configFrame();
-            _ring->write(frame, video_key_pos && !_video_key_pos);
+            key_pos = video_key_pos && !_video_key_pos;
             if (!frame->dropAble()) {
                 _video_key_pos = video_key_pos;
             }
         } else {
             // 没有视频时，设置is_key为true，目的是关闭gop缓存  [AUTO-TRANSLATED:f3223755]
             // When there is no video, set is_key to true to disable gop caching
-            _ring->write(frame, !haveVideo());
+            key_pos = !haveVideo();
+        }
+        if (_pre_record) {
+            _pre_record->inputFrame(frame, key_pos);
+        }
+        if (!_event_writers.empty()) {
+            auto cacheable = Frame::getCacheAbleFrame(frame);
+            for (auto it = _event_writers.begin(); it != _event_writers.end();) {
+                it = (*it)(cacheable) ? std::next(it) : _event_writers.erase(it);
+            }
+        }
+        if (_ring) {
+            // 此场景由于直接转发，可能存在切换线程引起的数据被缓存在管道，所以需要CacheAbleFrame  [AUTO-TRANSLATED:528afbb7]
+            // In this scenario, due to direct forwarding, there may be data cached in the pipeline due to thread switching, so CacheAbleFrame is needed
+            _ring->write(Frame::getCacheAbleFrame(frame), key_pos);
         }
     }
     return ret;
@@ -11,6 +11,7 @@
 #ifndef ZLMEDIAKIT_MULTIMEDIASOURCEMUXER_H
 #define ZLMEDIAKIT_MULTIMEDIASOURCEMUXER_H
 
+#include <atomic>
 #include "Common/Stamp.h"
 #include "Common/MediaSource.h"
 #include "Common/MediaSink.h"
@@ -18,6 +19,7 @@
 #include "Rtp/RtpSender.h"
 #include "Record/HlsRecorder.h"
 #include "Record/HlsMediaSource.h"
+#include "Record/PreRecordBuffer.h"
 #include "Rtsp/RtspMediaSourceMuxer.h"
 #include "Rtmp/RtmpMediaSourceMuxer.h"
 #include "TS/TSMediaSourceMuxer.h"
@@ -131,6 +133,19 @@ public:
      */
     std::string startRecord(const std::string &file_path, uint32_t back_time_ms, uint32_t forward_time_ms);
 
+#if defined(ENABLE_FFMPEG)
+    /**
+     * 获取最近一个完整的视频关键帧(包含其前的配置帧)，可直接送入解码器
+     * 调用即登记为截图消费者，之后开始缓存关键帧，超过kKeyFrameKeepMS未再调用则停止缓存并释放
+     * 无视频、尚未收到关键帧或刚开始缓存时返回空
+     * Get the latest complete video key frame (including the config frames before it), which can be fed to a decoder directly;
+     * calling it registers a snapshot consumer and the key frames are cached from then on, the cache is stopped and released
+     * when it is not called again within kKeyFrameKeepMS;
+     * empty if there is no video, no key frame has been received yet or the cache has just been started
+     */
+    std::vector<Frame::Ptr> getLastKeyFrame();
+#endif
+
     /**
      * 获取录制状态
      * @param type 录制类型
@@ -247,6 +262,10 @@ protected:
 
 private:
     void createGopCacheIfNeed(size_t gop_count);
+#if defined(ENABLE_FFMPEG)
+    void cacheKeyFrame(const Frame::Ptr &frame);
+    void clearKeyFrame();
+#endif
     std::shared_ptr<MediaSinkInterface> makeRecorder(MediaSource &sender, Recorder::type type);
 
 private:
@@ -272,6 +291,23 @@ private:
     HlsFMP4Recorder::Ptr _hls_fmp4;
     toolkit::EventPoller::Ptr _poller;
     RingType::Ptr _ring;
+    PreRecordBuffer::Ptr _pre_record;
+    // 使用磁盘回溯缓存的事件录制，返回false时结束
+    // Event recordings using the disk look-back buffer, removed when they return false
+    std::list<std::function<bool(const Frame::Ptr &)>> _event_writers;
+#if defined(ENABLE_FFMPEG)
+    // 无截图请求后继续缓存关键帧的时长
+    // How long the key frames are still cached after the last snapshot request
+    static constexpr uint64_t kKeyFrameKeepMS = 60 * 1000;
+    // 最近一次截图请求的时间，为0时不缓存关键帧
+    // The time of the latest snapshot request, the key frames are not cached when it is 0
+    std::atomic<uint64_t> _key_frame_request_ms { 0 };
+    // 最近的完整视频关键帧与正在接收的关键帧
+    // The latest complete video key frame and the key frame being received
+    std::mutex _key_frame_mtx;
+    std::vector<Frame::Ptr> _last_key_frame;
+    std::vector<Frame::Ptr> _cur_key_frame;
+#endif
 
     // 对象个数统计  [AUTO-TRANSLATED:3b43e8c2]
     // Object count statistics
@@ -0,0 +1,75 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "TlsContext.h"
+#include "Util/SSLBox.h"
+#include "Util/SSLUtil.h"
+#include "Util/logger.h"
+#include "Common/config.h"
+#include "Common/KTlsBox.h"
+
+#if defined(ENABLE_OPENSSL)
+#include <openssl/ssl.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+#if defined(ENABLE_OPENSSL)
+static int onAlpnSelect(SSL *ssl, const unsigned char **out, unsigned char *outlen, const unsigned char *in, unsigned int inlen, void *arg) {
+    GET_CONFIG(bool, enable_http2, Http::kEnableHttp2);
+    GET_CONFIG(bool, enable_alpn, Http::kEnableHttp2Alpn);
+    if (!enable_http2 || !enable_alpn) {
+        // 不回应alpn扩展，与未设置回调时相同
+        // The alpn extension is not answered, the same as without the callback
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    // rfc7301的线上格式，按本端的优先级选择；没有共同协议时不回应，客户端继续使用http/1.1
+    // The rfc7301 wire format, selected in our order of preference; without a common protocol it is not answered and the client keeps using http/1.1
+    static const unsigned char kProtocols[] = "\x02h2\x08http/1.1";
+    if (SSL_select_next_proto((unsigned char **)out, outlen, kProtocols, sizeof(kProtocols) - 1, in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    // 选中h2后客户端与h2c一样以http2连接前言开始，由HttpSession识别
+    // With h2 selected the client starts with the http2 connection preface like h2c, which HttpSession recognizes
+    return SSL_TLSEXT_ERR_OK;
+}
+
+static void setupContext(SSL_CTX *ctx) {
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+    SSL_CTX_set_alpn_select_cb(ctx, onAlpnSelect, nullptr);
+#endif
+#if defined(__linux__)
+    KTlsBox::setupContext(ctx);
+#endif
+}
+#endif
+
+bool TlsContext::loadCertificate(const string &pem_or_p12, const string &password, bool is_file) {
+    if (!SSL_Initor::Instance().loadCertificate(pem_or_p12, true, password, is_file)) {
+        return false;
+    }
+#if defined(ENABLE_OPENSSL)
+    // SSL_Initor以证书的主机名保存SSL_CTX(用于sni)，据此取回刚创建的SSL_CTX
+    // SSL_Initor keeps the SSL_CTX by the host name of the certificate (for sni), use it to get back the SSL_CTX just created
+    auto cers = SSLUtil::loadPublicKey(pem_or_p12, password, is_file);
+    auto ctx = cers.empty() ? nullptr : SSL_Initor::Instance().getSSLCtx(SSLUtil::getServerName(cers[0].get()), true);
+    if (!ctx) {
+        WarnL << "Can not find the SSL_CTX of the certificate, alpn and kTLS are not available with it: " << (is_file ? pem_or_p12 : "");
+        return true;
+    }
+    setupContext(ctx.get());
+#endif
+    return true;
+}
+
+} // namespace mediakit
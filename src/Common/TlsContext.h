@@ -0,0 +1,36 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_TLSCONTEXT_H
+#define ZLMEDIAKIT_TLSCONTEXT_H
+
+#include <string>
+
+namespace mediakit {
+
+class TlsContext {
+public:
+    /**
+     * 通过SSL_Initor加载服务端证书，并给该证书创建的SSL_CTX(包括sni证书)设置alpn与kTLS keylog等回调；
+     * 回调在加载证书时对每个SSL_CTX只设置一次，握手期间不再修改多个poller线程共享的SSL_CTX
+     * @param pem_or_p12 证书文件路径或内容，同SSL_Initor::loadCertificate
+     * @param password 私钥密码
+     * @param is_file pem_or_p12是否为文件路径
+     * Load a server certificate through SSL_Initor and set the alpn, kTLS keylog and other callbacks on the SSL_CTX it creates (sni certificates included);
+     * the callbacks are set once per SSL_CTX when the certificate is loaded, the SSL_CTX shared by the poller threads is not modified during handshakes
+     * @param pem_or_p12 Certificate file path or content, the same as SSL_Initor::loadCertificate
+     * @param password Private key password
+     * @param is_file Whether pem_or_p12 is a file path
+     */
+    static bool loadCertificate(const std::string &pem_or_p12, const std::string &password = "", bool is_file = true);
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_TLSCONTEXT_H
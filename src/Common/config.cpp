@@ -82,12 +82,14 @@ const string kResetWhenRePlay = GENERAL_FIELD "resetWhenRePlay";
 const string kMergeWriteMS = GENERAL_FIELD "mergeWriteMS";
 const string kCheckNvidiaDev = GENERAL_FIELD "check_nvidia_dev";
 const string kEnableFFmpegLog = GENERAL_FIELD "enable_ffmpeg_log";
+const string kTranscodeThreadNum = GENERAL_FIELD "transcode_thread_num";
 const string kWaitTrackReadyMS = GENERAL_FIELD "wait_track_ready_ms";
 const string kWaitAudioTrackDataMS = GENERAL_FIELD "wait_audio_track_data_ms";
 const string kWaitAddTrackMS = GENERAL_FIELD "wait_add_track_ms";
 const string kUnreadyFrameCache = GENERAL_FIELD "unready_frame_cache";
 const string kBroadcastPlayerCountChanged = GENERAL_FIELD "broadcast_player_count_changed";
 const string kListenIP = GENERAL_FIELD "listen_ip";
+const string kEnableKTLS = GENERAL_FIELD "enable_ktls";
 
 static onceToken token([]() {
     mINI::Instance()[kFlowThreshold] = 1024;
@@ -99,12 +101,14 @@ static onceToken token([]() {
     mINI::Instance()[kMediaServerId] = makeRandStr(16);
     mINI::Instance()[kCheckNvidiaDev] = 1;
     mINI::Instance()[kEnableFFmpegLog] = 0;
+    mINI::Instance()[kTranscodeThreadNum] = 0;
     mINI::Instance()[kWaitTrackReadyMS] = 10000;
     mINI::Instance()[kWaitAudioTrackDataMS] = 1000;
     mINI::Instance()[kWaitAddTrackMS] = 3000;
     mINI::Instance()[kUnreadyFrameCache] = 100;
     mINI::Instance()[kBroadcastPlayerCountChanged] = 0;
     mINI::Instance()[kListenIP] = "::";
+    mINI::Instance()[kEnableKTLS] = 0;
 });
 
 } // namespace General
@@ -128,6 +132,7 @@ const string kEnableFMP4 = string(kFieldName) + "enable_fmp4";
 const string kMP4AsPlayer = string(kFieldName) + "mp4_as_player";
 const string kMP4MaxSecond = string(kFieldName) + "mp4_max_second";
 const string kMP4SavePath = string(kFieldName) + "mp4_save_path";
+const string kPreRecordSecond = string(kFieldName) + "pre_record_second";
 
 const string kHlsSavePath = string(kFieldName) + "hls_save_path";
 
@@ -156,6 +161,7 @@ static onceToken token([]() {
     mINI::Instance()[kMP4AsPlayer] = 0;
     mINI::Instance()[kMP4MaxSecond] = 3600;
     mINI::Instance()[kMP4SavePath] = "./www";
+    mINI::Instance()[kPreRecordSecond] = 0;
 
     mINI::Instance()[kHlsSavePath] = "./www";
 
@@ -183,6 +189,12 @@ const string kForbidCacheSuffix = HTTP_FIELD "forbidCacheSuffix";
 const string kForwardedIpHeader = HTTP_FIELD "forwarded_ip_header";
 const string kAllowCrossDomains = HTTP_FIELD "allow_cross_domains";
 const string kAllowIPRange = HTTP_FIELD "allow_ip_range";
+const string kClientMaxConnPerHost = HTTP_FIELD "client_max_conn_per_host";
+const string kClientIdleSecond = HTTP_FIELD "client_idle_second";
+const string kClientMaxWaitingPerHost = HTTP_FIELD "client_max_waiting_per_host";
+const string kEnableHttp2 = HTTP_FIELD "enable_http2";
+const string kEnableHttp2Alpn = HTTP_FIELD "enable_http2_alpn";
+const string kFileCacheMB = HTTP_FIELD "file_cache_mb";
 
 static onceToken token([]() {
     mINI::Instance()[kSendBufSize] = 64 * 1024;
@@ -207,6 +219,12 @@ static onceToken token([]() {
     mINI::Instance()[kForwardedIpHeader] = "";
     mINI::Instance()[kAllowCrossDomains] = 1;
     mINI::Instance()[kAllowIPRange] = "::1,127.0.0.1,172.16.0.0-172.31.255.255,192.168.0.0-192.168.255.255,10.0.0.0-10.255.255.255";
+    mINI::Instance()[kClientMaxConnPerHost] = 32;
+    mINI::Instance()[kClientIdleSecond] = 15;
+    mINI::Instance()[kClientMaxWaitingPerHost] = 1024;
+    mINI::Instance()[kEnableHttp2] = 1;
+    mINI::Instance()[kEnableHttp2Alpn] = 0;
+    mINI::Instance()[kFileCacheMB] = 128;
 });
 
 } // namespace Http
@@ -314,6 +332,11 @@ const string kFileBufSize = RECORD_FIELD "fileBufSize";
 const string kFastStart = RECORD_FIELD "fastStart";
 const string kFileRepeat = RECORD_FIELD "fileRepeat";
 const string kEnableFmp4 = RECORD_FIELD "enableFmp4";
+const string kPreRecordPath = RECORD_FIELD "preRecordPath";
+const string kPreRecordMaxMB = RECORD_FIELD "preRecordMaxMB";
+const string kEnableIndex = RECORD_FIELD "enableIndex";
+const string kMoovCacheMB = RECORD_FIELD "moovCacheMB";
+const string kReadAheadMS = RECORD_FIELD "readAheadMS";
 
 static onceToken token([]() {
     mINI::Instance()[kAppName] = "record";
@@ -322,6 +345,11 @@ static onceToken token([]() {
     mINI::Instance()[kFastStart] = false;
     mINI::Instance()[kFileRepeat] = false;
     mINI::Instance()[kEnableFmp4] = false;
+    mINI::Instance()[kPreRecordPath] = "./prerecord";
+    mINI::Instance()[kPreRecordMaxMB] = 512;
+    mINI::Instance()[kEnableIndex] = true;
+    mINI::Instance()[kMoovCacheMB] = 64;
+    mINI::Instance()[kReadAheadMS] = 5000;
 });
 } // namespace Record
 
@@ -338,6 +366,7 @@ const string kFileBufSize = HLS_FIELD "fileBufSize";
 const string kBroadcastRecordTs = HLS_FIELD "broadcastRecordTs";
 const string kDeleteDelaySec = HLS_FIELD "deleteDelaySec";
 const string kFastRegister = HLS_FIELD "fastRegister";
+const string kPullPrefetch = HLS_FIELD "pullPrefetch";
 
 static onceToken token([]() {
     mINI::Instance()[kSegmentDuration] = 2;
@@ -349,6 +378,7 @@ static onceToken token([]() {
     mINI::Instance()[kBroadcastRecordTs] = false;
     mINI::Instance()[kDeleteDelaySec] = 10;
     mINI::Instance()[kFastRegister] = false;
+    mINI::Instance()[kPullPrefetch] = 1;
 });
 } // namespace Hls
 
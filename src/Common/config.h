@@ -242,6 +242,9 @@ extern const std::string kCheckNvidiaDev;
 // 是否开启ffmpeg日志  [AUTO-TRANSLATED:038b471e]
 // Whether to enable ffmpeg log
 extern const std::string kEnableFFmpegLog;
+// ffmpeg编解码任务线程池大小，置0则为cpu核数
+// The size of the ffmpeg decode/encode task thread pool, 0 means the number of cpu cores
+extern const std::string kTranscodeThreadNum;
 // 最多等待未初始化的Track 10秒，超时之后会忽略未初始化的Track  [AUTO-TRANSLATED:826cd533]
 // Maximum wait time for uninitialized Track is 10 seconds, after timeout, uninitialized Track will be ignored
 extern const std::string kWaitTrackReadyMS;
@@ -262,6 +265,10 @@ extern const std::string kBroadcastPlayerCountChanged;
 // 绑定的本地网卡ip  [AUTO-TRANSLATED:daa90832]
 // Bound local network card ip
 extern const std::string kListenIP;
+// 是否在tls握手完成后把AES-GCM发送密钥装入内核(linux kTLS)，由内核加密发送数据；内核或加密套件不支持时自动回退为用户态加密
+// Whether to install the AES-GCM send key into the kernel (linux kTLS) after the tls handshake so that the kernel encrypts the sent data;
+// it falls back to userspace encryption automatically if the kernel or the cipher suite does not support it
+extern const std::string kEnableKTLS;
 } // namespace General
 
 namespace Protocol {
@@ -322,6 +329,9 @@ extern const std::string kMP4MaxSecond;
 // mp4录制保存路径  [AUTO-TRANSLATED:6d860f27]
 // MP4 recording save path
 extern const std::string kMP4SavePath;
+// startRecord回溯录制的磁盘缓存时长，单位秒，置0则关闭并使用内存中的gop缓存
+// The duration of the disk look-back buffer for startRecord, in seconds, 0 disables it and the in-memory gop cache is used
+extern const std::string kPreRecordSecond;
 
 // hls录制保存路径  [AUTO-TRANSLATED:cfa90719]
 // HLS recording save path
@@ -375,6 +385,24 @@ extern const std::string kAllowCrossDomains;
 // 允许访问http api和http文件索引的ip地址范围白名单，置空情况下不做限制  [AUTO-TRANSLATED:ab939863]
 // Whitelist of IP address ranges allowed to access HTTP API and HTTP file index. No restrictions are imposed when empty
 extern const std::string kAllowIPRange;
+// http客户端每个主机的最大连接数，超出后请求排队等待空闲连接，0为不限制
+// The max connections of the http client per host, requests beyond it wait for an idle connection, 0 means unlimited
+extern const std::string kClientMaxConnPerHost;
+// http客户端空闲连接保持秒数，0为不复用连接
+// Seconds to keep an idle http client connection, 0 disables connection reuse
+extern const std::string kClientIdleSecond;
+// http客户端每个主机排队等待连接的最大请求数，超出后请求直接失败，0为不限制
+// The max requests of the http client waiting for a connection per host, requests beyond it fail at once, 0 means unlimited
+extern const std::string kClientMaxWaitingPerHost;
+// 是否允许http2(prior knowledge h2c)，同一连接上多路复用请求
+// Whether to allow http2 (prior knowledge h2c), requests are multiplexed on one connection
+extern const std::string kEnableHttp2;
+// https下是否通过alpn协商h2，需同时开启enable_http2
+// Whether to negotiate h2 by alpn over https, enable_http2 must be on as well
+extern const std::string kEnableHttp2Alpn;
+// 热点文件内容缓存的大小上限，单位MB，0为关闭；同一个文件(例如hls切片)被大量播放器请求时只读取一次磁盘
+// The size limit of the hot file content cache in MB, 0 to disable; a file (e.g. an hls segment) requested by lots of players is read from disk only once
+extern const std::string kFileCacheMB;
 } // namespace Http
 
 // //////////SHELL配置///////////  [AUTO-TRANSLATED:f023ec45]
@@ -493,6 +521,21 @@ extern const std::string kFileRepeat;
 // mp4录制文件是否采用fmp4格式  [AUTO-TRANSLATED:12559ae0]
 // Whether to use fmp4 format for MP4 recording files
 extern const std::string kEnableFmp4;
+// 回溯录制磁盘缓存的保存目录
+// The directory of the look-back disk buffers
+extern const std::string kPreRecordPath;
+// 每个流回溯录制磁盘缓存的大小上限，单位MB
+// The size limit of the look-back disk buffer of each stream, in MB
+extern const std::string kPreRecordMaxMB;
+// 是否维护录像索引(mp4录像与保留的hls切片)，用于按时间段快速查询
+// Whether to maintain the record index (mp4 records and kept hls segments) for fast time range queries
+extern const std::string kEnableIndex;
+// 进程级moov缓存的大小上限，单位MB，0为关闭；同一个文件被多次点播时不再从磁盘读取moov
+// The size limit of the process wide moov cache in MB, 0 to disable; the moov of a file played many times is not read from disk again
+extern const std::string kMoovCacheMB;
+// mp4点播时提前通知内核预读的时长，单位毫秒，0为关闭
+// The duration the kernel is told to read ahead during mp4 vod, in milliseconds, 0 to disable
+extern const std::string kReadAheadMS;
 } // namespace Record
 
 // //////////HLS相关配置///////////  [AUTO-TRANSLATED:873cc84c]
@@ -525,6 +568,10 @@ extern const std::string kDeleteDelaySec;
 // 如果设置为1，则第一个切片长度强制设置为1个GOP  [AUTO-TRANSLATED:fbbb651d]
 // If set to 1, the length of the first slice is forced to be 1 GOP
 extern const std::string kFastRegister;
+// 拉取hls时同时下载的切片个数(含当前播放的切片)，大于1时提前下载后续切片，1为逐个下载
+// The number of segments downloaded at the same time when pulling hls (including the playing one),
+// more than 1 downloads the following segments in advance, 1 downloads them one by one
+extern const std::string kPullPrefetch;
 } // namespace Hls
 
 // //////////Rtp代理相关配置///////////  [AUTO-TRANSLATED:7b285587]
@@ -27,6 +27,12 @@ bool HlsParser::parse(const string &http_url, const string &m3u8) {
     _is_live = true;
     _is_m3u8_inner = false;
     int index = 0;
+    // #EXT-X-BYTERANGE:<n>[@<o>]，未指定o时紧接同一文件上个切片的结束位置
+    // #EXT-X-BYTERANGE:<n>[@<o>], without o it follows the end of the previous segment of the same file
+    int64_t range_size = -1;
+    int64_t range_offset = -1;
+    int64_t last_range_end = 0;
+    string last_range_url;
 
     auto lines = split(m3u8, "\n");
     for (auto &line : lines) {
@@ -38,6 +44,14 @@ bool HlsParser::parse(const string &http_url, const string &m3u8) {
         if ((_is_m3u8_inner || extinf_dur != 0) && line[0] != '#') {
             segment.duration = extinf_dur;
             segment.url = Parser::mergeUrl(http_url, line);
+            segment.range.clear();
+            if (range_size > 0 && !_is_m3u8_inner) {
+                auto offset = range_offset >= 0 ? range_offset : (segment.url == last_range_url ? last_range_end : 0);
+                segment.range = StrPrinter << "bytes=" << offset << "-" << offset + range_size - 1;
+                last_range_url = segment.url;
+                last_range_end = offset + range_size;
+            }
+            range_size = range_offset = -1;
             if (!_is_m3u8_inner) {
                 // ts按照先后顺序排序  [AUTO-TRANSLATED:c34f8c9d]
                 // Sort by order of appearance
@@ -67,6 +81,11 @@ bool HlsParser::parse(const string &http_url, const string &m3u8) {
             continue;
         }
 
+        if (line.find("#EXT-X-BYTERANGE:") == 0) {
+            sscanf(line.data(), "#EXT-X-BYTERANGE:%" SCNd64 "@%" SCNd64, &range_size, &range_offset);
+            continue;
+        }
+
         if (line == "#EXTM3U") {
             _is_m3u8 = true;
             continue;
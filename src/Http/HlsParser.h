@@ -24,6 +24,9 @@ typedef struct{
     // ts切片长度  [AUTO-TRANSLATED:9d5545f8]
     // TS segment length
     float duration;
+    // #EXT-X-BYTERANGE对应的http Range请求头，例如bytes=0-1023，为空则下载整个文件
+    // The http Range header of #EXT-X-BYTERANGE, e.g. bytes=0-1023, empty to download the whole file
+    std::string range;
 
     // ////内嵌m3u8//////  [AUTO-TRANSLATED:c3fabbfd]
     // //// Embedded m3u8 //////
@@ -9,6 +9,7 @@
  */
 
 #include "HlsPlayer.h"
+#include "HttpClientPool.h"
 #include "Common/config.h"
 using namespace std;
 using namespace toolkit;
@@ -76,14 +77,39 @@ void HlsPlayer::teardown_l(const SockException &ex) {
     }
     _timer.reset();
     _timer_ts.reset();
-    _http_ts_player.reset();
+    _prefetch.clear();
+    recycleSegmentClient();
     shutdown(ex);
 }
 
+bool HlsPlayer::canPoolSegmentClient() {
+    // 使用代理或指定网卡的连接不与其他播放器共享
+    // Connections through a proxy or a specified network adapter are not shared with other players
+    return (*this)[Client::kProxyUrl].empty() && (*this)[Client::kNetAdapter].empty();
+}
+
+void HlsPlayer::recycleSegmentClient() {
+    auto client = std::move(_http_ts_player);
+    if (!client || !canPoolSegmentClient() || client->waitResponse() || !client->alive()) {
+        return;
+    }
+    // 空闲的切片下载连接留给同一poller上后续的拉流复用，例如重连后的同一源站
+    // Keep the idle segment connection for later pulls on the same poller, e.g. the same origin after a reconnection
+    auto key = HttpClientPool::getKey(client->getUrl(), getPoller());
+    client->setOnComplete(nullptr);
+    client->setOnPacket(nullptr);
+    client->clear();
+    HttpClientPool::Instance().pushIdle(key, client);
+}
+
 void HlsPlayer::teardown() {
     teardown_l(SockException(Err_shutdown, "teardown"));
 }
 
+string HlsPlayer::getSegmentKey(const ts_segment &segment) {
+    return segment.range.empty() ? segment.url : segment.range + "@" + segment.url;
+}
+
 void HlsPlayer::fetchSegment() {
     if (_ts_list.empty()) {
         // 如果是点播文件，播放列表为空代表文件播放结束，关闭播放器: #2628  [AUTO-TRANSLATED:c2d0b647]
@@ -105,99 +131,192 @@ void HlsPlayer::fetchSegment() {
         // The player is still alive and is currently downloading
         return;
     }
-    weak_ptr<HlsPlayer> weak_self = static_pointer_cast<HlsPlayer>(shared_from_this());
-    if (!_http_ts_player) {
-        _http_ts_player = std::make_shared<HttpTSPlayer>(getPoller());
-        _http_ts_player->setProxyUrl((*this)[Client::kProxyUrl]);
-        _http_ts_player->setAllowResendRequest(true);
-        _http_ts_player->setOnCreateSocket([weak_self](const EventPoller::Ptr &poller) {
-            auto strong_self = weak_self.lock();
-            if (strong_self) {
-                return strong_self->createSocket();
-            }
-            return Socket::createSocket(poller, true);
-        });
-        auto benchmark_mode = (*this)[Client::kBenchmarkMode].as<int>();
-        if (!benchmark_mode) {
-            _http_ts_player->setOnPacket([weak_self](const char *data, size_t len) {
-                auto strong_self = weak_self.lock();
-                if (!strong_self) {
-                    return;
-                }
-                // 收到ts包  [AUTO-TRANSLATED:334862da]
-                // Received ts packet
-                // Received ts package
-                strong_self->onPacket(data, len);
-            });
-        }
 
-        if (!(*this)[Client::kNetAdapter].empty()) {
-            _http_ts_player->setNetAdapter((*this)[Client::kNetAdapter]);
+    auto segment = std::move(_ts_list.front());
+    _ts_list.pop_front();
+
+    auto it = _prefetch.find(getSegmentKey(segment));
+    if (it != _prefetch.end()) {
+        // 该切片已提前下载，改为当前切片，先输入已收到的数据，后续数据直接输入
+        // The segment is downloaded in advance, make it the current segment,
+        // input the received data first and the following data directly
+        auto prefetch = std::move(it->second);
+        _prefetch.erase(it);
+        recycleSegmentClient();
+        _http_ts_player = prefetch->client;
+        prefetchSegments();
+        // 下一个切片的下载时机按本切片成为当前切片起计时，与播放进度一致，而不是从预取开始计时
+        // The next segment is scheduled from the moment this one becomes current, which follows the playback,
+        // rather than from the moment it was prefetched
+        setSegmentCallback(_http_ts_player, segment);
+        if (!prefetch->data.empty()) {
+            onPacket(prefetch->data.data(), prefetch->data.size());
+        }
+        if (prefetch->completed) {
+            _http_ts_player->setOnComplete(nullptr);
+            onSegmentCompleted(segment.url, segment.duration, 0, prefetch->err);
         }
+        return;
+    }
+
+    if (!_http_ts_player) {
+        _http_ts_player = createSegmentClient(segment.url);
     } else {
         // 每次请求新的ts片段时重置HttpTSPlayer状态
         _http_ts_player->clear();
         _http_ts_player->setProxyUrl((*this)[Client::kProxyUrl]);
     }
+    prefetchSegments();
+    setSegmentCallback(_http_ts_player, segment);
+    sendSegmentRequest(_http_ts_player, segment);
+}
 
-    Ticker ticker;
-    auto url = _ts_list.front().url;
-    auto duration = _ts_list.front().duration;
-    _ts_list.pop_front();
-
-    _http_ts_player->setOnComplete([weak_self, ticker, duration, url](const SockException &err) {
-        auto strong_self = weak_self.lock();
-        if (!strong_self) {
-            return;
+void HlsPlayer::prefetchSegments() {
+    GET_CONFIG(uint32_t, pull_prefetch, Hls::kPullPrefetch);
+    auto benchmark_mode = (*this)[Client::kBenchmarkMode].as<int>();
+    // 当前切片也计入下载个数
+    // The current segment is counted as well
+    size_t count = 1;
+    for (auto &segment : _ts_list) {
+        if (++count > pull_prefetch) {
+            break;
         }
-        if (err) {
-            WarnL << "Download ts segment " << url << " failed:" << err;
-            if (err.getErrCode() == Err_timeout) {
-                strong_self->_timeout_multiple = MAX(strong_self->_timeout_multiple + 1, MAX_TIMEOUT_MULTIPLE);
-            } else {
-                strong_self->_timeout_multiple = MAX(strong_self->_timeout_multiple - 1, MIN_TIMEOUT_MULTIPLE);
-            }
-            strong_self->_ts_download_failed_count++;
-            if (strong_self->_ts_download_failed_count > MAX_TS_DOWNLOAD_FAILED_COUNT) {
-                WarnL << "ts segment " << url << " download failed count is " << strong_self->_ts_download_failed_count << ", teardown player";
-                strong_self->teardown_l(SockException(Err_shutdown, "ts segment download failed"));
-                return;
-            }
-        } else {
-            strong_self->_ts_download_failed_count = 0;
+        auto key = getSegmentKey(segment);
+        if (_prefetch.find(key) != _prefetch.end()) {
+            continue;
         }
-        // 提前0.5秒下载好，支持点播文件控制下载速度: #2628  [AUTO-TRANSLATED:82247326]
-        // Download 0.5 seconds in advance to support on-demand file download speed control: #2628
-        // Download 0.5 seconds in advance to support video-on-demand files to control download speed: #2628
-        auto delay = duration - 0.5 - ticker.elapsedTime() / 1000.0f;
-        if (delay > 2.0) {
-            // 提前1秒下载  [AUTO-TRANSLATED:852349aa]
-            // Download 1 second in advance
-            // Download 1 second in advance
-            delay -= 1.0;
-        } else if (delay <= 0) {
-            // 延时最小10ms  [AUTO-TRANSLATED:fbb3665e]
-            // Delay a minimum of 10ms
-            // Delay at least 10ms
-            delay = 0.01;
+        auto prefetch = std::make_shared<Prefetch>();
+        prefetch->client = createSegmentClient(segment.url);
+        weak_ptr<Prefetch> weak_prefetch = prefetch;
+        if (!benchmark_mode) {
+            prefetch->client->setOnPacket([weak_prefetch](const char *data, size_t len) {
+                auto strong_prefetch = weak_prefetch.lock();
+                if (strong_prefetch) {
+                    strong_prefetch->data.append(data, len);
+                }
+            });
         }
-        // 延时下载下一个切片  [AUTO-TRANSLATED:26eb528d]
-        // Delay downloading the next slice
-        strong_self->_timer_ts.reset(new Timer(delay, [weak_self]() {
-            auto strong_self = weak_self.lock();
-            if (strong_self) {
-                strong_self->fetchSegment();
+        prefetch->client->setOnComplete([weak_prefetch](const SockException &err) {
+            auto strong_prefetch = weak_prefetch.lock();
+            if (strong_prefetch) {
+                strong_prefetch->completed = true;
+                strong_prefetch->err = err;
             }
-            return false;
-        }, strong_self->getPoller()));
+        });
+        sendSegmentRequest(prefetch->client, segment);
+        _prefetch.emplace(std::move(key), std::move(prefetch));
+    }
+}
+
+HttpTSPlayer::Ptr HlsPlayer::createSegmentClient(const string &url) {
+    HttpTSPlayer::Ptr client;
+    if (canPoolSegmentClient()) {
+        // 优先复用同一poller上到该主机的空闲keep-alive连接
+        // Reuse an idle keep-alive connection to the host on the same poller first
+        auto key = HttpClientPool::getKey(url, getPoller());
+        client = dynamic_pointer_cast<HttpTSPlayer>(HttpClientPool::Instance().popIdle(key));
+    }
+    if (!client) {
+        client = std::make_shared<HttpTSPlayer>(getPoller());
+    }
+    weak_ptr<HlsPlayer> weak_self = static_pointer_cast<HlsPlayer>(shared_from_this());
+    client->setProxyUrl((*this)[Client::kProxyUrl]);
+    client->setAllowResendRequest(true);
+    client->setOnCreateSocket([weak_self](const EventPoller::Ptr &poller) {
+        auto strong_self = weak_self.lock();
+        if (strong_self) {
+            return strong_self->createSocket();
+        }
+        return Socket::createSocket(poller, true);
     });
+    if (!(*this)[Client::kNetAdapter].empty()) {
+        client->setNetAdapter((*this)[Client::kNetAdapter]);
+    }
+    return client;
+}
 
-    _http_ts_player->setMethod("GET");
+void HlsPlayer::sendSegmentRequest(const HttpTSPlayer::Ptr &client, const ts_segment &segment) {
+    client->setMethod("GET");
+    if (!segment.range.empty()) {
+        client->addHeader("Range", segment.range);
+    }
     // ts切片必须在其时长的2-5倍内下载完毕  [AUTO-TRANSLATED:d458e7b5]
     // The ts slice must be downloaded within 2-5 times its duration
     // The ts segment must be downloaded within 2-5 times its duration
-    _http_ts_player->setCompleteTimeout(_timeout_multiple * duration * 1000);
-    _http_ts_player->sendRequest(url);
+    client->setCompleteTimeout(_timeout_multiple * segment.duration * 1000);
+    client->sendRequest(segment.url);
+}
+
+void HlsPlayer::setSegmentCallback(const HttpTSPlayer::Ptr &client, const ts_segment &segment) {
+    weak_ptr<HlsPlayer> weak_self = static_pointer_cast<HlsPlayer>(shared_from_this());
+    auto benchmark_mode = (*this)[Client::kBenchmarkMode].as<int>();
+    if (!benchmark_mode) {
+        client->setOnPacket([weak_self](const char *data, size_t len) {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return;
+            }
+            // 收到ts包  [AUTO-TRANSLATED:334862da]
+            // Received ts packet
+            // Received ts package
+            strong_self->onPacket(data, len);
+        });
+    } else {
+        client->setOnPacket(nullptr);
+    }
+    auto url = segment.url;
+    auto duration = segment.duration;
+    Ticker ticker;
+    client->setOnComplete([weak_self, ticker, duration, url](const SockException &err) {
+        auto strong_self = weak_self.lock();
+        if (strong_self) {
+            strong_self->onSegmentCompleted(url, duration, ticker.elapsedTime(), err);
+        }
+    });
+}
+
+void HlsPlayer::onSegmentCompleted(const string &url, float duration, uint64_t elapsed_ms, const SockException &err) {
+    if (err) {
+        WarnL << "Download ts segment " << url << " failed:" << err;
+        if (err.getErrCode() == Err_timeout) {
+            _timeout_multiple = MAX(_timeout_multiple + 1, MAX_TIMEOUT_MULTIPLE);
+        } else {
+            _timeout_multiple = MAX(_timeout_multiple - 1, MIN_TIMEOUT_MULTIPLE);
+        }
+        _ts_download_failed_count++;
+        if (_ts_download_failed_count > MAX_TS_DOWNLOAD_FAILED_COUNT) {
+            WarnL << "ts segment " << url << " download failed count is " << _ts_download_failed_count << ", teardown player";
+            teardown_l(SockException(Err_shutdown, "ts segment download failed"));
+            return;
+        }
+    } else {
+        _ts_download_failed_count = 0;
+    }
+    // 提前0.5秒下载好，支持点播文件控制下载速度: #2628  [AUTO-TRANSLATED:82247326]
+    // Download 0.5 seconds in advance to support on-demand file download speed control: #2628
+    // Download 0.5 seconds in advance to support video-on-demand files to control download speed: #2628
+    auto delay = duration - 0.5 - elapsed_ms / 1000.0f;
+    if (delay > 2.0) {
+        // 提前1秒下载  [AUTO-TRANSLATED:852349aa]
+        // Download 1 second in advance
+        // Download 1 second in advance
+        delay -= 1.0;
+    } else if (delay <= 0) {
+        // 延时最小10ms  [AUTO-TRANSLATED:fbb3665e]
+        // Delay a minimum of 10ms
+        // Delay at least 10ms
+        delay = 0.01;
+    }
+    // 延时下载下一个切片  [AUTO-TRANSLATED:26eb528d]
+    // Delay downloading the next slice
+    weak_ptr<HlsPlayer> weak_self = static_pointer_cast<HlsPlayer>(shared_from_this());
+    _timer_ts.reset(new Timer(delay, [weak_self]() {
+        auto strong_self = weak_self.lock();
+        if (strong_self) {
+            strong_self->fetchSegment();
+        }
+        return false;
+    }, getPoller()));
 }
 
 bool HlsPlayer::onParsed(bool is_m3u8_inner, int64_t sequence, const map<int, ts_segment> &ts_map) {
@@ -228,7 +347,8 @@ bool HlsPlayer::onParsed(bool is_m3u8_inner, int64_t sequence, const map<int, ts
         _wait_index_update_ticker.resetTime();
         for (auto &pr : ts_map) {
             auto &ts = pr.second;
-            if (_ts_url_cache.emplace(ts.url).second) {
+            auto key = getSegmentKey(ts);
+            if (_ts_url_cache.emplace(key).second) {
                 // 该ts未重复  [AUTO-TRANSLATED:4b6fab6b]
                 // This ts is not duplicated
                 // The ts is not repeated
@@ -236,7 +356,7 @@ bool HlsPlayer::onParsed(bool is_m3u8_inner, int64_t sequence, const map<int, ts
                 // 按时间排序  [AUTO-TRANSLATED:7b61e414]
                 // Sort by time
                 // Sort by time
-                _ts_url_sort.emplace_back(ts.url);
+                _ts_url_sort.emplace_back(std::move(key));
             }
         }
         if (_ts_url_sort.size() > 2 * ts_map.size()) {
@@ -360,7 +480,11 @@ void HlsPlayer::playDelay(float delay_sec) {
 }
 
 size_t HlsPlayer::getRecvSpeed() {
-    return TcpClient::getRecvSpeed() + (_http_ts_player ? _http_ts_player->getRecvSpeed() : 0);
+    auto ret = TcpClient::getRecvSpeed() + (_http_ts_player ? _http_ts_player->getRecvSpeed() : 0);
+    for (auto &pr : _prefetch) {
+        ret += pr.second->client->getRecvSpeed();
+    }
+    return ret;
 }
 
 size_t HlsPlayer::getRecvTotalBytes() {
@@ -102,7 +102,14 @@ private:
     void playDelay(float delay_sec = 0);
     float delaySecond();
     void fetchSegment();
+    void prefetchSegments();
+    HttpTSPlayer::Ptr createSegmentClient(const std::string &url);
+    void sendSegmentRequest(const HttpTSPlayer::Ptr &client, const ts_segment &segment);
+    void setSegmentCallback(const HttpTSPlayer::Ptr &client, const ts_segment &segment);
+    void onSegmentCompleted(const std::string &url, float duration, uint64_t elapsed_ms, const toolkit::SockException &err);
     void teardown_l(const toolkit::SockException &ex);
+    bool canPoolSegmentClient();
+    void recycleSegmentClient();
     void fetchIndexFile();
 
 private:
@@ -115,6 +122,22 @@ private:
         }
     };
 
+    // 提前下载的切片
+    // A segment downloaded in advance
+    struct Prefetch {
+        using Ptr = std::shared_ptr<Prefetch>;
+        HttpTSPlayer::Ptr client;
+        // 成为当前切片前已收到的数据
+        // The data received before it becomes the current segment
+        std::string data;
+        bool completed = false;
+        toolkit::SockException err;
+    };
+
+    // 切片去重与预取的key，带Range的切片共享同一url
+    // The key to dedupe and prefetch segments, segments with a Range share the same url
+    static std::string getSegmentKey(const ts_segment &segment);
+
 private:
     bool _play_result = false;
     int64_t _last_sequence = -1;
@@ -127,6 +150,7 @@ private:
     std::list<std::string> _ts_url_sort;
     std::set<std::string, UrlComp> _ts_url_cache;
     HttpTSPlayer::Ptr _http_ts_player;
+    std::map<std::string, Prefetch::Ptr> _prefetch;
     int _timeout_multiple = MIN_TIMEOUT_MULTIPLE;
     int _try_fetch_index_times = 0;
     int _ts_download_failed_count = 0;
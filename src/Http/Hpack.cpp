@@ -0,0 +1,415 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <unordered_map>
+#include "Hpack.h"
+#include "Util/util.h"
+#include "Util/onceToken.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// RFC 7541 附录A 静态表
+// RFC 7541 Appendix A static table
+static const pair<const char *, const char *> s_static_table[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+static constexpr size_t kStaticTableSize = sizeof(s_static_table) / sizeof(s_static_table[0]);
+
+// RFC 7541 附录B huffman编码表，下标为符号(256为EOS)
+// RFC 7541 Appendix B huffman code, indexed by symbol (256 is EOS)
+static const struct {
+    uint32_t code;
+    uint8_t bits;
+} s_huffman_table[] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28},
+    {0xfffffe6, 28}, {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28}, {0xfffffed, 28}, {0xfffffee, 28},
+    {0xfffffef, 28}, {0xffffff0, 28}, {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28},
+    {0xffffffa, 28}, {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10},
+    {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6},
+    {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6},
+    {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7},
+    {0x69, 7}, {0x6a, 7}, {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8}, {0x73, 7},
+    {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5},
+    {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7},
+    {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14},
+    {0x1ffd, 13}, {0xffffffc, 28}, {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23},
+    {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24}, {0x7fffe1, 23},
+    {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21},
+    {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22},
+    {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22},
+    {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22}, {0x7ffff2, 23},
+    {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21},
+    {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27},
+    {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22}, {0x3fffeb, 22},
+    {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27},
+    {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26}, {0x3fffffff, 30},
+};
+
+// huffman解码树，节点的两个子节点下标为0时表示不存在，叶子节点的symbol为符号值
+// The huffman decoding tree, a child index of 0 means none, the symbol of a leaf node is the decoded value
+struct HuffmanNode {
+    uint16_t child[2] = { 0, 0 };
+    int16_t symbol = -1;
+};
+
+static const vector<HuffmanNode> &getHuffmanTree() {
+    static vector<HuffmanNode> s_tree;
+    static onceToken token([]() {
+        s_tree.reserve(512);
+        s_tree.emplace_back();
+        for (int symbol = 0; symbol < 257; ++symbol) {
+            auto &item = s_huffman_table[symbol];
+            size_t node = 0;
+            for (int bit = item.bits - 1; bit >= 0; --bit) {
+                auto b = (item.code >> bit) & 0x01;
+                if (!s_tree[node].child[b]) {
+                    s_tree[node].child[b] = (uint16_t)s_tree.size();
+                    s_tree.emplace_back();
+                }
+                node = s_tree[node].child[b];
+            }
+            s_tree[node].symbol = symbol;
+        }
+    });
+    return s_tree;
+}
+
+static bool huffmanDecode(const uint8_t *ptr, size_t size, string &out) {
+    auto &tree = getHuffmanTree();
+    size_t node = 0;
+    // 当前未完成符号的比特数以及是否全为1，用于校验结尾的填充
+    // The bit count of the pending symbol and whether they are all ones, used to validate the trailing padding
+    size_t depth = 0;
+    bool all_ones = true;
+    for (size_t i = 0; i < size; ++i) {
+        for (int bit = 7; bit >= 0; --bit) {
+            auto b = (ptr[i] >> bit) & 0x01;
+            node = tree[node].child[b];
+            if (!node) {
+                return false;
+            }
+            ++depth;
+            all_ones = all_ones && b;
+            auto symbol = tree[node].symbol;
+            if (symbol < 0) {
+                continue;
+            }
+            if (symbol == 256) {
+                // 不允许出现EOS
+                // EOS must not appear
+                return false;
+            }
+            out.push_back((char)symbol);
+            node = 0;
+            depth = 0;
+            all_ones = true;
+        }
+    }
+    // 填充必须是EOS的前缀(全1)且不超过7比特
+    // The padding must be a prefix of EOS (all ones) and no longer than 7 bits
+    return depth < 8 && all_ones;
+}
+
+static bool decodeInteger(const uint8_t *&ptr, const uint8_t *end, int prefix_bits, uint64_t &value) {
+    if (ptr >= end) {
+        return false;
+    }
+    uint64_t max_prefix = (1 << prefix_bits) - 1;
+    value = *ptr++ & max_prefix;
+    if (value < max_prefix) {
+        return true;
+    }
+    for (int shift = 0; ptr < end; shift += 7) {
+        if (shift > 28) {
+            // 整数过大
+            // The integer is too large
+            return false;
+        }
+        auto byte = *ptr++;
+        value += (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool decodeString(const uint8_t *&ptr, const uint8_t *end, string &out) {
+    if (ptr >= end) {
+        return false;
+    }
+    bool huffman = *ptr & 0x80;
+    uint64_t len;
+    if (!decodeInteger(ptr, end, 7, len) || len > (uint64_t)(end - ptr)) {
+        return false;
+    }
+    out.clear();
+    if (huffman) {
+        out.reserve(len * 8 / 5);
+        if (!huffmanDecode(ptr, len, out)) {
+            return false;
+        }
+    } else {
+        out.assign((const char *)ptr, len);
+    }
+    ptr += len;
+    return true;
+}
+
+static void encodeInteger(uint8_t flags, int prefix_bits, uint64_t value, string &out) {
+    uint64_t max_prefix = (1 << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out.push_back((char)(flags | value));
+        return;
+    }
+    out.push_back((char)(flags | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out.push_back((char)(0x80 | (value & 0x7F)));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static void encodeString(const string &str, string &out) {
+    // 不使用huffman编码，节省cpu
+    // Do not use huffman coding to save cpu
+    encodeInteger(0x00, 7, str.size(), out);
+    out.append(str);
+}
+
+bool HpackDecoder::decode(const uint8_t *ptr, size_t size, HeaderList &headers) {
+    auto end = ptr + size;
+    size_t list_size = 0;
+    // 动态表大小更新只能出现在头部块的开头
+    // A dynamic table size update may only appear at the beginning of a header block
+    bool allow_size_update = true;
+    string name, value;
+    while (ptr < end) {
+        auto byte = *ptr;
+        uint64_t index;
+        if (byte & 0x80) {
+            // 索引头部字段
+            // Indexed header field
+            if (!decodeInteger(ptr, end, 7, index) || !getEntry(index, name, value)) {
+                return false;
+            }
+        } else if ((byte & 0xE0) == 0x20) {
+            // 动态表大小更新
+            // Dynamic table size update
+            if (!allow_size_update || !decodeInteger(ptr, end, 5, index) || index > _settings_table_size) {
+                return false;
+            }
+            _max_table_size = index;
+            evict(_max_table_size);
+            continue;
+        } else {
+            // 字面量头部字段，0x40为加入动态表，0x00为不加入，0x10为永不加入
+            // Literal header field, 0x40 with incremental indexing, 0x00 without indexing, 0x10 never indexed
+            bool indexing = byte & 0x40;
+            if (!decodeInteger(ptr, end, indexing ? 6 : 4, index)) {
+                return false;
+            }
+            if (index) {
+                string unused;
+                if (!getEntry(index, name, unused)) {
+                    return false;
+                }
+            } else if (!decodeString(ptr, end, name)) {
+                return false;
+            }
+            if (!decodeString(ptr, end, value)) {
+                return false;
+            }
+            if (indexing) {
+                addEntry(name, value);
+            }
+        }
+        allow_size_update = false;
+        list_size += name.size() + value.size() + 32;
+        if (list_size > _max_header_list_size) {
+            return false;
+        }
+        headers.emplace_back(std::move(name), std::move(value));
+    }
+    return true;
+}
+
+void HpackDecoder::setMaxTableSize(size_t size) {
+    _settings_table_size = size;
+    if (_max_table_size > size) {
+        _max_table_size = size;
+        evict(_max_table_size);
+    }
+}
+
+void HpackDecoder::setMaxHeaderListSize(size_t size) {
+    _max_header_list_size = size;
+}
+
+bool HpackDecoder::getEntry(uint64_t index, string &name, string &value) const {
+    if (!index) {
+        return false;
+    }
+    if (index <= kStaticTableSize) {
+        name = s_static_table[index - 1].first;
+        value = s_static_table[index - 1].second;
+        return true;
+    }
+    index -= kStaticTableSize + 1;
+    if (index >= _table.size()) {
+        return false;
+    }
+    name = _table[index].first;
+    value = _table[index].second;
+    return true;
+}
+
+void HpackDecoder::addEntry(string name, string value) {
+    auto entry_size = name.size() + value.size() + 32;
+    if (entry_size > _max_table_size) {
+        // 条目大于动态表时清空动态表
+        // An entry larger than the table empties the table
+        evict(0);
+        return;
+    }
+    evict(_max_table_size - entry_size);
+    _table_size += entry_size;
+    _table.emplace_front(std::move(name), std::move(value));
+}
+
+void HpackDecoder::evict(size_t max_size) {
+    while (_table_size > max_size) {
+        auto &back = _table.back();
+        _table_size -= back.first.size() + back.second.size() + 32;
+        _table.pop_back();
+    }
+}
+
+void HpackEncoder::encode(const string &name_in, const string &value, string &out) const {
+    static unordered_map<string, size_t> s_name_index;
+    static unordered_map<string, size_t> s_pair_index;
+    static onceToken token([]() {
+        for (size_t i = 0; i < kStaticTableSize; ++i) {
+            auto &item = s_static_table[i];
+            // 同名条目取第一个
+            // Take the first entry for duplicated names
+            s_name_index.emplace(item.first, i + 1);
+            if (*item.second) {
+                s_pair_index.emplace(string(item.first) + '\0' + item.second, i + 1);
+            }
+        }
+    });
+
+    auto name = strToLower(string(name_in));
+    auto it = s_pair_index.find(name + '\0' + value);
+    if (it != s_pair_index.end()) {
+        // 静态表快速路径：名称与值都命中，1个字节
+        // Static table fast path: both name and value hit, a single byte
+        encodeInteger(0x80, 7, it->second, out);
+        return;
+    }
+    // 字面量且不加入动态表
+    // Literal without indexing
+    auto name_it = s_name_index.find(name);
+    if (name_it != s_name_index.end()) {
+        encodeInteger(0x00, 4, name_it->second, out);
+    } else {
+        encodeInteger(0x00, 4, 0, out);
+        encodeString(name, out);
+    }
+    encodeString(value, out);
+}
+
+} // namespace mediakit
@@ -0,0 +1,86 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_HPACK_H
+#define ZLMEDIAKIT_HPACK_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace mediakit {
+
+/**
+ * HPACK(RFC 7541)头部解压器，支持静态表、动态表与huffman编码，每个http2连接一个实例
+ * HPACK (RFC 7541) header decompressor, supports the static table, the dynamic table and huffman coding, one instance per http2 connection
+ */
+class HpackDecoder {
+public:
+    using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+    /**
+     * 解压一个完整的头部块
+     * @param ptr 头部块数据
+     * @param size 头部块长度
+     * @param headers 解压出的头部，按出现顺序排列
+     * @return false代表压缩错误(COMPRESSION_ERROR)，连接必须关闭
+     * Decompress a complete header block
+     * @param ptr Header block data
+     * @param size Header block length
+     * @param headers The decompressed headers in the order they appear
+     * @return false means a compression error (COMPRESSION_ERROR), the connection must be closed
+     */
+    bool decode(const uint8_t *ptr, size_t size, HeaderList &headers);
+
+    /**
+     * 设置本端通告的SETTINGS_HEADER_TABLE_SIZE，对端的动态表大小更新不能超过该值
+     * Set the SETTINGS_HEADER_TABLE_SIZE advertised by us, table size updates of the peer must not exceed it
+     */
+    void setMaxTableSize(size_t size);
+
+    /**
+     * 设置头部列表解压后的最大字节数，防止压缩炸弹
+     * Set the max bytes of a decompressed header list to guard against compression bombs
+     */
+    void setMaxHeaderListSize(size_t size);
+
+private:
+    bool getEntry(uint64_t index, std::string &name, std::string &value) const;
+    void addEntry(std::string name, std::string value);
+    void evict(size_t max_size);
+
+private:
+    size_t _table_size = 0;
+    size_t _max_table_size = 4096;
+    size_t _settings_table_size = 4096;
+    size_t _max_header_list_size = 64 * 1024;
+    // 动态表，最新的条目在前面
+    // The dynamic table, the newest entry comes first
+    std::deque<std::pair<std::string, std::string>> _table;
+};
+
+/**
+ * HPACK头部压缩器，只使用静态表：名称与值都命中时只需1个字节，否则用字面量且不加入动态表，
+ * 因此不需要维护动态表状态，也不受对端SETTINGS_HEADER_TABLE_SIZE影响
+ * HPACK header compressor that only uses the static table: a name and value hit takes a single byte, otherwise
+ * a literal is emitted without indexing, so no dynamic table state is kept and the peer SETTINGS_HEADER_TABLE_SIZE does not matter
+ */
+class HpackEncoder {
+public:
+    /**
+     * 压缩一个头部并追加到out，名称会转换为小写
+     * Compress a header and append it to out, the name is converted to lower case
+     */
+    void encode(const std::string &name, const std::string &value, std::string &out) const;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_HPACK_H
@@ -0,0 +1,670 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+#include "Http2Splitter.h"
+#include "Util/logger.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static const char kConnectionPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+static constexpr size_t kConnectionPrefaceSize = sizeof(kConnectionPreface) - 1;
+
+static constexpr size_t kFrameHeaderSize = 9;
+// 本端不修改SETTINGS_MAX_FRAME_SIZE与SETTINGS_INITIAL_WINDOW_SIZE，使用协议默认值
+// SETTINGS_MAX_FRAME_SIZE and SETTINGS_INITIAL_WINDOW_SIZE are left at the protocol defaults on our side
+static constexpr size_t kMaxFrameSize = 16384;
+static constexpr int64_t kInitialWindowSize = 65535;
+static constexpr int64_t kMaxWindowSize = 0x7FFFFFFF;
+static constexpr uint32_t kMaxConcurrentStreams = 128;
+
+enum FrameType : uint8_t {
+    kData = 0x0,
+    kHeaders = 0x1,
+    kPriority = 0x2,
+    kRstStream = 0x3,
+    kSettings = 0x4,
+    kPushPromise = 0x5,
+    kPing = 0x6,
+    kGoAway = 0x7,
+    kWindowUpdate = 0x8,
+    kContinuation = 0x9,
+};
+
+enum FrameFlag : uint8_t {
+    kEndStream = 0x1,
+    kAck = 0x1,
+    kEndHeaders = 0x4,
+    kPadded = 0x8,
+    kPriorityFlag = 0x20,
+};
+
+enum SettingId : uint16_t {
+    kHeaderTableSize = 0x1,
+    kEnablePush = 0x2,
+    kMaxConcurrentStreamsId = 0x3,
+    kInitialWindowSizeId = 0x4,
+    kMaxFrameSizeId = 0x5,
+    kMaxHeaderListSize = 0x6,
+};
+
+static inline uint32_t load_be24(const uint8_t *p) {
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void save_be32(uint8_t *p, uint32_t val) {
+    p[0] = val >> 24;
+    p[1] = val >> 16;
+    p[2] = val >> 8;
+    p[3] = val;
+}
+
+static void makeFrameHeader(uint8_t *p, size_t size, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    p[0] = size >> 16;
+    p[1] = size >> 8;
+    p[2] = size;
+    p[3] = type;
+    p[4] = flags;
+    save_be32(p + 5, stream_id & 0x7FFFFFFF);
+}
+
+// 去掉PADDED标志带来的填充
+// Strip the padding of the PADDED flag
+static bool stripPadding(uint8_t flags, const uint8_t *&ptr, size_t &size) {
+    if (!(flags & kPadded)) {
+        return true;
+    }
+    if (size < 1 || ptr[0] >= size) {
+        return false;
+    }
+    size -= 1 + ptr[0];
+    ptr += 1;
+    return true;
+}
+
+void Http2Splitter::startHttp2(size_t preface_received) {
+    _preface_offset = preface_received;
+    _decoder.setMaxHeaderListSize(_max_body_size);
+
+    // 服务端连接前言：SETTINGS帧
+    // The server connection preface: a SETTINGS frame
+    uint8_t settings[6];
+    settings[0] = 0;
+    settings[1] = kMaxConcurrentStreamsId;
+    save_be32(settings + 2, kMaxConcurrentStreams);
+    sendFrame(kSettings, 0, 0, settings, sizeof(settings));
+}
+
+void Http2Splitter::setHttp2MaxBodySize(size_t size) {
+    _max_body_size = size;
+}
+
+void Http2Splitter::inputHttp2(const char *data, size_t len) {
+    if (_closed) {
+        return;
+    }
+    while (_preface_offset < kConnectionPrefaceSize && len) {
+        if (*data != kConnectionPreface[_preface_offset]) {
+            connectionError(kProtocolError, "invalid http2 connection preface");
+            return;
+        }
+        ++data;
+        --len;
+        ++_preface_offset;
+    }
+
+    const uint8_t *ptr = (const uint8_t *)data;
+    const uint8_t *end = ptr + len;
+    // 上次剩余的不完整帧，与本次数据拼接
+    // The incomplete frame left last time, spliced with this input
+    string remain;
+    if (!_remain_data.empty()) {
+        remain = std::move(_remain_data);
+        _remain_data.clear();
+        remain.append(data, len);
+        ptr = (const uint8_t *)remain.data();
+        end = ptr + remain.size();
+    }
+
+    while (!_closed && end - ptr >= (ssize_t)kFrameHeaderSize) {
+        auto size = load_be24(ptr);
+        if (size > kMaxFrameSize) {
+            connectionError(kFrameSizeError, StrPrinter << "http2 frame is too large: " << size);
+            return;
+        }
+        if (end - ptr < (ssize_t)(kFrameHeaderSize + size)) {
+            break;
+        }
+        auto type = ptr[3];
+        auto flags = ptr[4];
+        auto stream_id = load_be32(ptr + 5) & 0x7FFFFFFF;
+        auto payload = ptr + kFrameHeaderSize;
+        ptr += kFrameHeaderSize + size;
+        if (!onFrame(type, flags, stream_id, payload, size)) {
+            return;
+        }
+    }
+    if (!_closed && ptr < end) {
+        _remain_data.assign((const char *)ptr, end - ptr);
+    }
+}
+
+bool Http2Splitter::onFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size) {
+    if (!_got_settings && type != kSettings) {
+        return connectionError(kProtocolError, "the first http2 frame is not SETTINGS");
+    }
+    if (_continuation_stream_id && type != kContinuation) {
+        return connectionError(kProtocolError, "expect http2 CONTINUATION frame");
+    }
+
+    switch (type) {
+        case kData: return onDataFrame(flags, stream_id, ptr, size);
+        case kHeaders: return onHeadersFrame(flags, stream_id, ptr, size);
+        case kContinuation: {
+            if (!_continuation_stream_id || stream_id != _continuation_stream_id) {
+                return connectionError(kProtocolError, "unexpected http2 CONTINUATION frame");
+            }
+            _header_block.append((const char *)ptr, size);
+            if (_header_block.size() > _max_body_size) {
+                return connectionError(kEnhanceYourCalm, "http2 header block is too large");
+            }
+            if (!(flags & kEndHeaders)) {
+                return true;
+            }
+            _continuation_stream_id = 0;
+            return onHeaderBlock(stream_id, _continuation_flags & kEndStream);
+        }
+        case kPriority: {
+            if (!stream_id) {
+                return connectionError(kProtocolError, "http2 PRIORITY frame on stream 0");
+            }
+            if (size != 5) {
+                resetHttp2Stream(stream_id, kFrameSizeError);
+            }
+            // 不支持优先级，发送时按轮询调度
+            // Priorities are ignored, streams are scheduled round robin
+            return true;
+        }
+        case kRstStream: {
+            if (!stream_id || stream_id > _last_stream_id) {
+                return connectionError(kProtocolError, "invalid http2 RST_STREAM frame");
+            }
+            if (size != 4) {
+                return connectionError(kFrameSizeError, "invalid http2 RST_STREAM frame size");
+            }
+            auto it = _streams.find(stream_id);
+            if (it != _streams.end()) {
+                _streams.erase(it);
+                onHttp2StreamClosed(stream_id, (ErrorCode)load_be32(ptr));
+            }
+            return true;
+        }
+        case kSettings: return onSettingsFrame(flags, stream_id, ptr, size);
+        case kPushPromise: return connectionError(kProtocolError, "http2 client can not send PUSH_PROMISE");
+        case kPing: {
+            if (stream_id) {
+                return connectionError(kProtocolError, "http2 PING frame on non-zero stream");
+            }
+            if (size != 8) {
+                return connectionError(kFrameSizeError, "invalid http2 PING frame size");
+            }
+            if (!(flags & kAck)) {
+                sendFrame(kPing, kAck, 0, ptr, size);
+            }
+            return true;
+        }
+        case kGoAway: {
+            if (stream_id || size < 8) {
+                return connectionError(kProtocolError, "invalid http2 GOAWAY frame");
+            }
+            auto error_code = load_be32(ptr + 4);
+            if (error_code != kNoError) {
+                _closed = true;
+                onHttp2Error(StrPrinter << "recv http2 GOAWAY, error code: " << error_code);
+                return false;
+            }
+            // 对端正常关闭，不再接受新的流，已有的流完成后再关闭连接
+            // The peer closes gracefully, no new stream is accepted and the connection is closed after the existing streams finish
+            _goaway = true;
+            if (_streams.empty()) {
+                return connectionError(kNoError, "recv http2 GOAWAY");
+            }
+            return true;
+        }
+        case kWindowUpdate: return onWindowUpdateFrame(stream_id, ptr, size);
+        // 忽略未知类型的帧
+        // Frames of unknown types are ignored
+        default: return true;
+    }
+}
+
+bool Http2Splitter::onHeadersFrame(uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size) {
+    if (!stream_id || !(stream_id & 0x01)) {
+        return connectionError(kProtocolError, "invalid http2 HEADERS stream id");
+    }
+    if (!stripPadding(flags, ptr, size)) {
+        return connectionError(kProtocolError, "invalid http2 HEADERS padding");
+    }
+    if (flags & kPriorityFlag) {
+        if (size < 5) {
+            return connectionError(kFrameSizeError, "invalid http2 HEADERS priority");
+        }
+        ptr += 5;
+        size -= 5;
+    }
+    _header_block.assign((const char *)ptr, size);
+    if (!(flags & kEndHeaders)) {
+        _continuation_stream_id = stream_id;
+        _continuation_flags = flags;
+        return true;
+    }
+    return onHeaderBlock(stream_id, flags & kEndStream);
+}
+
+bool Http2Splitter::onHeaderBlock(uint32_t stream_id, bool end_stream) {
+    // 即使流会被拒绝，也必须解压头部块以保持HPACK状态一致
+    // The header block must be decompressed even if the stream is refused to keep the HPACK state in sync
+    HeaderList headers;
+    auto ok = _decoder.decode((const uint8_t *)_header_block.data(), _header_block.size(), headers);
+    _header_block.clear();
+    if (!ok) {
+        return connectionError(kCompressionError, "http2 hpack decode failed");
+    }
+
+    auto it = _streams.find(stream_id);
+    if (it != _streams.end()) {
+        // 请求trailer，必须带END_STREAM
+        // Request trailers, END_STREAM is required
+        if (it->second.remote_closed || !end_stream) {
+            resetHttp2Stream(stream_id, it->second.remote_closed ? kStreamClosed : kProtocolError);
+            return true;
+        }
+        onRequestComplete(stream_id);
+        return true;
+    }
+
+    if (stream_id <= _last_stream_id) {
+        return connectionError(kStreamClosed, "http2 HEADERS on closed stream");
+    }
+    _last_stream_id = stream_id;
+    if (_goaway || _streams.size() >= kMaxConcurrentStreams) {
+        resetHttp2Stream(stream_id, kRefusedStream);
+        return true;
+    }
+
+    auto &stream = _streams[stream_id];
+    stream.send_window = _peer_initial_window;
+    stream.recv_window = kInitialWindowSize;
+    stream.headers = std::move(headers);
+    if (end_stream) {
+        onRequestComplete(stream_id);
+    }
+    return true;
+}
+
+bool Http2Splitter::onDataFrame(uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size) {
+    if (!stream_id) {
+        return connectionError(kProtocolError, "http2 DATA frame on stream 0");
+    }
+    // 连接级流控计入整个帧(包括填充)
+    // Connection level flow control counts the whole frame (including padding)
+    if ((int64_t)size > _recv_window) {
+        return connectionError(kFlowControlError, "http2 connection receive window exceeded");
+    }
+    _recv_window -= size;
+    if (_recv_window < kInitialWindowSize / 2) {
+        sendWindowUpdate(0, kInitialWindowSize - _recv_window);
+        _recv_window = kInitialWindowSize;
+    }
+
+    auto frame_size = size;
+    if (!stripPadding(flags, ptr, size)) {
+        return connectionError(kProtocolError, "invalid http2 DATA padding");
+    }
+
+    auto it = _streams.find(stream_id);
+    if (it == _streams.end() || it->second.remote_closed) {
+        if (stream_id > _last_stream_id) {
+            return connectionError(kProtocolError, "http2 DATA frame on idle stream");
+        }
+        resetHttp2Stream(stream_id, kStreamClosed);
+        return true;
+    }
+
+    auto &stream = it->second;
+    if ((int64_t)frame_size > stream.recv_window) {
+        resetHttp2Stream(stream_id, kFlowControlError);
+        return true;
+    }
+    stream.recv_window -= frame_size;
+    if (stream.content.size() + size > _max_body_size) {
+        WarnL << "http2 request body is too large, stream: " << stream_id;
+        resetHttp2Stream(stream_id, kRefusedStream);
+        return true;
+    }
+    stream.content.append((const char *)ptr, size);
+
+    if (flags & kEndStream) {
+        onRequestComplete(stream_id);
+        return true;
+    }
+    if (stream.recv_window < kInitialWindowSize / 2) {
+        sendWindowUpdate(stream_id, kInitialWindowSize - stream.recv_window);
+        stream.recv_window = kInitialWindowSize;
+    }
+    return true;
+}
+
+bool Http2Splitter::onSettingsFrame(uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size) {
+    if (stream_id) {
+        return connectionError(kProtocolError, "http2 SETTINGS frame on non-zero stream");
+    }
+    if (flags & kAck) {
+        if (size) {
+            return connectionError(kFrameSizeError, "http2 SETTINGS ack with payload");
+        }
+        return true;
+    }
+    if (size % 6) {
+        return connectionError(kFrameSizeError, "invalid http2 SETTINGS frame size");
+    }
+    _got_settings = true;
+    for (auto end = ptr + size; ptr < end; ptr += 6) {
+        uint16_t id = (ptr[0] << 8) | ptr[1];
+        auto value = load_be32(ptr + 2);
+        switch (id) {
+            case kEnablePush: {
+                if (value > 1) {
+                    return connectionError(kProtocolError, "invalid http2 SETTINGS_ENABLE_PUSH");
+                }
+                break;
+            }
+            case kInitialWindowSizeId: {
+                if (value > kMaxWindowSize) {
+                    return connectionError(kFlowControlError, "invalid http2 SETTINGS_INITIAL_WINDOW_SIZE");
+                }
+                // 初始窗口变化时调整所有流的发送窗口
+                // Adjust the send window of all streams when the initial window changes
+                int64_t delta = (int64_t)value - _peer_initial_window;
+                for (auto &pr : _streams) {
+                    pr.second.send_window += delta;
+                    if (pr.second.send_window > kMaxWindowSize) {
+                        return connectionError(kFlowControlError, "http2 stream send window overflow");
+                    }
+                }
+                _peer_initial_window = value;
+                break;
+            }
+            case kMaxFrameSizeId: {
+                if (value < 16384 || value > 0xFFFFFF) {
+                    return connectionError(kProtocolError, "invalid http2 SETTINGS_MAX_FRAME_SIZE");
+                }
+                _peer_max_frame_size = value;
+                break;
+            }
+            // 本端编码器不使用动态表，忽略SETTINGS_HEADER_TABLE_SIZE
+            // Our encoder does not use the dynamic table, so SETTINGS_HEADER_TABLE_SIZE is ignored
+            default: break;
+        }
+    }
+    sendFrame(kSettings, kAck, 0, nullptr, 0);
+    flushHttp2Streams();
+    return true;
+}
+
+bool Http2Splitter::onWindowUpdateFrame(uint32_t stream_id, const uint8_t *ptr, size_t size) {
+    if (size != 4) {
+        return connectionError(kFrameSizeError, "invalid http2 WINDOW_UPDATE frame size");
+    }
+    auto increment = load_be32(ptr) & 0x7FFFFFFF;
+    if (!stream_id) {
+        if (!increment) {
+            return connectionError(kProtocolError, "http2 WINDOW_UPDATE with zero increment");
+        }
+        _send_window += increment;
+        if (_send_window > kMaxWindowSize) {
+            return connectionError(kFlowControlError, "http2 connection send window overflow");
+        }
+        flushHttp2Streams();
+        return true;
+    }
+
+    auto it = _streams.find(stream_id);
+    if (it == _streams.end()) {
+        if (stream_id > _last_stream_id) {
+            return connectionError(kProtocolError, "http2 WINDOW_UPDATE on idle stream");
+        }
+        // 已关闭的流可能仍会收到WINDOW_UPDATE
+        // WINDOW_UPDATE may still arrive on a closed stream
+        return true;
+    }
+    if (!increment) {
+        resetHttp2Stream(stream_id, kProtocolError);
+        return true;
+    }
+    it->second.send_window += increment;
+    if (it->second.send_window > kMaxWindowSize) {
+        resetHttp2Stream(stream_id, kFlowControlError);
+        return true;
+    }
+    flushHttp2Streams();
+    return true;
+}
+
+void Http2Splitter::onRequestComplete(uint32_t stream_id) {
+    auto &stream = _streams[stream_id];
+    stream.remote_closed = true;
+    auto headers = std::move(stream.headers);
+    auto content = std::move(stream.content);
+    // 回调中可能修改_streams，此后不能再使用stream引用
+    // _streams may be modified in the callback, the stream reference must not be used afterwards
+    onHttp2Request(stream_id, headers, content);
+}
+
+bool Http2Splitter::connectionError(ErrorCode error_code, const string &err) {
+    if (_closed) {
+        return false;
+    }
+    uint8_t payload[8];
+    save_be32(payload, _last_stream_id);
+    save_be32(payload + 4, error_code);
+    sendFrame(kGoAway, 0, 0, payload, sizeof(payload));
+    _closed = true;
+    onHttp2Error(err);
+    return false;
+}
+
+void Http2Splitter::sendFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const void *payload, size_t size) {
+    auto buffer = BufferRaw::create();
+    buffer->setCapacity(kFrameHeaderSize + size + 1);
+    makeFrameHeader((uint8_t *)buffer->data(), size, type, flags, stream_id);
+    if (size) {
+        memcpy(buffer->data() + kFrameHeaderSize, payload, size);
+    }
+    buffer->setSize(kFrameHeaderSize + size);
+    onHttp2SendData(std::move(buffer));
+}
+
+void Http2Splitter::sendWindowUpdate(uint32_t stream_id, uint32_t increment) {
+    uint8_t payload[4];
+    save_be32(payload, increment);
+    sendFrame(kWindowUpdate, 0, stream_id, payload, sizeof(payload));
+}
+
+void Http2Splitter::sendHttp2Headers(uint32_t stream_id, const HeaderList &headers, bool end_stream) {
+    auto it = _streams.find(stream_id);
+    if (_closed || it == _streams.end() || it->second.local_closed) {
+        return;
+    }
+    string block;
+    block.reserve(256);
+    for (auto &pr : headers) {
+        _encoder.encode(pr.first, pr.second, block);
+    }
+
+    // 超过对端最大帧长度时拆分为HEADERS + CONTINUATION
+    // Split into HEADERS + CONTINUATION when exceeding the max frame size of the peer
+    size_t offset = 0;
+    uint8_t type = kHeaders;
+    do {
+        auto size = std::min<size_t>(block.size() - offset, _peer_max_frame_size);
+        uint8_t flags = offset + size == block.size() ? kEndHeaders : 0;
+        if (type == kHeaders && end_stream) {
+            flags |= kEndStream;
+        }
+        sendFrame(type, flags, stream_id, block.data() + offset, size);
+        offset += size;
+        type = kContinuation;
+    } while (offset < block.size());
+
+    if (end_stream) {
+        it->second.local_closed = true;
+        if (it->second.remote_closed) {
+            closeStream(stream_id, kNoError);
+        }
+    }
+}
+
+void Http2Splitter::sendHttp2Data(uint32_t stream_id, const Buffer::Ptr &buffer, bool end_stream) {
+    auto it = _streams.find(stream_id);
+    if (_closed || it == _streams.end() || it->second.local_closed || it->second.end_pending) {
+        return;
+    }
+    auto &stream = it->second;
+    if (buffer && buffer->size()) {
+        stream.pending_size += buffer->size();
+        stream.pending.emplace_back(buffer);
+    }
+    stream.end_pending = end_stream;
+    if (sendStreamData(stream_id, stream, SIZE_MAX) && stream.local_closed && stream.remote_closed) {
+        closeStream(stream_id, kNoError);
+    }
+}
+
+bool Http2Splitter::sendStreamData(uint32_t stream_id, Stream &stream, size_t max_frames) {
+    size_t frames = 0;
+    while (!stream.pending.empty() && frames < max_frames) {
+        auto window = std::min(_send_window, stream.send_window);
+        if (window <= 0) {
+            break;
+        }
+        auto front = stream.pending.front();
+        auto size = std::min<size_t>({ front->size() - stream.pending_offset, (size_t)window, (size_t)_peer_max_frame_size });
+        auto last = stream.pending.size() == 1 && stream.pending_offset + size == front->size();
+        uint8_t flags = (last && stream.end_pending) ? kEndStream : 0;
+
+        // 帧头与负载分开发送，负载引用原始buffer，避免拷贝
+        // The frame header and the payload are sent separately, the payload references the original buffer to avoid copying
+        auto header = BufferRaw::create();
+        header->setCapacity(kFrameHeaderSize + 1);
+        makeFrameHeader((uint8_t *)header->data(), size, kData, flags, stream_id);
+        header->setSize(kFrameHeaderSize);
+        onHttp2SendData(std::move(header));
+        onHttp2SendData(std::make_shared<BufferOffset<Buffer::Ptr>>(front, stream.pending_offset, size));
+
+        ++frames;
+        _send_window -= size;
+        stream.send_window -= size;
+        stream.pending_size -= size;
+        stream.pending_offset += size;
+        if (stream.pending_offset == front->size()) {
+            stream.pending.pop_front();
+            stream.pending_offset = 0;
+        }
+        if (flags & kEndStream) {
+            stream.local_closed = true;
+        }
+    }
+    if (stream.pending.empty() && stream.end_pending && !stream.local_closed && frames < max_frames) {
+        // 没有数据，只发送空的DATA帧结束流
+        // No data left, send an empty DATA frame to end the stream
+        sendFrame(kData, kEndStream, stream_id, nullptr, 0);
+        stream.local_closed = true;
+        ++frames;
+    }
+    return frames > 0;
+}
+
+void Http2Splitter::flushHttp2Streams() {
+    if (_closed) {
+        return;
+    }
+    // 每个流每轮最多发送一帧，轮询直到窗口耗尽或没有排队数据
+    // Each stream sends at most one frame per round, loop until the windows are exhausted or nothing is queued
+    vector<uint32_t> finished;
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (auto &pr : _streams) {
+            auto &stream = pr.second;
+            if (stream.local_closed || !sendStreamData(pr.first, stream, 1)) {
+                continue;
+            }
+            progress = true;
+            if (stream.local_closed && stream.remote_closed) {
+                finished.emplace_back(pr.first);
+            }
+        }
+    }
+    for (auto stream_id : finished) {
+        closeStream(stream_id, kNoError);
+    }
+
+    // 通知可继续写入的流，回调中可能修改_streams，先收集
+    // Notify the writable streams, _streams may be modified in the callbacks so collect them first
+    vector<uint32_t> writable;
+    for (auto &pr : _streams) {
+        auto &stream = pr.second;
+        if (!stream.local_closed && !stream.end_pending && stream.pending.empty() && stream.send_window > 0) {
+            writable.emplace_back(pr.first);
+        }
+    }
+    for (auto stream_id : writable) {
+        if (_closed || _send_window <= 0) {
+            break;
+        }
+        onHttp2StreamWritable(stream_id);
+    }
+}
+
+void Http2Splitter::resetHttp2Stream(uint32_t stream_id, ErrorCode error_code) {
+    if (_closed) {
+        return;
+    }
+    uint8_t payload[4];
+    save_be32(payload, error_code);
+    sendFrame(kRstStream, 0, stream_id, payload, sizeof(payload));
+    if (_streams.find(stream_id) != _streams.end()) {
+        closeStream(stream_id, error_code);
+    }
+}
+
+void Http2Splitter::closeStream(uint32_t stream_id, ErrorCode error_code) {
+    _streams.erase(stream_id);
+    onHttp2StreamClosed(stream_id, error_code);
+    if (_goaway && _streams.empty()) {
+        // 对端GOAWAY后最后一个流结束
+        // The last stream finished after the GOAWAY of the peer
+        connectionError(kNoError, "recv http2 GOAWAY, all streams finished");
+    }
+}
+
+size_t Http2Splitter::getHttp2PendingSize(uint32_t stream_id) const {
+    auto it = _streams.find(stream_id);
+    return it == _streams.end() ? 0 : it->second.pending_size;
+}
+
+} // namespace mediakit
@@ -0,0 +1,194 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_HTTP2SPLITTER_H
+#define ZLMEDIAKIT_HTTP2SPLITTER_H
+
+#include <map>
+#include <deque>
+#include <string>
+#include "Hpack.h"
+#include "Network/Buffer.h"
+
+namespace mediakit {
+
+/**
+ * http2(RFC 9113)服务端帧解析与封装，负责连接前言、SETTINGS、流状态、HPACK以及连接与流两级流控，
+ * 不关心请求语义，收到完整请求(头部+body)后通过onHttp2Request回调
+ * Server side http2 (RFC 9113) framing, handles the connection preface, SETTINGS, stream states, HPACK and
+ * the connection and stream level flow control; request semantics are left to the subclass through onHttp2Request
+ */
+class Http2Splitter {
+public:
+    using HeaderList = HpackDecoder::HeaderList;
+
+    enum ErrorCode : uint32_t {
+        kNoError = 0x0,
+        kProtocolError = 0x1,
+        kInternalError = 0x2,
+        kFlowControlError = 0x3,
+        kSettingsTimeout = 0x4,
+        kStreamClosed = 0x5,
+        kFrameSizeError = 0x6,
+        kRefusedStream = 0x7,
+        kCancel = 0x8,
+        kCompressionError = 0x9,
+        kConnectError = 0xa,
+        kEnhanceYourCalm = 0xb,
+        kInadequateSecurity = 0xc,
+        kHttp11Required = 0xd,
+    };
+
+    virtual ~Http2Splitter() = default;
+
+    /**
+     * 开始http2会话，发送服务端SETTINGS
+     * @param preface_received 已经被http/1.1解析器消费的连接前言字节数
+     * Start the http2 session and send the server SETTINGS
+     * @param preface_received The bytes of the connection preface already consumed by the http/1.1 parser
+     */
+    void startHttp2(size_t preface_received);
+
+    /**
+     * 输入收到的数据，可能是不完整的帧或多个帧
+     * Input received data, may be an incomplete frame or several frames
+     */
+    void inputHttp2(const char *data, size_t len);
+
+    /**
+     * 发送响应头部
+     * Send the response headers
+     */
+    void sendHttp2Headers(uint32_t stream_id, const HeaderList &headers, bool end_stream);
+
+    /**
+     * 发送响应body，受流控限制时在本对象内排队，窗口更新后继续发送
+     * @param buffer 数据，可以为空(仅结束流)
+     * Send response body data, queued in this object while blocked by flow control and resumed after window updates
+     * @param buffer Data, may be null (only ends the stream)
+     */
+    void sendHttp2Data(uint32_t stream_id, const toolkit::Buffer::Ptr &buffer, bool end_stream);
+
+    /**
+     * 重置流，将触发onHttp2StreamClosed
+     * Reset a stream, onHttp2StreamClosed will be triggered
+     */
+    void resetHttp2Stream(uint32_t stream_id, ErrorCode error_code);
+
+    /**
+     * 尝试发送排队的body数据，socket缓存清空时也应调用
+     * Try to send the queued body data, should also be called when the socket buffer is flushed
+     */
+    void flushHttp2Streams();
+
+    /**
+     * 获取流排队未发送的字节数
+     * Get the queued unsent bytes of a stream
+     */
+    size_t getHttp2PendingSize(uint32_t stream_id) const;
+
+    /**
+     * 设置请求body的最大字节数
+     * Set the max bytes of a request body
+     */
+    void setHttp2MaxBodySize(size_t size);
+
+protected:
+    /**
+     * 收到一个完整的请求
+     * @param headers 解压后的头部，包含:method等伪头部
+     * @param content 请求body
+     * A complete request is received
+     * @param headers The decompressed headers, including pseudo headers such as :method
+     * @param content The request body
+     */
+    virtual void onHttp2Request(uint32_t stream_id, HeaderList &headers, std::string &content) = 0;
+
+    /**
+     * 流没有排队数据且发送窗口可用，可以继续写入body
+     * The stream has no queued data and its send window is open, more body data can be written
+     */
+    virtual void onHttp2StreamWritable(uint32_t stream_id) {};
+
+    /**
+     * 流结束(正常完成或被重置)，之后该流不再可用
+     * @param error_code 正常完成时为kNoError
+     * The stream is finished (completed or reset) and can not be used any more
+     * @param error_code kNoError when completed normally
+     */
+    virtual void onHttp2StreamClosed(uint32_t stream_id, ErrorCode error_code) {};
+
+    /**
+     * 连接级错误、对端带错误码的GOAWAY，或对端正常GOAWAY后所有流已结束，连接应当关闭
+     * A connection error, a GOAWAY with an error code from the peer, or all streams finished after a graceful GOAWAY
+     * from the peer; the connection should be closed
+     */
+    virtual void onHttp2Error(const std::string &err) = 0;
+
+    /**
+     * 发送编码后的帧
+     * Send the encoded frames
+     */
+    virtual void onHttp2SendData(toolkit::Buffer::Ptr buffer) = 0;
+
+private:
+    struct Stream {
+        bool remote_closed = false;
+        bool local_closed = false;
+        bool end_pending = false;
+        int64_t send_window = 0;
+        int64_t recv_window = 0;
+        size_t pending_size = 0;
+        // 第一个排队buffer已经发送的字节数
+        // The bytes already sent of the first queued buffer
+        size_t pending_offset = 0;
+        std::deque<toolkit::Buffer::Ptr> pending;
+        HeaderList headers;
+        std::string content;
+    };
+
+    bool onFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size);
+    bool onHeadersFrame(uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size);
+    bool onHeaderBlock(uint32_t stream_id, bool end_stream);
+    bool onDataFrame(uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size);
+    bool onSettingsFrame(uint8_t flags, uint32_t stream_id, const uint8_t *ptr, size_t size);
+    bool onWindowUpdateFrame(uint32_t stream_id, const uint8_t *ptr, size_t size);
+    void onRequestComplete(uint32_t stream_id);
+    bool connectionError(ErrorCode error_code, const std::string &err);
+    void sendFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const void *payload, size_t size);
+    void sendWindowUpdate(uint32_t stream_id, uint32_t increment);
+    bool sendStreamData(uint32_t stream_id, Stream &stream, size_t max_frames);
+    void closeStream(uint32_t stream_id, ErrorCode error_code);
+
+private:
+    bool _closed = false;
+    // 收到对端NO_ERROR的GOAWAY / a NO_ERROR GOAWAY is received from the peer
+    bool _goaway = false;
+    bool _got_settings = false;
+    size_t _preface_offset = 0;
+    uint32_t _last_stream_id = 0;
+    // 头部块跨越多个帧时的流id、标志与数据
+    // The stream id, flags and data of a header block spanning several frames
+    uint32_t _continuation_stream_id = 0;
+    uint8_t _continuation_flags = 0;
+    std::string _header_block;
+    size_t _max_body_size = 4 * 1024 * 1024;
+    int64_t _send_window = 65535;
+    int64_t _recv_window = 65535;
+    uint32_t _peer_initial_window = 65535;
+    uint32_t _peer_max_frame_size = 16384;
+    std::string _remain_data;
+    HpackDecoder _decoder;
+    HpackEncoder _encoder;
+    std::map<uint32_t, Stream> _streams;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_HTTP2SPLITTER_H
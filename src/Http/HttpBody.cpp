@@ -229,6 +229,11 @@ HttpFileBody::HttpFileBody(const string &file_path, bool use_mmap) {
     }
 }
 
+HttpFileBody::HttpFileBody(Buffer::Ptr content) {
+    _read_to = content->size();
+    _content = std::move(content);
+}
+
 void HttpFileBody::setRange(uint64_t offset, uint64_t max_size) {
     CHECK((int64_t)offset <= _read_to && (int64_t)(max_size + offset) <= _read_to);
     _read_to = max_size + offset;
@@ -281,6 +286,14 @@ Buffer::Ptr HttpFileBody::readData(size_t size) {
         // No remaining bytes
         return nullptr;
     }
+    if (_content) {
+        // 文件缓存模式，引用缓存的内存
+        // File cache mode, reference the cached memory
+        auto ret = std::make_shared<BufferOffset<Buffer::Ptr>>(_content, _file_offset, size);
+        _file_offset += size;
+        return ret;
+    }
+
     if (!_map_addr) {
         // fread模式  [AUTO-TRANSLATED:c4dee2a3]
         // fread mode
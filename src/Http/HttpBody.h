@@ -149,6 +149,14 @@ public:
      */
     HttpFileBody(const std::string &file_path, bool use_mmap = true);
 
+    /**
+     * 构造函数，文件内容来自HttpFileCache
+     * @param content 文件内容，多个body共享
+     * Constructor, the file content comes from HttpFileCache
+     * @param content The file content, shared by multiple bodies
+     */
+    HttpFileBody(toolkit::Buffer::Ptr content);
+
     /**
      * 设置读取范围
      * @param offset 相对文件头的偏移量
@@ -170,6 +178,7 @@ private:
     uint64_t _file_offset = 0;
     std::shared_ptr<FILE> _fp;
     std::shared_ptr<char> _map_addr;
+    toolkit::Buffer::Ptr _content;
     toolkit::ResourcePool<toolkit::BufferRaw> _pool;
 };
 
@@ -0,0 +1,193 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "HttpClientPool.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+HttpClientPool &HttpClientPool::Instance() {
+    static HttpClientPool instance;
+    return instance;
+}
+
+string HttpClientPool::getKey(const string &url, const EventPoller::Ptr &poller) {
+    auto schema = strToLower(findSubString(url.data(), NULL, "://"));
+    auto host = findSubString(url.data(), "://", "/");
+    if (host.empty()) {
+        host = findSubString(url.data(), "://", NULL);
+    }
+    // 去除认证信息
+    // Remove the credentials
+    auto pos = host.find('@');
+    if (pos != string::npos) {
+        host = host.substr(pos + 1);
+    }
+    uint16_t port = schema == "https" ? 443 : 80;
+    splitUrl(host, host, port);
+    auto ret = schema + "://" + host + ":" + to_string(port);
+    if (poller) {
+        ret += "@" + to_string((uintptr_t)poller.get());
+    }
+    return ret;
+}
+
+void HttpClientPool::getClient(const string &key, float timeout_sec, const onCreate &create, const onClient &cb) {
+    GET_CONFIG(uint32_t, max_conn, Http::kClientMaxConnPerHost);
+    GET_CONFIG(uint32_t, max_waiting, Http::kClientMaxWaitingPerHost);
+    HttpClient::Ptr client;
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto &host = _hosts[key];
+        if (!host.idle.empty()) {
+            client = std::move(host.idle.front().first);
+            host.idle.pop_front();
+        } else if (max_conn && host.busy >= max_conn) {
+            if (max_waiting && host.waiting.size() >= max_waiting) {
+                // 排队已满，主机可能已无响应，直接失败而不是无限堆积
+                // The queue is full, the host may be unresponsive, fail at once instead of piling up without bound
+                fail(SockException(Err_other, "too many http requests waiting for " + key), cb);
+                return;
+            }
+            // 连接数达到上限，等待连接归还
+            // The connection limit is reached, wait for a connection to be returned
+            host.waiting.emplace_back(Waiter { create, cb, getCurrentMillisecond() + uint64_t(MAX(timeout_sec, 0.0f) * 1000) });
+            createTimer_l();
+            return;
+        }
+        ++host.busy;
+    }
+    dispatch(client ? client : create(), cb);
+}
+
+void HttpClientPool::putClient(const string &key, const HttpClient::Ptr &client, bool reusable) {
+    onCreate create;
+    onClient cb;
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _hosts.find(key);
+        if (it == _hosts.end()) {
+            return;
+        }
+        auto &host = it->second;
+        if (host.waiting.empty()) {
+            --host.busy;
+            if (reusable) {
+                pushIdle_l(host, client);
+            } else if (!host.busy && host.idle.empty()) {
+                _hosts.erase(it);
+            }
+            return;
+        }
+        // 把连接直接交给排队的请求
+        // Hand the connection to a queued request directly
+        create = std::move(host.waiting.front().create);
+        cb = std::move(host.waiting.front().cb);
+        host.waiting.pop_front();
+    }
+    dispatch(reusable ? client : create(), cb);
+}
+
+HttpClient::Ptr HttpClientPool::popIdle(const string &key) {
+    lock_guard<mutex> lck(_mtx);
+    auto it = _hosts.find(key);
+    if (it == _hosts.end() || it->second.idle.empty()) {
+        return nullptr;
+    }
+    auto ret = std::move(it->second.idle.front().first);
+    it->second.idle.pop_front();
+    if (!it->second.busy && it->second.idle.empty()) {
+        _hosts.erase(it);
+    }
+    return ret;
+}
+
+void HttpClientPool::pushIdle(const string &key, const HttpClient::Ptr &client) {
+    lock_guard<mutex> lck(_mtx);
+    pushIdle_l(_hosts[key], client);
+}
+
+void HttpClientPool::pushIdle_l(Host &host, const HttpClient::Ptr &client) {
+    GET_CONFIG(uint32_t, max_conn, Http::kClientMaxConnPerHost);
+    GET_CONFIG(uint32_t, idle_sec, Http::kClientIdleSecond);
+    if (!idle_sec) {
+        // 不复用连接
+        // Connection reuse is disabled
+        release(client);
+        return;
+    }
+    host.idle.emplace_front(client, getCurrentMillisecond());
+    if (max_conn && host.idle.size() > max_conn) {
+        release(host.idle.back().first);
+        host.idle.pop_back();
+    }
+    createTimer_l();
+}
+
+void HttpClientPool::createTimer_l() {
+    if (!_timer) {
+        _timer = std::make_shared<Timer>(1.0f, []() {
+            HttpClientPool::Instance().onManager();
+            return true;
+        }, nullptr);
+    }
+}
+
+void HttpClientPool::onManager() {
+    GET_CONFIG(uint32_t, idle_sec, Http::kClientIdleSecond);
+    auto now = getCurrentMillisecond();
+    lock_guard<mutex> lck(_mtx);
+    for (auto it = _hosts.begin(); it != _hosts.end();) {
+        auto &idle = it->second.idle;
+        // 最久未使用的在后面
+        // The least recently used ones are at the back
+        while (!idle.empty() && now - idle.back().second >= idle_sec * 1000) {
+            release(idle.back().first);
+            idle.pop_back();
+        }
+        auto &waiting = it->second.waiting;
+        for (auto wit = waiting.begin(); wit != waiting.end();) {
+            if (now < wit->deadline) {
+                ++wit;
+                continue;
+            }
+            fail(SockException(Err_timeout, "wait for http connection timeout: " + it->first), wit->cb);
+            wit = waiting.erase(wit);
+        }
+        if (!it->second.busy && idle.empty() && it->second.waiting.empty()) {
+            it = _hosts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void HttpClientPool::dispatch(const HttpClient::Ptr &client, const onClient &cb) {
+    // 总是异步执行，避免在上一个请求的回调中重入
+    // Always run asynchronously to avoid reentering the callback of the previous request
+    client->getPoller()->async([client, cb]() { cb(SockException(), client); }, false);
+}
+
+void HttpClientPool::fail(const SockException &ex, const onClient &cb) {
+    // 与dispatch一致，总是异步执行
+    // Always run asynchronously, the same as dispatch
+    EventPollerPool::Instance().getPoller()->async([ex, cb]() { cb(ex, nullptr); }, false);
+}
+
+void HttpClientPool::release(const HttpClient::Ptr &client) {
+    // 在连接所属的poller线程关闭
+    // Close on the poller thread of the connection
+    client->getPoller()->async([client]() { client->shutdown(SockException(Err_shutdown, "http client idle timeout")); }, false);
+}
+
+} // namespace mediakit
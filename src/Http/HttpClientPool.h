@@ -0,0 +1,111 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_HTTPCLIENTPOOL_H
+#define ZLMEDIAKIT_HTTPCLIENTPOOL_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "HttpClient.h"
+#include "Poller/Timer.h"
+
+namespace mediakit {
+
+/**
+ * http客户端keep-alive连接池，按协议、主机与端口复用连接
+ * 每个连接同一时间只有一个请求在途，每个主机的连接数达到上限后请求排队等待连接归还
+ * Keep-alive connection pool of the http client, connections are reused by scheme, host and port
+ * Each connection carries one request at a time, requests wait for a returned connection once a host reaches its connection limit
+ */
+class HttpClientPool {
+public:
+    using onCreate = std::function<HttpClient::Ptr()>;
+    using onClient = std::function<void(const toolkit::SockException &ex, const HttpClient::Ptr &client)>;
+
+    static HttpClientPool &Instance();
+
+    /**
+     * 生成连接池的key
+     * @param url 请求url
+     * @param poller 不为空时只复用该poller线程上的连接
+     * Make the key of the pool
+     * @param url Request url
+     * @param poller Only reuse connections on this poller thread if not empty
+     */
+    static std::string getKey(const std::string &url, const toolkit::EventPoller::Ptr &poller = nullptr);
+
+    /**
+     * 获取一个连接，优先复用空闲连接，没有时通过create新建，该主机连接数达到上限时排队
+     * 回调总是异步在连接所属的poller线程执行，请求结束后必须调用putClient归还；
+     * 排队已满或排队超时时回调ex为失败且client为空，此时无需归还
+     * @param timeout_sec 最长排队秒数
+     * Get a connection, an idle one is reused first, otherwise a new one is made by create; it queues when the host reaches its limit
+     * The callback always runs asynchronously on the poller thread of the connection, putClient must be called when the request ends;
+     * when the queue is full or the wait times out, the callback gets a failed ex and a null client, which needs no putClient
+     * @param timeout_sec The max seconds to wait in the queue
+     */
+    void getClient(const std::string &key, float timeout_sec, const onCreate &create, const onClient &cb);
+
+    /**
+     * 归还getClient获取的连接，需在连接所属的poller线程调用
+     * @param reusable 连接是否还能复用(未出错、服务器未要求关闭且仍然连接)
+     * Return a connection got by getClient, it should be called on the poller thread of the connection
+     * @param reusable Whether the connection can be reused (no error, not closed by the server and still connected)
+     */
+    void putClient(const std::string &key, const HttpClient::Ptr &client, bool reusable);
+
+    /**
+     * 取出一个空闲连接，不计入连接数，没有时返回nullptr
+     * Take an idle connection which is not counted in the limit, nullptr if there is none
+     */
+    HttpClient::Ptr popIdle(const std::string &key);
+
+    /**
+     * 放入一个不再使用的空闲连接，需在连接所属的poller线程调用
+     * Put an idle connection no longer used, it should be called on the poller thread of the connection
+     */
+    void pushIdle(const std::string &key, const HttpClient::Ptr &client);
+
+private:
+    HttpClientPool() = default;
+
+    struct Waiter {
+        onCreate create;
+        onClient cb;
+        // 排队超时时间点 / the time the wait times out
+        uint64_t deadline;
+    };
+
+    struct Host {
+        // 正在使用的连接数
+        // Connections in use
+        size_t busy = 0;
+        // 空闲连接及其放入时间，最近放入的在前
+        // Idle connections with the time they were put, the most recent one first
+        std::list<std::pair<HttpClient::Ptr, uint64_t>> idle;
+        std::list<Waiter> waiting;
+    };
+
+    void pushIdle_l(Host &host, const HttpClient::Ptr &client);
+    void createTimer_l();
+    void onManager();
+    static void dispatch(const HttpClient::Ptr &client, const onClient &cb);
+    static void fail(const toolkit::SockException &ex, const onClient &cb);
+    static void release(const HttpClient::Ptr &client);
+
+private:
+    std::mutex _mtx;
+    std::unordered_map<std::string, Host> _hosts;
+    toolkit::Timer::Ptr _timer;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_HTTPCLIENTPOOL_H
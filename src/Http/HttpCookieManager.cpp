@@ -18,12 +18,17 @@ using namespace toolkit;
 
 namespace mediakit {
 
+// cookie分片个数，分片号以两个十六进制字符作为cookie随机字符串的前缀
+// The number of cookie shards, the shard index is the two hex characters prefixing the cookie random string
+static constexpr size_t kCookieShardCount = 64;
+
 //////////////////////////////HttpServerCookie////////////////////////////////////
 HttpServerCookie::HttpServerCookie(
     const std::shared_ptr<HttpCookieManager> &manager, const string &cookie_name, const string &uid,
     const string &cookie, uint64_t max_elapsed) {
     _uid = uid;
     _max_elapsed = max_elapsed;
+    _update_ms = getCurrentMillisecond();
     _cookie_uuid = cookie;
     _cookie_name = cookie_name;
     _manager = manager;
@@ -54,11 +59,15 @@ const string &HttpServerCookie::getCookieName() const {
 }
 
 void HttpServerCookie::updateTime() {
-    _ticker.resetTime();
+    _update_ms = getCurrentMillisecond();
 }
 
 bool HttpServerCookie::isExpired() {
-    return _ticker.elapsedTime() > _max_elapsed * 1000;
+    return getCurrentMillisecond() > getExpireTime();
+}
+
+uint64_t HttpServerCookie::getExpireTime() const {
+    return _update_ms + _max_elapsed * 1000;
 }
 
 void HttpServerCookie::setAttach(toolkit::Any attach) {
@@ -75,10 +84,17 @@ string HttpServerCookie::cookieExpireTime() const {
 INSTANCE_IMP(HttpCookieManager);
 
 HttpCookieManager::HttpCookieManager() {
+    for (size_t i = 0; i < kCookieShardCount; ++i) {
+        char prefix[8];
+        snprintf(prefix, sizeof(prefix), "%02x", (int)i);
+        _shards.emplace_back(new Shard(prefix));
+    }
     // 定时删除过期的cookie，防止内存膨胀  [AUTO-TRANSLATED:dd9dc9c0]
     // Delete expired cookies periodically to prevent memory bloat
+    // 每次只处理到期的桶，所以可以频繁执行
+    // Only the due buckets are visited each time, so it can run frequently
     _timer = std::make_shared<Timer>(
-        10.0f,
+        1.0f,
         [this]() {
             onManager();
             return true;
@@ -90,59 +106,96 @@ HttpCookieManager::~HttpCookieManager() {
     _timer.reset();
 }
 
+HttpCookieManager::Shard &HttpCookieManager::getShardByUid(const string &uid) {
+    return *_shards[std::hash<string>()(uid) % _shards.size()];
+}
+
+HttpCookieManager::Shard *HttpCookieManager::getShardByCookie(const string &cookie) {
+    if (cookie.size() < 2 || !isxdigit((uint8_t)cookie[0]) || !isxdigit((uint8_t)cookie[1])) {
+        return nullptr;
+    }
+    auto index = strtoul(cookie.substr(0, 2).data(), nullptr, 16);
+    return index < _shards.size() ? _shards[index].get() : nullptr;
+}
+
 void HttpCookieManager::onManager() {
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
-    // 先遍历所有类型  [AUTO-TRANSLATED:4917ee89]
-    // First iterate through all types
-    for (auto it_name = _map_cookie.begin(); it_name != _map_cookie.end();) {
-        // 再遍历该类型下的所有cookie  [AUTO-TRANSLATED:0aab9e18]
-        // Then iterate through all cookies under that type
-        for (auto it_cookie = it_name->second.begin(); it_cookie != it_name->second.end();) {
-            if (it_cookie->second->isExpired()) {
+    auto now = getCurrentMillisecond();
+    for (auto &shard : _shards) {
+        // 过期的cookie在锁外析构
+        // The expired cookies are destroyed outside the lock
+        vector<HttpServerCookie::Ptr> expired;
+        lock_guard<recursive_mutex> lck(shard->mtx);
+        auto &wheel = shard->wheel;
+        while (!wheel.empty() && wheel.begin()->first * 1000 <= now) {
+            auto bucket = std::move(wheel.begin()->second);
+            wheel.erase(wheel.begin());
+            for (auto &pr : bucket) {
+                auto it_name = shard->map_cookie.find(pr.first);
+                if (it_name == shard->map_cookie.end()) {
+                    continue;
+                }
+                auto it_cookie = it_name->second.find(pr.second);
+                if (it_cookie == it_name->second.end()) {
+                    // 已经被删除
+                    // Already deleted
+                    continue;
+                }
+                if (!it_cookie->second->isExpired()) {
+                    // 期间被访问过，按新的过期时间放回时间轮
+                    // Accessed in the meantime, put it back into the timer wheel with the new expire time
+                    wheel[it_cookie->second->getExpireTime() / 1000 + 1].emplace_back(std::move(pr));
+                    continue;
+                }
                 // cookie过期,移除记录  [AUTO-TRANSLATED:8b48b8a2]
                 // Cookie expired, remove record
                 DebugL << it_cookie->second->getUid() << " cookie过期:" << it_cookie->second->getCookie();
-                it_cookie = it_name->second.erase(it_cookie);
-                continue;
+                expired.emplace_back(std::move(it_cookie->second));
+                it_name->second.erase(it_cookie);
+                if (it_name->second.empty()) {
+                    // 该类型下没有任何cookie记录,移除之  [AUTO-TRANSLATED:92e3b783]
+                    // There are no cookie records under this type, remove it
+                    shard->map_cookie.erase(it_name);
+                }
             }
-            ++it_cookie;
         }
-
-        if (it_name->second.empty()) {
-            // 该类型下没有任何cookie记录,移除之  [AUTO-TRANSLATED:92e3b783]
-            // There are no cookie records under this type, remove it
-            DebugL << "该path下没有任何cookie记录:" << it_name->first;
-            it_name = _map_cookie.erase(it_name);
-            continue;
-        }
-        ++it_name;
     }
 }
 
 HttpServerCookie::Ptr HttpCookieManager::addCookie(const string &cookie_name, const string &uid_in, uint64_t max_elapsed, toolkit::Any attach, int max_client) {
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
-    auto cookie = _generator.obtain();
+    // 同一uid下的cookie位于同一分片，匿名用户轮流分配
+    // The cookies of one uid live in the same shard, anonymous users are assigned in turn
+    auto &shard = uid_in.empty() ? *_shards[_anonymous_index++ % _shards.size()] : getShardByUid(uid_in);
+    lock_guard<recursive_mutex> lck(shard.mtx);
+    auto cookie = shard.generator.obtain();
     auto uid = uid_in.empty() ? cookie : uid_in;
-    auto oldCookie = getOldestCookie(cookie_name, uid, max_client);
+    auto oldCookie = getOldestCookie(shard, cookie_name, uid, max_client);
     if (!oldCookie.empty()) {
         // 假如该账号已经登录了，那么删除老的cookie。  [AUTO-TRANSLATED:f18d826d]
         // If the account has already logged in, delete the old cookie.
         // 目的是实现单账号多地登录时挤占登录  [AUTO-TRANSLATED:8a64aec7]
         // The purpose is to achieve login squeeze when multiple devices log in with the same account
-        delCookie(cookie_name, oldCookie);
+        delCookie(shard, cookie_name, oldCookie);
     }
     HttpServerCookie::Ptr data(new HttpServerCookie(shared_from_this(), cookie_name, uid, cookie, max_elapsed));
     data->setAttach(std::move(attach));
     // 保存该账号下的新cookie  [AUTO-TRANSLATED:e476c9c8]
     // Save the new cookie under this account
-    _map_cookie[cookie_name][cookie] = data;
+    shard.map_cookie[cookie_name][cookie] = data;
+    shard.wheel[data->getExpireTime() / 1000 + 1].emplace_back(cookie_name, cookie);
     return data;
 }
 
 HttpServerCookie::Ptr HttpCookieManager::getCookie(const string &cookie_name, const string &cookie) {
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
-    auto it_name = _map_cookie.find(cookie_name);
-    if (it_name == _map_cookie.end()) {
+    auto shard = getShardByCookie(cookie);
+    if (!shard) {
+        return nullptr;
+    }
+    // 过期的cookie在锁外析构
+    // The expired cookie is destroyed outside the lock
+    HttpServerCookie::Ptr expired;
+    lock_guard<recursive_mutex> lck(shard->mtx);
+    auto it_name = shard->map_cookie.find(cookie_name);
+    if (it_name == shard->map_cookie.end()) {
         // 不存在该类型的cookie  [AUTO-TRANSLATED:d32b0997]
         // There is no cookie of this type
         return nullptr;
@@ -157,6 +210,7 @@ HttpServerCookie::Ptr HttpCookieManager::getCookie(const string &cookie_name, co
         // cookie过期  [AUTO-TRANSLATED:a980453f]
         // Cookie expired
         DebugL << "cookie过期:" << it_cookie->second->getCookie();
+        expired = std::move(it_cookie->second);
         it_name->second.erase(it_cookie);
         return nullptr;
     }
@@ -182,9 +236,17 @@ HttpServerCookie::Ptr HttpCookieManager::getCookieByUid(const string &cookie_nam
     if (cookie_name.empty() || uid.empty()) {
         return nullptr;
     }
-    auto cookie = getOldestCookie(cookie_name, uid);
+    string cookie;
+    {
+        auto &shard = getShardByUid(uid);
+        lock_guard<recursive_mutex> lck(shard.mtx);
+        cookie = getOldestCookie(shard, cookie_name, uid);
+    }
     if (cookie.empty()) {
-        return nullptr;
+        // 匿名用户的uid即cookie，其记录位于cookie所在分片
+        // The uid of an anonymous user is the cookie itself, which is recorded in the shard of the cookie
+        auto data = getCookie(cookie_name, uid);
+        return data && data->getUid() == uid ? data : nullptr;
     }
     return getCookie(cookie_name, cookie);
 }
@@ -193,13 +255,17 @@ bool HttpCookieManager::delCookie(const HttpServerCookie::Ptr &cookie) {
     if (!cookie) {
         return false;
     }
-    return delCookie(cookie->getCookieName(), cookie->getCookie());
+    auto shard = getShardByCookie(cookie->getCookie());
+    if (!shard) {
+        return false;
+    }
+    lock_guard<recursive_mutex> lck(shard->mtx);
+    return delCookie(*shard, cookie->getCookieName(), cookie->getCookie());
 }
 
-bool HttpCookieManager::delCookie(const string &cookie_name, const string &cookie) {
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
-    auto it_name = _map_cookie.find(cookie_name);
-    if (it_name == _map_cookie.end()) {
+bool HttpCookieManager::delCookie(Shard &shard, const string &cookie_name, const string &cookie) {
+    auto it_name = shard.map_cookie.find(cookie_name);
+    if (it_name == shard.map_cookie.end()) {
         return false;
     }
     return it_name->second.erase(cookie);
@@ -208,20 +274,22 @@ bool HttpCookieManager::delCookie(const string &cookie_name, const string &cooki
 void HttpCookieManager::onAddCookie(const string &cookie_name, const string &uid, const string &cookie) {
     // 添加新的cookie，我们记录下这个uid下有哪些cookie，目的是实现单账号多地登录时挤占登录  [AUTO-TRANSLATED:60b752e9]
     // Add a new cookie, we record which cookies are under this uid, the purpose is to achieve login squeeze when multiple devices log in with the same account
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
+    auto shard = getShardByCookie(cookie);
+    lock_guard<recursive_mutex> lck(shard->mtx);
     // 相同用户下可以存在多个cookie(意味多地登录)，这些cookie根据登录时间的早晚依次排序  [AUTO-TRANSLATED:1e0b93b9]
     // Multiple cookies can exist under the same user (meaning multiple devices log in), these cookies are sorted in order of login time
-    _map_uid_to_cookie[cookie_name][uid][getCurrentMillisecond()] = cookie;
+    shard->map_uid_to_cookie[cookie_name][uid][getCurrentMillisecond()] = cookie;
 }
 
 void HttpCookieManager::onDelCookie(const string &cookie_name, const string &uid, const string &cookie) {
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
+    auto shard = getShardByCookie(cookie);
+    lock_guard<recursive_mutex> lck(shard->mtx);
     // 回收随机字符串  [AUTO-TRANSLATED:18a699ff]
     // Recycle random string
-    _generator.release(cookie);
+    shard->generator.release(cookie);
 
-    auto it_name = _map_uid_to_cookie.find(cookie_name);
-    if (it_name == _map_uid_to_cookie.end()) {
+    auto it_name = shard->map_uid_to_cookie.find(cookie_name);
+    if (it_name == shard->map_uid_to_cookie.end()) {
         // 该类型下未有任意用户登录  [AUTO-TRANSLATED:8ba458b9]
         // No user has logged in under this type
         return;
@@ -258,15 +326,14 @@ void HttpCookieManager::onDelCookie(const string &cookie_name, const string &uid
         }
         // 该类型下未有任何用户在线，移除之  [AUTO-TRANSLATED:e705cfe6]
         // There are no users online under this type, remove it
-        _map_uid_to_cookie.erase(it_name);
+        shard->map_uid_to_cookie.erase(it_name);
         break;
     }
 }
 
-string HttpCookieManager::getOldestCookie(const string &cookie_name, const string &uid, int max_client) {
-    lock_guard<recursive_mutex> lck(_mtx_cookie);
-    auto it_name = _map_uid_to_cookie.find(cookie_name);
-    if (it_name == _map_uid_to_cookie.end()) {
+string HttpCookieManager::getOldestCookie(Shard &shard, const string &cookie_name, const string &uid, int max_client) {
+    auto it_name = shard.map_uid_to_cookie.find(cookie_name);
+    if (it_name == shard.map_uid_to_cookie.end()) {
         // 不存在该类型的cookie  [AUTO-TRANSLATED:d32b0997]
         // There is no cookie of this type
         return "";
@@ -314,7 +381,9 @@ string RandStrGenerator::obtain_l() {
     auto str = makeRandStr(12, false);
     str.append((char *)&_index, sizeof(_index));
     ++_index;
-    return MD5(str).hexdigest();
+    auto ret = MD5(str).hexdigest();
+    ret.replace(0, _prefix.size(), _prefix);
+    return ret;
 }
 
 } // namespace mediakit
\ No newline at end of file
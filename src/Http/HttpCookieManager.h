@@ -16,8 +16,11 @@
 #include "Util/TimeTicker.h"
 #include "Util/mini.h"
 #include "Util/util.h"
+#include <atomic>
+#include <map>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #define COOKIE_DEFAULT_LIFE (7 * 24 * 60 * 60)
 
@@ -118,6 +121,12 @@ public:
      */
     bool isExpired();
 
+    /**
+     * 获取过期时间戳，单位毫秒
+     * Get the expiration timestamp, in milliseconds
+     */
+    uint64_t getExpireTime() const;
+
     /**
      * 设置附加数据
      * Set additional data
@@ -145,7 +154,9 @@ private:
     std::string _cookie_name;
     std::string _cookie_uuid;
     uint64_t _max_elapsed;
-    toolkit::Ticker _ticker;
+    // 最后访问时间戳，updateTime可能在多个线程调用
+    // The last access timestamp, updateTime may be called from multiple threads
+    std::atomic<uint64_t> _update_ms;
     toolkit::Any _attach;
     std::weak_ptr<HttpCookieManager> _manager;
 };
@@ -158,6 +169,11 @@ private:
  */
 class RandStrGenerator {
 public:
+    /**
+     * @param prefix 随机字符串固定前缀，用于区分不同生成器生成的字符串
+     * @param prefix Fixed prefix of the random strings, used to tell the strings of different generators apart
+     */
+    RandStrGenerator(std::string prefix = "") : _prefix(std::move(prefix)) {}
 
     /**
      * 获取不碰撞的随机字符串
@@ -183,6 +199,7 @@ private:
     std::string obtain_l();
 
 private:
+    std::string _prefix;
     // 碰撞库  [AUTO-TRANSLATED:25a2ca2b]
     // Collision library
     std::unordered_set<std::string> _obtained;
@@ -198,6 +215,11 @@ private:
  * This object implements the function that the same account can log in to at most several devices
  
  * [AUTO-TRANSLATED:ad6008e8]
+ * cookie按分片保存，每个分片独立加锁，cookie随机字符串前两个字符即为分片号，同一uid下的cookie位于同一分片；
+ * 过期清理按过期时间分桶，定时器只处理到期的桶，避免每次遍历所有cookie
+ * Cookies are stored in shards locked independently, the first two characters of the cookie random string are the shard index
+ * and the cookies of one uid live in the same shard; expiration is bucketed by expire time and the timer only visits
+ * the due buckets instead of sweeping every cookie
  */
 class HttpCookieManager : public std::enable_shared_from_this<HttpCookieManager> {
 public:
@@ -289,9 +311,43 @@ public:
     bool delCookie(const HttpServerCookie::Ptr &cookie);
 
 private:
+    using CookieMap = std::unordered_map<
+        std::string /*cookie_name*/, std::unordered_map<std::string /*cookie*/, HttpServerCookie::Ptr /*cookie_data*/>>;
+    using UidMap = std::unordered_map<
+        std::string /*cookie_name*/,
+        std::unordered_map<std::string /*uid*/, std::map<uint64_t /*cookie time stamp*/, std::string /*cookie*/>>>;
+
+    struct Shard {
+        Shard(std::string prefix) : generator(std::move(prefix)) {}
+
+        std::recursive_mutex mtx;
+        CookieMap map_cookie;
+        UidMap map_uid_to_cookie;
+        // 按过期时间(秒)分桶的时间轮，cookie被访问时不移动，所在的桶到期时再按新的过期时间放回
+        // The timer wheel bucketed by expire time (seconds), a cookie is not moved when accessed,
+        // it is put back with its new expire time when its bucket is due
+        std::map<uint64_t /*expire second*/, std::vector<std::pair<std::string /*cookie_name*/, std::string /*cookie*/>>> wheel;
+        RandStrGenerator generator;
+    };
+
     HttpCookieManager();
 
     void onManager();
+
+    /**
+     * 根据uid获取分片
+     * Get the shard by uid
+     */
+    Shard &getShardByUid(const std::string &uid);
+
+    /**
+     * 根据cookie随机字符串前缀获取分片
+     * @return 分片，cookie非法时返回nullptr
+     * Get the shard by the prefix of the cookie random string
+     * @return The shard, nullptr if the cookie is invalid
+     */
+    Shard *getShardByCookie(const std::string &cookie);
+
     /**
      * 构造cookie对象时触发，目的是记录某账号下多个cookie
      * @param cookie_name cookie名，例如MY_SESSION
@@ -322,11 +378,13 @@ private:
 
     /**
      * 获取某用户名下最先登录时的cookie，目的是实现某用户下最多登录若干个设备
+     * @param shard 该用户所在分片，调用者需持有分片锁
      * @param cookie_name cookie名，例如MY_SESSION
      * @param uid 用户id
      * @param max_client 最多登录的设备个数
      * @return 最早的cookie随机字符串
      * Get the cookie that logged in first under a certain username, the purpose is to implement the function that at most several devices can log in under a certain user
+     * @param shard the shard of the user, the caller must hold the shard lock
      * @param cookie_name cookie name, such as MY_SESSION
      * @param uid user id
      * @param max_client the maximum number of devices that can log in
@@ -334,33 +392,30 @@ private:
      
      * [AUTO-TRANSLATED:431b0732]
      */
-    std::string getOldestCookie(const std::string &cookie_name, const std::string &uid, int max_client = 1);
+    std::string getOldestCookie(Shard &shard, const std::string &cookie_name, const std::string &uid, int max_client = 1);
 
     /**
      * 删除cookie
+     * @param shard cookie所在分片，调用者需持有分片锁
      * @param cookie_name cookie名，例如MY_SESSION
      * @param cookie cookie随机字符串
      * @return 成功true
      * Delete cookie
+     * @param shard the shard of the cookie, the caller must hold the shard lock
      * @param cookie_name cookie name, such as MY_SESSION
      * @param cookie cookie random string
      * @return success true
 
      * [AUTO-TRANSLATED:09fa1e44]
      */
-    bool delCookie(const std::string &cookie_name, const std::string &cookie);
+    bool delCookie(Shard &shard, const std::string &cookie_name, const std::string &cookie);
 
 private:
-    std::unordered_map<
-        std::string /*cookie_name*/, std::unordered_map<std::string /*cookie*/, HttpServerCookie::Ptr /*cookie_data*/>>
-        _map_cookie;
-    std::unordered_map<
-        std::string /*cookie_name*/,
-        std::unordered_map<std::string /*uid*/, std::map<uint64_t /*cookie time stamp*/, std::string /*cookie*/>>>
-        _map_uid_to_cookie;
-    std::recursive_mutex _mtx_cookie;
+    std::vector<std::unique_ptr<Shard>> _shards;
+    // 匿名cookie轮流分配到各个分片
+    // Anonymous cookies are assigned to the shards in turn
+    std::atomic<size_t> _anonymous_index { 0 };
     toolkit::Timer::Ptr _timer;
-    RandStrGenerator _generator;
 };
 
 } // namespace mediakit
@@ -0,0 +1,127 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "HttpFileCache.h"
+#include "Util/File.h"
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Common/config.h"
+#include "Thread/WorkThreadPool.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+HttpFileCache &HttpFileCache::Instance() {
+    static HttpFileCache s_instance;
+    return s_instance;
+}
+
+HttpFileCache::Shard &HttpFileCache::getShard(const string &path) {
+    return _shards[std::hash<string>()(path) % kShardCount];
+}
+
+static Buffer::Ptr loadFile(const string &path, uint64_t size) {
+    std::shared_ptr<FILE> fp(fopen(path.data(), "rb"), [](FILE *fp) {
+        if (fp) {
+            fclose(fp);
+        }
+    });
+    if (!fp) {
+        return nullptr;
+    }
+    auto ret = BufferRaw::create();
+    ret->setCapacity(size + 1);
+    if (fread(ret->data(), 1, size, fp.get()) != size) {
+        // 文件在获取大小后被修改
+        // The file has been modified after its size was got
+        WarnL << "read file failed: " << path << ", " << get_uv_errmsg();
+        return nullptr;
+    }
+    ret->setSize(size);
+    return ret;
+}
+
+Buffer::Ptr HttpFileCache::get(const string &path, time_t mtime, uint64_t size) {
+    GET_CONFIG(uint32_t, cache_mb, Http::kFileCacheMB);
+    size_t max_bytes = (size_t)cache_mb * 1024 * 1024 / kShardCount;
+    if (!size || size > max_bytes / 2) {
+        // 缓存关闭或者文件太大，不加入缓存
+        // The cache is disabled or the file is too large, do not cache it
+        return nullptr;
+    }
+
+    auto &shard = getShard(path);
+    Entry::Ptr entry;
+    {
+        lock_guard<mutex> lck(shard.mtx);
+        auto it = shard.entries.find(path);
+        if (it != shard.entries.end()) {
+            auto &old = it->second->second;
+            if (old->mtime == mtime && old->file_size == size) {
+                // 命中，或者正在加载时返回空
+                // A hit, or null while it is being loaded
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                return old->data;
+            } else {
+                // 文件已被修改
+                // The file has been modified
+                shard.bytes -= old->file_size;
+                shard.lru.erase(it->second);
+                shard.entries.erase(it);
+            }
+        }
+        entry = std::make_shared<Entry>(mtime, size);
+        shard.lru.emplace_front(path, entry);
+        shard.entries.emplace(path, shard.lru.begin());
+        shard.bytes += size;
+        while (shard.bytes > max_bytes && shard.lru.size() > 1) {
+            shard.bytes -= shard.lru.back().second->file_size;
+            shard.entries.erase(shard.lru.back().first);
+            shard.lru.pop_back();
+        }
+    }
+
+    // 未命中时在后台线程读取磁盘，本次请求由调用者直接读取文件，不阻塞http线程
+    // On a miss the disk is read in a background thread, this request is served from the file by the caller
+    // so that the http thread is never blocked
+    WorkThreadPool::Instance().getExecutor()->async([this, &shard, path, entry]() { load(shard, path, entry); });
+    return nullptr;
+}
+
+void HttpFileCache::load(Shard &shard, const string &path, const Entry::Ptr &entry) {
+    auto data = loadFile(path, entry->file_size);
+    if (!data) {
+        remove(shard, path, entry.get());
+        return;
+    }
+    lock_guard<mutex> lck(shard.mtx);
+    // 加载期间被淘汰或替换时条目已不在缓存中，数据随本任务结束释放
+    // If the entry was evicted or replaced while loading it is no longer in the cache, the data is freed when this task ends
+    entry->data = std::move(data);
+}
+
+void HttpFileCache::remove(const string &path) {
+    remove(getShard(path), path, nullptr);
+}
+
+void HttpFileCache::remove(Shard &shard, const string &path, const Entry *entry) {
+    lock_guard<mutex> lck(shard.mtx);
+    auto it = shard.entries.find(path);
+    if (it == shard.entries.end() || (entry && it->second->second.get() != entry)) {
+        return;
+    }
+    shard.bytes -= it->second->second->file_size;
+    shard.lru.erase(it->second);
+    shard.entries.erase(it);
+}
+
+} // namespace mediakit
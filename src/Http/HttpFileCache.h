@@ -0,0 +1,96 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_HTTPFILECACHE_H
+#define ZLMEDIAKIT_HTTPFILECACHE_H
+
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Network/Buffer.h"
+
+namespace mediakit {
+
+/**
+ * 进程级的http热点文件内容缓存，以文件路径为key，通过文件修改时间与大小校验；
+ * 按路径哈希分片，每个分片独立加锁并按字节数淘汰最久未使用的文件；
+ * 同一个hls切片被大量播放器请求时只读取一次磁盘，且磁盘读取在后台线程进行，不阻塞http线程
+ * A process wide content cache of hot http files keyed by the file path and validated by the modification time and size;
+ * it is sharded by the hash of the path, each shard is locked independently and evicts the least recently used files by bytes;
+ * an hls segment requested by lots of players is read from the disk only once, in a background thread that never blocks the http threads
+ */
+class HttpFileCache {
+public:
+    static HttpFileCache &Instance();
+
+    /**
+     * 获取文件内容，未命中时在后台线程读取文件并加入缓存，读取完成前返回空，由调用者直接读取文件
+     * @param path 文件路径
+     * @param mtime 文件修改时间
+     * @param size 文件大小
+     * @return 文件内容，未命中、加载中、缓存关闭或文件过大时返回空
+     * Get the content of a file, on a miss it is read in a background thread and added to the cache,
+     * null is returned until it is loaded and the caller reads the file directly
+     * @param path File path
+     * @param mtime The modification time of the file
+     * @param size File size
+     * @return The file content, null on a miss, while loading, or if the cache is disabled or the file is too large
+     */
+    toolkit::Buffer::Ptr get(const std::string &path, time_t mtime, uint64_t size);
+
+    /**
+     * 移除文件缓存，文件被删除时调用以便及时释放内存
+     * @param path 文件路径
+     * Remove a file from the cache, called when the file is deleted so that the memory is released in time
+     * @param path File path
+     */
+    void remove(const std::string &path);
+
+private:
+    HttpFileCache() = default;
+
+private:
+    static constexpr size_t kShardCount = 8;
+
+    struct Entry {
+        using Ptr = std::shared_ptr<Entry>;
+        Entry(time_t mtime, uint64_t file_size) : mtime(mtime), file_size(file_size) {}
+
+        time_t mtime;
+        uint64_t file_size;
+        // 为空表示后台线程加载中，受分片锁保护
+        // Null while it is loaded in the background thread, guarded by the shard lock
+        toolkit::Buffer::Ptr data;
+    };
+
+    using EntryList = std::list<std::pair<std::string, Entry::Ptr>>;
+
+    struct Shard {
+        std::mutex mtx;
+        // 加载中的文件也计入字节数
+        // Files being loaded are counted as well
+        size_t bytes = 0;
+        EntryList lru;
+        std::unordered_map<std::string, EntryList::iterator> entries;
+    };
+
+    Shard &getShard(const std::string &path);
+    void load(Shard &shard, const std::string &path, const Entry::Ptr &entry);
+    void remove(Shard &shard, const std::string &path, const Entry *entry);
+
+private:
+    Shard _shards[kShardCount];
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_HTTPFILECACHE_H
@@ -9,6 +9,7 @@
  */
 
 #include <iomanip>
+#include <sys/stat.h>
 #include "Util/File.h"
 #include "Common/Parser.h"
 #include "Common/config.h"
@@ -17,6 +18,7 @@
 #include "HttpConst.h"
 #include "HttpSession.h"
 #include "HttpFileManager.h"
+#include "HttpFileCache.h"
 
 using namespace std;
 using namespace toolkit;
@@ -752,6 +754,38 @@ HttpResponseInvokerImp::HttpResponseInvokerImp(const HttpResponseInvokerImp::Htt
     };
 }
 
+static string httpDate(time_t tt) {
+    struct tm tm;
+#if defined(_WIN32)
+    gmtime_s(&tm, &tt);
+#else
+    gmtime_r(&tt, &tm);
+#endif
+    char buf[64];
+    strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+// 协商缓存，If-None-Match优先于If-Modified-Since
+// Conditional request, If-None-Match takes precedence over If-Modified-Since
+static bool isNotModified(const StrCaseMap &requestHeader, const string &etag, const string &last_modified) {
+    auto it = requestHeader.find("If-None-Match");
+    if (it != requestHeader.end()) {
+        for (auto &tag : split(it->second, ",")) {
+            trim(tag);
+            if (start_with(tag, "W/")) {
+                tag.erase(0, 2);
+            }
+            if (tag == etag || tag == "*") {
+                return true;
+            }
+        }
+        return false;
+    }
+    it = requestHeader.find("If-Modified-Since");
+    return it != requestHeader.end() && it->second == last_modified;
+}
+
 void HttpResponseInvokerImp::responseFile(const StrCaseMap &requestHeader,
                                           const StrCaseMap &responseHeader,
                                           const string &file,
@@ -768,7 +802,27 @@ void HttpResponseInvokerImp::responseFile(const StrCaseMap &requestHeader,
     // file is the file path
     GET_CONFIG(string, charSet, Http::kCharSet);
     StrCaseMap &httpHeader = const_cast<StrCaseMap &>(responseHeader);
-    auto fileBody = std::make_shared<HttpFileBody>(file, use_mmap);
+    HttpFileBody::Ptr fileBody;
+    struct stat st;
+    if (use_mmap && stat(file.data(), &st) == 0 && S_ISREG(st.st_mode)) {
+        // 允许缓存的文件支持协商缓存并且优先从内存读取
+        // A cacheable file supports conditional requests and is read from memory first
+        auto etag = "\"" + to_string(st.st_mtime) + "-" + to_string(st.st_size) + "\"";
+        auto last_modified = httpDate(st.st_mtime);
+        httpHeader.emplace("ETag", etag);
+        httpHeader.emplace("Last-Modified", last_modified);
+        if (isNotModified(requestHeader, etag, last_modified)) {
+            (*this)(304, httpHeader, HttpBody::Ptr());
+            return;
+        }
+        auto content = HttpFileCache::Instance().get(file, st.st_mtime, st.st_size);
+        if (content) {
+            fileBody = std::make_shared<HttpFileBody>(std::move(content));
+        }
+    }
+    if (!fileBody) {
+        fileBody = std::make_shared<HttpFileBody>(file, use_mmap);
+    }
     if (fileBody->remainSize() < 0) {
         // 打开文件失败  [AUTO-TRANSLATED:1f0405cb]
         // Failed to open file
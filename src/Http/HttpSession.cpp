@@ -40,8 +40,8 @@ void HttpSession::onHttpRequest_HEAD() {
     sendResponse(200, false);
 }
 
-void HttpSession::onHttpRequest_OPTIONS() {
-    KeyValue header;
+static HttpSession::KeyValue getOptionsHeader() {
+    HttpSession::KeyValue header;
     header.emplace("Allow", "GET, POST, HEAD, OPTIONS");
     GET_CONFIG(bool, allow_cross_domains, Http::kAllowCrossDomains);
     if (allow_cross_domains) {
@@ -52,7 +52,11 @@ void HttpSession::onHttpRequest_OPTIONS() {
     header.emplace("Access-Control-Allow-Credentials", "true");
     header.emplace("Access-Control-Request-Methods", "GET, POST, OPTIONS");
     header.emplace("Access-Control-Request-Headers", "Accept,Accept-Language,Content-Language,Content-Type");
-    sendResponse(200, true, nullptr, header);
+    return header;
+}
+
+void HttpSession::onHttpRequest_OPTIONS() {
+    sendResponse(200, true, nullptr, getOptionsHeader());
 }
 
 ssize_t HttpSession::onRecvHeader(const char *header, size_t len) {
@@ -69,6 +73,11 @@ ssize_t HttpSession::onRecvHeader(const char *header, size_t len) {
     });
 
     _parser.parse(header, len);
+    if (_parser.method() == "PRI" && _parser.url() == "*") {
+        // http2 prior knowledge(h2c)连接前言，此后的数据都是http2帧
+        // The http2 prior knowledge (h2c) connection preface, all the following data are http2 frames
+        return onHttp2Preface(len);
+    }
     CHECK(_parser.url()[0] == '/');
     _origin = _parser["Origin"];
 
@@ -168,6 +177,9 @@ void HttpSession::onRecv(const Buffer::Ptr &pBuf) {
 }
 
 void HttpSession::onError(const SockException &err) {
+    for (auto &pr : _http2_streams) {
+        onHttp2StreamDone(pr.second, err);
+    }
     if (_is_live_stream) {
         // flv/ts播放器  [AUTO-TRANSLATED:5b444fd9]
         // flv/ts player
@@ -269,10 +281,12 @@ bool HttpSession::checkWebSocket() {
     return true;
 }
 
-bool HttpSession::checkLiveStream(const string &schema, const string &url_suffix, const function<void(const MediaSource::Ptr &src)> &cb) {
-    std::string url = _parser.url();
-    auto it = _parser.getUrlArgs().find("schema");
-    if (it != _parser.getUrlArgs().end()) {
+// 从请求url解析直播流的MediaInfo，url必须以url_suffix结尾，或者通过schema参数指定协议
+// Parse the MediaInfo of a live stream from the request url, which must end with url_suffix or specify the schema by the schema argument
+static bool parseLiveMediaInfo(const Parser &parser, const string &schema, const string &url_suffix, MediaInfo &media_info) {
+    std::string url = parser.url();
+    auto it = parser.getUrlArgs().find("schema");
+    if (it != parser.getUrlArgs().end()) {
         if (strcasecmp(it->second.c_str(), schema.c_str())) {
             // unsupported schema
             return false;
@@ -291,21 +305,29 @@ bool HttpSession::checkLiveStream(const string &schema, const string &url_suffix
 
     // 带参数的url  [AUTO-TRANSLATED:074764b0]
     // Url with parameters
-    if (!_parser.params().empty()) {
+    if (!parser.params().empty()) {
         url += "?";
-        url += _parser.params();
+        url += parser.params();
     }
 
     // 解析带上协议+参数完整的url  [AUTO-TRANSLATED:5cdc7e68]
     // Parse the complete url with protocol + parameters
-    _media_info.parse(schema + "://" + _parser["Host"] + url);
+    media_info.parse(schema + "://" + parser["Host"] + url);
 
-    if (_media_info.app.empty() || _media_info.stream.empty()) {
+    if (media_info.app.empty() || media_info.stream.empty()) {
         // url不合法  [AUTO-TRANSLATED:9aad134e]
         // URL is invalid
         return false;
     }
 
+    return true;
+}
+
+bool HttpSession::checkLiveStream(const string &schema, const string &url_suffix, const function<void(const MediaSource::Ptr &src)> &cb) {
+    if (!parseLiveMediaInfo(_parser, schema, url_suffix, _media_info)) {
+        return false;
+    }
+
     if (_is_websocket) {
         _media_info.protocol = overSsl() ? "wss" : "ws";
     } else {
@@ -774,7 +796,7 @@ void HttpSession::sendResponse(int code,
 
 void HttpSession::urlDecode(Parser &parser) {
     parser.setUrl(strCoding::UrlDecodePath(parser.url()));
-    for (auto &pr : _parser.getUrlArgs()) {
+    for (auto &pr : parser.getUrlArgs()) {
         const_cast<string &>(pr.second) = strCoding::UrlDecodeComponent(pr.second);
     }
 }
@@ -895,4 +917,501 @@ std::shared_ptr<FlvMuxer> HttpSession::getSharedPtr() {
     return dynamic_pointer_cast<FlvMuxer>(shared_from_this());
 }
 
+// http2流上积压未发送数据的上限，直播流超过后重置该流，防止对端不更新窗口导致内存无限增长
+// The limit of unsent data queued on a http2 stream, a live stream beyond it is reset to avoid unbounded memory growth when the peer stops updating the window
+static constexpr size_t kMaxHttp2PendingSize = 8 * 1024 * 1024;
+
+// http2下每个http-flv流使用独立的FlvMuxer，同一连接可以同时播放多个流
+// Every http-flv stream over http2 uses its own FlvMuxer, so one connection can play several streams at the same time
+class Http2FlvMuxer : public FlvMuxer, public std::enable_shared_from_this<Http2FlvMuxer> {
+public:
+    using Ptr = std::shared_ptr<Http2FlvMuxer>;
+    using onWriteCB = std::function<void(const Buffer::Ptr &data)>;
+
+    Http2FlvMuxer(onWriteCB on_write, std::function<void()> on_detach) {
+        _on_write = std::move(on_write);
+        _on_detach = std::move(on_detach);
+    }
+
+    using FlvMuxer::start;
+
+protected:
+    void onWrite(const Buffer::Ptr &data, bool flush) override { _on_write(data); }
+    void onDetach() override { _on_detach(); }
+    std::shared_ptr<FlvMuxer> getSharedPtr() override { return shared_from_this(); }
+
+private:
+    onWriteCB _on_write;
+    std::function<void()> _on_detach;
+};
+
+ssize_t HttpSession::onHttp2Preface(size_t len) {
+    GET_CONFIG(bool, enable_http2, Http::kEnableHttp2);
+    if (!enable_http2) {
+        WarnP(this) << "http2 is disabled, please set " << Http::kEnableHttp2 << " in config.ini file.";
+        shutdown(SockException(Err_shutdown, "http2 is disabled"));
+        return 0;
+    }
+    _parser.clear();
+    setHttp2MaxBodySize(_max_req_size);
+    startHttp2(len);
+
+    weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
+    getSock()->setOnFlush([weak_self]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return false;
+        }
+        // socket缓存清空后继续发送被流控阻塞的数据以及读取文件
+        // Resume the data blocked by flow control and file reading after the socket buffer is flushed
+        strong_self->flushHttp2Streams();
+        return true;
+    });
+
+    _on_recv_body = [this](const char *data, size_t len) {
+        inputHttp2(data, len);
+        // 后续都是http2帧
+        // All the following data are http2 frames
+        return true;
+    };
+    return -1;
+}
+
+void HttpSession::onHttp2Request(uint32_t stream_id, HeaderList &headers, string &content) {
+    // 转换为http/1.1格式的请求头，复用Parser以及现有的http api、文件服务和直播流逻辑
+    // Convert to an http/1.1 style request header to reuse Parser and the existing http api, file service and live stream logic
+    string method, path, authority, cookie, lines;
+    for (auto &pr : headers) {
+        if (pr.first.empty() || pr.first.find_first_of("\r\n: ", 1) != string::npos || pr.second.find_first_of("\r\n") != string::npos) {
+            resetHttp2Stream(stream_id, kProtocolError);
+            return;
+        }
+        if (pr.first[0] == ':') {
+            if (pr.first == ":method") {
+                method = pr.second;
+            } else if (pr.first == ":path") {
+                path = pr.second;
+            } else if (pr.first == ":authority") {
+                authority = pr.second;
+            }
+            continue;
+        }
+        if (pr.first == "cookie") {
+            // http2允许把cookie拆分为多个头部，需要合并
+            // http2 allows splitting the cookie into several headers, merge them
+            cookie += cookie.empty() ? "" : "; ";
+            cookie += pr.second;
+            continue;
+        }
+        lines += pr.first + ": " + pr.second + "\r\n";
+    }
+    if (method.empty() || path.empty() || path[0] != '/' || path.find(' ') != string::npos) {
+        resetHttp2Stream(stream_id, kProtocolError);
+        return;
+    }
+
+    string str = method + " " + path + " HTTP/2\r\n";
+    if (!authority.empty()) {
+        str += "Host: " + authority + "\r\n";
+    }
+    if (!cookie.empty()) {
+        str += "Cookie: " + cookie + "\r\n";
+    }
+    str += lines;
+    str += "\r\n";
+
+    Parser parser;
+    parser.parse(str.data(), str.size());
+    parser.setContent(std::move(content));
+    urlDecode(parser);
+    // 记录最近的请求，用于get_peer_ip获取代理转发的真实ip
+    // Keep the latest request, used by get_peer_ip to get the real ip forwarded by a proxy
+    _parser = parser;
+    _http2_streams[stream_id].origin = parser["Origin"];
+
+    if (method == "GET") {
+        onHttp2Request_GET(stream_id, parser);
+    } else if (method == "POST" || method == "DELETE") {
+        emitHttp2Event(stream_id, parser, true);
+    } else if (method == "HEAD") {
+        sendHttp2Response(stream_id, 200);
+    } else if (method == "OPTIONS") {
+        sendHttp2Response(stream_id, 200, nullptr, getOptionsHeader());
+    } else {
+        WarnP(this) << "Http method not supported: " << method;
+        sendHttp2Response(stream_id, 405);
+    }
+}
+
+void HttpSession::onHttp2Request_GET(uint32_t stream_id, Parser &parser) {
+    if (emitHttp2Event(stream_id, parser, false)) {
+        // 拦截http api事件
+        // Intercept http api events
+        return;
+    }
+
+    if (checkHttp2LiveStream(stream_id, parser)) {
+        // 拦截http-flv/ts/fmp4播放器
+        // Intercept http-flv/ts/fmp4 players
+        return;
+    }
+
+    weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
+    HttpFileManager::onAccessPath(*this, parser, [weak_self, stream_id](int code, const string &content_type,
+                                                                       const StrCaseMap &responseHeader, const HttpBody::Ptr &body) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        strong_self->async([weak_self, stream_id, code, content_type, responseHeader, body]() {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return;
+            }
+            strong_self->sendHttp2Response(stream_id, code, content_type.data(), responseHeader, body);
+        });
+    });
+}
+
+bool HttpSession::emitHttp2Event(uint32_t stream_id, const Parser &parser, bool doInvoke) {
+    weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
+    HttpResponseInvoker invoker = [weak_self, stream_id](int code, const KeyValue &headerOut, const HttpBody::Ptr &body) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        strong_self->async([weak_self, stream_id, code, headerOut, body]() {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                // 本对象已经销毁
+                // This object has been destroyed
+                return;
+            }
+            strong_self->sendHttp2Response(stream_id, code, nullptr, headerOut, body);
+        });
+    };
+    bool consumed = false;
+    NOTICE_EMIT(BroadcastHttpRequestArgs, Broadcast::kBroadcastHttpRequest, parser, invoker, consumed, *this);
+    if (!consumed && doInvoke) {
+        // 该事件无人消费，所以返回404
+        // This event is not consumed, so return 404
+        invoker(404, KeyValue(), HttpBody::Ptr());
+    }
+    return consumed;
+}
+
+bool HttpSession::checkHttp2LiveStream(uint32_t stream_id, const Parser &parser) {
+    static const pair<const char *, const char *> s_live_suffix[] = {
+        { RTMP_SCHEMA, ".live.flv" },
+        { TS_SCHEMA, ".live.ts" },
+        { FMP4_SCHEMA, ".live.mp4" },
+    };
+    MediaInfo media_info;
+    auto it = std::find_if(std::begin(s_live_suffix), std::end(s_live_suffix), [&](const pair<const char *, const char *> &pr) {
+        return parseLiveMediaInfo(parser, pr.first, pr.second, media_info);
+    });
+    if (it == std::end(s_live_suffix)) {
+        return false;
+    }
+    media_info.protocol = overSsl() ? "https" : "http";
+    _http2_streams[stream_id].media_info = media_info;
+
+    auto start_pts = atoll(parser.getUrlArgs()["starPts"].data());
+    weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
+    // 鉴权结果回调
+    // Authentication result callback
+    auto onRes = [weak_self, stream_id, start_pts](const string &err) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        if (!err.empty()) {
+            // 播放鉴权失败
+            // Playback authentication failed
+            strong_self->sendHttp2Response(stream_id, 401, nullptr, KeyValue(), std::make_shared<HttpStringBody>(err));
+            return;
+        }
+        auto it = strong_self->_http2_streams.find(stream_id);
+        if (it == strong_self->_http2_streams.end()) {
+            // 流已经被重置
+            // The stream has been reset
+            return;
+        }
+        MediaSource::findAsync(it->second.media_info, strong_self, [weak_self, stream_id, start_pts](const MediaSource::Ptr &src) {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return;
+            }
+            if (!src) {
+                GET_CONFIG(string, notFound, Http::kNotFound);
+                strong_self->sendHttp2Response(stream_id, 404, "text/html", KeyValue(), std::make_shared<HttpStringBody>(notFound));
+                return;
+            }
+            strong_self->startHttp2LiveStream(stream_id, src, start_pts);
+        });
+    };
+
+    Broadcast::AuthInvoker invoker = [weak_self, onRes](const string &err) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->async([onRes, err]() { onRes(err); });
+        }
+    };
+
+    auto flag = NOTICE_EMIT(BroadcastMediaPlayedArgs, Broadcast::kBroadcastMediaPlayed, media_info, invoker, *this);
+    if (!flag) {
+        // 该事件无人监听，默认不鉴权
+        // No one is listening to this event, no authentication by default
+        onRes("");
+    }
+    return true;
+}
+
+void HttpSession::startHttp2LiveStream(uint32_t stream_id, const MediaSource::Ptr &src, uint32_t start_pts) {
+    if (_http2_streams.find(stream_id) == _http2_streams.end()) {
+        return;
+    }
+    weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
+    auto on_write = [weak_self, stream_id](const Buffer::Ptr &buffer) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onHttp2LiveData(stream_id, buffer);
+        }
+    };
+    auto on_detach = [weak_self, stream_id]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->resetHttp2Stream(stream_id, kCancel);
+        }
+    };
+    auto get_info = [weak_self]() {
+        Any ret;
+        ret.set(static_pointer_cast<Session>(weak_self.lock()));
+        return ret;
+    };
+
+    if (auto rtmp_src = dynamic_pointer_cast<RtmpMediaSource>(src)) {
+        KeyValue headerOut;
+        headerOut["Cache-Control"] = "no-store";
+        sendHttp2Response(stream_id, 200, HttpFileManager::getContentType(".flv").data(), headerOut, nullptr, true);
+        auto it = _http2_streams.find(stream_id);
+        if (it == _http2_streams.end()) {
+            return;
+        }
+        auto muxer = std::make_shared<Http2FlvMuxer>(on_write, on_detach);
+        it->second.flv_muxer = muxer;
+        it->second.is_live_stream = true;
+        muxer->start(getPoller(), rtmp_src, start_pts);
+        return;
+    }
+
+    if (auto ts_src = dynamic_pointer_cast<TSMediaSource>(src)) {
+        sendHttp2Response(stream_id, 200, HttpFileManager::getContentType(".ts").data(), KeyValue(), nullptr, true);
+        auto it = _http2_streams.find(stream_id);
+        if (it == _http2_streams.end()) {
+            return;
+        }
+        ts_src->pause(false);
+        auto reader = ts_src->getRing()->attach(getPoller());
+        reader->setGetInfoCB(get_info);
+        reader->setDetachCB(on_detach);
+        reader->setReadCB([on_write](const TSMediaSource::RingDataType &ts_list) {
+            ts_list->for_each([&](const TSPacket::Ptr &ts) { on_write(ts); });
+        });
+        it->second.ts_reader = std::move(reader);
+        it->second.is_live_stream = true;
+        return;
+    }
+
+    auto fmp4_src = dynamic_pointer_cast<FMP4MediaSource>(src);
+    assert(fmp4_src);
+    sendHttp2Response(stream_id, 200, HttpFileManager::getContentType(".mp4").data(), KeyValue(), nullptr, true);
+    auto it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end()) {
+        return;
+    }
+    it->second.is_live_stream = true;
+    onHttp2LiveData(stream_id, std::make_shared<BufferString>(fmp4_src->getInitSegment()));
+    it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end()) {
+        return;
+    }
+    fmp4_src->pause(false);
+    auto reader = fmp4_src->getRing()->attach(getPoller());
+    reader->setGetInfoCB(get_info);
+    reader->setDetachCB(on_detach);
+    reader->setReadCB([on_write](const FMP4MediaSource::RingDataType &fmp4_list) {
+        fmp4_list->for_each([&](const FMP4Packet::Ptr &fmp4) { on_write(fmp4); });
+    });
+    it->second.fmp4_reader = std::move(reader);
+}
+
+void HttpSession::onHttp2LiveData(uint32_t stream_id, const Buffer::Ptr &buffer) {
+    auto it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end()) {
+        return;
+    }
+    if (getHttp2PendingSize(stream_id) > kMaxHttp2PendingSize) {
+        WarnP(this) << "http2 stream(" << it->second.media_info.shortUrl() << ") is too slow, reset it, stream id: " << stream_id;
+        resetHttp2Stream(stream_id, kCancel);
+        return;
+    }
+    _ticker.resetTime();
+    it->second.total_bytes += buffer->size();
+    sendHttp2Data(stream_id, buffer, false);
+}
+
+void HttpSession::sendHttp2Response(uint32_t stream_id, int code, const char *pcContentType, const KeyValue &header,
+                                    const HttpBody::Ptr &body, bool no_content_length) {
+    auto it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end()) {
+        // 流已经被重置
+        // The stream has been reset
+        return;
+    }
+    GET_CONFIG(string, charSet, Http::kCharSet);
+
+    // body默认为空
+    // Body defaults to empty
+    int64_t size = 0;
+    if (body && body->remainSize()) {
+        size = body->remainSize();
+    }
+
+    HttpSession::KeyValue &headerOut = const_cast<HttpSession::KeyValue &>(header);
+    headerOut.emplace("Date", dateStr());
+    headerOut.emplace("Server", kServerName);
+
+    GET_CONFIG(bool, allow_cross_domains, Http::kAllowCrossDomains);
+    if (allow_cross_domains && !it->second.origin.empty()) {
+        headerOut.emplace("Access-Control-Allow-Origin", it->second.origin);
+        headerOut.emplace("Access-Control-Allow-Credentials", "true");
+    }
+
+    if (!no_content_length && size >= 0 && (size_t)size < SIZE_MAX) {
+        headerOut["Content-Length"] = to_string(size);
+    }
+
+    if (size && !pcContentType) {
+        pcContentType = "text/plain";
+    }
+
+    if ((size || no_content_length) && pcContentType) {
+        string strContentType = pcContentType;
+        strContentType += "; charset=";
+        strContentType += charSet;
+        headerOut.emplace("Content-Type", std::move(strContentType));
+    }
+
+    HeaderList headers;
+    headers.reserve(header.size() + 1);
+    headers.emplace_back(":status", to_string(code));
+    for (auto &pr : header) {
+        // http2禁止连接相关的头部
+        // Connection specific headers are forbidden in http2
+        if (!strcasecmp(pr.first.data(), "Connection") || !strcasecmp(pr.first.data(), "Keep-Alive")
+            || !strcasecmp(pr.first.data(), "Transfer-Encoding") || !strcasecmp(pr.first.data(), "Upgrade")
+            || !strcasecmp(pr.first.data(), "Proxy-Connection")) {
+            continue;
+        }
+        headers.emplace_back(pr.first, pr.second);
+    }
+
+    auto end_stream = !size && !no_content_length;
+    if (!end_stream && size) {
+        it->second.body = body;
+    }
+    // 无body时结束流，将触发onHttp2StreamClosed，此后不能再使用it
+    // The stream ends when there is no body, which triggers onHttp2StreamClosed, so it must not be used afterwards
+    sendHttp2Headers(stream_id, headers, end_stream);
+    if (size) {
+        readHttp2Body(stream_id);
+    }
+}
+
+void HttpSession::readHttp2Body(uint32_t stream_id) {
+    auto it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end() || !it->second.body || it->second.reading) {
+        return;
+    }
+    if (isSocketBusy() || getHttp2PendingSize(stream_id)) {
+        // 等待socket缓存清空或者流控窗口更新后通过onHttp2StreamWritable继续
+        // Wait for the socket buffer to be flushed or the window to be updated, then continue through onHttp2StreamWritable
+        return;
+    }
+    it->second.reading = true;
+
+    GET_CONFIG(uint32_t, sendBufSize, Http::kSendBufSize);
+    weak_ptr<HttpSession> weak_self = static_pointer_cast<HttpSession>(shared_from_this());
+    it->second.body->readDataAsync(sendBufSize, [weak_self, stream_id](const Buffer::Ptr &buffer) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        strong_self->async([weak_self, stream_id, buffer]() {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return;
+            }
+            strong_self->onHttp2BodyData(stream_id, buffer);
+        }, false);
+    });
+}
+
+void HttpSession::onHttp2BodyData(uint32_t stream_id, const Buffer::Ptr &buffer) {
+    auto it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end()) {
+        return;
+    }
+    _ticker.resetTime();
+    it->second.reading = false;
+    // 读取完毕或者定长body已经读完最后一块时结束流
+    // End the stream when reading is finished or the last piece of a fixed length body has been read
+    auto end_stream = !buffer || !it->second.body->remainSize();
+    if (end_stream) {
+        it->second.body = nullptr;
+    }
+    sendHttp2Data(stream_id, buffer, end_stream);
+    if (!end_stream) {
+        // socket还可以写且没有被流控阻塞时继续读取
+        // Keep reading while the socket is writable and the stream is not blocked by flow control
+        readHttp2Body(stream_id);
+    }
+}
+
+void HttpSession::onHttp2StreamWritable(uint32_t stream_id) {
+    readHttp2Body(stream_id);
+}
+
+void HttpSession::onHttp2StreamClosed(uint32_t stream_id, ErrorCode error_code) {
+    auto it = _http2_streams.find(stream_id);
+    if (it == _http2_streams.end()) {
+        return;
+    }
+    onHttp2StreamDone(it->second, SockException(Err_shutdown, StrPrinter << "http2 stream closed, error code: " << error_code));
+    if (it->second.flv_muxer) {
+        it->second.flv_muxer->stop();
+    }
+    _http2_streams.erase(it);
+}
+
+void HttpSession::onHttp2StreamDone(Http2Stream &stream, const SockException &err) {
+    if (!stream.is_live_stream) {
+        return;
+    }
+    stream.is_live_stream = false;
+    uint64_t duration = stream.ticker.createdTime() / 1000;
+    WarnP(this) << "http2 FLV/TS/FMP4播放器(" << stream.media_info.shortUrl() << ")断开:" << err << ",耗时(s):" << duration;
+
+    GET_CONFIG(uint32_t, iFlowThreshold, General::kFlowThreshold);
+    if (stream.total_bytes >= iFlowThreshold * 1024) {
+        NOTICE_EMIT(BroadcastFlowReportArgs, Broadcast::kBroadcastFlowReport, stream.media_info, stream.total_bytes, duration, true, *this);
+    }
+}
+
+void HttpSession::onHttp2Error(const string &err) {
+    shutdown(SockException(Err_shutdown, err));
+}
+
+void HttpSession::onHttp2SendData(Buffer::Ptr buffer) {
+    send(std::move(buffer));
+}
+
 } /* namespace mediakit */
@@ -11,11 +11,14 @@
 #ifndef SRC_HTTP_HTTPSESSION_H_
 #define SRC_HTTP_HTTPSESSION_H_
 
+#include <map>
 #include <functional>
 #include "Network/Session.h"
 #include "Rtmp/FlvMuxer.h"
 #include "HttpRequestSplitter.h"
 #include "WebSocketSplitter.h"
+#include "Http2Splitter.h"
+#include "Common/KTlsBox.h"
 #include "HttpCookieManager.h"
 #include "HttpFileManager.h"
 #include "TS/TSMediaSource.h"
@@ -26,7 +29,8 @@ namespace mediakit {
 class HttpSession: public toolkit::Session,
                    public FlvMuxer,
                    public HttpRequestSplitter,
-                   public WebSocketSplitter {
+                   public WebSocketSplitter,
+                   public Http2Splitter {
 public:
     using Ptr = std::shared_ptr<HttpSession>;
     using KeyValue = StrCaseMap;
@@ -128,7 +132,33 @@ protected:
     // Overload to get client ip
     std::string get_peer_ip() override;
 
+    //Http2Splitter override
+    void onHttp2Request(uint32_t stream_id, HeaderList &headers, std::string &content) override;
+    void onHttp2StreamWritable(uint32_t stream_id) override;
+    void onHttp2StreamClosed(uint32_t stream_id, ErrorCode error_code) override;
+    void onHttp2Error(const std::string &err) override;
+    void onHttp2SendData(toolkit::Buffer::Ptr buffer) override;
+
 private:
+    // http2的每个流的上下文
+    // The context of every http2 stream
+    struct Http2Stream {
+        // http请求中的Origin字段
+        // Origin field in http request
+        std::string origin;
+        HttpBody::Ptr body;
+        bool reading = false;
+        // http-flv/ts/fmp4直播流
+        // http-flv/ts/fmp4 live stream
+        bool is_live_stream = false;
+        uint64_t total_bytes = 0;
+        MediaInfo media_info;
+        toolkit::Ticker ticker;
+        FlvMuxer::Ptr flv_muxer;
+        TSMediaSource::RingType::RingReader::Ptr ts_reader;
+        FMP4MediaSource::RingType::RingReader::Ptr fmp4_reader;
+    };
+
     void onHttpRequest_GET();
     void onHttpRequest_POST();
     void onHttpRequest_HEAD();
@@ -152,6 +182,19 @@ private:
     // Set socket flag
     void setSocketFlags();
 
+    ssize_t onHttp2Preface(size_t len);
+    void onHttp2Request_GET(uint32_t stream_id, Parser &parser);
+    bool emitHttp2Event(uint32_t stream_id, const Parser &parser, bool doInvoke);
+    bool checkHttp2LiveStream(uint32_t stream_id, const Parser &parser);
+    void startHttp2LiveStream(uint32_t stream_id, const MediaSource::Ptr &src, uint32_t start_pts);
+    void onHttp2LiveData(uint32_t stream_id, const toolkit::Buffer::Ptr &buffer);
+    void sendHttp2Response(uint32_t stream_id, int code, const char *pcContentType = nullptr,
+                           const HttpSession::KeyValue &header = HttpSession::KeyValue(),
+                           const HttpBody::Ptr &body = nullptr, bool no_content_length = false);
+    void readHttp2Body(uint32_t stream_id);
+    void onHttp2BodyData(uint32_t stream_id, const toolkit::Buffer::Ptr &buffer);
+    void onHttp2StreamDone(Http2Stream &stream, const toolkit::SockException &err);
+
 protected:
     MediaInfo _media_info;
 
@@ -178,9 +221,12 @@ private:
     // 处理content数据的callback  [AUTO-TRANSLATED:38890e8d]
     // Callback to handle content data
     std::function<bool (const char *data,size_t len) > _on_recv_body;
+    // http2的流，key为stream id
+    // http2 streams, the key is the stream id
+    std::map<uint32_t, Http2Stream> _http2_streams;
 };
 
-using HttpsSession = toolkit::SessionWithSSL<HttpSession>;
+using HttpsSession = SessionWithKTLS<HttpSession>;
 
 } /* namespace mediakit */
 
@@ -12,10 +12,12 @@
 #include <iomanip> 
 #include <sys/stat.h>
 #include "HlsMakerImp.h"
+#include "RecordIndex.h"
 #include "Util/util.h"
 #include "Util/uv_errno.h"
 #include "Util/File.h"
 #include "Common/config.h"
+#include "Http/HttpFileCache.h"
 
 using namespace std;
 using namespace toolkit;
@@ -63,6 +65,7 @@ void HlsMakerImp::clearCache() {
 static void clearHls(const std::list<std::string> &files) {
     for (auto &file : files) {
         File::delete_file(file);
+        HttpFileCache::Instance().remove(file);
     }
     File::deleteEmptyDir(File::parentDir(files.back()));
 }
@@ -170,6 +173,7 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
     // 保存本切片的元数据  [AUTO-TRANSLATED:64e6f692]
     // Save metadata for this slice
     _info.start_time = ::time(NULL);
+    _start_ms = getCurrentMillisecond(true);
     _info.file_name = segment_name;
     _info.file_path = segment_path;
     _info.url = _info.app + "/" + _info.stream + "/" + segment_name;
@@ -189,6 +193,9 @@ void HlsMakerImp::onDelSegment(uint64_t index) {
         return;
     }
     File::delete_file(it->second.data(), true);
+    // 切片已删除，释放其文件缓存
+    // The segment is deleted, release its file cache
+    HttpFileCache::Instance().remove(it->second);
     _segment_file_paths.erase(it);
 }
 
@@ -233,6 +240,17 @@ void HlsMakerImp::onFlushLastSegment(uint64_t duration_ms) {
     // 关闭并flush文件到磁盘  [AUTO-TRANSLATED:9798ec4d]
     // Close and flush file to disk
     _file = nullptr;
+    GET_CONFIG(bool, enable_index, Record::kEnableIndex);
+    if (enable_index && (!isLive() || isKeep())) {
+        // 保留的切片追加到录像索引，用于按时间段快速查询
+        // Append the kept segment to the record index for fast time range queries
+        RecordIndexItem item;
+        item.start_ms = _start_ms;
+        item.end_ms = _start_ms + duration_ms;
+        item.file_size = File::fileSize(_info.file_path.data());
+        item.file_name = _info.file_name;
+        RecordIndex::Instance().append(Recorder::type_hls, _path_prefix, std::move(item));
+    }
     if (!isLive() || isKeep()) {
         _current_dir_seg_list.emplace_back(duration_ms, _info.file_name.erase(0, _current_dir.size()));
     }
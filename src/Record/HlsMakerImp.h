@@ -74,6 +74,9 @@ private:
     std::string _path_prefix;
     std::string _current_dir;
     std::string _current_dir_init_file;
+    // 当前切片的开始时间，unix时间戳，单位毫秒
+    // The start time of the current segment, unix timestamp in milliseconds
+    uint64_t _start_ms = 0;
     RecordInfo _info;
     std::shared_ptr<FILE> _file;
     std::shared_ptr<char> _file_buf;
@@ -10,6 +10,10 @@
 
 #if defined(ENABLE_MP4)
 
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#endif
 #include "MP4.h"
 #include "Util/File.h"
 #include "Util/logger.h"
@@ -81,6 +85,106 @@ MP4FileIO::Reader MP4FileIO::createReader(){
     #define ftell64 ftell
 #endif
 
+// moov超过该大小时不读入内存
+// A moov larger than this is not read into memory
+static constexpr uint64_t kMaxMoovSize = 64 * 1024 * 1024;
+
+static uint64_t readBE(const uint8_t *ptr, size_t bytes) {
+    uint64_t ret = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        ret = (ret << 8) | ptr[i];
+    }
+    return ret;
+}
+
+// 遍历顶层box查找moov，size为box总大小(包含头部)
+// Walk the top level boxes to find moov, size is the total size of the box (including its header)
+static bool findMoov(FILE *fp, uint64_t file_size, uint64_t &offset, uint64_t &size) {
+    uint8_t buf[16];
+    offset = 0;
+    while (fseek64(fp, offset, SEEK_SET) == 0 && fread(buf, 1, 8, fp) == 8) {
+        size = readBE(buf, 4);
+        if (size == 1) {
+            if (fread(buf + 8, 1, 8, fp) != 8) {
+                return false;
+            }
+            size = readBE(buf + 8, 8);
+        } else if (size == 0) {
+            // box延续到文件末尾
+            // The box extends to the end of the file
+            size = file_size - offset;
+        }
+        if (size < 8) {
+            return false;
+        }
+        if (readBE(buf + 4, 4) == MOV_TAG('m', 'o', 'o', 'v')) {
+            return true;
+        }
+        offset += size;
+    }
+    return false;
+}
+
+MP4MoovCache &MP4MoovCache::Instance() {
+    static MP4MoovCache s_instance;
+    return s_instance;
+}
+
+MP4MoovCache::Moov::Ptr MP4MoovCache::get(const string &path, FILE *fp) {
+    struct stat st;
+    if (stat(path.data(), &st) != 0) {
+        return nullptr;
+    }
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _entries.find(path);
+        if (it != _entries.end()) {
+            auto &entry = it->second->second;
+            if (entry.mtime == st.st_mtime && entry.file_size == (uint64_t)st.st_size) {
+                _lru.splice(_lru.begin(), _lru, it->second);
+                return entry.moov;
+            }
+            // 文件已被修改
+            // The file has been modified
+            _bytes -= entry.moov->data.size();
+            _lru.erase(it->second);
+            _entries.erase(it);
+        }
+    }
+
+    auto moov = std::make_shared<Moov>();
+    uint64_t size;
+    auto found = findMoov(fp, (uint64_t)st.st_size, moov->offset, size) && size <= kMaxMoovSize;
+    if (found) {
+        moov->data.resize(size);
+        found = fseek64(fp, moov->offset, SEEK_SET) == 0 && fread((char *)moov->data.data(), 1, size, fp) == size;
+    }
+    fseek64(fp, 0, SEEK_SET);
+    if (!found) {
+        return nullptr;
+    }
+
+    GET_CONFIG(uint32_t, cache_mb, Record::kMoovCacheMB);
+    size_t max_bytes = (size_t)cache_mb * 1024 * 1024;
+    if (size > max_bytes / 4) {
+        // 缓存关闭或者moov太大，不加入缓存
+        // The cache is disabled or the moov is too large, do not cache it
+        return moov;
+    }
+    lock_guard<mutex> lck(_mtx);
+    if (_entries.find(path) == _entries.end()) {
+        _lru.emplace_front(path, Entry { st.st_mtime, (uint64_t)st.st_size, moov });
+        _entries.emplace(path, _lru.begin());
+        _bytes += size;
+    }
+    while (_bytes > max_bytes && !_lru.empty()) {
+        _bytes -= _lru.back().second.moov->data.size();
+        _entries.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    return moov;
+}
+
 void MP4FileDisk::openFile(const char *file, const char *mode) {
     // 创建文件  [AUTO-TRANSLATED:bd145ed5]
     // Create a file
@@ -115,9 +219,53 @@ void MP4FileDisk::openFile(const char *file, const char *mode) {
 
 void MP4FileDisk::closeFile() {
     _file = nullptr;
+    _moov = nullptr;
+    _read_cache = false;
+}
+
+void MP4FileDisk::enableReadCache(const string &file) {
+    _moov = MP4MoovCache::Instance().get(file, _file.get());
+    _read_cache = true;
+    _seek_pending = true;
+    _pos = 0;
+}
+
+void MP4FileDisk::setReadAhead(uint64_t bytes) {
+    _read_ahead = bytes;
+    _advise_begin = _advise_end = 0;
+}
+
+void MP4FileDisk::readAhead(size_t bytes) {
+#if defined(POSIX_FADV_WILLNEED)
+    if (!_read_ahead || (_pos >= _advise_begin && _pos + bytes <= _advise_end)) {
+        return;
+    }
+    // 读到上次预读窗口的一半或者seek到窗口外时，通知内核异步预读之后的数据，避免读取sample时阻塞在磁盘io上
+    // When half of the last window has been read or the position leaves the window, tell the kernel to read the following data
+    // asynchronously, so reading samples does not block on disk io
+    posix_fadvise(fileno(_file.get()), _pos, _read_ahead, POSIX_FADV_WILLNEED);
+    _advise_begin = _pos;
+    _advise_end = _pos + _read_ahead / 2;
+#endif
 }
 
 int MP4FileDisk::onRead(void *data, size_t bytes) {
+    if (_read_cache) {
+        if (_moov && _pos >= _moov->offset && _pos + bytes <= _moov->offset + _moov->data.size()) {
+            memcpy(data, _moov->data.data() + (_pos - _moov->offset), bytes);
+            _pos += bytes;
+            _seek_pending = true;
+            return 0;
+        }
+        readAhead(bytes);
+        if (_seek_pending) {
+            if (fseek64(_file.get(), _pos, SEEK_SET) != 0) {
+                return -1;
+            }
+            _seek_pending = false;
+        }
+        _pos += bytes;
+    }
     if (bytes == fread(data, 1, bytes, _file.get())){
         return 0;
     }
@@ -129,10 +277,18 @@ int MP4FileDisk::onWrite(const void *data, size_t bytes) {
 }
 
 int MP4FileDisk::onSeek(uint64_t offset) {
+    if (_read_cache) {
+        _pos = offset;
+        _seek_pending = true;
+        return 0;
+    }
     return fseek64(_file.get(), offset, SEEK_SET);
 }
 
 uint64_t MP4FileDisk::onTell() {
+    if (_read_cache) {
+        return _pos;
+    }
     return ftell64(_file.get());
 }
 
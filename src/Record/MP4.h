@@ -13,8 +13,11 @@
 
 #if defined(ENABLE_MP4)
 
+#include <list>
+#include <mutex>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include "mp4-writer.h"
 #include "mov-writer.h"
 #include "mov-reader.h"
@@ -109,6 +112,52 @@ public:
     virtual int onWrite(const void *data, size_t bytes) = 0;
 };
 
+/**
+ * 进程级的moov缓存，以文件路径为key，通过文件修改时间与大小校验，超出总大小后淘汰最久未使用的
+ * 同一个文件被多次点播时，moov直接从内存读取，不再访问磁盘
+ * A process wide moov cache keyed by the file path and validated by the modification time and size,
+ * the least recently used ones are evicted when the total size is exceeded;
+ * when the same file is played many times, its moov is read from memory instead of the disk
+ */
+class MP4MoovCache {
+public:
+    struct Moov {
+        using Ptr = std::shared_ptr<const Moov>;
+        // moov box(包含头部)在文件中的偏移量
+        // The offset of the moov box (including its header) in the file
+        uint64_t offset = 0;
+        std::string data;
+    };
+
+    static MP4MoovCache &Instance();
+
+    /**
+     * 获取文件的moov，未命中时从文件读取并加入缓存(缓存关闭时不加入)
+     * @param path 文件路径
+     * @param fp 已打开的文件，读取后恢复至文件开头
+     * @return moov，找不到moov或者moov过大时返回空
+     * Get the moov of a file, it is read from the file and added to the cache (unless the cache is disabled) on a miss
+     * @param path File path
+     * @param fp The opened file, rewound to the beginning after reading
+     * @return The moov, null if there is no moov or it is too large
+     */
+    Moov::Ptr get(const std::string &path, FILE *fp);
+
+private:
+    MP4MoovCache() = default;
+
+private:
+    struct Entry {
+        time_t mtime;
+        uint64_t file_size;
+        Moov::Ptr moov;
+    };
+    std::mutex _mtx;
+    size_t _bytes = 0;
+    std::list<std::pair<std::string, Entry>> _lru;
+    std::unordered_map<std::string, std::list<std::pair<std::string, Entry>>::iterator> _entries;
+};
+
 // 磁盘MP4文件类  [AUTO-TRANSLATED:e3f5ac07]
 // Disk MP4 file class
 class MP4FileDisk : public MP4FileIO {
@@ -135,6 +184,22 @@ public:
      */
     void closeFile();
 
+    /**
+     * 启用读缓存，moov从MP4MoovCache读取，只用于解复用
+     * @param file 文件路径
+     * Enable the read cache, the moov is read from MP4MoovCache; only for demuxing
+     * @param file File path
+     */
+    void enableReadCache(const std::string &file);
+
+    /**
+     * 设置预读字节数，读取sample时提前通知内核异步预读之后的数据
+     * @param bytes 预读字节数，0为不预读
+     * Set the read ahead bytes, the kernel is told to read the following data asynchronously in advance when reading samples
+     * @param bytes Read ahead bytes, 0 to disable
+     */
+    void setReadAhead(uint64_t bytes);
+
 protected:
     uint64_t onTell() override;
     int onSeek(uint64_t offset) override;
@@ -142,6 +207,19 @@ protected:
     int onWrite(const void *data, size_t bytes) override;
 
 private:
+    void readAhead(size_t bytes);
+
+private:
+    // 启用读缓存后自行维护读位置，从moov缓存读取时文件位置不变，真正读文件前再seek
+    // With the read cache enabled the read position is maintained here, the file position does not move
+    // while reading from the moov cache and is seeked right before reading the file
+    bool _read_cache = false;
+    bool _seek_pending = false;
+    uint64_t _pos = 0;
+    uint64_t _read_ahead = 0;
+    uint64_t _advise_begin = 0;
+    uint64_t _advise_end = 0;
+    MP4MoovCache::Moov::Ptr _moov;
     std::shared_ptr<FILE> _file;
 };
 
@@ -14,6 +14,8 @@
 #include "MP4Demuxer.h"
 #include "Util/File.h"
 #include "Util/logger.h"
+#include "Common/config.h"
+#include "Thread/WorkThreadPool.h"
 #include "Extension/Factory.h"
 
 using namespace std;
@@ -30,9 +32,18 @@ void MP4Demuxer::openMP4(const string &file) {
 
     _mp4_file = std::make_shared<MP4FileDisk>();
     _mp4_file->openFile(file.data(), "rb+");
+    _mp4_file->enableReadCache(file);
     _mov_reader = _mp4_file->createReader();
     getAllTracks();
     _duration_ms = mov_reader_getduration(_mov_reader.get());
+
+    GET_CONFIG(uint32_t, read_ahead_ms, Record::kReadAheadMS);
+    if (read_ahead_ms && _duration_ms) {
+        // 按平均码率换算预读窗口大小
+        // Convert the read ahead window to bytes by the average bitrate
+        auto bytes = File::fileSize(file) * read_ahead_ms / _duration_ms;
+        _mp4_file->setReadAhead(std::max<uint64_t>(bytes, 256 * 1024));
+    }
 }
 
 void MP4Demuxer::closeMP4() {
@@ -194,6 +205,63 @@ uint64_t MP4Demuxer::getDurationMS() const {
 
 /////////////////////////////////////////////////////////////////////////////////
 
+static uint32_t readBE32(const uint8_t *ptr) {
+    return (ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+}
+
+static uint64_t readBE64(const uint8_t *ptr) {
+    return ((uint64_t)readBE32(ptr) << 32) | readBE32(ptr + 4);
+}
+
+// 只读取moov(优先从MP4MoovCache)中的mvhd获取文件时长，不解析sample表，失败返回0
+// Only read mvhd in moov (from MP4MoovCache first) for the duration without parsing the sample table, returns 0 on failure
+static uint64_t probeDurationMS(const string &path) {
+    std::shared_ptr<FILE> fp(File::create_file(path, "rb"), [](FILE *fp) {
+        if (fp) {
+            fclose(fp);
+        }
+    });
+    auto moov = fp ? MP4MoovCache::Instance().get(path, fp.get()) : nullptr;
+    if (!moov || moov->data.size() < 16) {
+        return 0;
+    }
+    auto ptr = (const uint8_t *)moov->data.data();
+    auto end = ptr + moov->data.size();
+    ptr += readBE32(ptr) == 1 ? 16 : 8;
+    while (ptr + 8 <= end) {
+        uint64_t size = readBE32(ptr);
+        uint64_t header = 8;
+        if (size == 1) {
+            if (ptr + 16 > end) {
+                break;
+            }
+            size = readBE64(ptr + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = end - ptr;
+        }
+        if (size < header || size > (uint64_t)(end - ptr)) {
+            break;
+        }
+        if (readBE32(ptr + 4) == MOV_TAG('m', 'v', 'h', 'd')) {
+            if (size < header + 32) {
+                break;
+            }
+            auto body = ptr + header;
+            // version 1的时间字段为64位
+            // The time fields of version 1 are 64 bits
+            auto timescale = body[0] == 1 ? readBE32(body + 20) : readBE32(body + 12);
+            auto duration = body[0] == 1 ? readBE64(body + 24) : readBE32(body + 16);
+            if (!timescale || duration == UINT32_MAX || duration == UINT64_MAX) {
+                break;
+            }
+            return duration * 1000 / timescale;
+        }
+        ptr += size;
+    }
+    return 0;
+}
+
 void MultiMP4Demuxer::openMP4(const string &files_string) {
     std::vector<std::string> files;
     if (File::is_dir(files_string)) {
@@ -210,28 +278,83 @@ void MultiMP4Demuxer::openMP4(const string &files_string) {
 
     uint64_t duration_ms = 0;
     for (auto &file : files) {
-        auto demuxer = std::make_shared<MP4Demuxer>();
-        demuxer->openMP4(file);
-        _demuxers.emplace(duration_ms, demuxer);
-        duration_ms += demuxer->getDurationMS();
+        auto item = std::make_shared<Item>();
+        item->path = file;
+        if (_items.empty()) {
+            // 第一个文件立即打开，用于获取track信息
+            // The first file is opened immediately for the track information
+            item->demuxer = std::make_shared<MP4Demuxer>();
+            item->demuxer->openMP4(file);
+            item->duration_ms = item->demuxer->getDurationMS();
+        } else {
+            item->duration_ms = probeDurationMS(file);
+            if (!item->duration_ms) {
+                // moov中没有时长(例如fmp4)，只能完整打开
+                // There is no duration in moov (e.g. fmp4), it has to be fully opened
+                item->demuxer = getDemuxer(*item);
+                item->duration_ms = item->demuxer ? item->demuxer->getDurationMS() : 0;
+            }
+        }
+        if (!item->duration_ms) {
+            WarnL << "Ignore empty mp4 file: " << file;
+            continue;
+        }
+        _items.emplace(duration_ms, std::move(item));
+        duration_ms += _items.rbegin()->second->duration_ms;
     }
-    CHECK(!_demuxers.empty());
-    _it = _demuxers.begin();
-    for (auto &track : _it->second->getTracks(false)) {
+    CHECK(!_items.empty());
+    _it = _items.begin();
+    for (auto &track : _it->second->demuxer->getTracks(false)) {
         auto clone_track(track->clone());
         clone_track->setIndex(clone_track->getTrackType());
         _tracks.emplace(clone_track->getIndex(), clone_track);
         DebugL << "track index: " << track->getIndex() << " -> " << clone_track->getIndex();
     }
+    prefetch(std::next(_it));
+}
+
+MP4Demuxer::Ptr MultiMP4Demuxer::getDemuxer(Item &item) {
+    lock_guard<mutex> lck(item.mtx);
+    if (!item.demuxer && !item.failed) {
+        try {
+            auto demuxer = std::make_shared<MP4Demuxer>();
+            demuxer->openMP4(item.path);
+            item.demuxer = std::move(demuxer);
+        } catch (std::exception &ex) {
+            WarnL << "Open mp4 file failed: " << item.path << ", " << ex.what();
+            item.failed = true;
+        }
+    }
+    return item.demuxer;
+}
+
+void MultiMP4Demuxer::prefetch(ItemMap::iterator it) {
+    if (it == _items.end()) {
+        return;
+    }
+    // 在后台线程预先解析下一个文件的sample表
+    // Parse the sample table of the next file in a background thread in advance
+    auto item = it->second;
+    WorkThreadPool::Instance().getExecutor()->async([item]() { getDemuxer(*item); });
+}
+
+void MultiMP4Demuxer::release(ItemMap::iterator it) {
+    if (it == _items.end() || _items.size() == 1) {
+        return;
+    }
+    // 播放过的文件释放sample表，再次seek到时重新打开
+    // Release the sample table of a played file, it is reopened when seeked to again
+    lock_guard<mutex> lck(it->second->mtx);
+    it->second->demuxer = nullptr;
 }
 
 uint64_t MultiMP4Demuxer::getDurationMS() const {
-    return _demuxers.empty() ? 0 : _demuxers.rbegin()->first + _demuxers.rbegin()->second->getDurationMS();
+    return _items.empty() ? 0 : _items.rbegin()->first + _items.rbegin()->second->duration_ms;
 }
 
 void MultiMP4Demuxer::closeMP4() {
-    _demuxers.clear();
-    _it = _demuxers.end();
+    _items.clear();
+    _it = _items.end();
     _tracks.clear();
 }
 
@@ -239,13 +362,27 @@ int64_t MultiMP4Demuxer::seekTo(int64_t stamp_ms) {
     if (stamp_ms >= (int64_t)getDurationMS()) {
         return -1;
     }
-    _it = std::prev(_demuxers.upper_bound(stamp_ms));
-    return _it->first + _it->second->seekTo(stamp_ms - _it->first);
+    auto it = std::prev(_items.upper_bound(stamp_ms));
+    auto demuxer = getDemuxer(*it->second);
+    if (!demuxer) {
+        return -1;
+    }
+    if (it != _it) {
+        release(_it);
+        _it = it;
+        prefetch(std::next(_it));
+    }
+    auto stamp = demuxer->seekTo(stamp_ms - _it->first);
+    return stamp == -1 ? -1 : _it->first + stamp;
 }
 
 Frame::Ptr MultiMP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
-    for (;;) {
-        auto ret = _it->second->readFrame(keyFrame, eof);
+    while (_it != _items.end()) {
+        Frame::Ptr ret;
+        eof = true;
+        if (auto demuxer = getDemuxer(*_it->second)) {
+            ret = demuxer->readFrame(keyFrame, eof);
+        }
         if (ret) {
             ret->setIndex(ret->getTrackType());
             auto it = _tracks.find(ret->getIndex());
@@ -256,19 +393,32 @@ Frame::Ptr MultiMP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
                 it->second->inputFrame(ret);
             }
         }
-        if (eof && _it != _demuxers.end()) {
-            // 切换到下一个文件
-            if (++_it == _demuxers.end()) {
-                // 已经是最后一个文件了
-                eof = true;
-                return nullptr;
-            }
-            // 下一个文件从头开始播放
-            _it->second->seekTo(0);
-            continue;
+        if (!eof) {
+            return ret;
+        }
+        // 切换到下一个文件，它一般已经在后台打开
+        // Switch to the next file, which has usually been opened in the background
+        auto next = std::next(_it);
+        if (next == _items.end()) {
+            // 已经是最后一个文件了
+            // This is already the last file
+            return ret;
+        }
+        release(_it);
+        _it = next;
+        prefetch(std::next(_it));
+        // 下一个文件从头开始播放
+        // The next file is played from the beginning
+        if (auto demuxer = getDemuxer(*_it->second)) {
+            demuxer->seekTo(0);
+        }
+        if (ret) {
+            eof = false;
+            return ret;
         }
-        return ret;
     }
+    eof = true;
+    return nullptr;
 }
 
 std::vector<Track::Ptr> MultiMP4Demuxer::getTracks(bool trackReady) const {
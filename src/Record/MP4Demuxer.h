@@ -13,6 +13,7 @@
 #ifdef ENABLE_MP4
 
 #include <map>
+#include <mutex>
 #include "MP4.h"
 #include "Extension/Track.h"
 #include "Util/ResourcePool.h"
@@ -114,7 +115,14 @@ public:
 
     /**
      * 批量打开mp4文件，把多个文件当做一个mp4看待
+     * 只有第一个文件会被立即打开，其他文件只读取moov/mvhd获取时长，在播放到或seek到时才解析sample表，
+     * 并在后台线程预先打开下一个文件，跨文件播放时不会卡顿
      * @param file 多个mp4文件路径，以分号分隔; 或者包含多个mp4文件的文件夹
+     * Open several mp4 files as one continuous mp4
+     * Only the first file is opened immediately, the others only have moov/mvhd read for the duration and
+     * their sample tables are parsed when played or seeked to; the next file is pre-opened in a background thread,
+     * so playback does not stall across file boundaries
+     * @param file Paths of the mp4 files separated by semicolons; or a folder containing the mp4 files
      */
     void openMP4(const std::string &file);
 
@@ -151,10 +159,29 @@ public:
      */
     uint64_t getDurationMS() const;
 
+private:
+    struct Item {
+        using Ptr = std::shared_ptr<Item>;
+        std::string path;
+        uint64_t duration_ms = 0;
+        // 保护demuxer，它可能在后台线程被预先打开
+        // Protects demuxer, which may be pre-opened in a background thread
+        std::mutex mtx;
+        bool failed = false;
+        MP4Demuxer::Ptr demuxer;
+    };
+    using ItemMap = std::map<uint64_t, Item::Ptr>;
+
+    static MP4Demuxer::Ptr getDemuxer(Item &item);
+    void prefetch(ItemMap::iterator it);
+    void release(ItemMap::iterator it);
+
 private:
     std::map<int, Track::Ptr> _tracks;
-    std::map<uint64_t, MP4Demuxer::Ptr>::iterator _it;
-    std::map<uint64_t, MP4Demuxer::Ptr> _demuxers;
+    ItemMap::iterator _it;
+    // key为文件在总体时间轴上的开始位置
+    // The key is the start position of the file on the overall timeline
+    ItemMap _items;
 };
 
 }//namespace mediakit
@@ -14,6 +14,7 @@
 #include "Util/File.h"
 #include "Common/config.h"
 #include "MP4Recorder.h"
+#include "RecordIndex.h"
 #include "Thread/WorkThreadPool.h"
 #include "MP4Muxer.h"
 
@@ -50,6 +51,8 @@ void MP4Recorder::createFile() {
     // ///record 业务逻辑//////  [AUTO-TRANSLATED:2e78931a]
     // ///record Business Logic//////
     _info.start_time = ::time(NULL);
+    _start_ms = getCurrentMillisecond(true);
+    _key_ms.clear();
     _info.file_name = file_name;
     _info.file_path = full_path;
     GET_CONFIG(string, appName, Record::kAppName);
@@ -74,9 +77,13 @@ void MP4Recorder::asyncClose() {
     auto muxer = _muxer;
     auto full_path_tmp = _full_path_tmp;
     auto info = _info;
+    RecordIndexItem item;
+    item.start_ms = _start_ms;
+    item.key_ms = std::move(_key_ms);
     TraceL << "Start close tmp mp4 file: " << full_path_tmp;
-    WorkThreadPool::Instance().getExecutor()->async([muxer, full_path_tmp, info]() mutable {
-        info.time_len = muxer->getDuration() / 1000.0f;
+    WorkThreadPool::Instance().getExecutor()->async([muxer, full_path_tmp, info, item]() mutable {
+        auto duration_ms = muxer->getDuration();
+        info.time_len = duration_ms / 1000.0f;
         // 关闭mp4可能非常耗时，所以要放在后台线程执行  [AUTO-TRANSLATED:a7378a11]
         // Closing mp4 can be very time-consuming, so it should be executed in the background thread
         TraceL << "Closing tmp mp4 file: " << full_path_tmp;
@@ -95,6 +102,16 @@ void MP4Recorder::asyncClose() {
             // 临时文件名改成正式文件名，防止mp4未完成时被访问  [AUTO-TRANSLATED:541a6f00]
             // Change the temporary file name to the official file name to prevent access to the mp4 before it is completed
             rename(full_path_tmp.data(), info.file_path.data());
+
+            GET_CONFIG(bool, enable_index, Record::kEnableIndex);
+            if (enable_index) {
+                // 追加录像索引，用于按时间段快速查询
+                // Append to the record index for fast time range queries
+                item.end_ms = item.start_ms + duration_ms;
+                item.file_size = info.file_size;
+                item.file_name = info.file_path.substr(info.folder.size());
+                RecordIndex::Instance().append(Recorder::type_mp4, info.folder, std::move(item));
+            }
         }
         TraceL << "Emit mp4 record event: " << info.file_path;
         // 触发mp4录制切片生成事件  [AUTO-TRANSLATED:9959dcd4]
@@ -131,6 +148,20 @@ bool MP4Recorder::inputFrame(const Frame::Ptr &frame) {
         for (auto &ref : _delta_stamp) {
             ref.reset();
         }
+        stamp_inc = 0;
+    }
+
+    if (_have_video && frame->getTrackType() == TrackVideo && frame->keyFrame()) {
+        // 记录关键帧位置，用于按时间seek；mp4文件从第一个视频关键帧开始，其时间轴以该帧的dts为0点
+        // Record the key frame position for seeking by time; the mp4 file starts from the first video key frame,
+        // its timeline takes the dts of that frame as zero
+        if (_key_ms.empty()) {
+            _start_dts = frame->dts();
+        }
+        auto key_ms = frame->pts() > _start_dts ? frame->pts() - _start_dts : 0;
+        if (_key_ms.empty() || _key_ms.back() != key_ms) {
+            _key_ms.emplace_back(key_ms);
+        }
     }
 
     if (_muxer) {
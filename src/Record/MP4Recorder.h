@@ -13,6 +13,7 @@
 
 #include <mutex>
 #include <memory>
+#include <vector>
 #include "Common/MediaSink.h"
 #include "Record/Recorder.h"
 #include "MP4Muxer.h"
@@ -72,6 +73,13 @@ private:
     size_t _max_second;
     DeltaStamp _delta_stamp[TrackMax];
     std::atomic<uint64_t> _file_index { 0 };
+    // 当前文件的开始时间(unix时间戳，单位毫秒)与关键帧时间，用于录像索引
+    // The start time (unix timestamp in milliseconds) and key frame times of the current file, used by the record index
+    uint64_t _start_ms = 0;
+    // 当前文件第一个视频关键帧的dts，关键帧时间相对它计算
+    // The dts of the first video key frame of the current file, key frame times are relative to it
+    uint64_t _start_dts = 0;
+    std::vector<uint32_t> _key_ms;
     std::string _full_path_tmp;
     RecordInfo _info;
     MP4Muxer::Ptr _muxer;
@@ -0,0 +1,303 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "PreRecordBuffer.h"
+#include "Extension/Factory.h"
+#include "Util/File.h"
+#include "Util/logger.h"
+#include "Thread/WorkThreadPool.h"
+#include <atomic>
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 每个分段文件的时长，只在gop开始处切换分段
+// The duration of each segment file, a segment is only switched at the start of a gop
+static constexpr uint64_t kSegmentMS = 10 * 1000;
+// 帧头: 负载长度(4) + codec(1) + track index(1) + 保留(2) + dts(8) + pts(8)
+// Frame header: payload size(4) + codec(1) + track index(1) + reserved(2) + dts(8) + pts(8)
+static constexpr size_t kFrameHeaderSize = 24;
+// 防止读取到损坏的分段文件时分配过大的内存
+// Prevent allocating too much memory when reading a corrupted segment file
+static constexpr uint32_t kMaxFrameSize = 16 * 1024 * 1024;
+// 积累到该大小或到gop开始处时才把帧交给写线程，减少跨线程任务数
+// Frames are handed to the writer thread once this size is reached or at the start of a gop, to reduce cross-thread tasks
+static constexpr size_t kFlushBytes = 256 * 1024;
+// 写线程积压超过该大小时认为磁盘过慢，停止缓存，防止内存无限增长
+// The disk is considered too slow when the writer thread lags behind by this size, buffering stops to bound the memory
+static constexpr size_t kMaxQueuedBytes = 64 * 1024 * 1024;
+
+// 写线程状态，除error与queued_bytes外只在写线程中访问
+// The writer thread state, only accessed in the writer thread except error and queued_bytes
+class PreRecordBuffer::Writer {
+public:
+    EventPoller::Ptr poller;
+    // 写入中的分段文件 / the segment file being written
+    string path;
+    shared_ptr<FILE> fp;
+    atomic<bool> error { false };
+    atomic<size_t> queued_bytes { 0 };
+
+    void open(const string &file) {
+        path = file;
+        fp.reset(File::create_file(path, "wb"), [](FILE *fp) {
+            if (fp) {
+                fclose(fp);
+            }
+        });
+        if (!fp) {
+            WarnL << "create pre-record segment failed: " << path << ", " << get_uv_errmsg();
+            error = true;
+        }
+    }
+
+    void write(const vector<Frame::Ptr> &frames, size_t bytes) {
+        queued_bytes -= bytes;
+        if (!fp) {
+            return;
+        }
+        uint8_t header[kFrameHeaderSize] = { 0 };
+        for (auto &frame : frames) {
+            uint32_t size = frame->size();
+            uint64_t dts = frame->dts();
+            uint64_t pts = frame->pts();
+            memcpy(header, &size, 4);
+            header[4] = (uint8_t)frame->getCodecId();
+            header[5] = (uint8_t)frame->getIndex();
+            memcpy(header + 8, &dts, 8);
+            memcpy(header + 16, &pts, 8);
+            if (fwrite(header, sizeof(header), 1, fp.get()) != 1 || (size && fwrite(frame->data(), size, 1, fp.get()) != 1)) {
+                WarnL << "write pre-record segment failed: " << path << ", " << get_uv_errmsg();
+                error = true;
+                fp.reset();
+                return;
+            }
+        }
+    }
+};
+
+class PreRecordBuffer::Segment {
+public:
+    Segment(string path, uint64_t dts, shared_ptr<Writer> writer) : path(std::move(path)), start_dts(dts), writer(std::move(writer)) {}
+
+    ~Segment() {
+        // 在写线程中排在此前的写入之后关闭并删除文件，最后一个分段删除后同时删除空目录
+        // Close and delete the file in the writer thread after the writes queued before,
+        // the empty directory is deleted together with the last segment
+        auto writer = std::move(this->writer);
+        auto path = std::move(this->path);
+        writer->poller->async([writer, path]() {
+            if (writer->path == path) {
+                writer->fp.reset();
+            }
+            File::delete_file(path, true);
+        });
+    }
+
+    string path;
+    uint64_t start_dts;
+    // 已写入及排队写入的字节数 / bytes written or queued for writing
+    size_t bytes = 0;
+    shared_ptr<Writer> writer;
+    // 每个gop开始处的时间戳与文件偏移量
+    // The timestamp and file offset of each gop start
+    vector<pair<uint64_t, size_t>> keys;
+};
+
+size_t PreRecordBuffer::Reader::read(const onFrame &cb) const {
+    size_t count = 0;
+    for (auto &range : _ranges) {
+        shared_ptr<FILE> fp(fopen(range.segment->path.data(), "rb"), [](FILE *fp) {
+            if (fp) {
+                fclose(fp);
+            }
+        });
+        if (!fp || fseek(fp.get(), range.begin, SEEK_SET) != 0) {
+            WarnL << "open pre-record segment failed: " << range.segment->path << ", " << get_uv_errmsg();
+            continue;
+        }
+        uint8_t header[kFrameHeaderSize];
+        for (auto pos = range.begin; pos + kFrameHeaderSize <= range.end;) {
+            if (fread(header, sizeof(header), 1, fp.get()) != 1) {
+                break;
+            }
+            uint32_t size;
+            uint64_t dts, pts;
+            memcpy(&size, header, 4);
+            memcpy(&dts, header + 8, 8);
+            memcpy(&pts, header + 16, 8);
+            if (size > kMaxFrameSize) {
+                WarnL << "invalid frame size in pre-record segment: " << range.segment->path << ", " << size;
+                break;
+            }
+            auto buffer = BufferRaw::create();
+            buffer->setCapacity(size + 1);
+            buffer->setSize(size);
+            if (size && fread(buffer->data(), size, 1, fp.get()) != 1) {
+                break;
+            }
+            pos += kFrameHeaderSize + size;
+            auto frame = Factory::getFrameFromBuffer((CodecId)header[4], std::move(buffer), dts, pts);
+            if (!frame) {
+                continue;
+            }
+            frame->setIndex(header[5]);
+            cb(frame);
+            ++count;
+        }
+    }
+    return count;
+}
+
+PreRecordBuffer::PreRecordBuffer(string dir, uint64_t max_ms, size_t max_bytes) {
+    _dir = std::move(dir);
+    _max_ms = max_ms;
+    _max_bytes = max_bytes;
+    _writer = std::make_shared<Writer>();
+    _writer->poller = WorkThreadPool::Instance().getPoller();
+}
+
+PreRecordBuffer::~PreRecordBuffer() {
+    clear();
+}
+
+const EventPoller::Ptr &PreRecordBuffer::getPoller() const {
+    return _writer->poller;
+}
+
+void PreRecordBuffer::inputFrame(const Frame::Ptr &frame, bool key_pos) {
+    if (_error) {
+        return;
+    }
+    if (_writer->error || _writer->queued_bytes > kMaxQueuedBytes) {
+        WarnL << "pre-record buffer disabled: " << (_writer->error ? "file io failed, " : "disk too slow, ") << _dir;
+        _error = true;
+        clear();
+        return;
+    }
+    if (key_pos) {
+        if (_segments.empty() || frame->dts() < _segments.back()->start_dts || frame->dts() >= _segments.back()->start_dts + kSegmentMS) {
+            createSegment(frame->dts());
+        }
+    }
+    if (_segments.empty()) {
+        // 等待第一个gop
+        // Wait for the first gop
+        return;
+    }
+
+    auto &segment = *_segments.back();
+    if (key_pos) {
+        segment.keys.emplace_back(frame->dts(), segment.bytes);
+    }
+    auto bytes = kFrameHeaderSize + frame->size();
+    _pending.emplace_back(Frame::getCacheAbleFrame(frame));
+    _pending_bytes += bytes;
+    segment.bytes += bytes;
+    _total_bytes += bytes;
+    _last_dts = frame->dts();
+    if (key_pos || _pending_bytes >= kFlushBytes) {
+        flushPending();
+    }
+    if (key_pos) {
+        dropSegments();
+    }
+}
+
+void PreRecordBuffer::flushPending() {
+    if (_pending.empty()) {
+        return;
+    }
+    auto bytes = _pending_bytes;
+    _writer->queued_bytes += bytes;
+    auto writer = _writer;
+    auto frames = std::make_shared<vector<Frame::Ptr>>(std::move(_pending));
+    writer->poller->async([writer, frames, bytes]() { writer->write(*frames, bytes); }, false);
+    _pending.clear();
+    _pending_bytes = 0;
+}
+
+PreRecordBuffer::Reader::Ptr PreRecordBuffer::getReader(uint64_t back_ms) {
+    auto ret = std::make_shared<Reader>();
+    if (_segments.empty()) {
+        return ret;
+    }
+    // 快照内的数据交给写线程，并确保对读取者可见
+    // Hand the data of the snapshot to the writer thread and make sure it is visible to the reader
+    flushPending();
+    auto writer = _writer;
+    writer->poller->async([writer]() {
+        if (writer->fp) {
+            fflush(writer->fp.get());
+        }
+    }, false);
+
+    // 从后往前找到不晚于now - back_ms的最近一个gop，找不到时从最老的gop开始
+    // Search backwards for the latest gop no later than now - back_ms, start from the oldest gop if not found
+    size_t segment_index = 0;
+    size_t key_index = 0;
+    bool found = false;
+    for (size_t i = _segments.size(); i > 0 && !found; --i) {
+        auto &keys = _segments[i - 1]->keys;
+        for (size_t j = keys.size(); j > 0; --j) {
+            if (keys[j - 1].first + back_ms <= _last_dts) {
+                segment_index = i - 1;
+                key_index = j - 1;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    auto &first = _segments[segment_index];
+    ret->_start_dts = first->keys[key_index].first;
+    for (auto i = segment_index; i < _segments.size(); ++i) {
+        auto &segment = _segments[i];
+        ret->_ranges.emplace_back(Reader::Range { segment, i == segment_index ? first->keys[key_index].second : 0, segment->bytes });
+    }
+    return ret;
+}
+
+void PreRecordBuffer::clear() {
+    _pending.clear();
+    _pending_bytes = 0;
+    _segments.clear();
+    _total_bytes = 0;
+    _last_dts = 0;
+}
+
+void PreRecordBuffer::createSegment(uint64_t dts) {
+    // 上一个分段的数据先交给写线程，再切换文件
+    // Hand the data of the previous segment to the writer thread before switching the file
+    flushPending();
+    auto segment = std::make_shared<Segment>(_dir + to_string(_segment_index++) + ".seg", dts, _writer);
+    auto writer = _writer;
+    auto path = segment->path;
+    writer->poller->async([writer, path]() { writer->open(path); }, false);
+    _segments.emplace_back(std::move(segment));
+}
+
+void PreRecordBuffer::dropSegments() {
+    while (_segments.size() > 1) {
+        // 第二个分段起的数据已满足最大回溯时长，或者总大小超出上限时，删除最老的分段
+        // Delete the oldest segment when the data from the second segment already covers the max look-back duration,
+        // or when the total size exceeds the limit
+        auto &second = _segments[1];
+        if (second->start_dts + _max_ms > _last_dts && _total_bytes <= _max_bytes) {
+            break;
+        }
+        _total_bytes -= _segments.front()->bytes;
+        _segments.pop_front();
+    }
+}
+
+} // namespace mediakit
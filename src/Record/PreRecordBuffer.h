@@ -0,0 +1,134 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_PRERECORDBUFFER_H
+#define ZLMEDIAKIT_PRERECORDBUFFER_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+#include "Extension/Frame.h"
+#include "Poller/EventPoller.h"
+
+namespace mediakit {
+
+/**
+ * 基于磁盘的回溯录制缓存，帧数据追加写入滚动的分段文件，内存中只保存每个gop的索引
+ * 分段总时长与总大小有上限，超出后删除最老的分段；文件读写都在独立的写线程中进行，不阻塞媒体线程
+ * A disk backed look-back buffer for event recording, frames are appended to rolling segment files
+ * and only the index of each gop is kept in memory; the total duration and size of the segments are bounded,
+ * the oldest segment is deleted when exceeded; all file io runs in a dedicated writer thread and never blocks the media thread
+ */
+class PreRecordBuffer {
+public:
+    using Ptr = std::shared_ptr<PreRecordBuffer>;
+
+    class Segment;
+    class Writer;
+
+    /**
+     * 某一时刻的回溯数据快照，须在getPoller()线程中读取以保证快照内的数据已写入，读取期间相关分段文件不会被删除
+     * A snapshot of the look-back data at some moment, it must be read in the getPoller() thread so that its data has been written,
+     * the related segment files will not be deleted while reading
+     */
+    class Reader {
+    public:
+        using Ptr = std::shared_ptr<Reader>;
+        using onFrame = std::function<void(const Frame::Ptr &frame)>;
+
+        /**
+         * 同步读取快照内的全部帧
+         * @return 读取的帧数
+         * Read all frames in the snapshot synchronously
+         * @return The count of frames read
+         */
+        size_t read(const onFrame &cb) const;
+
+        /**
+         * 快照的起始时间戳，单位毫秒
+         * The start timestamp of the snapshot, in milliseconds
+         */
+        uint64_t getStartDts() const { return _start_dts; }
+
+    private:
+        friend class PreRecordBuffer;
+
+        struct Range {
+            std::shared_ptr<Segment> segment;
+            size_t begin;
+            size_t end;
+        };
+        uint64_t _start_dts = 0;
+        std::vector<Range> _ranges;
+    };
+
+    /**
+     * @param dir 分段文件保存目录，须为本对象独占，对象销毁时删除
+     * @param max_ms 最大回溯时长，单位毫秒
+     * @param max_bytes 分段文件总大小上限
+     * @param dir The directory of the segment files, it must be used by this object only and is deleted when the object is destroyed
+     * @param max_ms The max look-back duration, in milliseconds
+     * @param max_bytes The max total size of the segment files
+     */
+    PreRecordBuffer(std::string dir, uint64_t max_ms, size_t max_bytes);
+    ~PreRecordBuffer();
+
+    /**
+     * 写入帧，帧时间戳须已修正
+     * @param frame 帧
+     * @param key_pos 是否为gop开始处(视频的第一个配置帧或关键帧，纯音频时为每一帧)
+     * Write a frame, its timestamps must have been fixed
+     * @param frame The frame
+     * @param key_pos Whether it is the start of a gop (the first config frame or key frame of video, every frame for audio only streams)
+     */
+    void inputFrame(const Frame::Ptr &frame, bool key_pos);
+
+    /**
+     * 获取最近back_ms毫秒数据的快照，快照从不晚于now - back_ms的最近一个gop开始
+     * Get a snapshot of the latest back_ms milliseconds, it starts from the latest gop no later than now - back_ms
+     */
+    Reader::Ptr getReader(uint64_t back_ms);
+
+    /**
+     * 写线程，快照须在该线程中读取
+     * The writer thread, snapshots must be read in it
+     */
+    const toolkit::EventPoller::Ptr &getPoller() const;
+
+    /**
+     * 清空缓存，轨道重置时调用
+     * Clear the buffer, called when the tracks are reset
+     */
+    void clear();
+
+private:
+    void createSegment(uint64_t dts);
+    void dropSegments();
+    void flushPending();
+
+private:
+    bool _error = false;
+    uint64_t _max_ms;
+    size_t _max_bytes;
+    size_t _total_bytes = 0;
+    size_t _segment_index = 0;
+    uint64_t _last_dts = 0;
+    std::string _dir;
+    std::deque<std::shared_ptr<Segment>> _segments;
+    // 尚未交给写线程的帧 / frames not handed to the writer thread yet
+    std::vector<Frame::Ptr> _pending;
+    size_t _pending_bytes = 0;
+    std::shared_ptr<Writer> _writer;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_PRERECORDBUFFER_H
@@ -0,0 +1,413 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <ctime>
+#include <cstdio>
+#include <algorithm>
+#include <unordered_set>
+#include "RecordIndex.h"
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Thread/WorkThreadPool.h"
+#if defined(ENABLE_MP4)
+#include "MP4Demuxer.h"
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 内存中最多缓存的流索引个数
+// The max count of stream indexes cached in memory
+static constexpr size_t kMaxCachedStream = 64;
+// 查找流录像目录时最多进入的目录层级: [vhost/][record/]app/stream/date
+// The max directory depth when searching for record folders: [vhost/][record/]app/stream/date
+static constexpr int kMaxSearchDepth = 5;
+// 重建索引时由文件名得到的开始时间只精确到秒，去重时允许的误差
+// The start time parsed from a file name during rebuilding is only accurate to the second, the tolerance when deduplicating
+static constexpr uint64_t kDedupToleranceMS = 2000;
+
+static const char *getIndexName(Recorder::type type) {
+    return type == Recorder::type_mp4 ? ".mp4.index" : ".hls.index";
+}
+
+static string getFolder(const string &folder) {
+    if (!folder.empty() && folder.back() == '/') {
+        return folder;
+    }
+    return folder + "/";
+}
+
+static string toLine(const RecordIndexItem &item) {
+    string line = to_string(item.start_ms) + "\t" + to_string(item.end_ms) + "\t" + to_string(item.file_size) + "\t" + item.file_name + "\t";
+    for (size_t i = 0; i < item.key_ms.size(); ++i) {
+        if (i) {
+            line += ',';
+        }
+        line += to_string(item.key_ms[i]);
+    }
+    line += '\n';
+    return line;
+}
+
+static void appendLine(const string &index_path, const RecordIndexItem &item) {
+    auto fp = File::create_file(index_path, "ab");
+    if (!fp) {
+        WarnL << "Open record index failed: " << index_path;
+        return;
+    }
+    auto line = toLine(item);
+    fwrite(line.data(), line.size(), 1, fp);
+    fclose(fp);
+}
+
+static bool fromLine(const string &line, RecordIndexItem &item) {
+    auto fields = split(line, "\t");
+    if (fields.size() < 4) {
+        return false;
+    }
+    item.start_ms = strtoull(fields[0].data(), nullptr, 10);
+    item.end_ms = strtoull(fields[1].data(), nullptr, 10);
+    item.file_size = strtoull(fields[2].data(), nullptr, 10);
+    item.file_name = fields[3];
+    if (fields.size() > 4) {
+        for (auto &key : split(fields[4], ",")) {
+            item.key_ms.emplace_back(atoi(key.data()));
+        }
+    }
+    return item.end_ms >= item.start_ms && !item.file_name.empty();
+}
+
+static bool lessStart(const RecordIndexItem &a, const RecordIndexItem &b) {
+    return a.start_ms < b.start_ms;
+}
+
+static void insertItem(vector<RecordIndexItem> &items, RecordIndexItem item) {
+    auto lower = item.start_ms > kDedupToleranceMS ? item.start_ms - kDedupToleranceMS : 0;
+    auto it = lower_bound(items.begin(), items.end(), lower, [](const RecordIndexItem &item, uint64_t stamp) { return item.start_ms < stamp; });
+    for (; it != items.end() && it->start_ms <= item.start_ms + kDedupToleranceMS; ++it) {
+        if (it->file_name == item.file_name) {
+            // 已存在(重建索引时扫描到了该文件)，以录制时记录的信息为准
+            // Already exists (the file was found by rebuilding), prefer the information recorded while recording
+            *it = std::move(item);
+            sort(items.begin(), items.end(), lessStart);
+            return;
+        }
+    }
+    it = upper_bound(items.begin(), items.end(), item.start_ms, [](uint64_t stamp, const RecordIndexItem &item) { return stamp < item.start_ms; });
+    items.emplace(it, std::move(item));
+}
+
+static bool isDateDir(const string &name) {
+    int year, month, day;
+    return name.size() == sizeof("2020-01-01") - 1 && sscanf(name.data(), "%4d-%2d-%2d", &year, &month, &day) == 3;
+}
+
+static uint64_t makeTime(int year, int month, int day, int hour, int minute, int second) {
+    struct tm tm = {0};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1;
+    return mktime(&tm) * 1000ULL;
+}
+
+static string getName(const string &path) {
+    auto pos = path.rfind('/');
+    return pos == string::npos ? path : path.substr(pos + 1);
+}
+
+// mp4录像目录结构为: date/YYYY-MM-DD-HH-MM-SS-index.mp4
+// The layout of a mp4 record folder is: date/YYYY-MM-DD-HH-MM-SS-index.mp4
+static void scanMP4(const string &folder, vector<RecordIndexItem> &items) {
+#if defined(ENABLE_MP4)
+    File::scanDir(folder, [&](const string &date_path, bool is_dir) {
+        auto date = getName(date_path);
+        if (!is_dir || !isDateDir(date)) {
+            return true;
+        }
+        File::scanDir(date_path, [&](const string &path, bool is_dir) {
+            auto name = getName(path);
+            int year, month, day, hour, minute, second, index;
+            if (is_dir || !end_with(name, ".mp4")
+                || sscanf(name.data(), "%d-%d-%d-%d-%d-%d-%d.mp4", &year, &month, &day, &hour, &minute, &second, &index) != 7) {
+                return true;
+            }
+            RecordIndexItem item;
+            item.start_ms = makeTime(year, month, day, hour, minute, second);
+            item.file_size = File::fileSize(path);
+            item.file_name = date + "/" + name;
+            try {
+                MP4Demuxer demuxer;
+                demuxer.openMP4(path);
+                item.end_ms = item.start_ms + demuxer.getDurationMS();
+            } catch (std::exception &ex) {
+                WarnL << "Open mp4 file failed: " << path << ", " << ex.what();
+                return true;
+            }
+            items.emplace_back(std::move(item));
+            return true;
+        });
+        return true;
+    });
+#endif
+}
+
+// hls录像目录结构为: date/hour/MM-SS_index.ts，每个小时目录下有一个vod.m3u8记录切片时长
+// The layout of a hls record folder is: date/hour/MM-SS_index.ts, every hour directory has a vod.m3u8 with the segment durations
+static void scanHls(const string &folder, vector<RecordIndexItem> &items) {
+    File::scanDir(folder, [&](const string &date_path, bool is_dir) {
+        auto date = getName(date_path);
+        int year, month, day;
+        if (!is_dir || !isDateDir(date) || sscanf(date.data(), "%d-%d-%d", &year, &month, &day) != 3) {
+            return true;
+        }
+        File::scanDir(date_path, [&](const string &hour_path, bool is_dir) {
+            auto hour = getName(hour_path);
+            if (!is_dir) {
+                return true;
+            }
+            for (auto m3u8 : { "/vod.m3u8", "/vod.fmp4.m3u8" }) {
+                auto content = File::loadFile(hour_path + m3u8);
+                uint64_t duration_ms = 0;
+                for (auto &line : split(content, "\n")) {
+                    trim(line);
+                    if (start_with(line, "#EXTINF:")) {
+                        duration_ms = atof(line.data() + sizeof("#EXTINF:") - 1) * 1000;
+                        continue;
+                    }
+                    int minute, second, index;
+                    if (line.empty() || line[0] == '#' || sscanf(line.data(), "%d-%d_%d", &minute, &second, &index) != 3) {
+                        continue;
+                    }
+                    RecordIndexItem item;
+                    item.start_ms = makeTime(year, month, day, atoi(hour.data()), minute, second);
+                    item.end_ms = item.start_ms + duration_ms;
+                    item.file_name = date + "/" + hour + "/" + line;
+                    item.file_size = File::fileSize(folder + item.file_name);
+                    items.emplace_back(std::move(item));
+                }
+            }
+            return true;
+        });
+        return true;
+    });
+}
+
+uint64_t RecordIndexItem::getSeekMS(uint64_t stamp_ms) const {
+    if (stamp_ms <= start_ms) {
+        return 0;
+    }
+    auto offset = stamp_ms - start_ms;
+    if (key_ms.empty()) {
+        // 没有关键帧信息，由播放器seek到最近的关键帧
+        // No key frame information, the player seeks to the nearest key frame
+        return offset;
+    }
+    auto it = upper_bound(key_ms.begin(), key_ms.end(), offset);
+    return it == key_ms.begin() ? 0 : *(--it);
+}
+
+RecordIndex &RecordIndex::Instance() {
+    static RecordIndex s_instance;
+    return s_instance;
+}
+
+RecordIndex::Stream::Ptr RecordIndex::getStream(Recorder::type type, const string &folder) {
+    auto key = getFolder(folder) + getIndexName(type);
+    lock_guard<mutex> lck(_mtx);
+    auto it = _streams.find(key);
+    if (it != _streams.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->second;
+    }
+    _lru.emplace_front(key, std::make_shared<Stream>());
+    _streams.emplace(key, _lru.begin());
+    if (_lru.size() > kMaxCachedStream) {
+        // 只淘汰没有被使用的流，加载、重建或追加中的流被其任务引用着，淘汰后会与新建的同名流并发重建同一个索引文件
+        // Only evict a stream nobody uses, a stream being loaded, rebuilt or appended is referenced by its task,
+        // evicting it would let a new stream of the same folder rebuild the same index file concurrently
+        for (auto it = std::prev(_lru.end()); it != _lru.begin(); --it) {
+            if (it->second.use_count() == 1) {
+                _streams.erase(it->first);
+                _lru.erase(it);
+                break;
+            }
+        }
+    }
+    return _lru.front().second;
+}
+
+void RecordIndex::load(Recorder::type type, const string &folder, Stream &stream, unique_lock<mutex> &lck) {
+    stream.cond.wait(lck, [&]() { return !stream.rebuilding; });
+    if (stream.loaded) {
+        return;
+    }
+    auto index_path = getFolder(folder) + getIndexName(type);
+    if (File::fileExist(index_path)) {
+        unordered_set<string> names;
+        for (auto &line : split(File::loadFile(index_path), "\n")) {
+            RecordIndexItem item;
+            if (fromLine(line, item) && names.emplace(item.file_name).second) {
+                stream.items.emplace_back(std::move(item));
+            }
+        }
+        stable_sort(stream.items.begin(), stream.items.end(), lessStart);
+        // 索引文件已由其他任务重建，补充写入暂存的文件
+        // The index file has been rebuilt by another task, write the pending files into it
+        for (auto &item : stream.pending) {
+            appendLine(index_path, item);
+            insertItem(stream.items, std::move(item));
+        }
+        stream.pending.clear();
+        stream.loaded = true;
+        return;
+    }
+
+    // 索引文件不存在，扫描目录重建，扫描期间追加的文件暂存在pending中
+    // The index file does not exist, rebuild it by scanning the folder, files appended while scanning are kept in pending
+    stream.rebuilding = true;
+    lck.unlock();
+    vector<RecordIndexItem> items;
+    type == Recorder::type_mp4 ? scanMP4(getFolder(folder), items) : scanHls(getFolder(folder), items);
+    sort(items.begin(), items.end(), lessStart);
+    lck.lock();
+
+    for (auto &item : stream.pending) {
+        insertItem(items, std::move(item));
+    }
+    stream.pending.clear();
+    stream.items = std::move(items);
+    stream.loaded = true;
+    stream.rebuilding = false;
+    stream.cond.notify_all();
+
+    if (stream.items.empty()) {
+        return;
+    }
+    string content;
+    for (auto &item : stream.items) {
+        content += toLine(item);
+    }
+    auto tmp_path = index_path + ".tmp";
+    if (File::saveFile(content, tmp_path)) {
+        rename(tmp_path.data(), index_path.data());
+    }
+    InfoL << "Rebuild record index: " << index_path << ", " << stream.items.size() << " files";
+}
+
+void RecordIndex::append(Recorder::type type, const string &folder, RecordIndexItem item) {
+    auto stream = getStream(type, folder);
+    unique_lock<mutex> lck(stream->mtx);
+    if (stream->rebuilding) {
+        stream->pending.emplace_back(std::move(item));
+        return;
+    }
+    auto index_path = getFolder(folder) + getIndexName(type);
+    if (!stream->loaded && !File::fileExist(index_path)) {
+        // 首次追加时索引文件不存在，可能目录下已有历史录像，在后台线程重建索引
+        // The index file does not exist on the first append, there may be history records in the folder, rebuild the index in a background thread
+        stream->pending.emplace_back(std::move(item));
+        stream->rebuilding = true;
+        lck.unlock();
+        WorkThreadPool::Instance().getExecutor()->async([type, folder, stream]() {
+            unique_lock<mutex> lck(stream->mtx);
+            stream->rebuilding = false;
+            Instance().load(type, folder, *stream, lck);
+        });
+        return;
+    }
+    appendLine(index_path, item);
+    if (stream->loaded) {
+        insertItem(stream->items, std::move(item));
+    }
+}
+
+vector<RecordIndexItem> RecordIndex::query(Recorder::type type, const string &folder, uint64_t start_ms, uint64_t end_ms) {
+    auto stream = getStream(type, folder);
+    unique_lock<mutex> lck(stream->mtx);
+    load(type, folder, *stream, lck);
+
+    vector<RecordIndexItem> ret;
+    auto &items = stream->items;
+    // 第一个开始时间晚于start_ms的文件，它的前一个文件可能包含start_ms
+    // The first file starting later than start_ms, the one before it may contain start_ms
+    auto it = upper_bound(items.begin(), items.end(), start_ms, [](uint64_t stamp, const RecordIndexItem &item) { return stamp < item.start_ms; });
+    if (it != items.begin() && prev(it)->end_ms > start_ms) {
+        --it;
+    }
+    auto root = getFolder(folder);
+    for (; it != items.end() && it->start_ms < end_ms; ++it) {
+        if (it->end_ms <= start_ms) {
+            continue;
+        }
+        if (!File::fileExist(root + it->file_name)) {
+            // 录像文件已被删除
+            // The record file has been deleted
+            continue;
+        }
+        ret.emplace_back(*it);
+    }
+    return ret;
+}
+
+static void searchRecordFolder(const string &dir, int depth, vector<string> &out) {
+    bool found = false;
+    vector<string> sub_dirs;
+    File::scanDir(dir, [&](const string &path, bool is_dir) {
+        if (!is_dir) {
+            return true;
+        }
+        if (isDateDir(getName(path))) {
+            found = true;
+        } else {
+            sub_dirs.emplace_back(path);
+        }
+        return true;
+    });
+    if (found) {
+        out.emplace_back(getFolder(dir));
+        return;
+    }
+    if (depth >= kMaxSearchDepth) {
+        return;
+    }
+    for (auto &sub_dir : sub_dirs) {
+        searchRecordFolder(sub_dir, depth + 1, out);
+    }
+}
+
+void RecordIndex::rebuildAll(Recorder::type type, const string &root) {
+    vector<string> folders;
+    searchRecordFolder(root, 0, folders);
+    size_t count = 0;
+    for (auto &folder : folders) {
+        if (File::fileExist(folder + getIndexName(type))) {
+            continue;
+        }
+        ++count;
+        // 不同目录的重建分散到所有后台线程并行执行
+        // Rebuilding of different folders is spread across all background threads
+        WorkThreadPool::Instance().getPoller()->async([type, folder]() {
+            auto &self = Instance();
+            auto stream = self.getStream(type, folder);
+            unique_lock<mutex> lck(stream->mtx);
+            self.load(type, folder, *stream, lck);
+        });
+    }
+    InfoL << "Found " << folders.size() << " record folders under " << root << ", " << count << " of them need to rebuild the " << getIndexName(type);
+}
+
+} // namespace mediakit
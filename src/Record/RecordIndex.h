@@ -0,0 +1,111 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RECORDINDEX_H
+#define ZLMEDIAKIT_RECORDINDEX_H
+
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Record/Recorder.h"
+
+namespace mediakit {
+
+/**
+ * 录像索引中的一个文件(mp4文件或hls切片)
+ * A file (mp4 file or hls segment) in the record index
+ */
+struct RecordIndexItem {
+    // 开始与结束时间，unix时间戳，单位毫秒
+    // Start and end time, unix timestamp in milliseconds
+    uint64_t start_ms = 0;
+    uint64_t end_ms = 0;
+    uint64_t file_size = 0;
+    // 相对流录像目录的路径
+    // The path relative to the record folder of the stream
+    std::string file_name;
+    // 关键帧相对文件开始的时间，单位毫秒
+    // Key frame times relative to the start of the file, in milliseconds
+    std::vector<uint32_t> key_ms;
+
+    /**
+     * 获取不晚于指定时间的最近关键帧相对文件开始的时间
+     * @param stamp_ms unix时间戳，单位毫秒
+     * Get the time of the nearest key frame not later than the specified moment, relative to the start of the file
+     * @param stamp_ms unix timestamp in milliseconds
+     */
+    uint64_t getSeekMS(uint64_t stamp_ms) const;
+};
+
+/**
+ * 每个流的录像索引，录制完成一个文件时追加写入流录像目录下的隐藏索引文件，
+ * 内存中按开始时间排序，按时间段查询时二分查找，避免遍历目录与打开文件
+ * The record index of each stream, an entry is appended to a hidden index file in the record folder of the stream
+ * whenever a file is finished; entries are sorted by start time in memory and time range queries
+ * use binary search instead of scanning directories and opening files
+ */
+class RecordIndex {
+public:
+    static RecordIndex &Instance();
+
+    /**
+     * 追加一个录制完成的文件
+     * @param type 录制类型，type_mp4或type_hls
+     * @param folder 流录像目录
+     * Append a finished record file
+     * @param type Record type, type_mp4 or type_hls
+     * @param folder The record folder of the stream
+     */
+    void append(Recorder::type type, const std::string &folder, RecordIndexItem item);
+
+    /**
+     * 查询与[start_ms, end_ms)相交的录像文件，按开始时间排序
+     * Query the record files intersecting [start_ms, end_ms), sorted by start time
+     */
+    std::vector<RecordIndexItem> query(Recorder::type type, const std::string &folder, uint64_t start_ms, uint64_t end_ms);
+
+    /**
+     * 查找根目录下没有索引的流录像目录，并在后台线程并行重建
+     * Find the record folders without an index under the root and rebuild them in parallel in background threads
+     */
+    void rebuildAll(Recorder::type type, const std::string &root);
+
+private:
+    RecordIndex() = default;
+
+    struct Stream {
+        using Ptr = std::shared_ptr<Stream>;
+        std::mutex mtx;
+        std::condition_variable cond;
+        bool loaded = false;
+        bool rebuilding = false;
+        std::vector<RecordIndexItem> items;
+        // 重建索引期间追加的文件
+        // Files appended while rebuilding
+        std::vector<RecordIndexItem> pending;
+    };
+
+    Stream::Ptr getStream(Recorder::type type, const std::string &folder);
+    void load(Recorder::type type, const std::string &folder, Stream &stream, std::unique_lock<std::mutex> &lck);
+
+private:
+    std::mutex _mtx;
+    // 最近使用的流排在前面，超出上限后淘汰最久未使用且空闲的
+    // The recently used streams come first, the least recently used idle one is evicted when the limit is exceeded
+    std::list<std::pair<std::string, Stream::Ptr>> _lru;
+    std::unordered_map<std::string, std::list<std::pair<std::string, Stream::Ptr>>::iterator> _streams;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RECORDINDEX_H
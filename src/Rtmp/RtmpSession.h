@@ -19,6 +19,7 @@
 #include "RtmpMediaSourceImp.h"
 #include "Util/TimeTicker.h"
 #include "Network/Session.h"
+#include "Common/KTlsBox.h"
 
 namespace mediakit {
 
@@ -118,7 +119,7 @@ private:
  
  * [AUTO-TRANSLATED:21d167ba]
  */
-using RtmpSessionWithSSL = toolkit::SessionWithSSL<RtmpSession>;
+using RtmpSessionWithSSL = SessionWithKTLS<RtmpSession>;
 
 } /* namespace mediakit */
 #endif /* SRC_RTMP_RTMPSESSION_H_ */
@@ -29,6 +29,10 @@ void Decoder::setOnDecode(Decoder::onDecode cb) {
 void Decoder::setOnStream(Decoder::onStream cb) {
     _on_stream = std::move(cb);
 }
+
+void Decoder::setOnDecodeBuffer(Decoder::onDecodeBuffer cb) {
+    _on_decode_buffer = std::move(cb);
+}
     
 static Decoder::Ptr createDecoder_l(DecoderImp::Type type) {
     switch (type){
@@ -63,21 +67,33 @@ DecoderImp::Ptr DecoderImp::createDecoder(Type type, MediaSinkInterface *sink){
 }
 
 void DecoderImp::flush() {
+    _decoder->flush();
     for (auto &pr : _tracks) {
         pr.second.second.flush();
     }
 }
 
+void DecoderImp::reset() {
+    _decoder->reset();
+}
+
 ssize_t DecoderImp::input(const uint8_t *data, size_t bytes){
     return _decoder->input(data, bytes);
 }
 
+ssize_t DecoderImp::input(const Buffer::Ptr &holder, const uint8_t *data, size_t bytes) {
+    return _decoder->input(holder, data, bytes);
+}
+
 DecoderImp::DecoderImp(const Decoder::Ptr &decoder, MediaSinkInterface *sink){
     _decoder = decoder;
     _sink = sink;
     _decoder->setOnDecode([this](int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes) {
         onDecode(stream, codecid, flags, pts, dts, data, bytes);
     });
+    _decoder->setOnDecodeBuffer([this](int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        onDecodeBuffer(stream, codecid, flags, pts, dts, buffer);
+    });
     _decoder->setOnStream([this](int stream, int codecid, const void *extra, size_t bytes, int finish) {
         onStream(stream, codecid, extra, bytes, finish);
     });
@@ -108,12 +124,25 @@ void DecoderImp::onStream(int stream, int codecid, const void *extra, size_t byt
 }
 
 void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes) {
-    pts /= 90;
-    dts /= 90;
+    auto codec = getTrackCodec(stream, codecid);
+    if (codec != CodecInvalid) {
+        onDecodeFrame(stream, codec, Factory::getFrameFromPtr(codec, (char *)data, bytes, dts / 90, pts / 90));
+    }
+}
 
+void DecoderImp::onDecodeBuffer(int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+    auto codec = getTrackCodec(stream, codecid);
+    if (codec != CodecInvalid) {
+        // 可缓存的帧，FrameMerger等下游无需再拷贝
+        // A cacheable frame, so FrameMerger and the like need not copy it again
+        onDecodeFrame(stream, codec, Factory::getFrameFromBuffer(codec, buffer, dts / 90, pts / 90));
+    }
+}
+
+CodecId DecoderImp::getTrackCodec(int stream, int codecid) {
     auto codec = getCodecByMpegId(codecid);
     if (codec == CodecInvalid) {
-        return;
+        return CodecInvalid;
     }
     auto &ref = _tracks[stream];
     if (!ref.first) {
@@ -121,10 +150,17 @@ void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64
     }
     if (!ref.first) {
         WarnL << "Unsupported codec :" << getCodecName(codec);
+        return CodecInvalid;
+    }
+    return codec;
+}
+
+void DecoderImp::onDecodeFrame(int stream, CodecId codec, const Frame::Ptr &frame) {
+    if (!frame) {
         return;
     }
     GET_CONFIG(bool, merge_frame, RtpProxy::kMergeFrame)
-    auto frame = Factory::getFrameFromPtr(codec, (char *)data, bytes, dts, pts);
+    auto &ref = _tracks[stream];
     if (getTrackType(codec) != TrackVideo || !merge_frame) {
         onFrame(stream, frame);
         if (_last_is_keyframe && _video_merge) {
@@ -141,6 +177,9 @@ void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64
 }
 #else
 void DecoderImp::onDecode(int stream,int codecid,int flags,int64_t pts,int64_t dts,const void *data,size_t bytes) {}
+void DecoderImp::onDecodeBuffer(int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {}
+CodecId DecoderImp::getTrackCodec(int stream, int codecid) { return CodecInvalid; }
+void DecoderImp::onDecodeFrame(int stream, CodecId codec, const Frame::Ptr &frame) {}
 void DecoderImp::onStream(int stream,int codecid,const void *extra,size_t bytes,int finish) {}
 #endif
 
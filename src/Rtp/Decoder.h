@@ -23,10 +23,33 @@ public:
     using Ptr = std::shared_ptr<Decoder>;
     using onDecode = std::function<void(int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes)>;
     using onStream = std::function<void(int stream, int codecid, const void *extra, size_t bytes, int finish)>;
+    // 帧数据以Buffer输出，下游无需再拷贝
+    // Frame data is output as a Buffer, so downstream needs no further copy
+    using onDecodeBuffer = std::function<void(int stream, int codecid, int flags, int64_t pts, int64_t dts, const toolkit::Buffer::Ptr &buffer)>;
 
     virtual ssize_t input(const uint8_t *data, size_t bytes) = 0;
+
+    /**
+     * 输入数据，holder持有data所在的内存，解析器可以直接引用而不拷贝
+     * Input data, holder owns the memory of data so the parser may reference it without copying
+     */
+    virtual ssize_t input(const toolkit::Buffer::Ptr &holder, const uint8_t *data, size_t bytes) { return input(data, bytes); }
+
+    /**
+     * 输出缓存中已完整的帧
+     * Output the complete frames in the cache
+     */
+    virtual void flush() {}
+
+    /**
+     * 输入数据不连续(例如丢包)时，丢弃未完成的数据并重新同步
+     * Drop the incomplete data and resync when the input is discontinuous (e.g. packet loss)
+     */
+    virtual void reset() {}
+
     void setOnDecode(onDecode cb);
     void setOnStream(onStream cb);
+    void setOnDecodeBuffer(onDecodeBuffer cb);
 
 protected:
     Decoder() = default;
@@ -35,6 +58,7 @@ protected:
 protected:
     onDecode _on_decode;
     onStream _on_stream;
+    onDecodeBuffer _on_decode_buffer;
 };
 
 class DecoderImp {
@@ -45,7 +69,9 @@ public:
 
     static Ptr createDecoder(Type type, MediaSinkInterface *sink);
     ssize_t input(const uint8_t *data, size_t bytes);
+    ssize_t input(const toolkit::Buffer::Ptr &holder, const uint8_t *data, size_t bytes);
     void flush();
+    void reset();
 
 protected:
     void onTrack(int index, const Track::Ptr &track);
@@ -54,6 +80,9 @@ protected:
 private:
     DecoderImp(const Decoder::Ptr &decoder, MediaSinkInterface *sink);
     void onDecode(int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes);
+    void onDecodeBuffer(int stream, int codecid, int flags, int64_t pts, int64_t dts, const toolkit::Buffer::Ptr &buffer);
+    CodecId getTrackCodec(int stream, int codecid);
+    void onDecodeFrame(int stream, CodecId codec, const Frame::Ptr &frame);
     void onStream(int stream, int codecid, const void *extra, size_t bytes, int finish);
 
 private:
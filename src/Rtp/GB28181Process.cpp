@@ -10,7 +10,6 @@
 
 #if defined(ENABLE_RTPPROXY)
 #include "GB28181Process.h"
-#include "Extension/CommonRtp.h"
 #include "Extension/Factory.h"
 #include "Http/HttpTSPlayer.h"
 #include "Util/File.h"
@@ -59,7 +58,14 @@ GB28181Process::GB28181Process(const MediaInfo &media_info, MediaSinkInterface *
 }
 
 void GB28181Process::onRtpSorted(RtpPacket::Ptr rtp) {
-    _rtp_decoder[rtp->getHeader()->pt]->inputRtp(rtp, false);
+    auto it = _rtp_decoder.find(rtp->getHeader()->pt);
+    if (it != _rtp_decoder.end()) {
+        it->second->inputRtp(rtp, false);
+        return;
+    }
+    // ps或ts负载，直接在rtp负载上解析，不再先拼接成帧
+    // ps or ts payload, parse it on the rtp payload directly instead of splicing frames first
+    onMpegRtp(rtp);
 }
 
 void GB28181Process::flush() {
@@ -137,9 +143,8 @@ bool GB28181Process::inputRtp(bool, const char *data, size_t data_len) {
                 WarnL << "Unknown rtp payload type(" << (int)pt << "), decode it as mpeg-ps or mpeg-ts";
             }
             ref = std::make_shared<RtpReceiverImp>(90000, [this](RtpPacket::Ptr rtp) { onRtpSorted(std::move(rtp)); });
-            // ts或ps负载  [AUTO-TRANSLATED:3ca31480]
-            // ts or ps payload
-            _rtp_decoder[pt] = std::make_shared<CommonRtpDecoder>(CodecInvalid, 32 * 1024);
+            // ts或ps负载不经过rtp解码器，见onMpegRtp
+            // ts or ps payload bypasses the rtp decoders, see onMpegRtp
             // 设置dump目录  [AUTO-TRANSLATED:23c88ace]
             // Set dump directory
             GET_CONFIG(string, dump_dir, RtpProxy::kDumpDir);
@@ -155,39 +160,51 @@ bool GB28181Process::inputRtp(bool, const char *data, size_t data_len) {
 
         // 设置frame回调  [AUTO-TRANSLATED:dec7590f]
         // Set frame callback
-        _rtp_decoder[pt]->addDelegate([this, pt](const Frame::Ptr &frame) {
-            frame->setIndex(pt);
-            onRtpDecode(frame);
-            return true;
-        });
+        auto it = _rtp_decoder.find(pt);
+        if (it != _rtp_decoder.end()) {
+            it->second->addDelegate([this, pt](const Frame::Ptr &frame) {
+                frame->setIndex(pt);
+                _interface->inputFrame(frame);
+                return true;
+            });
+        }
     }
 
     return ref->inputRtp(TrackVideo, (unsigned char *)data, data_len);
 }
 
-void GB28181Process::onRtpDecode(const Frame::Ptr &frame) {
-    switch (frame->getCodecId()) {
-        case CodecInvalid:
-        case CodecTS:
-        case CodecPS: break;
-
-        default:
-            // 这里不是ps或ts  [AUTO-TRANSLATED:6f79ac69]
-            // This is not ps or ts
-            _interface->inputFrame(frame);
-            return;
+void GB28181Process::onMpegRtp(const RtpPacket::Ptr &rtp) {
+    auto payload = rtp->getPayload();
+    auto size = rtp->getPayloadSize();
+    if (!size) {
+        return;
+    }
+    auto seq = rtp->getSeq();
+    auto stamp = rtp->getStamp();
+    if (_decoder && (uint16_t)(_last_seq + 1) != seq) {
+        WarnL << "rtp丢包:" << _last_seq << " -> " << seq;
+        if (stamp != _last_stamp) {
+            // 时间戳已变化，之前的帧认为已收齐
+            // The timestamp has changed, the previous frame is considered complete
+            _decoder->flush();
+        }
+        // 丢弃不完整的数据并重新同步
+        // Drop the incomplete data and resync
+        _decoder->reset();
     }
+    _last_seq = seq;
+    _last_stamp = stamp;
 
     // 这是TS或PS  [AUTO-TRANSLATED:55782860]
     // This is TS or PS
     if (_save_file_ps) {
-        fwrite(frame->data(), frame->size(), 1, _save_file_ps.get());
+        fwrite(payload, size, 1, _save_file_ps.get());
     }
 
     if (!_decoder) {
         // 创建解码器  [AUTO-TRANSLATED:0cc03d90]
         // Create decoder
-        if (checkTS((uint8_t *)frame->data(), frame->size())) {
+        if (checkTS(payload, size)) {
             // 猜测是ts负载  [AUTO-TRANSLATED:c2be3a47]
             // Guess it is a ts payload
             InfoL << _media_info.stream << " judged to be TS";
@@ -201,7 +218,9 @@ void GB28181Process::onRtpDecode(const Frame::Ptr &frame) {
     }
 
     if (_decoder) {
-        _decoder->input(reinterpret_cast<const uint8_t *>(frame->data()), frame->size());
+        // 解析器直接引用rtp包内存
+        // The parser references the rtp packet memory directly
+        _decoder->input(rtp, payload, size);
     }
 }
 
@@ -55,9 +55,11 @@ protected:
     void onRtpSorted(RtpPacket::Ptr rtp);
 
 private:
-    void onRtpDecode(const Frame::Ptr &frame);
+    void onMpegRtp(const RtpPacket::Ptr &rtp);
 
 private:
+    uint16_t _last_seq = 0;
+    uint32_t _last_stamp = 0;
     MediaInfo _media_info;
     DecoderImp::Ptr _decoder;
     MediaSinkInterface *_interface;
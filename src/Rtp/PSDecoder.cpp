@@ -11,67 +11,543 @@
 #if defined(ENABLE_RTPPROXY)
 
 #include "PSDecoder.h"
-#include "mpeg-ps.h"
+#include "mpeg-proto.h"
+#include "Util/logger.h"
 
 using namespace toolkit;
 
 namespace mediakit{
 
-PSDecoder::PSDecoder() {
-    _ps_demuxer = ps_demuxer_create([](void* param,
-                                       int stream,
-                                       int codecid,
-                                       int flags,
-                                       int64_t pts,
-                                       int64_t dts,
-                                       const void* data,
-                                       size_t bytes){
-        PSDecoder *thiz = (PSDecoder *)param;
-        if(thiz->_on_decode){
-            thiz->_on_decode(stream, codecid, flags, pts, dts, data, bytes);
-        }
+static constexpr uint8_t kPackHeader = 0xBA;
+static constexpr uint8_t kStreamMap = 0xBC;
+static constexpr uint8_t kPrivateStream1 = 0xBD;
+// psm最长1024字节
+// A psm is at most 1024 bytes
+static constexpr size_t kMaxStreamMapSize = 6 + 1024;
+// 防止不更新pts的异常流导致内存溢出
+// Prevent a broken stream that never updates the pts from exhausting the memory
+static constexpr size_t kMaxFrameSize = 16 * 1024 * 1024;
+
+static inline bool isPesStream(uint8_t sid) {
+    return sid == kPrivateStream1 || (sid >= 0xC0 && sid <= 0xEF);
+}
+
+static inline bool isVideoStream(uint8_t sid) {
+    return (sid & 0xF0) == 0xE0;
+}
+
+static inline int64_t readTimestamp(const uint8_t *ptr) {
+    return ((int64_t)(ptr[0] & 0x0E) << 29) | (ptr[1] << 22) | ((ptr[2] & 0xFE) << 14) | (ptr[3] << 7) | (ptr[4] >> 1);
+}
+
+// 获取解析该起始码头部所需的字节数，数据不足以确定时返回已知的下限，不是起始码时返回0
+// Get the bytes needed to parse the header of this start code, a lower bound while the data is not enough to tell, 0 if it is not a start code
+static size_t getHeaderSize(const uint8_t *ptr, size_t len) {
+    if (len < 6) {
+        return 6;
+    }
+    if (ptr[0] != 0x00 || ptr[1] != 0x00 || ptr[2] != 0x01 || ptr[3] < kPackHeader) {
         return 0;
-    },this);
+    }
+    auto sid = ptr[3];
+    if (sid == kPackHeader) {
+        if ((ptr[4] & 0xC0) != 0x40) {
+            // mpeg1
+            return 12;
+        }
+        return len < 14 ? 14 : 14 + (ptr[13] & 0x07);
+    }
+    size_t packet_size = 6 + ((ptr[4] << 8) | ptr[5]);
+    if (sid == kStreamMap) {
+        // psm整个暂存后解析
+        // The whole psm is staged and then parsed
+        return packet_size <= kMaxStreamMapSize ? packet_size : 6;
+    }
+    if (isPesStream(sid)) {
+        if (len < 9) {
+            return 9;
+        }
+        if ((ptr[6] & 0xC0) == 0x80) {
+            return 9 + ptr[8];
+        }
+    }
+    // 系统头、填充包等只解析长度
+    // System headers, padding packets and the like only have their length parsed
+    return 6;
+}
 
-    ps_demuxer_notify_t notify = {
-            [](void *param, int stream, int codecid, const void *extra, int bytes, int finish) {
-                PSDecoder *thiz = (PSDecoder *) param;
-                if (thiz->_on_stream) {
-                    thiz->_on_stream(stream, codecid, extra, bytes, finish);
+// 未收到psm时，根据负载猜测编码格式
+// Guess the codec from the payload when no psm has been received
+static int guessCodec(uint8_t sid, const uint8_t *ptr, size_t size) {
+    if (isVideoStream(sid)) {
+        for (size_t i = 0; i + 3 < size; ++i) {
+            if (ptr[i] == 0x00 && ptr[i + 1] == 0x00 && ptr[i + 2] == 0x01) {
+                auto h265_type = (ptr[i + 3] >> 1) & 0x3F;
+                // h265的vps/sps/pps/aud
+                // vps/sps/pps/aud of h265
+                if (h265_type >= 32 && h265_type <= 35) {
+                    return PSI_STREAM_H265;
                 }
+                return PSI_STREAM_H264;
             }
-    };
-    ps_demuxer_set_notify((struct ps_demuxer_t *) _ps_demuxer, &notify, this);
+        }
+        return 0;
+    }
+    if (size > 2 && ptr[0] == 0xFF && (ptr[1] & 0xF0) == 0xF0) {
+        // adts
+        return PSI_STREAM_AAC;
+    }
+    return 0;
 }
 
-PSDecoder::~PSDecoder() {
-    ps_demuxer_destroy((struct ps_demuxer_t*)_ps_demuxer);
-}
+// 引用调用者内存的buffer，不拷贝也不持有
+// A buffer referencing the caller's memory, neither copied nor owned
+class BufferTransient : public Buffer {
+public:
+    BufferTransient(const uint8_t *data, size_t size) {
+        _data = (char *)data;
+        _size = size;
+    }
+
+    char *data() const override { return _data; }
+    size_t size() const override { return _size; }
+
+private:
+    char *_data;
+    size_t _size;
+};
 
 ssize_t PSDecoder::input(const uint8_t *data, size_t bytes) {
-    HttpRequestSplitter::input(reinterpret_cast<const char *>(data), bytes);
+    // 调用者不保证数据的生命周期，只在本次调用内直接引用，返回前只拷贝尚未输出的负载
+    // The caller does not guarantee the lifetime of the data, it is referenced during this call only and
+    // just the payload not yet output is copied before returning
+    auto holder = std::make_shared<BufferTransient>(data, bytes);
+    _transient = holder.get();
+    auto ret = input(holder, data, bytes);
+    _transient = nullptr;
+    detachTransient(holder);
+    return ret;
+}
+
+void PSDecoder::detachTransient(const Buffer::Ptr &holder) {
+    for (auto &pr : _streams) {
+        for (auto &piece : pr.second.pieces) {
+            if (piece.holder != holder) {
+                continue;
+            }
+            auto raw = BufferRaw::create();
+            raw->assign((const char *)piece.ptr, piece.size);
+            piece.ptr = (const uint8_t *)raw->data();
+            piece.holder = std::move(raw);
+        }
+    }
+}
+
+ssize_t PSDecoder::input(const Buffer::Ptr &holder, const uint8_t *data, size_t bytes) {
+    auto ptr = data;
+    auto end = data + bytes;
+    while (ptr < end) {
+        switch (_state) {
+            case kSearch: ptr = searchPackHeader(ptr, end); break;
+            case kHeader: ptr = inputHeader(ptr, end); break;
+            case kPayload: ptr = inputPayload(holder, ptr, end); break;
+            case kSkip: {
+                auto size = std::min<size_t>(_remain_size, end - ptr);
+                ptr += size;
+                _remain_size -= size;
+                if (!_remain_size) {
+                    _state = kHeader;
+                }
+                break;
+            }
+        }
+    }
     return bytes;
 }
 
-const char *PSDecoder::onSearchPacketTail(const char *data, size_t len) {
-    try {
-        auto ret = ps_demuxer_input(static_cast<struct ps_demuxer_t *>(_ps_demuxer), reinterpret_cast<const uint8_t *>(data), len);
-        if (ret >= 0 && ret <= (ssize_t)len) {
-            // 解析成功全部或部分  [AUTO-TRANSLATED:a8085d34]
-            // Parse successful, all or part
-            return data + ret;
-        }
-
-        // 解析失败，丢弃所有数据  [AUTO-TRANSLATED:e6f644d9]
-        // Parse failed, discard all data
-        return data + len;
-    } catch (toolkit::AssertFailedException &ex) {
-        InfoL << "解析 ps 异常: bytes=" << len
-              << ", exception=" << ex.what()
-              << ", hex=" << hexdump(data, MIN(len, 32));
-        // 触发断言，解析失败，丢弃所有数据  [AUTO-TRANSLATED:b60c6db0]
-        // Trigger assertion, parse failed, discard all data
-        return data + len;
+void PSDecoder::flush() {
+    // 未指定长度的pes要到下一个起始码才结束，已无后续数据时其负载即完整；指定了长度但未收齐的pes不输出
+    // A pes without length only ends at the next start code, so with no more data its payload is complete;
+    // a pes with a length that is not fully received is not output
+    bool cur_complete = _state == kPayload && !_remain_size;
+    for (auto &pr : _streams) {
+        if (&pr.second != _cur || cur_complete) {
+            emitFrame(pr.second);
+        }
+    }
+}
+
+void PSDecoder::reset() {
+    for (auto &pr : _streams) {
+        pr.second.pieces.clear();
+        pr.second.bytes = 0;
+    }
+    _cur = nullptr;
+    _header.clear();
+    _scan_word = 0xFFFFFFFF;
+    _state = kSearch;
+}
+
+void PSDecoder::resync(const char *reason) {
+    WarnL << "解析 ps 异常: " << reason << ", 重新搜索pack header";
+    reset();
+}
+
+const uint8_t *PSDecoder::searchPackHeader(const uint8_t *ptr, const uint8_t *end) {
+    while (ptr < end) {
+        _scan_word = (_scan_word << 8) | *ptr++;
+        if (_scan_word == (0x00000100 | kPackHeader)) {
+            _scan_word = 0xFFFFFFFF;
+            _header.assign("\x00\x00\x01\xBA", 4);
+            _state = kHeader;
+            break;
+        }
+    }
+    return ptr;
+}
+
+const uint8_t *PSDecoder::inputHeader(const uint8_t *ptr, const uint8_t *end) {
+    if (_header.empty()) {
+        // 头部完整在输入中时直接解析
+        // Parse in place when the whole header is in the input
+        auto len = (size_t)(end - ptr);
+        auto need = getHeaderSize(ptr, len);
+        if (!need) {
+            resync("not start code");
+            return ptr;
+        }
+        if (need <= len) {
+            onHeader(ptr, need);
+            return ptr + need;
+        }
+    }
+    // 头部跨越了输入边界，暂存后逐步补齐
+    // The header crosses the input boundary, stage it and fill it up gradually
+    while (true) {
+        auto need = getHeaderSize((const uint8_t *)_header.data(), _header.size());
+        if (!need) {
+            resync("not start code");
+            return ptr;
+        }
+        if (_header.size() >= need) {
+            onHeader((const uint8_t *)_header.data(), need);
+            _header.clear();
+            return ptr;
+        }
+        if (ptr == end) {
+            return ptr;
+        }
+        auto size = std::min<size_t>(need - _header.size(), end - ptr);
+        _header.append((const char *)ptr, size);
+        ptr += size;
+    }
+}
+
+const uint8_t *PSDecoder::inputPayload(const Buffer::Ptr &holder, const uint8_t *ptr, const uint8_t *end) {
+    if (_remain_size) {
+        auto size = std::min<size_t>(_remain_size, end - ptr);
+        appendPayload(holder, ptr, size);
+        _remain_size -= size;
+        if (!_remain_size) {
+            onPesEnd();
+        }
+        return ptr + size;
+    }
+
+    // 未指定pes长度，负载直到下一个起始码为止
+    // The pes length is unspecified, the payload lasts until the next start code
+    auto start = ptr;
+    while (ptr < end) {
+        _scan_word = (_scan_word << 8) | *ptr++;
+        if ((_scan_word & 0xFFFFFF00) == 0x00000100 && (uint8_t)_scan_word >= kPackHeader) {
+            // 起始码的前3个字节可能在上一次输入中
+            // The first 3 bytes of the start code may be in the previous input
+            auto size = (size_t)(ptr - start);
+            if (size >= 4) {
+                appendPayload(holder, start, size - 4);
+            } else {
+                trimPayload(4 - size);
+            }
+            auto sid = (char)_scan_word;
+            _scan_word = 0xFFFFFFFF;
+            onPesEnd();
+            _header.assign("\x00\x00\x01", 3);
+            _header.push_back(sid);
+            return ptr;
+        }
+    }
+    appendPayload(holder, start, ptr - start);
+    return ptr;
+}
+
+void PSDecoder::onHeader(const uint8_t *ptr, size_t size) {
+    auto sid = ptr[3];
+    _state = kHeader;
+    if (sid == kPackHeader) {
+        return;
+    }
+    size_t packet_size = 6 + ((ptr[4] << 8) | ptr[5]);
+    if (sid == kStreamMap && size == packet_size) {
+        onStreamMap(ptr, size);
+        return;
+    }
+    if (isPesStream(sid) && size > 6) {
+        if (packet_size > 6 && packet_size < size) {
+            resync("bad pes length");
+            return;
+        }
+        if (packet_size == 6 && !isVideoStream(sid)) {
+            resync("audio pes without length");
+            return;
+        }
+        onPesHeader(sid, ptr, size);
+        _remain_size = packet_size > 6 ? packet_size - size : 0;
+        _scan_word = 0xFFFFFFFF;
+        _state = kPayload;
+        if (packet_size == size) {
+            onPesEnd();
+        }
+        return;
+    }
+    // 系统头、填充包等，跳过
+    // System headers, padding packets and the like are skipped
+    _remain_size = packet_size - size;
+    if (_remain_size) {
+        _state = kSkip;
+    }
+}
+
+void PSDecoder::onPesHeader(uint8_t sid, const uint8_t *ptr, size_t size) {
+    auto &stream = _streams[sid];
+    stream.sid = sid;
+    // 带pts的pes是新一帧的开始(同一帧可能被拆成多个pes)
+    // A pes with pts starts a new frame (a frame may be split into several pes)
+    if ((ptr[7] & 0x80) && size >= 14) {
+        auto pts = readTimestamp(ptr + 9);
+        auto dts = ((ptr[7] & 0xC0) == 0xC0 && size >= 19) ? readTimestamp(ptr + 14) : pts;
+        if (pts != stream.pts) {
+            emitFrame(stream);
+        }
+        stream.pts = pts;
+        stream.dts = dts;
+    }
+    stream.pes_start = true;
+    _cur = &stream;
+}
+
+void PSDecoder::onPesEnd() {
+    _state = kHeader;
+    if (!_cur) {
+        return;
+    }
+    auto &stream = *_cur;
+    _cur = nullptr;
+    if (!isVideoStream(stream.sid)) {
+        // 音频一个pes即一帧或多帧完整的数据
+        // An audio pes carries one or more complete frames
+        emitFrame(stream);
+    }
+}
+
+void PSDecoder::onStreamMap(const uint8_t *ptr, size_t size) {
+    // 跳过起始码、长度、版本字段及program_stream_info，末尾4字节为crc
+    // Skip the start code, length, version fields and program_stream_info, the last 4 bytes are the crc
+    if (size < 16) {
+        return;
+    }
+    size_t pos = 10 + ((ptr[8] << 8) | ptr[9]);
+    if (pos + 2 > size - 4) {
+        return;
+    }
+    auto map_end = std::min<size_t>(pos + 2 + ((ptr[pos] << 8) | ptr[pos + 1]), size - 4);
+    pos += 2;
+
+    bool changed = false;
+    size_t count = 0;
+    for (auto i = pos; i + 4 <= map_end; i += 4 + ((ptr[i + 2] << 8) | ptr[i + 3])) {
+        auto &stream = _streams[ptr[i + 1]];
+        stream.sid = ptr[i + 1];
+        if (stream.codecid != ptr[i]) {
+            stream.codecid = ptr[i];
+            changed = true;
+        }
+        ++count;
+    }
+    _have_stream_map = true;
+    if (!changed || !_on_stream) {
+        return;
+    }
+    size_t index = 0;
+    for (auto i = pos; i + 4 <= map_end; i += 4 + ((ptr[i + 2] << 8) | ptr[i + 3])) {
+        _on_stream(ptr[i + 1], ptr[i], nullptr, 0, ++index == count);
+    }
+}
+
+void PSDecoder::appendPayload(const Buffer::Ptr &holder, const uint8_t *ptr, size_t size) {
+    if (!_cur || !size) {
+        return;
+    }
+    if (_cur->pes_start) {
+        _cur->pes_start = false;
+        // pts未变化或未携带pts时，按访问单元边界分帧
+        // When the pts is unchanged or absent, split frames on access unit boundaries
+        if (_cur->bytes && isVideoStream(_cur->sid) && isAccessUnitStart(*_cur, ptr, size)) {
+            emitFrame(*_cur);
+        }
+    }
+    auto &pieces = _cur->pieces;
+    if (!pieces.empty() && pieces.back().holder == holder && pieces.back().ptr + pieces.back().size == ptr) {
+        pieces.back().size += size;
+    } else {
+        pieces.emplace_back(Piece { holder, ptr, size });
+    }
+    _cur->bytes += size;
+    if (_cur->bytes > kMaxFrameSize) {
+        WarnL << "ps帧过大(" << _cur->bytes << "), 丢弃";
+        pieces.clear();
+        _cur->bytes = 0;
+    }
+}
+
+void PSDecoder::trimPayload(size_t size) {
+    if (!_cur) {
+        return;
+    }
+    auto &pieces = _cur->pieces;
+    while (size && !pieces.empty()) {
+        auto n = std::min(size, pieces.back().size);
+        pieces.back().size -= n;
+        _cur->bytes -= n;
+        size -= n;
+        if (!pieces.back().size) {
+            pieces.pop_back();
+        }
+    }
+}
+
+// pes负载是否开始了新的访问单元：AUD必然开始新帧；参数集、SEI或首个slice则要求缓存中已有slice
+// Whether a pes payload starts a new access unit: an AUD always does; a parameter set, SEI or first slice
+// does only when a slice is already pending
+bool PSDecoder::isAccessUnitStart(const Stream &stream, const uint8_t *ptr, size_t size) {
+    size_t pos;
+    if (size >= 4 && !ptr[0] && !ptr[1] && ptr[2] == 1) {
+        pos = 3;
+    } else if (size >= 5 && !ptr[0] && !ptr[1] && !ptr[2] && ptr[3] == 1) {
+        pos = 4;
+    } else {
+        // 同一帧被拆成多个pes时，后续pes从nalu中间开始
+        // When a frame is split into several pes, the following ones start in the middle of a nalu
+        return false;
+    }
+    switch (stream.codecid) {
+        case PSI_STREAM_H264: {
+            if (size < pos + 2) {
+                return false;
+            }
+            auto type = ptr[pos] & 0x1F;
+            if (type == 9) {
+                return true;
+            }
+            // first_mb_in_slice为0时ue(v)编码的首位为1
+            // A first_mb_in_slice of 0 is coded by ue(v) as a leading 1 bit
+            bool first_slice = type >= 1 && type <= 5 && (ptr[pos + 1] & 0x80);
+            return (first_slice || (type >= 6 && type <= 8)) && hasSlice(stream);
+        }
+        case PSI_STREAM_H265: {
+            if (size < pos + 3) {
+                return false;
+            }
+            auto type = (ptr[pos] >> 1) & 0x3F;
+            if (type == 35) {
+                return true;
+            }
+            // first_slice_segment_in_pic_flag是nalu头后的第一位
+            // first_slice_segment_in_pic_flag is the first bit after the nalu header
+            bool first_slice = type <= 31 && (ptr[pos + 2] & 0x80);
+            return (first_slice || (type >= 32 && type <= 34) || type == 39) && hasSlice(stream);
+        }
+        default: return false;
+    }
+}
+
+bool PSDecoder::hasSlice(const Stream &stream) {
+    bool h265 = stream.codecid == PSI_STREAM_H265;
+    uint32_t word = 0xFFFFFFFF;
+    for (auto &piece : stream.pieces) {
+        for (size_t i = 0; i < piece.size; ++i) {
+            if ((word & 0xFFFFFF) == 0x000001) {
+                auto type = h265 ? (piece.ptr[i] >> 1) & 0x3F : piece.ptr[i] & 0x1F;
+                if (h265 ? type <= 31 : (type >= 1 && type <= 5)) {
+                    return true;
+                }
+            }
+            word = (word << 8) | piece.ptr[i];
+        }
+    }
+    return false;
+}
+
+void PSDecoder::emitFrame(Stream &stream) {
+    if (stream.pieces.empty()) {
+        return;
+    }
+    if (!stream.codecid && !_have_stream_map) {
+        auto &first = stream.pieces.front();
+        stream.codecid = guessCodec(stream.sid, first.ptr, first.size);
+        if (stream.codecid && _on_stream) {
+            InfoL << "No psm found, guess codec of stream " << (int)stream.sid << " as " << stream.codecid;
+            _on_stream(stream.sid, stream.codecid, nullptr, 0, isVideoStream(stream.sid));
+        }
+    }
+    if (!stream.codecid) {
+        stream.pieces.clear();
+        stream.bytes = 0;
+        return;
+    }
+
+    Buffer::Ptr buffer;
+    if (stream.pieces.size() == 1) {
+        // 一帧完整在一个输入中，直接引用
+        // The whole frame is in one input, reference it directly
+        auto &piece = stream.pieces.front();
+        // 调用者的临时内存不能被下游持有，优先使用指针回调
+        // The caller's transient memory must not be held downstream, prefer the pointer callback
+        bool transient = piece.holder.get() == _transient;
+        if (!_on_decode_buffer || (transient && _on_decode)) {
+            if (_on_decode) {
+                _on_decode(stream.sid, stream.codecid, 0, stream.pts, stream.dts, piece.ptr, piece.size);
+            }
+            stream.pieces.clear();
+            stream.bytes = 0;
+            return;
+        }
+        if (transient) {
+            auto raw = BufferRaw::create();
+            raw->assign((const char *)piece.ptr, piece.size);
+            buffer = std::move(raw);
+        } else {
+            buffer = std::make_shared<BufferOffset<Buffer::Ptr>>(piece.holder, (const char *)piece.ptr - piece.holder->data(), piece.size);
+        }
+    } else {
+        // 一帧跨越多个输入，拼接为连续内存
+        // The frame spans several inputs, splice it into contiguous memory
+        auto raw = BufferRaw::create();
+        raw->setCapacity(stream.bytes + 1);
+        auto dst = raw->data();
+        for (auto &piece : stream.pieces) {
+            memcpy(dst, piece.ptr, piece.size);
+            dst += piece.size;
+        }
+        raw->setSize(stream.bytes);
+        buffer = std::move(raw);
+    }
+    stream.pieces.clear();
+    stream.bytes = 0;
+
+    if (_on_decode_buffer) {
+        _on_decode_buffer(stream.sid, stream.codecid, 0, stream.pts, stream.dts, buffer);
+    } else if (_on_decode) {
+        _on_decode(stream.sid, stream.codecid, 0, stream.pts, stream.dts, buffer->data(), buffer->size());
     }
 }
 
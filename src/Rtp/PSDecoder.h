@@ -13,28 +13,91 @@
 
 #if defined(ENABLE_RTPPROXY)
 #include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include "Decoder.h"
-#include "Http/HttpRequestSplitter.h"
 
 namespace mediakit{
 
 // ps解析器  [AUTO-TRANSLATED:f156a1f1]
 // ps parser
-class PSDecoder : public Decoder, private HttpRequestSplitter {
+// 增量解析ps/pes，负载直接引用输入的内存(例如rtp包)，只有一帧跨越多个输入时才分配内存拼接
+// Parses ps/pes incrementally and references the payload in the input memory (e.g. rtp packets) directly,
+// memory is only allocated to splice a frame that spans several inputs
+class PSDecoder : public Decoder {
 public:
-    PSDecoder();
-    ~PSDecoder();
+    ssize_t input(const uint8_t *data, size_t bytes) override;
+    ssize_t input(const toolkit::Buffer::Ptr &holder, const uint8_t *data, size_t bytes) override;
+    void flush() override;
+    void reset() override;
 
-    ssize_t input(const uint8_t* data, size_t bytes) override;
-
-    // HttpRequestSplitter interface
 private:
-    using HttpRequestSplitter::input;
-    const char *onSearchPacketTail(const char *data, size_t len) override;
-    ssize_t onRecvHeader(const char *, size_t) override { return 0; };
+    enum State {
+        // 搜索pack header
+        // Searching for a pack header
+        kSearch = 0,
+        // 解析起始码及头部
+        // Parsing a start code and its header
+        kHeader,
+        // pes负载
+        // Pes payload
+        kPayload,
+        // 跳过不关心的包
+        // Skipping a packet we do not care about
+        kSkip,
+    };
+
+    // 引用输入内存的一段负载
+    // A piece of payload referencing the input memory
+    struct Piece {
+        toolkit::Buffer::Ptr holder;
+        const uint8_t *ptr;
+        size_t size;
+    };
+
+    struct Stream {
+        uint8_t sid = 0;
+        int codecid = 0;
+        int64_t pts = 0;
+        int64_t dts = 0;
+        size_t bytes = 0;
+        // 刚解析完pes头，负载尚未输入
+        // A pes header was just parsed and its payload has not been input yet
+        bool pes_start = false;
+        std::vector<Piece> pieces;
+    };
+
+    const uint8_t *searchPackHeader(const uint8_t *ptr, const uint8_t *end);
+    const uint8_t *inputHeader(const uint8_t *ptr, const uint8_t *end);
+    const uint8_t *inputPayload(const toolkit::Buffer::Ptr &holder, const uint8_t *ptr, const uint8_t *end);
+    void onHeader(const uint8_t *ptr, size_t size);
+    void onPesHeader(uint8_t sid, const uint8_t *ptr, size_t size);
+    void onPesEnd();
+    void onStreamMap(const uint8_t *ptr, size_t size);
+    void appendPayload(const toolkit::Buffer::Ptr &holder, const uint8_t *ptr, size_t size);
+    void trimPayload(size_t size);
+    bool isAccessUnitStart(const Stream &stream, const uint8_t *ptr, size_t size);
+    bool hasSlice(const Stream &stream);
+    void detachTransient(const toolkit::Buffer::Ptr &holder);
+    void emitFrame(Stream &stream);
+    void resync(const char *reason);
 
 private:
-    void *_ps_demuxer = nullptr;
+    State _state = kSearch;
+    uint32_t _scan_word = 0xFFFFFFFF;
+    // 负载或跳过的剩余字节数，负载为0时表示未指定pes长度
+    // Bytes left of the payload or the skipped packet, 0 for a payload means the pes length is unspecified
+    size_t _remain_size = 0;
+    bool _have_stream_map = false;
+    // 跨越输入边界的头部
+    // A header crossing the input boundary
+    std::string _header;
+    // input(data, bytes)期间引用调用者内存的holder，调用返回后内存即失效
+    // The holder referencing the caller's memory during input(data, bytes), the memory is gone once the call returns
+    const toolkit::Buffer *_transient = nullptr;
+    Stream *_cur = nullptr;
+    std::unordered_map<uint8_t, Stream> _streams;
 };
 
 }//namespace mediakit
@@ -10,7 +10,9 @@
 
 #if defined(ENABLE_RTPPROXY)
 
+#include <array>
 #include "PSEncoder.h"
+#include "mpeg-proto.h"
 #include "Common/config.h"
 #include "Extension/CommonRtp.h"
 #include "Rtsp/RtspMuxer.h"
@@ -19,7 +21,53 @@ using namespace toolkit;
 
 namespace mediakit{
 
+static constexpr uint8_t kPackHeader = 0xBA;
+static constexpr uint8_t kSystemHeader = 0xBB;
+static constexpr uint8_t kStreamMap = 0xBC;
+static constexpr uint8_t kAudioStream = 0xC0;
+static constexpr uint8_t kVideoStream = 0xE0;
+// pes包长度字段的最大值
+// The max value of the pes packet length field
+static constexpr size_t kMaxPesSize = 0xFFFF;
+// 非关键帧时每隔多少个pack插入一次system header与psm(主要用于纯音频)
+// How many packs apart a system header and psm are inserted besides key frames (mainly for audio only streams)
+static constexpr uint32_t kPsmPeriod = 30;
+// program_mux_rate与rate_bound，单位为50字节/秒
+// program_mux_rate and rate_bound, in units of 50 bytes per second
+static constexpr uint32_t kMuxRate = 25000;
+// 同一时间戳的h264/h265帧最大缓存个数，与FrameMerger保持一致
+// The max count of cached h264/h265 frames with the same timestamp, the same as FrameMerger
+static constexpr size_t kMaxFrameCacheSize = 100;
+
+static uint32_t mpegCrc32(const uint8_t *data, size_t size) {
+    static auto s_table = []() {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i << 24;
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i) {
+        crc = (crc << 8) ^ s_table[((crc >> 24) ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+static void writeTimestamp(uint8_t *ptr, uint8_t prefix, uint64_t stamp) {
+    ptr[0] = (prefix << 4) | (((stamp >> 30) & 0x07) << 1) | 0x01;
+    ptr[1] = (stamp >> 22) & 0xFF;
+    ptr[2] = (((stamp >> 15) & 0x7F) << 1) | 0x01;
+    ptr[3] = (stamp >> 7) & 0xFF;
+    ptr[4] = ((stamp & 0x7F) << 1) | 0x01;
+}
+
 PSEncoderImp::PSEncoderImp(uint32_t ssrc, uint8_t payload_type, bool ps_or_ts) : MpegMuxer(ps_or_ts) {
+    _ps_or_ts = ps_or_ts;
     GET_CONFIG(uint32_t, s_video_mtu, Rtp::kVideoMtuSize);
     _rtp_encoder = std::make_shared<CommonRtpEncoder>();
     auto video_mtu = s_video_mtu;
@@ -42,6 +90,328 @@ PSEncoderImp::~PSEncoderImp() {
     InfoL << this;
 }
 
+bool PSEncoderImp::addTrack(const Track::Ptr &track) {
+    if (!_ps_or_ts) {
+        return MpegMuxer::addTrack(track);
+    }
+    auto stream_type = getMpegIdByCodec(track->getCodecId());
+    if (stream_type == PSI_STREAM_RESERVED) {
+        WarnL << "Unsupported codec: " << track->getCodecName();
+        return false;
+    }
+    uint8_t sid = track->getTrackType() == TrackVideo ? kVideoStream : kAudioStream;
+    for (auto &pr : _tracks) {
+        if (pr.second.type == track->getTrackType()) {
+            ++sid;
+        }
+    }
+    if (track->getTrackType() == TrackVideo) {
+        _have_video = true;
+    }
+    auto &ref = _tracks[track->getIndex()];
+    ref.sid = sid;
+    ref.stream_type = stream_type;
+    ref.type = track->getTrackType();
+    ++_psm_version;
+    return true;
+}
+
+void PSEncoderImp::resetTracks() {
+    if (!_ps_or_ts) {
+        MpegMuxer::resetTracks();
+        return;
+    }
+    _have_video = false;
+    _psm_period = 0;
+    _tracks.clear();
+}
+
+bool PSEncoderImp::inputFrame(const Frame::Ptr &frame) {
+    if (!_ps_or_ts) {
+        return MpegMuxer::inputFrame(frame);
+    }
+    auto it = _tracks.find(frame->getIndex());
+    if (it == _tracks.end()) {
+        return false;
+    }
+    auto &track = it->second;
+    switch (frame->getCodecId()) {
+        case CodecH264:
+        case CodecH265: {
+            inputVideoFrame(track, frame);
+            return true;
+        }
+
+        case CodecAAC: {
+            CHECK(frame->prefixSize(), "Mpeg muxer required aac frame with adts header");
+        }
+
+        default: {
+            bool key = !_have_video;
+            if (!_have_video) {
+                _timestamp = frame->dts();
+            }
+            if (track.type == TrackVideo) {
+                key = frame->keyFrame();
+                _timestamp = frame->dts();
+            }
+            addPayload(frame->data(), frame->size());
+            writePack(track, frame->dts(), frame->pts(), key);
+            return true;
+        }
+    }
+}
+
+void PSEncoderImp::flush() {
+    if (!_ps_or_ts) {
+        MpegMuxer::flush();
+        return;
+    }
+    for (auto &pr : _tracks) {
+        flushVideo(pr.second);
+    }
+}
+
+void PSEncoderImp::inputVideoFrame(PSTrack &track, const Frame::Ptr &frame) {
+    if (!track.cache.empty()) {
+        // 与FrameMerger::h264_prefix的切分规则一致
+        // The same split rules as FrameMerger::h264_prefix
+        auto &back = track.cache.back();
+        bool flush = track.cache.size() > kMaxFrameCacheSize;
+        if (track.have_decode_able_frame && (back->dts() != frame->dts() || frame->decodeAble() || frame->configFrame())) {
+            flush = true;
+        }
+        if (flush) {
+            flushVideo(track);
+        }
+    }
+    if (frame->decodeAble()) {
+        track.have_decode_able_frame = true;
+    }
+    track.cache.emplace_back(Frame::getCacheAbleFrame(frame));
+}
+
+void PSEncoderImp::flushVideo(PSTrack &track) {
+    if (track.cache.empty()) {
+        return;
+    }
+    bool key = false;
+    track.cache.for_each([&](const Frame::Ptr &frame) {
+        if (frame->keyFrame()) {
+            key = true;
+        }
+        if (!frame->prefixSize()) {
+            addPayload("\x00\x00\x00\x01", 4);
+        }
+        addPayload(frame->data(), frame->size());
+    });
+    auto &back = track.cache.back();
+    _timestamp = back->dts();
+    writePack(track, back->dts(), back->pts(), key);
+    track.cache.clear();
+    track.have_decode_able_frame = false;
+}
+
+void PSEncoderImp::addPayload(const char *ptr, size_t size) {
+    if (size) {
+        _payload.emplace_back(Slice { ptr, 0, size });
+        _payload_size += size;
+    }
+}
+
+void PSEncoderImp::writePack(const PSTrack &track, uint64_t dts, uint64_t pts, bool key) {
+    _header.clear();
+    _slices.clear();
+    writePackHeader(dts * 90);
+    if (key || _psm_period == 0) {
+        writeSystemHeader();
+        writeStreamMap();
+    }
+    _psm_period = (_psm_period + 1) % kPsmPeriod;
+
+    // 负载超过pes长度上限时拆分成多个pes，只有第一个pes携带时间戳
+    // A payload over the pes length limit is split into several pes, only the first of which carries the timestamps
+    size_t header_offset = 0;
+    size_t index = 0;
+    size_t offset = 0;
+    size_t remain = _payload_size;
+    bool first = true;
+    do {
+        auto max_size = kMaxPesSize - 3 - (first ? (pts != dts ? 10 : 5) : 0);
+        auto pes_size = MIN(remain, max_size);
+        writePesHeader(track, pes_size, first, pts * 90, dts * 90);
+        _slices.emplace_back(Slice { nullptr, header_offset, _header.size() - header_offset });
+        header_offset = _header.size();
+        remain -= pes_size;
+        first = false;
+        while (pes_size) {
+            auto &slice = _payload[index];
+            auto size = MIN(pes_size, slice.size - offset);
+            _slices.emplace_back(Slice { slice.ptr + offset, 0, size });
+            pes_size -= size;
+            offset += size;
+            if (offset == slice.size) {
+                ++index;
+                offset = 0;
+            }
+        }
+    } while (remain);
+
+    sendSlices(_timestamp, key);
+    _payload.clear();
+    _payload_size = 0;
+}
+
+void PSEncoderImp::writePackHeader(uint64_t scr) {
+    uint8_t buf[14];
+    buf[0] = 0x00;
+    buf[1] = 0x00;
+    buf[2] = 0x01;
+    buf[3] = kPackHeader;
+    // scr的扩展字段固定为0
+    // The scr extension is always 0
+    buf[4] = 0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 0x03);
+    buf[5] = (scr >> 20) & 0xFF;
+    buf[6] = ((scr >> 12) & 0xF8) | 0x04 | ((scr >> 13) & 0x03);
+    buf[7] = (scr >> 5) & 0xFF;
+    buf[8] = ((scr << 3) & 0xF8) | 0x04;
+    buf[9] = 0x01;
+    buf[10] = (kMuxRate >> 14) & 0xFF;
+    buf[11] = (kMuxRate >> 6) & 0xFF;
+    buf[12] = ((kMuxRate & 0x3F) << 2) | 0x03;
+    // 无填充字节
+    // No stuffing bytes
+    buf[13] = 0xF8;
+    _header.append((char *)buf, sizeof(buf));
+}
+
+void PSEncoderImp::writeSystemHeader() {
+    uint8_t audio_bound = 0, video_bound = 0;
+    for (auto &pr : _tracks) {
+        if (pr.second.type == TrackVideo) {
+            ++video_bound;
+        } else {
+            ++audio_bound;
+        }
+    }
+    auto length = 6 + 3 * _tracks.size();
+    uint8_t buf[12];
+    buf[0] = 0x00;
+    buf[1] = 0x00;
+    buf[2] = 0x01;
+    buf[3] = kSystemHeader;
+    buf[4] = (length >> 8) & 0xFF;
+    buf[5] = length & 0xFF;
+    buf[6] = 0x80 | ((kMuxRate >> 15) & 0x7F);
+    buf[7] = (kMuxRate >> 7) & 0xFF;
+    buf[8] = ((kMuxRate & 0x7F) << 1) | 0x01;
+    buf[9] = (audio_bound << 2) & 0xFC;
+    buf[10] = 0xE0 | (video_bound & 0x1F);
+    buf[11] = 0x7F;
+    _header.append((char *)buf, sizeof(buf));
+    for (auto &pr : _tracks) {
+        // P-STD缓存大小，视频为400*1024字节，音频为32*128字节
+        // The P-STD buffer size, 400*1024 bytes for video and 32*128 bytes for audio
+        uint8_t stream[3];
+        stream[0] = pr.second.sid;
+        stream[1] = pr.second.type == TrackVideo ? 0xE1 : 0xC0;
+        stream[2] = pr.second.type == TrackVideo ? 0x90 : 0x20;
+        _header.append((char *)stream, sizeof(stream));
+    }
+}
+
+void PSEncoderImp::writeStreamMap() {
+    auto begin = _header.size();
+    auto length = 10 + 4 * _tracks.size();
+    uint8_t buf[12];
+    buf[0] = 0x00;
+    buf[1] = 0x00;
+    buf[2] = 0x01;
+    buf[3] = kStreamMap;
+    buf[4] = (length >> 8) & 0xFF;
+    buf[5] = length & 0xFF;
+    buf[6] = 0xE0 | (_psm_version & 0x1F);
+    buf[7] = 0xFF;
+    // program_stream_info_length
+    buf[8] = 0x00;
+    buf[9] = 0x00;
+    // elementary_stream_map_length
+    buf[10] = ((4 * _tracks.size()) >> 8) & 0xFF;
+    buf[11] = (4 * _tracks.size()) & 0xFF;
+    _header.append((char *)buf, sizeof(buf));
+    for (auto &pr : _tracks) {
+        uint8_t stream[4];
+        stream[0] = pr.second.stream_type;
+        stream[1] = pr.second.sid;
+        stream[2] = 0x00;
+        stream[3] = 0x00;
+        _header.append((char *)stream, sizeof(stream));
+    }
+    auto crc = mpegCrc32((uint8_t *)_header.data() + begin, _header.size() - begin);
+    uint8_t crc_buf[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+    _header.append((char *)crc_buf, sizeof(crc_buf));
+}
+
+void PSEncoderImp::writePesHeader(const PSTrack &track, size_t payload_size, bool first, uint64_t pts, uint64_t dts) {
+    uint8_t flags = 0;
+    uint8_t header_size = 0;
+    if (first) {
+        flags = pts != dts ? 0xC0 : 0x80;
+        header_size = pts != dts ? 10 : 5;
+    }
+    auto length = 3 + header_size + payload_size;
+    uint8_t buf[19];
+    buf[0] = 0x00;
+    buf[1] = 0x00;
+    buf[2] = 0x01;
+    buf[3] = track.sid;
+    buf[4] = (length >> 8) & 0xFF;
+    buf[5] = length & 0xFF;
+    // 第一个pes设置data_alignment_indicator
+    // data_alignment_indicator is set on the first pes
+    buf[6] = first ? 0x84 : 0x80;
+    buf[7] = flags;
+    buf[8] = header_size;
+    if (flags & 0x80) {
+        writeTimestamp(buf + 9, flags >> 6, pts);
+    }
+    if (flags & 0x40) {
+        writeTimestamp(buf + 14, 0x01, dts);
+    }
+    _header.append((char *)buf, 9 + header_size);
+}
+
+void PSEncoderImp::sendSlices(uint64_t stamp, bool key) {
+    // 每个rtp包的负载直接从头部与帧数据的各段中拷贝，整个过程只拷贝一次
+    // The payload of each rtp packet is gathered straight from the header and frame data slices, which is the only copy
+    auto &info = _rtp_encoder->getRtpInfo();
+    auto max_size = info.getMaxSize();
+    auto remain = _header.size() + _payload_size;
+    size_t index = 0;
+    size_t offset = 0;
+    while (remain) {
+        auto rtp_size = MIN(remain, max_size);
+        remain -= rtp_size;
+        auto rtp = info.makeRtp(TrackVideo, nullptr, rtp_size, remain == 0, stamp);
+        auto dst = rtp->getPayload();
+        while (rtp_size) {
+            auto &slice = _slices[index];
+            auto src = (slice.ptr ? slice.ptr : _header.data() + slice.offset) + offset;
+            auto size = MIN(rtp_size, slice.size - offset);
+            memcpy(dst, src, size);
+            dst += size;
+            rtp_size -= size;
+            offset += size;
+            if (offset == slice.size) {
+                ++index;
+                offset = 0;
+            }
+        }
+        _rtp_encoder->inputRtp(std::move(rtp), key);
+        key = false;
+    }
+}
+
 void PSEncoderImp::onWrite(std::shared_ptr<Buffer> buffer, uint64_t stamp, bool key_pos) {
     if (!buffer) {
         return;
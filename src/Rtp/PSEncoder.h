@@ -13,13 +13,20 @@
 
 #if defined(ENABLE_RTPPROXY)
 
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include "Record/MPEG.h"
 #include "Common/MediaSink.h"
+#include "Util/List.h"
 
 namespace mediakit {
 
 class CommonRtpEncoder;
 
+// ps模式下直接生成pack/pes头部，rtp负载从头部与原始帧数据中按段拷贝，不再经过中间的整帧ps缓存；ts模式仍使用MpegMuxer
+// In ps mode the pack/pes headers are generated directly and the rtp payloads are gathered from those headers and the original
+// frame data, without an intermediate buffer holding the whole ps frame; the ts mode still goes through MpegMuxer
 class PSEncoderImp : public MpegMuxer {
 public:
     /**
@@ -37,6 +44,11 @@ public:
     PSEncoderImp(uint32_t ssrc, uint8_t payload_type = 96, bool ps_or_ts = true);
     ~PSEncoderImp() override;
 
+    bool addTrack(const Track::Ptr &track) override;
+    void resetTracks() override;
+    bool inputFrame(const Frame::Ptr &frame) override;
+    void flush() override;
+
 protected:
     // rtp打包后回调  [AUTO-TRANSLATED:8f88aef9]
     // Callback after rtp packaging
@@ -46,6 +58,45 @@ protected:
     void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t stamp, bool key_pos) override;
 
 private:
+    // ps头部或帧负载中的一段，ptr为空时表示_header中的偏移
+    // A slice of the ps headers or the frame payload, a null ptr means an offset in _header
+    struct Slice {
+        const char *ptr;
+        size_t offset;
+        size_t size;
+    };
+
+    struct PSTrack {
+        uint8_t sid = 0;
+        uint8_t stream_type = 0;
+        TrackType type = TrackInvalid;
+        // 同一时间戳的h264/h265帧(例如sps、pps、idr)缓存后作为一个pack输出
+        // H264/h265 frames with the same timestamp (e.g. sps, pps and idr) are cached and output as one pack
+        bool have_decode_able_frame = false;
+        toolkit::List<Frame::Ptr> cache;
+    };
+
+    void inputVideoFrame(PSTrack &track, const Frame::Ptr &frame);
+    void flushVideo(PSTrack &track);
+    void addPayload(const char *ptr, size_t size);
+    void writePack(const PSTrack &track, uint64_t dts, uint64_t pts, bool key);
+    void writePackHeader(uint64_t scr);
+    void writeSystemHeader();
+    void writeStreamMap();
+    void writePesHeader(const PSTrack &track, size_t payload_size, bool first, uint64_t pts, uint64_t dts);
+    void sendSlices(uint64_t stamp, bool key);
+
+private:
+    bool _ps_or_ts;
+    bool _have_video = false;
+    uint8_t _psm_version = 0;
+    uint32_t _psm_period = 0;
+    uint64_t _timestamp = 0;
+    size_t _payload_size = 0;
+    std::string _header;
+    std::vector<Slice> _payload;
+    std::vector<Slice> _slices;
+    std::unordered_map<int, PSTrack> _tracks;
     std::shared_ptr<CommonRtpEncoder> _rtp_encoder;
 };
 
@@ -25,9 +25,9 @@ static constexpr size_t kMaxCachedFrameMS = 10 * 1000;
 
 namespace mediakit {
 
-RtpProcess::Ptr RtpProcess::createProcess(const MediaTuple &tuple) {
+RtpProcess::Ptr RtpProcess::createProcess(const MediaTuple &tuple, const EventPoller::Ptr &poller) {
     RtpProcess::Ptr ret(new RtpProcess(tuple));
-    ret->createTimer();
+    ret->createTimer(poller);
     return ret;
 }
 
@@ -85,7 +85,7 @@ void RtpProcess::onManager() {
     }
 }
 
-void RtpProcess::createTimer() {
+void RtpProcess::createTimer(const EventPoller::Ptr &poller) {
     // 创建超时管理定时器  [AUTO-TRANSLATED:865cf865]
     // Create a timeout management timer
     weak_ptr<RtpProcess> weakSelf = shared_from_this();
@@ -96,7 +96,7 @@ void RtpProcess::createTimer() {
         }
         strongSelf->onManager();
         return true;
-    }, EventPollerPool::Instance().getPoller());
+    }, poller ? poller : EventPollerPool::Instance().getPoller());
 }
 
 bool RtpProcess::inputRtp(bool is_udp, const Socket::Ptr &sock, const char *data, size_t len, const struct sockaddr *addr, uint64_t *dts_out) {
@@ -25,7 +25,15 @@ public:
     using Ptr = std::shared_ptr<RtpProcess>;
     using onDetachCB = std::function<void(const toolkit::SockException &ex)>;
 
-    static Ptr createProcess(const MediaTuple &tuple);
+    /**
+     * 创建RtpProcess
+     * @param tuple 流信息
+     * @param poller 超时定时器所在线程，置空时随机分配；单端口多路复用时与接收socket同线程，保证流只在一个poller上处理
+     * Create RtpProcess
+     * @param tuple Stream info
+     * @param poller Poller of the timeout timer, a random one is picked if empty; in multiplex mode it is the receiving socket's poller, so the stream stays on one poller
+     */
+    static Ptr createProcess(const MediaTuple &tuple, const toolkit::EventPoller::Ptr &poller = nullptr);
     ~RtpProcess();
     enum OnlyTrack { kAll = 0, kOnlyAudio = 1, kOnlyVideo = 2 };
 
@@ -125,7 +133,7 @@ private:
     void doCachedFunc();
     bool alive();
     void onManager();
-    void createTimer();
+    void createTimer(const toolkit::EventPoller::Ptr &poller);
 
 private:
     bool _pause_timeout = false;
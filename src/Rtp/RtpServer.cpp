@@ -9,12 +9,18 @@
  */
 
 #if defined(ENABLE_RTPPROXY)
+#include <algorithm>
+#include <unordered_map>
 #include "Util/uv_errno.h"
 #include "RtpServer.h"
 #include "RtpProcess.h"
 #include "Rtcp/RtcpContext.h"
 #include "Common/config.h"
 
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
 using namespace std;
 using namespace toolkit;
 
@@ -134,6 +140,147 @@ private:
     std::shared_ptr<struct sockaddr_storage> _rtcp_addr;
 };
 
+// 给reuseport组挂载cBPF程序，内核按rtp头中的ssrc选择接收socket，同一ssrc的包总是落在同一个poller上
+// Attach a cBPF program to the reuseport group, the kernel picks the receiving socket by the ssrc in the rtp header,
+// so packets of one ssrc always land on the same poller
+static bool attachSsrcReusePortFilter(int fd, uint32_t group_size) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    // reuseport程序的数据偏移从udp负载开始算，rtp ssrc位于偏移8处
+    // Offsets of a reuseport program start at the udp payload, the rtp ssrc is at offset 8
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, 8 },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog = { (unsigned short)(sizeof(code) / sizeof(code[0])), code };
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+#else
+    return false;
+#endif
+}
+
+static bool isSamePeer(const struct sockaddr *a, const struct sockaddr *b) {
+    if (a->sa_family != b->sa_family) {
+        return false;
+    }
+    switch (a->sa_family) {
+        case AF_INET: {
+            auto a4 = (const struct sockaddr_in *)a;
+            auto b4 = (const struct sockaddr_in *)b;
+            return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+        }
+        case AF_INET6: {
+            auto a6 = (const struct sockaddr_in6 *)a;
+            auto b6 = (const struct sockaddr_in6 *)b;
+            return a6->sin6_port == b6->sin6_port && !memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr));
+        }
+        default: return false;
+    }
+}
+
+/**
+ * 单端口多路复用时的ssrc分流器，每个poller一个，只在其socket所在线程访问
+ * 同一ssrc的RtpProcess(包括其超时定时器)都在该poller上创建和处理
+ * SSRC demuxer of a multiplexed port, one per poller and only accessed on its socket's poller
+ * The RtpProcess of a ssrc (including its timeout timer) is created and driven on that poller
+ */
+class RtpMultiplexHelper : public std::enable_shared_from_this<RtpMultiplexHelper> {
+public:
+    using Ptr = std::shared_ptr<RtpMultiplexHelper>;
+
+    RtpMultiplexHelper(Socket::Ptr sock, MediaTuple tuple, int only_track) {
+        _sock = std::move(sock);
+        _tuple = std::move(tuple);
+        _only_track = only_track;
+    }
+
+    ~RtpMultiplexHelper() {
+        _sock->setOnRead(nullptr);
+    }
+
+    const Socket::Ptr &getSock() const { return _sock; }
+
+    void start() {
+        weak_ptr<RtpMultiplexHelper> weak_self = shared_from_this();
+        _sock->setOnRead([weak_self](const Buffer::Ptr &buf, struct sockaddr *addr, int addr_len) {
+            if (auto strong_self = weak_self.lock()) {
+                strong_self->onRecvRtp(buf, addr, addr_len);
+            }
+        });
+    }
+
+private:
+    struct Stream {
+        RtpProcess::Ptr process;
+        struct sockaddr_storage peer;
+    };
+
+    // 只有合法rtp包才会创建流，对端在此之前不占用任何状态，所以无需RtpSession的10秒非法连接超时；
+    // 流建立后由RtpProcess自身的超时管理回收
+    // A stream is only created by a valid rtp packet and a peer holds no state before that, so RtpSession's
+    // 10s illegal connection timeout is not needed; once created, a stream is reaped by RtpProcess's own timeout
+    void onRecvRtp(const Buffer::Ptr &buf, struct sockaddr *addr, int addr_len) {
+        uint32_t ssrc = 0;
+        if (!isRtp(buf->data(), buf->size()) || !getSSRC(buf->data(), buf->size(), ssrc)) {
+            return;
+        }
+        auto &stream = _streams[ssrc];
+        if (!stream.process) {
+            createStream(stream, ssrc, addr, addr_len);
+        } else if (!isSamePeer(addr, (struct sockaddr *)&stream.peer)) {
+            // 与UdpServer按对端区分会话的行为保持一致，ssrc冲突时不混流
+            // Same as UdpServer sessions keyed by peer, packets of a conflicting ssrc are not mixed in
+            WarnL << "ssrc conflicted, rtp dropped: " << printSSRC(ssrc) << " from " << SockUtil::inet_ntoa(addr);
+            return;
+        }
+        try {
+            // 与RtpSession保持一致(包括上报的协议类型)
+            // Same as RtpSession (including the reported protocol)
+            stream.process->inputRtp(false, _sock, buf->data(), buf->size(), addr);
+        } catch (std::exception &ex) {
+            stream.process->onDetach(SockException(Err_shutdown, ex.what()));
+        }
+    }
+
+    void createStream(Stream &stream, uint32_t ssrc, struct sockaddr *addr, int addr_len) {
+        auto tuple = _tuple;
+        // 多路复用时总是使用ssrc为流id
+        // Always use the ssrc as stream id in multiplex mode
+        tuple.stream = printSSRC(ssrc);
+        stream.process = RtpProcess::createProcess(tuple, _sock->getPoller());
+        stream.process->setOnlyTrack((RtpProcess::OnlyTrack)_only_track);
+        memset(&stream.peer, 0, sizeof(stream.peer));
+        memcpy(&stream.peer, addr, std::min<size_t>(addr_len, sizeof(stream.peer)));
+
+        weak_ptr<RtpMultiplexHelper> weak_self = shared_from_this();
+        weak_ptr<RtpProcess> weak_process = stream.process;
+        stream.process->setOnDetach([weak_self, weak_process, ssrc](const SockException &ex) {
+            auto strong_self = weak_self.lock();
+            if (!strong_self) {
+                return;
+            }
+            strong_self->_sock->getPoller()->async([weak_self, weak_process, ssrc]() {
+                auto strong_self = weak_self.lock();
+                if (!strong_self) {
+                    return;
+                }
+                auto it = strong_self->_streams.find(ssrc);
+                // 同一ssrc可能已被新的RtpProcess替换
+                // The ssrc may have been taken over by a new RtpProcess
+                if (it != strong_self->_streams.end() && it->second.process == weak_process.lock()) {
+                    strong_self->_streams.erase(it);
+                }
+            });
+        });
+    }
+
+private:
+    int _only_track = 0;
+    Socket::Ptr _sock;
+    MediaTuple _tuple;
+    std::unordered_map<uint32_t, Stream> _streams;
+};
+
 void RtpServer::start(uint16_t local_port, const char *local_ip, const MediaTuple &tuple, TcpMode tcp_mode, bool re_use_port, uint32_t ssrc, int only_track, bool multiplex) {
     // 创建udp服务器  [AUTO-TRANSLATED:99619428]
     // Create UDP server
@@ -164,6 +311,7 @@ void RtpServer::start(uint16_t local_port, const char *local_ip, const MediaTupl
     // 创建udp服务器  [AUTO-TRANSLATED:99619428]
     // Create UDP server
     UdpServer::Ptr udp_server;
+    std::vector<RtpMultiplexHelper::Ptr> multiplex_helpers;
     RtcpHelper::Ptr helper;
     // 增加了多路复用判断，如果多路复用为true，就走else逻辑，同时保留了原来stream_id为空走else逻辑  [AUTO-TRANSLATED:114690b1]
     // Added multiplexing judgment. If multiplexing is true, then go to the else logic, while retaining the original stream_id is empty to go to the else logic
@@ -195,12 +343,49 @@ void RtpServer::start(uint16_t local_port, const char *local_ip, const MediaTupl
     } else {
         // 单端口多线程接收多个流，根据ssrc区分流  [AUTO-TRANSLATED:e11c3ca8]
         // Single-port multi-threaded reception of multiple streams, distinguishing streams based on SSRC
-        udp_server = std::make_shared<UdpServer>();
-        (*udp_server)[RtpSession::kOnlyTrack] = only_track;
-        (*udp_server)[RtpSession::kUdpRecvBuffer] = udpRecvSocketBuffer;
-        (*udp_server)[RtpSession::kVhost] = tuple.vhost;
-        (*udp_server)[RtpSession::kApp] = tuple.app;
-        udp_server->start<RtpSession>(local_port, local_ip);
+        std::vector<Socket::Ptr> socks;
+#if defined(__linux__)
+        if (re_use_port) {
+            // 每个poller一个SO_REUSEPORT socket，内核按ssrc分流，一个流的收包、解析和超时管理都在同一个poller上；
+            // 端口已按re_use_port绑定，其他poller的socket才能加入同一个reuseport组
+            // One SO_REUSEPORT socket per poller and the kernel steers by ssrc, so receiving, parsing and timeout of a stream stay on one poller;
+            // the port is already bound with re_use_port, so sockets of the other pollers can join the same reuseport group
+            socks.emplace_back(rtp_socket);
+            EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+                auto sock_poller = static_pointer_cast<EventPoller>(executor);
+                if (sock_poller == poller) {
+                    return;
+                }
+                auto sock = Socket::createSocket(sock_poller, true);
+                if (!sock->bindUdpSock(local_port, local_ip, true)) {
+                    WarnL << "创建多路复用rtp端口 " << local_ip << ":" << local_port << " 失败:" << get_uv_errmsg(true);
+                    return;
+                }
+                SockUtil::setRecvBuf(sock->rawFD(), udpRecvSocketBuffer);
+                socks.emplace_back(std::move(sock));
+            });
+            if (socks.size() > 1 && !attachSsrcReusePortFilter(rtp_socket->rawFD(), socks.size())) {
+                // 内核会退化为按对端地址hash分流，同一设备仍然固定在一个poller上
+                // The kernel falls back to hashing by peer address, a device still sticks to one poller
+                WarnL << "按ssrc分流rtp失败:" << get_uv_errmsg(true);
+            }
+        }
+#endif
+        if (socks.empty()) {
+            // 未开启re_use_port时不能让其他socket共享该端口，仍由UdpServer按对端创建RtpSession
+            // Without re_use_port the port must not be shared with other sockets, so UdpServer still creates a RtpSession per peer
+            udp_server = std::make_shared<UdpServer>();
+            (*udp_server)[RtpSession::kOnlyTrack] = only_track;
+            (*udp_server)[RtpSession::kUdpRecvBuffer] = udpRecvSocketBuffer;
+            (*udp_server)[RtpSession::kVhost] = tuple.vhost;
+            (*udp_server)[RtpSession::kApp] = tuple.app;
+            udp_server->start<RtpSession>(local_port, local_ip);
+        }
+        for (auto &sock : socks) {
+            auto multiplex_helper = std::make_shared<RtpMultiplexHelper>(sock, tuple, only_track);
+            multiplex_helper->start();
+            multiplex_helpers.emplace_back(std::move(multiplex_helper));
+        }
         rtp_socket = nullptr;
     }
 
@@ -237,6 +422,7 @@ void RtpServer::start(uint16_t local_port, const char *local_ip, const MediaTupl
 
     _tcp_server = tcp_server;
     _udp_server = udp_server;
+    _multiplex_helpers = std::move(multiplex_helpers);
     _rtp_socket = rtp_socket;
     _rtcp_helper = helper;
     _tcp_mode = tcp_mode;
@@ -249,7 +435,13 @@ void RtpServer::setOnDetach(RtpProcess::onDetachCB cb) {
 }
 
 uint16_t RtpServer::getPort() {
-    return _udp_server ? _udp_server->getPort() : _rtp_socket->get_local_port();
+    if (_udp_server) {
+        return _udp_server->getPort();
+    }
+    if (!_multiplex_helpers.empty()) {
+        return _multiplex_helpers.front()->getSock()->get_local_port();
+    }
+    return _rtp_socket->get_local_port();
 }
 
 void RtpServer::connectToServer(const std::string &url, uint16_t port, const function<void(const SockException &ex)> &cb) {
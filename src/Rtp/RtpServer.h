@@ -13,6 +13,7 @@
 
 #if defined(ENABLE_RTPPROXY)
 #include <memory>
+#include <vector>
 #include "Network/Socket.h"
 #include "Network/TcpServer.h"
 #include "Network/UdpServer.h"
@@ -21,6 +22,7 @@
 namespace mediakit {
 
 class RtcpHelper;
+class RtpMultiplexHelper;
 
 /**
  * RTP服务器，支持UDP/TCP
@@ -108,6 +110,9 @@ private:
 protected:
     toolkit::Socket::Ptr _rtp_socket;
     toolkit::UdpServer::Ptr _udp_server;
+    // 单端口多路复用且开启re_use_port时，每个poller一个SO_REUSEPORT socket及其ssrc分流器
+    // In multiplex mode with re_use_port, one SO_REUSEPORT socket and its ssrc demuxer per poller
+    std::vector<std::shared_ptr<RtpMultiplexHelper>> _multiplex_helpers;
     toolkit::TcpServer::Ptr _tcp_server;
     std::shared_ptr<uint32_t> _ssrc;
     std::shared_ptr<RtcpHelper> _rtcp_helper;
@@ -15,6 +15,7 @@
 #include <vector>
 #include <unordered_set>
 #include "Network/Session.h"
+#include "Common/KTlsBox.h"
 #include "RtspSplitter.h"
 #include "RtpReceiver.h"
 #include "Rtcp/RtcpContext.h"
@@ -278,7 +279,7 @@ private:
  
  * [AUTO-TRANSLATED:7d1eed83]
  */
-using RtspSessionWithSSL = toolkit::SessionWithSSL<RtspSession>;
+using RtspSessionWithSSL = SessionWithKTLS<RtspSession>;
 
 } /* namespace mediakit */
 
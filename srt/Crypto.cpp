@@ -153,116 +153,36 @@ static bool aes_unwrap(const uint8_t* in, int in_len, uint8_t* out, int* outLen,
 }
 
 /**
- * @brief: aes ctr 加密
- * @param [in]: in 待加密的数据
- * @param [in]: in_len 待加密的数据长度
- * @param [out]: out 加密后输出的数据
- * @param [out]: outLen 加密后输出的数据长度
- * @param [in]: key 密钥
- * @param [in]: key_len 密钥长度
+ * @brief: aes ctr 加解密(ctr模式加密与解密相同)，复用已设置密钥的ctx，仅重置iv
+ * @param [in]: ctx 已设置密钥的cipher上下文
+ * @param [in]: in 待加解密的数据
+ * @param [in]: in_len 待加解密的数据长度
+ * @param [out]: out 输出的数据，可以与in相同
  * @param [in]: iv iv向量(16byte)
  * @return : true: 成功，false: 失败
 **/
-static bool aes_ctr_encrypt(const uint8_t* in, int in_len, uint8_t* out, int* outLen, uint8_t* key, int key_len, uint8_t* iv) {
-
 #if defined(ENABLE_OPENSSL)
-    EVP_CIPHER_CTX* ctx = NULL;
-
-   *outLen = 0;
-
-    do {
-        if (!(ctx = EVP_CIPHER_CTX_new())) {
-            WarnL << "EVP_CIPHER_CTX_new fail";
-            break;
-        }
-
-        if (1 != EVP_EncryptInit_ex(ctx, aes_key_len_mapping_ctr_cipher(key_len), NULL, key, iv)) {
-            WarnL << "EVP_EncryptInit_ex fail";
-            break;
-        }
-
-        int len1 = 0;
-        if (1 != EVP_EncryptUpdate(ctx, (uint8_t*)out, &len1, (uint8_t*)in, in_len)) {
-            WarnL << "EVP_EncryptUpdate fail";
-            break;
-        }
-
-        int len2 = 0;
-        if (1 != EVP_EncryptFinal_ex(ctx, (uint8_t*)out + len1, &len2)) {
-            WarnL << "EVP_EncryptFinal_ex fail";
-            break;
-        }
-
-        *outLen = len1 + len2;
-    } while (0);
-
-    if (ctx != NULL) {
-        EVP_CIPHER_CTX_free(ctx);
+static bool aes_ctr_crypt(EVP_CIPHER_CTX *ctx, const uint8_t* in, int in_len, uint8_t* out, const uint8_t* iv) {
+    if (!ctx) {
+        return false;
     }
 
-    return *outLen != 0;
-#else
-    return false;
-#endif
-}
-
-
-/**
- * @brief: aes ctr 解密
- * @param [in]: in 待解密的数据
- * @param [in]: in_len 待解密的数据长度
- * @param [out]: out 解密后输出的数据
- * @param [out]: outLen 解密后输出的数据长度
- * @param [in]: key 密钥
- * @param [in]: key_len 密钥长度
- * @param [in]: iv iv向量(16byte)
- * @return : true: 成功，false: 失败
-**/
-static bool aes_ctr_decrypt(const uint8_t* in, int in_len, uint8_t* out, int* outLen, uint8_t* key, int key_len, uint8_t* iv) {
-
-#if defined(ENABLE_OPENSSL)
-    EVP_CIPHER_CTX* ctx = NULL;
-
-    *outLen = 0;
-
-    do {
-
-        if (!(ctx = EVP_CIPHER_CTX_new())) {
-            WarnL << "EVP_CIPHER_CTX_new fail";
-            break;
-        }
-
-        if (1 != EVP_DecryptInit_ex(ctx, aes_key_len_mapping_ctr_cipher(key_len), NULL, key, iv)) {
-            WarnL << "EVP_DecryptInit_ex fail";
-            break;
-        }
-
-        int len1 = 0;
-        if (1 != EVP_DecryptUpdate(ctx, (uint8_t*)out, &len1, (uint8_t*)in, in_len)) {
-            WarnL << "EVP_DecryptUpdate fail";
-            break;
-        }
-
-        int len2 = 0;
-        if (1 != EVP_DecryptFinal_ex(ctx, (uint8_t*)out + len1, &len2)) {
-            WarnL << "EVP_DecryptFinal_ex fail";
-            break;
-        }
-
-        *outLen = len1 + len2;
-    } while (0);
-
-    if (ctx != NULL) {
-        EVP_CIPHER_CTX_free(ctx);
+    // cipher与key传空，保留密钥扩展结果，只更新iv
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv)) {
+        WarnL << "EVP_EncryptInit_ex fail";
+        return false;
     }
 
-    return *outLen != 0;
+    int len1 = 0;
+    if (1 != EVP_EncryptUpdate(ctx, out, &len1, in, in_len)) {
+        WarnL << "EVP_EncryptUpdate fail";
+        return false;
+    }
 
-#else
-    return false;
-#endif
+    // ctr为流模式，没有padding，EVP_EncryptFinal_ex不会再输出数据
+    return len1 == in_len;
 }
-
+#endif
 
 ///////////////////////////////////////////////////
 // CryptoContext
@@ -344,18 +264,13 @@ bool CryptoContext::generateKEK() {
 #endif
 }
 
-BufferLikeString::Ptr CryptoContext::generateIv(uint32_t pkt_seq_no) {
-    auto iv = std::make_shared<BufferLikeString>();
-    iv->resize(128 /8);
-
+void CryptoContext::generateIv(uint32_t pkt_seq_no, uint8_t *iv) const {
     uint8_t* saltData = (uint8_t*)_salt.data();
-    uint8_t* ivData = (uint8_t*)iv->data();
-    memset((void*)ivData, 0, iv->size());
-    memcpy((void*)(ivData + 10), (void*)&pkt_seq_no, 4);
+    memset((void*)iv, 0, 128 / 8);
+    memcpy((void*)(iv + 10), (void*)&pkt_seq_no, 4);
     for (size_t i = 0; i < std::min<size_t>(_salt.size(), (size_t)112 /8); ++i) {
-        ivData[i] ^= saltData[i];
+        iv[i] ^= saltData[i];
     }
-    return iv;
 }
 
 ///////////////////////////////////////////////////
@@ -363,32 +278,51 @@ BufferLikeString::Ptr CryptoContext::generateIv(uint32_t pkt_seq_no) {
 
 AesCtrCryptoContext::AesCtrCryptoContext(const std::string& passparase, uint8_t kk, KeyMaterial::Ptr packet) :
     CryptoContext(passparase, kk, packet) {
+    resetCipher();
 }
 
-BufferLikeString::Ptr AesCtrCryptoContext::encrypt(uint32_t pkt_seq_no, const char *buf, int len) {
-    auto iv = generateIv(htonl(pkt_seq_no));
-    auto payload = std::make_shared<BufferLikeString>();
-    int size = (len + 15) /16 * 16 + 8;
-    payload->resize(size);
-    auto ret = aes_ctr_encrypt((const uint8_t*)buf, len, (uint8_t*)payload->data(), &size, (uint8_t*)_sek.data(), _sek.size(), (uint8_t*)iv->data());
-    if (!ret) {
-        return nullptr;
+AesCtrCryptoContext::~AesCtrCryptoContext() {
+#if defined(ENABLE_OPENSSL)
+    if (_cipher_ctx) {
+        EVP_CIPHER_CTX_free(_cipher_ctx);
+        _cipher_ctx = nullptr;
     }
-    payload->resize(size);
-    return payload;
+#endif
 }
 
-BufferLikeString::Ptr AesCtrCryptoContext::decrypt(uint32_t pkt_seq_no, const char *buf, int len) {
-    auto iv = generateIv(htonl(pkt_seq_no));
-    auto payload = std::make_shared<BufferLikeString>();
-    int size = len;
-    payload->resize(size);
-    auto ret = aes_ctr_decrypt((const uint8_t*)buf, len, (uint8_t*)payload->data(), &size, (uint8_t*)_sek.data(), _sek.size(), (uint8_t*)iv->data());
-    if (!ret) {
-        return nullptr;
+void AesCtrCryptoContext::refresh() {
+    CryptoContext::refresh();
+    resetCipher();
+}
+
+void AesCtrCryptoContext::resetCipher() {
+#if defined(ENABLE_OPENSSL)
+    if (!_cipher_ctx && !(_cipher_ctx = EVP_CIPHER_CTX_new())) {
+        WarnL << "EVP_CIPHER_CTX_new fail";
+        return;
+    }
+    // 只在sek变化时做一次密钥扩展
+    if (1 != EVP_EncryptInit_ex(_cipher_ctx, aes_key_len_mapping_ctr_cipher(_sek.size()), NULL, (uint8_t*)_sek.data(), NULL)) {
+        WarnL << "EVP_EncryptInit_ex fail";
+        EVP_CIPHER_CTX_free(_cipher_ctx);
+        _cipher_ctx = nullptr;
     }
-    payload->resize(size);
-    return payload;
+#endif
+}
+
+bool AesCtrCryptoContext::encrypt(uint32_t pkt_seq_no, const uint8_t *in, int len, uint8_t *out) {
+#if defined(ENABLE_OPENSSL)
+    uint8_t iv[128 / 8];
+    generateIv(htonl(pkt_seq_no), iv);
+    return aes_ctr_crypt(_cipher_ctx, in, len, out, iv);
+#else
+    return false;
+#endif
+}
+
+bool AesCtrCryptoContext::decrypt(uint32_t pkt_seq_no, const uint8_t *in, int len, uint8_t *out) {
+    // ctr模式解密即再做一次加密
+    return encrypt(pkt_seq_no, in, len, out);
 }
 
 ///////////////////////////////////////////////////
@@ -465,7 +399,7 @@ bool Crypto::loadFromKeyMaterial(KeyMaterial::Ptr packet) {
     return true;
 }
 
-BufferLikeString::Ptr Crypto::encrypt(DataPacket::Ptr pkt, const char *buf, int len) {
+bool Crypto::encrypt(const DataPacket::Ptr &pkt) {
     _pkt_count++;
 
     //refresh
@@ -481,27 +415,46 @@ BufferLikeString::Ptr Crypto::encrypt(DataPacket::Ptr pkt, const char *buf, int
     }
  
     pkt->KK = _ctx_pair[_ctx_idx]->_kk;
-    return _ctx_pair[_ctx_idx]->encrypt(pkt->packet_seq_number, buf, len);
+    pkt->storeToHeader();
+    auto payload = (uint8_t *)pkt->payloadData();
+    return _ctx_pair[_ctx_idx]->encrypt(pkt->packet_seq_number, payload, pkt->payloadSize(), payload);
 }
 
-BufferLikeString::Ptr Crypto::decrypt(DataPacket::Ptr pkt, const char *buf, int len) {
-    CryptoContext::Ptr _ctx;
+bool Crypto::decrypt(const DataPacket::Ptr &pkt) {
+    CryptoContext *ctx = nullptr;
     if (pkt->KK == KeyMaterial::KEY_BASED_ENCRYPTION_NO_SEK) {
-        auto payload = std::make_shared<BufferLikeString>();
-        payload->assign(buf, len);
-        return payload;
+        return true;
     } else if (pkt->KK == KeyMaterial::KEY_BASED_ENCRYPTION_EVEN_SEK) {
-        _ctx = _ctx_pair[0];
+        ctx = _ctx_pair[0].get();
     } else if (pkt->KK == KeyMaterial::KEY_BASED_ENCRYPTION_ODD_SEK) {
-        _ctx = _ctx_pair[1];
+        ctx = _ctx_pair[1].get();
     }
 
-    if (!_ctx) {
+    if (!ctx) {
         WarnL << "not has effective KeyMaterial with kk: " << pkt->KK;
-        return nullptr;
+        return false;
     }
 
-    return _ctx->decrypt(pkt->packet_seq_number, buf, len);
+    auto payload = (uint8_t *)pkt->payloadData();
+    return ctx->decrypt(pkt->packet_seq_number, payload, pkt->payloadSize(), payload);
+}
+
+size_t Crypto::decrypt(std::vector<DataPacket::Ptr> &pkts) {
+    // 原地压缩，保持交付顺序
+    // Compact in place, keeping the delivery order
+    size_t count = 0;
+    for (auto &pkt : pkts) {
+        if (!decrypt(pkt)) {
+            WarnL << "decrypt pkt->packet_seq_number: " << pkt->packet_seq_number << " fail";
+            continue;
+        }
+        if (&pkts[count] != &pkt) {
+            pkts[count] = std::move(pkt);
+        }
+        ++count;
+    }
+    pkts.resize(count);
+    return count;
 }
 
 } // namespace SRT
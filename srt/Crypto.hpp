@@ -1,6 +1,7 @@
 ﻿#ifndef ZLMEDIAKIT_SRT_CRYPTO_H
 #define ZLMEDIAKIT_SRT_CRYPTO_H
 #include <stdint.h>
+#include <list>
 #include <vector>
 
 #include "Network/Buffer.h"
@@ -11,6 +12,8 @@
 #include "HSExt.hpp"
 #include "Packet.hpp"
 
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
 namespace SRT {
 
 class CryptoContext : public std::enable_shared_from_this<CryptoContext> {
@@ -22,14 +25,18 @@ public:
     virtual void refresh();
     virtual std::string generateWarppedKey();
 
-    virtual BufferLikeString::Ptr encrypt(uint32_t pkt_seq_no, const char *buf, int len) = 0;
-    virtual BufferLikeString::Ptr decrypt(uint32_t pkt_seq_no, const char *buf, int len) = 0;
+    /**
+     * 加解密payload, in与out可以指向同一块内存(原地加解密)
+     * Encrypt/decrypt payload, in and out may point to the same memory (in-place)
+     */
+    virtual bool encrypt(uint32_t pkt_seq_no, const uint8_t *in, int len, uint8_t *out) = 0;
+    virtual bool decrypt(uint32_t pkt_seq_no, const uint8_t *in, int len, uint8_t *out) = 0;
     virtual uint8_t getCipher() const = 0;
 
 protected:
     virtual void loadFromKeyMaterial(KeyMaterial::Ptr packet);
     virtual bool generateKEK();
-    BufferLikeString::Ptr generateIv(uint32_t pkt_seq_no);
+    void generateIv(uint32_t pkt_seq_no, uint8_t *iv) const;
 
 private:
 
@@ -52,15 +59,23 @@ class AesCtrCryptoContext : public CryptoContext {
 public:
     using Ptr = std::shared_ptr<AesCtrCryptoContext>;
     AesCtrCryptoContext(const std::string& passparase, uint8_t kk, KeyMaterial::Ptr packet = nullptr);
-    virtual ~AesCtrCryptoContext() = default;
+    ~AesCtrCryptoContext() override;
 
     uint8_t getCipher() const  override {
         return KeyMaterial::CIPHER_AES_CTR;
     }
 
-    BufferLikeString::Ptr encrypt(uint32_t pkt_seq_no, const char *buf, int len) override;
-    BufferLikeString::Ptr decrypt(uint32_t pkt_seq_no, const char *buf, int len) override;
+    void refresh() override;
+    bool encrypt(uint32_t pkt_seq_no, const uint8_t *in, int len, uint8_t *out) override;
+    bool decrypt(uint32_t pkt_seq_no, const uint8_t *in, int len, uint8_t *out) override;
+
+private:
+    void resetCipher();
 
+private:
+    // 长期持有的cipher上下文，只在sek变化时重新设置密钥，每个包只重置iv
+    // Long-lived cipher context, the key is only set when sek changes, every packet just resets the iv
+    EVP_CIPHER_CTX *_cipher_ctx = nullptr;
 };
 
 
@@ -88,8 +103,24 @@ public:
     CryptoContext::Ptr  _ctx_pair[2];    /* Even(0)/Odd(1) crypto contexts */
     uint32_t _ctx_idx = 0;
 
-    BufferLikeString::Ptr encrypt(DataPacket::Ptr pkt, const char *buf, int len);
-    BufferLikeString::Ptr decrypt(DataPacket::Ptr pkt, const char *buf, int len);
+    /**
+     * 原地加密pkt的payload，并设置KK
+     * Encrypt the payload of pkt in place and set its KK
+     */
+    bool encrypt(const DataPacket::Ptr &pkt);
+
+    /**
+     * 原地解密pkt的payload
+     * Decrypt the payload of pkt in place
+     */
+    bool decrypt(const DataPacket::Ptr &pkt);
+
+    /**
+     * 批量原地解密，解密失败的包从列表中移除
+     * Decrypt a packet list in place, packets that fail are removed from the list
+     * @return 解密成功的包个数 / number of decrypted packets
+     */
+    size_t decrypt(std::vector<DataPacket::Ptr> &pkts);
 
 private:
 
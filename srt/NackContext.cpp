@@ -1,15 +1,15 @@
 ﻿#include "NackContext.hpp"
 
 namespace SRT {
-void NackContext::update(TimePoint now, std::list<PacketQueue::LostPair> &lostlist) {
-    for (auto item : lostlist) {
+void NackContext::update(TimePoint now, const PacketQueueInterface::LostList &lostlist) {
+    for (auto &item : lostlist) {
         mergeItem(now, item);
     }
 }
 void NackContext::getLostList(
-    TimePoint now, uint32_t rtt, uint32_t rtt_variance, std::list<PacketQueue::LostPair> &lostlist) {
+    TimePoint now, uint32_t rtt, uint32_t rtt_variance, PacketQueueInterface::LostList &lostlist) {
     lostlist.clear();
-    std::list<uint32_t> tmp_list;
+    std::vector<uint32_t> tmp_list;
 
     for (auto it = _nack_map.begin(); it != _nack_map.end(); ++it) {
         if (!it->second._is_nack) {
@@ -23,7 +23,7 @@ void NackContext::getLostList(
             }
         }
     }
-    tmp_list.sort();
+    std::sort(tmp_list.begin(), tmp_list.end());
 
     if (tmp_list.empty()) {
         return;
@@ -33,13 +33,13 @@ void NackContext::getLostList(
     uint32_t max = *tmp_list.rbegin();
 
     if ((max - min) >= (MAX_SEQ >> 1)) {
-        while ((max - tmp_list.front()) > (MAX_SEQ >> 1)) {
-            tmp_list.push_back(tmp_list.front());
-            tmp_list.pop_front();
-        }
+        // 回环后的小序号移到末尾
+        // Move the wrapped small seqs to the tail
+        auto it = std::find_if(tmp_list.begin(), tmp_list.end(), [&](uint32_t seq) { return (max - seq) <= (MAX_SEQ >> 1); });
+        std::rotate(tmp_list.begin(), it, tmp_list.end());
     }
 
-    PacketQueue::LostPair lost;
+    PacketQueueInterface::LostPair lost;
     bool finish = true;
     for (auto cur = tmp_list.begin(); cur != tmp_list.end(); ++cur) {
         if (finish) {
@@ -95,7 +95,7 @@ void NackContext::drop(uint32_t seq) {
     }
 }
 
-void NackContext::mergeItem(TimePoint now, PacketQueue::LostPair &item) {
+void NackContext::mergeItem(TimePoint now, const PacketQueueInterface::LostPair &item) {
     for (uint32_t i = item.first; i < item.second; ++i) {
         auto it = _nack_map.find(i);
         if (it != _nack_map.end()) {
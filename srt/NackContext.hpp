@@ -2,19 +2,19 @@
 #define ZLMEDIAKIT_SRT_NACK_CONTEXT_H
 #include "Common.hpp"
 #include "PacketQueue.hpp"
-#include <list>
+#include <map>
 
 namespace SRT {
 class NackContext {
 public:
     NackContext() = default;
     ~NackContext() = default;
-    void update(TimePoint now, std::list<PacketQueue::LostPair> &lostlist);
-    void getLostList(TimePoint now, uint32_t rtt, uint32_t rtt_variance, std::list<PacketQueue::LostPair> &lostlist);
+    void update(TimePoint now, const PacketQueueInterface::LostList &lostlist);
+    void getLostList(TimePoint now, uint32_t rtt, uint32_t rtt_variance, PacketQueueInterface::LostList &lostlist);
     void drop(uint32_t seq);
 
 private:
-    void mergeItem(TimePoint now, PacketQueue::LostPair &item);
+    void mergeItem(TimePoint now, const PacketQueueInterface::LostPair &item);
 
 private:
     class NackItem {
@@ -2,8 +2,6 @@
 #define ZLMEDIAKIT_SRT_PACKET_QUEUE_H
 #include "Packet.hpp"
 #include <algorithm>
-#include <list>
-#include <map>
 #include <memory>
 #include <tuple>
 #include <utility>
@@ -15,13 +13,17 @@ class PacketQueueInterface {
 public:
     using Ptr = std::shared_ptr<PacketQueueInterface>;
     using LostPair = std::pair<uint32_t, uint32_t>;
+    // 丢包区间列表与交付包列表，由调用者持有并复用，避免每次分配链表节点
+    // Lost ranges and delivered packets, owned and reused by the caller to avoid per call list node allocations
+    using LostList = std::vector<LostPair>;
+    using PacketList = std::vector<DataPacket::Ptr>;
 
     PacketQueueInterface() = default;
     virtual ~PacketQueueInterface() = default;
-    virtual bool inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out) = 0;
+    virtual bool inputPacket(DataPacket::Ptr pkt, PacketList &out) = 0;
 
     virtual uint32_t timeLatency() = 0;
-    virtual std::list<LostPair> getLostSeq() = 0;
+    virtual void getLostSeq(LostList &out) = 0;
 
     virtual size_t getSize() = 0;
     virtual size_t getExpectedSize() = 0;
@@ -29,48 +31,19 @@ public:
     virtual uint32_t getExpectedSeq() = 0;
 
     virtual std::string dump() = 0;
-    virtual bool drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out) = 0;
+    virtual bool drop(uint32_t first, uint32_t last, PacketList &out) = 0;
 };
 // for recv
-class PacketQueue : public PacketQueueInterface {
-public:
-    using Ptr = std::shared_ptr<PacketQueue>;
-
-    PacketQueue(uint32_t max_size, uint32_t init_seq, uint32_t latency);
-    ~PacketQueue() = default;
-    bool inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out);
-
-    uint32_t timeLatency();
-    std::list<LostPair> getLostSeq();
-
-    size_t getSize();
-    size_t getExpectedSize();
-    size_t getAvailableBufferSize();
-    uint32_t getExpectedSeq();
-
-    std::string dump();
-    bool drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out);
-
-private:
-    void tryInsertPkt(DataPacket::Ptr pkt);
-
-private:
-    uint32_t _pkt_cap;
-    uint32_t _pkt_latency;
-    uint32_t _pkt_expected_seq;
-    std::map<uint32_t, DataPacket::Ptr> _pkt_map;
-};
-
 class PacketRecvQueue : public PacketQueueInterface {
 public:
     using Ptr = std::shared_ptr<PacketRecvQueue>;
 
     PacketRecvQueue(uint32_t max_size, uint32_t init_seq, uint32_t latency,uint32_t flag = 0xbf);
     ~PacketRecvQueue() = default;
-    bool inputPacket(DataPacket::Ptr pkt, std::list<DataPacket::Ptr> &out);
+    bool inputPacket(DataPacket::Ptr pkt, PacketList &out);
 
     uint32_t timeLatency();
-    std::list<LostPair> getLostSeq();
+    void getLostSeq(LostList &out);
 
     size_t getSize();
     size_t getExpectedSize();
@@ -78,7 +51,7 @@ public:
     uint32_t getExpectedSeq();
 
     std::string dump();
-    bool drop(uint32_t first, uint32_t last, std::list<DataPacket::Ptr> &out);
+    bool drop(uint32_t first, uint32_t last, PacketList &out);
 
 private:
     void tryInsertPkt(DataPacket::Ptr pkt);
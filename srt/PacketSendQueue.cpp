@@ -4,29 +4,65 @@ namespace SRT {
 
 PacketSendQueue::PacketSendQueue(uint32_t max_size, uint32_t latency,uint32_t flag)
     : _srt_flag(flag)
-    , _pkt_cap(max_size)
-    , _pkt_latency(latency) {}
+    , _pkt_cap(std::max<uint32_t>(max_size, 1))
+    , _pkt_latency(latency)
+    , _pkt_cache(_pkt_cap) {}
+
+int64_t PacketSendQueue::offsetOf(uint32_t seq) const {
+    if (_size == 0) {
+        return -1;
+    }
+    // 序号为31位，回环后依然可以直接相减取模
+    // Seq numbers are 31 bits, subtraction modulo MAX_SEQ + 1 handles wrap around
+    uint32_t offset = (seq - _first_seq) & MAX_SEQ;
+    if (offset >= _size) {
+        return -1;
+    }
+    return offset;
+}
+
+void PacketSendQueue::popFront() {
+    _pkt_cache[_start] = nullptr;
+    _start = (_start + 1) % _pkt_cap;
+    _first_seq = genExpectedSeq(_first_seq + 1);
+    --_size;
+}
 
 bool PacketSendQueue::drop(uint32_t num) {
-    decltype(_pkt_cache.begin()) it;
-    for (it = _pkt_cache.begin(); it != _pkt_cache.end(); ++it) {
-        if ((*it)->packet_seq_number == num) {
-            break;
-        }
+    // num为对端期望的下一个包序号，之前的包都已确认
+    // num is the next seq expected by the peer, all packets before it are acknowledged
+    // 过期或回绕异常的ack偏移会超出窗口，直接忽略
+    // Stale or bogus acks land outside the window and are ignored
+    uint32_t offset = (num - _first_seq) & MAX_SEQ;
+    if (offset > _size) {
+        return true;
     }
-    if (it != _pkt_cache.end()) {
-        _pkt_cache.erase(_pkt_cache.begin(), it);
+    while (offset-- > 0) {
+        popFront();
     }
     return true;
 }
 
 bool PacketSendQueue::inputPacket(DataPacket::Ptr pkt) {
-    _pkt_cache.push_back(pkt);
-    while (_pkt_cache.size() > _pkt_cap) {
-        _pkt_cache.pop_front();
+    if (_size && pkt->packet_seq_number != genExpectedSeq(_first_seq + _size)) {
+        // 序号不连续(不应该发生)，清空窗口以保证序号索引有效
+        // Non consecutive seq (should not happen), reset the window to keep the seq index valid
+        WarnL << "discontinuous send seq " << pkt->packet_seq_number << " expected " << genExpectedSeq(_first_seq + _size);
+        while (_size) {
+            popFront();
+        }
     }
+    if (_size == _pkt_cap) {
+        popFront();
+    }
+    if (_size == 0) {
+        _first_seq = pkt->packet_seq_number;
+    }
+    _pkt_cache[(_start + _size) % _pkt_cap] = std::move(pkt);
+    ++_size;
+
     while (timeLatency() > _pkt_latency && TLPKTDrop()) {
-        _pkt_cache.pop_front();
+        popFront();
     }
     return true;
 }
@@ -35,37 +71,28 @@ bool PacketSendQueue::TLPKTDrop(){
     return (_srt_flag&HSExtMessage::HS_EXT_MSG_TLPKTDROP) && (_srt_flag &HSExtMessage::HS_EXT_MSG_TSBPDSND);
 }
 
-std::list<DataPacket::Ptr> PacketSendQueue::findPacketBySeq(uint32_t start, uint32_t end) {
-    std::list<DataPacket::Ptr> re;
-    decltype(_pkt_cache.begin()) it;
-    for (it = _pkt_cache.begin(); it != _pkt_cache.end(); ++it) {
-        if ((*it)->packet_seq_number == start) {
-            break;
-        }
+void PacketSendQueue::findPacketBySeq(uint32_t start, uint32_t end, PacketList &out) {
+    auto first = offsetOf(start);
+    if (first < 0) {
+        return;
     }
-
-    if (start == end) {
-        if (it != _pkt_cache.end()) {
-            re.push_back(*it);
-        }
-        return re;
+    auto last = offsetOf(end);
+    if (last < first) {
+        // 区间尾部已超出窗口，返回到窗口末尾为止
+        // The end of the range is outside the window, return up to the window tail
+        last = _size - 1;
     }
-
-    for (; it != _pkt_cache.end(); ++it) {
-        re.push_back(*it);
-        if ((*it)->packet_seq_number == end) {
-            break;
-        }
+    for (auto i = first; i <= last; ++i) {
+        out.emplace_back(at(i));
     }
-    return re;
 }
 
 uint32_t PacketSendQueue::timeLatency() {
-    if (_pkt_cache.empty()) {
+    if (_size == 0) {
         return 0;
     }
-    auto first = _pkt_cache.front()->timestamp;
-    auto last = _pkt_cache.back()->timestamp;
+    auto first = at(0)->timestamp;
+    auto last = at(_size - 1)->timestamp;
     uint32_t dur;
 
     if (last > first) {
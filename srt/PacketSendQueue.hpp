@@ -3,11 +3,10 @@
 
 #include "Packet.hpp"
 #include <algorithm>
-#include <list>
 #include <memory>
-#include <set>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace SRT {
 
@@ -15,22 +14,40 @@ class PacketSendQueue {
 public:
     using Ptr = std::shared_ptr<PacketSendQueue>;
     using LostPair = std::pair<uint32_t, uint32_t>;
+    using PacketList = std::vector<DataPacket::Ptr>;
 
     PacketSendQueue(uint32_t max_size, uint32_t latency,uint32_t flag = 0xbf);
     ~PacketSendQueue() = default;
 
     bool drop(uint32_t num);
     bool inputPacket(DataPacket::Ptr pkt);
-    std::list<DataPacket::Ptr> findPacketBySeq(uint32_t start, uint32_t end);
+    /**
+     * 按序号区间[start, end]查找待重传的包，结果追加到out
+     * Find packets in seq range [start, end] for retransmission, results are appended to out
+     */
+    void findPacketBySeq(uint32_t start, uint32_t end, PacketList &out);
+
+    size_t getSize() const { return _size; }
 
 private:
     uint32_t timeLatency();
     bool TLPKTDrop();
+    void popFront();
+    // 返回seq相对于队首的偏移，不在窗口内时返回-1
+    // Offset of seq from the queue head, -1 if seq is outside the window
+    int64_t offsetOf(uint32_t seq) const;
+    const DataPacket::Ptr &at(size_t offset) const { return _pkt_cache[(_start + offset) % _pkt_cap]; }
+
 private:
     uint32_t _srt_flag;
     uint32_t _pkt_cap;
     uint32_t _pkt_latency;
-    std::list<DataPacket::Ptr> _pkt_cache;
+    // 以序号为索引的环形缓存，队首包序号为_first_seq，包序号在缓存内连续
+    // Seq indexed ring buffer, the head packet has seq _first_seq and the seqs are consecutive
+    std::vector<DataPacket::Ptr> _pkt_cache;
+    uint32_t _first_seq = 0;
+    size_t _start = 0;
+    size_t _size = 0;
 };
 
 } // namespace SRT
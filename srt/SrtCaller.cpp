@@ -14,6 +14,8 @@
 #include "Common/config.h"
 #include "Common/Parser.h"
 #include <random>
+#include <mutex>
+#include <unordered_map>
 
 using namespace toolkit;
 using namespace std;
@@ -61,6 +63,11 @@ void SrtUrl::parse(const string &strUrl) {
 
 
 ////////////  SrtCaller //////////////////////////
+// 已发起连接的srt客户端，供getSrtInfo查询
+// Srt callers that have started connecting, queried by getSrtInfo
+static std::mutex s_caller_mtx;
+static std::unordered_map<SrtCaller *, std::weak_ptr<SrtCaller>> s_callers;
+
 SrtCaller::SrtCaller(const toolkit::EventPoller::Ptr &poller) {
     _poller = poller ? std::move(poller) : EventPollerPool::Instance().getPoller();
     _start_timestamp = SteadyClock::now();
@@ -79,6 +86,23 @@ SrtCaller::SrtCaller(const toolkit::EventPoller::Ptr &poller) {
 
 SrtCaller::~SrtCaller(void) {
     DebugL;
+    std::lock_guard<std::mutex> lck(s_caller_mtx);
+    s_callers.erase(this);
+}
+
+void SrtCaller::for_each(const std::function<void(const Ptr &)> &cb) {
+    std::vector<Ptr> callers;
+    {
+        std::lock_guard<std::mutex> lck(s_caller_mtx);
+        for (auto &pr : s_callers) {
+            if (auto caller = pr.second.lock()) {
+                callers.emplace_back(std::move(caller));
+            }
+        }
+    }
+    for (auto &caller : callers) {
+        cb(caller);
+    }
 }
 
 void SrtCaller::onConnect() {
@@ -89,6 +113,10 @@ void SrtCaller::onConnect() {
     _socket->bindPeerAddr((struct sockaddr *)&_url._addr, 0, true);
 
     weak_ptr<SrtCaller> weak_self = shared_from_this();
+    {
+        std::lock_guard<std::mutex> lck(s_caller_mtx);
+        s_callers[this] = weak_self;
+    }
     _socket->setOnRead([weak_self](const Buffer::Ptr &buf, struct sockaddr *addr, int addr_len) mutable {
         auto strong_self = weak_self.lock();
         if (!strong_self) {
@@ -116,6 +144,9 @@ void SrtCaller::onResult(const SockException &ex) {
         _handleshake_timer.reset();
         _keeplive_timer.reset();
         _announce_timer.reset();
+        if (_pacer) {
+            _pacer->clear();
+        }
     }
     return;
 }
@@ -419,35 +450,21 @@ void SrtCaller::sendLightACKPacket() {
     return;
 }
 
-void SrtCaller::sendNAKPacket(std::list<SRT::PacketQueue::LostPair> &lost_list) {
+void SrtCaller::sendNAKPacket(const SRT::PacketQueueInterface::LostList &lost_list) {
     SRT::NAKPacket::Ptr pkt = std::make_shared<SRT::NAKPacket>();
-    std::list<SRT::PacketQueue::LostPair> tmp;
     auto size = SRT::NAKPacket::getCIFSize(lost_list);
     size_t paylaod_size = getPayloadSize();
     if (size > paylaod_size) {
         WarnL << "loss report cif size " << size;
         size_t num = paylaod_size / 8;
-
-        size_t msgNum = (lost_list.size() + num - 1) / num;
-        decltype(lost_list.begin()) cur, next;
-        for (size_t i = 0; i < msgNum; ++i) {
-            cur = lost_list.begin();
-            std::advance(cur, i * num);
-
-            if (i == msgNum - 1) {
-                next = lost_list.end();
-            } else {
-                next = lost_list.begin();
-                std::advance(next, (i + 1) * num);
-            }
-            tmp.assign(cur, next);
+        for (size_t i = 0; i < lost_list.size(); i += num) {
+            auto next = std::min(i + num, lost_list.size());
             pkt->dst_socket_id = _peer_socket_id;
             pkt->timestamp = DurationCountMicroseconds(_now - _start_timestamp);
-            pkt->lost_list = tmp;
+            pkt->lost_list.assign(lost_list.begin() + i, lost_list.begin() + next);
             pkt->storeToData();
             sendControlPacket(pkt, true);
         }
-
     } else {
         pkt->dst_socket_id = _peer_socket_id;
         pkt->timestamp = DurationCountMicroseconds(_now - _start_timestamp);
@@ -534,26 +551,38 @@ void SrtCaller::sendControlPacket(SRT::ControlPacket::Ptr pkt, bool flush) {
 }
 
 void SrtCaller::sendDataPacket(SRT::DataPacket::Ptr pkt, char *buf, int len, bool flush) {
-    auto data = buf;
-    auto size = len;
-    BufferLikeString::Ptr payload;
+    pkt->storeToData((uint8_t *)buf, len);
     if (_crypto) {
-        payload = _crypto->encrypt(pkt, const_cast<char*>(buf), len);
-        if (!payload) {
+        if (!_crypto->encrypt(pkt)) {
             WarnL << "encrypt pkt->packet_seq_number: " << pkt->packet_seq_number << ", timestamp: " << "pkt->timestamp " << " fail";
             return;
         }
 
-        data = payload->data();
-        size = payload->size();
-
         tryAnnounceKeyMaterial();
     }
 
-    pkt->storeToData((uint8_t *)data, size);
-    sendPacket(pkt, flush);
     _send_buf->inputPacket(pkt);
-    return;
+    if (_pacer) {
+        _pacer->inputPacket(std::move(pkt), len, flush);
+        return;
+    }
+    onSendDataPacket(pkt, flush);
+}
+
+void SrtCaller::createPacer() {
+    _pacer = std::make_shared<SendPacer>(_poller, getMaxBandwidth(), getOverheadBandwidth(), _start_timestamp, _delay);
+    _pacer->setOnSend([this](const DataPacket::Ptr &pkt, bool flush) { onSendDataPacket(pkt, flush); });
+    _pacer->setOnDrop([this](uint32_t first, uint32_t last, size_t count) {
+        WarnL << "pacing queue overflow, drop " << count << " packets, seq:" << first << "->" << last;
+        _send_drop_pkts += count;
+        sendMsgDropReq(first, last);
+    });
+}
+
+void SrtCaller::onSendDataPacket(const DataPacket::Ptr &pkt, bool flush) {
+    ++_sent_pkts;
+    _sent_bytes += pkt->size();
+    sendPacket(pkt, flush);
 }
 
 void SrtCaller::sendPacket(Buffer::Ptr pkt, bool flush) {
@@ -694,6 +723,7 @@ void SrtCaller::handleHandshakeConclusion(SRT::HandshakePacket &pkt, struct sock
         //The recommended threshold value is 1.25 times the SRT latency value.
         //Note that the SRT sender keeps packets for at least 1 second in case the latency is not high enough for a large RTT
         _send_buf = std::make_shared<PacketSendQueue>(getPktBufSize(), std::min<uint32_t>((uint32_t)_delay * 1250, 1000000), resp->srt_flag);
+        createPacer();
     }
 
     onHandShakeFinished();
@@ -720,6 +750,9 @@ void SrtCaller::handleACK(uint8_t *buf, int len, struct sockaddr *addr) {
     if (_send_buf) {
         _send_buf->drop(ack.last_ack_pkt_seq_number);
     }
+    if (_pacer) {
+        _pacer->onAck(ack.rtt, ack.rtt_variance, ack.pkt_recv_rate, ack.estimated_link_capacity);
+    }
     sendControlPacket(pkt, true);
     // TraceL<<"ack number "<<ack.ack_number;
     return;
@@ -787,12 +820,17 @@ void SrtCaller::handleNAK(uint8_t *buf, int len, struct sockaddr *addr) {
             flush = true;
         }
         empty = true;
-        auto re_list = _send_buf->findPacketBySeq(it.first, it.second - 1);
-        for (auto& pkt : re_list) {
+        _retrans_pkt_list.clear();
+        _send_buf->findPacketBySeq(it.first, it.second - 1, _retrans_pkt_list);
+        for (auto& pkt : _retrans_pkt_list) {
             pkt->R = 1;
             pkt->storeToHeader();
             sendPacket(pkt, flush);
             empty = false;
+            ++_retrans_pkts;
+            if (_pacer) {
+                _pacer->onRetransmit();
+            }
         }
         if (empty) {
             sendMsgDropReq(it.first, it.second - 1);
@@ -813,7 +851,8 @@ void SrtCaller::handleDropReq(uint8_t *buf, int len, struct sockaddr *addr) {
 
     MsgDropReqPacket pkt;
     pkt.loadFromData(buf, len);
-    std::list<DataPacket::Ptr> list;
+    auto &list = _recv_pkt_list;
+    list.clear();
     // TraceL<<"drop "<<pkt.first_pkt_seq_num<<" last "<<pkt.last_pkt_seq_num;
     _recv_buf->drop(pkt.first_pkt_seq_num, pkt.last_pkt_seq_num, list);
     //checkAndSendAckNak();
@@ -907,20 +946,16 @@ void SrtCaller::handleDataPacket(uint8_t *buf, int len, struct sockaddr *addr) {
     DataPacket::Ptr pkt = std::make_shared<DataPacket>();
     pkt->loadFromData(buf, len);
 
-    if (_crypto) {
-        auto payload = _crypto->decrypt(pkt, pkt->payloadData(), pkt->payloadSize());
-        if (!payload) {
-            WarnL << "decrypt pkt->packet_seq_number: " << pkt->packet_seq_number << ", timestamp: " << "pkt->timestamp " << " fail";
-            return;
-        }
-
-        pkt->reloadPayload((uint8_t*)payload->data(), payload->size());
-    }
-
     _estimated_link_capacity_context->inputPacket(_now, pkt);
 
-    std::list<DataPacket::Ptr> list;
+    auto &list = _recv_pkt_list;
+    list.clear();
     _recv_buf->inputPacket(pkt, list);
+    if (_crypto && !list.empty()) {
+        // 只解密排序后交付的包，重复或过期丢弃的包不再解密
+        // Only decrypt the packets delivered in order, duplicated or dropped packets are never decrypted
+        _crypto->decrypt(list);
+    }
     for (auto& data : list) {
         if (_last_pkt_seq + 1 != data->packet_seq_number) {
             TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
@@ -939,9 +974,9 @@ void SrtCaller::checkAndSendAckNak() {
         nak_interval = 20 * 1000;
     }
     if (_nak_ticker.elapsedTime(_now) > nak_interval) {
-        auto lost = _recv_buf->getLostSeq();
-        if (!lost.empty()) {
-            sendNAKPacket(lost);
+        _recv_buf->getLostSeq(_lost_list);
+        if (!_lost_list.empty()) {
+            sendNAKPacket(_lost_list);
         }
         _nak_ticker.resetTime(_now);
     }
@@ -1018,6 +1053,20 @@ float SrtCaller::getTimeOutSec() {
     return (float)timeout;
 };
 
+int64_t SrtCaller::getMaxBandwidth() {
+    GET_CONFIG(int64_t, maxBW, SRT::kMaxBandwidth);
+    return maxBW;
+}
+
+int SrtCaller::getOverheadBandwidth() {
+    GET_CONFIG(int, oheadBW, SRT::kOverheadBandwidth);
+    if (oheadBW < 5 || oheadBW > 100) {
+        WarnL << "config srt " << kOverheadBandwidth << " not vaild";
+        return 25;
+    }
+    return oheadBW;
+}
+
 std::string SrtCaller::generateStreamId() { 
     return _url._streamid;
 };
@@ -1054,6 +1103,62 @@ size_t SrtCaller::getRecvTotalBytes() const {
     return _socket ? _socket->getRecvTotalBytes() : 0;
 }
 
+void SrtCaller::getCallerInfo(const std::function<void(Json::Value)> &callback) {
+    if (!callback) {
+        return;
+    }
+
+    std::weak_ptr<SrtCaller> weak_self = shared_from_this();
+    _poller->async([weak_self, callback]() {
+        Json::Value result;
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            result["error"] = "Caller object destroyed";
+            callback(std::move(result));
+            return;
+        }
+
+        result["socket_id"] = strong_self->_socket_id;
+        result["peer_socket_id"] = strong_self->_peer_socket_id;
+        result["stream_id"] = strong_self->_url._streamid;
+        result["url"] = strong_self->_url._full_url;
+        result["is_caller"] = true;
+        result["is_pusher"] = !strong_self->isPlayer();
+        if (strong_self->_socket) {
+            result["peer_ip"] = strong_self->_socket->get_peer_ip();
+            result["peer_port"] = strong_self->_socket->get_peer_port();
+        }
+        result["latency_ms"] = strong_self->_delay;
+
+        auto &pacer = strong_self->_pacer;
+        // 推流时我们是发送者，rtt来自对端ACK；拉流时我们是接收者，rtt由ACKACK测得
+        // When pushing we are the sender and the rtt comes from the peer's ACK, when playing we measure it with ACKACK
+        bool use_ack_rtt = !strong_self->isPlayer() && pacer;
+        result["rtt_us"] = use_ack_rtt ? pacer->getLiveCC().getRtt() : strong_self->_rtt;
+        result["rtt_variance_us"] = use_ack_rtt ? pacer->getLiveCC().getRttVariance() : strong_self->_rtt_variance;
+
+        Json::Value send;
+        send["speed"] = (Json::UInt64)strong_self->getSendSpeed();
+        send["packets"] = (Json::UInt64)strong_self->_sent_pkts;
+        send["bytes"] = (Json::UInt64)strong_self->_sent_bytes;
+        send["retransmits"] = (Json::UInt64)strong_self->_retrans_pkts;
+        send["drops"] = (Json::UInt64)strong_self->_send_drop_pkts;
+        if (pacer) {
+            dumpPacer(*pacer, send);
+        }
+        result["send"] = std::move(send);
+
+        Json::Value recv;
+        recv["bytes"] = (Json::UInt64)strong_self->getRecvTotalBytes();
+        if (strong_self->_recv_buf) {
+            recv["buffer_size"] = (Json::UInt64)strong_self->_recv_buf->getSize();
+        }
+        result["recv"] = std::move(recv);
+
+        callback(std::move(result));
+    });
+}
+
 size_t SrtCaller::getSendSpeed() const {
     return _socket ? _socket->getSendSpeed() : 0;
 }
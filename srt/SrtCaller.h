@@ -25,8 +25,10 @@
 #include "Common/MultiMediaSourceMuxer.h"
 #include "Rtp/Decoder.h"
 #include "TS/TSMediaSource.h"
+#include "json/json.h"
 #include <memory>
 #include <string>
+#include <functional>
 
 
 namespace mediakit {
@@ -67,6 +69,20 @@ public:
     size_t getRecvTotalBytes() const;
     size_t getSendSpeed() const;
     size_t getSendTotalBytes() const;
+    uint32_t getSocketId() const { return _socket_id; }
+
+    /**
+     * 在所属poller线程采集连接统计信息(发送码率控制、rtt、重传与丢包等)，格式与SrtTransport::getTransportInfo一致
+     * Sample the connection statistics (sender pacing, rtt, retransmits, drops...) on the owner poller,
+     * in the same format as SrtTransport::getTransportInfo
+     */
+    void getCallerInfo(const std::function<void(Json::Value)> &callback);
+
+    /**
+     * 遍历所有已发起连接的srt客户端
+     * Iterate over all srt callers that have started connecting
+     */
+    static void for_each(const std::function<void(const Ptr &)> &cb);
 
 protected:
 
@@ -80,6 +96,10 @@ protected:
     virtual int getLatencyMul();
     virtual int getPktBufSize();
     virtual float getTimeOutSec();
+    // 最大发送带宽(字节/秒)，0为按输入码率自动计算，小于0为不限速
+    // Max send bandwidth in bytes/s, 0 follows the input rate, negative disables pacing
+    virtual int64_t getMaxBandwidth();
+    virtual int getOverheadBandwidth();
 
     virtual bool isPlayer() = 0;
 
@@ -90,7 +110,7 @@ private:
     void sendHandshakeConclusion();
     void sendACKPacket();
     void sendLightACKPacket();
-    void sendNAKPacket(std::list<SRT::PacketQueue::LostPair> &lost_list);
+    void sendNAKPacket(const SRT::PacketQueueInterface::LostList &lost_list);
     void sendMsgDropReq(uint32_t first, uint32_t last);
     void sendKeepLivePacket();
     void sendShutDown();
@@ -98,6 +118,8 @@ private:
     void sendControlPacket(SRT::ControlPacket::Ptr pkt, bool flush = true);
     void sendDataPacket(SRT::DataPacket::Ptr pkt, char *buf, int len, bool flush = false);
     void sendPacket(toolkit::Buffer::Ptr pkt, bool flush);
+    void createPacer();
+    void onSendDataPacket(const SRT::DataPacket::Ptr &pkt, bool flush);
 
     void handleHandshake(uint8_t *buf, int len, struct sockaddr *addr);
     void handleHandshakeInduction(SRT::HandshakePacket &pkt, struct sockaddr *addr);
@@ -153,7 +175,7 @@ private:
 
     //peer
     uint32_t _sync_cookie          = 0;
-    uint32_t _peer_socket_id;
+    uint32_t _peer_socket_id       = 0;
 
     // for handshake
     SRT::Timer::Ptr _handleshake_timer;
@@ -169,6 +191,11 @@ private:
 
     // for recv
     SRT::PacketQueueInterface::Ptr _recv_buf;
+    // 收包、重传与丢包统计的复用缓存
+    // Reusable storage for delivered packets, retransmission and loss reports
+    SRT::PacketQueueInterface::PacketList _recv_pkt_list;
+    SRT::PacketSendQueue::PacketList _retrans_pkt_list;
+    SRT::PacketQueueInterface::LostList _lost_list;
     uint32_t _last_pkt_seq = 0;
 
     // Ack
@@ -191,6 +218,16 @@ private:
     uint32_t _send_packet_seq_number = 0;
     uint32_t _send_msg_number        = 1;
 
+    // 发送端码率控制，与SrtTransport一致
+    // Sender pacing, same as SrtTransport
+    SRT::SendPacer::Ptr _pacer;
+
+    // 发送统计 / send statistics
+    uint64_t _sent_pkts = 0;
+    uint64_t _sent_bytes = 0;
+    uint64_t _retrans_pkts = 0;
+    uint64_t _send_drop_pkts = 0;
+
     //AckAck
     uint32_t _last_recv_ackack_seq_num = 0;
 
@@ -19,6 +19,12 @@ const std::string kPort = SRT_FIELD "port";
 const std::string kLatencyMul = SRT_FIELD "latencyMul";
 const std::string kPktBufSize = SRT_FIELD "pktBufSize";
 const std::string kPassPhrase = SRT_FIELD "passPhrase";
+// srt 最大发送带宽(字节/秒)，0为按输入码率加overhead自动计算，-1为不限速
+// SRT max send bandwidth in bytes/s, 0 follows the input rate plus overhead, -1 disables pacing
+const std::string kMaxBandwidth = SRT_FIELD "maxBW";
+// 自动带宽模式下为重传预留的带宽百分比
+// Percent of bandwidth reserved for retransmission in auto bandwidth mode
+const std::string kOverheadBandwidth = SRT_FIELD "oheadBW";
 
 static onceToken token([]() {
     mINI::Instance()[kTimeOutSec] = 5;
@@ -26,6 +32,8 @@ static onceToken token([]() {
     mINI::Instance()[kLatencyMul] = 4;
     mINI::Instance()[kPktBufSize] = 8192;
     mINI::Instance()[kPassPhrase] = "";
+    mINI::Instance()[kMaxBandwidth] = -1;
+    mINI::Instance()[kOverheadBandwidth] = 25;
 });
 
 static std::atomic<uint32_t> s_srt_socket_id_generate { 125 };
@@ -316,6 +324,7 @@ void SrtTransport::handleHandshakeConclusion(HandshakePacket &pkt, struct sockad
         _send_buf = std::make_shared<PacketSendQueue>(getPktBufSize(), delay * 1e3,srt_flag);
         _send_packet_seq_number = _init_seq_number;
         _buf_delay = delay;
+        createPacer();
         onHandShakeFinished(_stream_id, addr);
 
         if(!isPusher()){
@@ -385,6 +394,9 @@ void SrtTransport::handleACK(uint8_t *buf, int len, struct sockaddr_storage *add
     pkt->ack_number = ack.ack_number;
     pkt->storeToData();
     _send_buf->drop(ack.last_ack_pkt_seq_number);
+    if (_pacer) {
+        _pacer->onAck(ack.rtt, ack.rtt_variance, ack.pkt_recv_rate, ack.estimated_link_capacity);
+    }
     sendControlPacket(pkt, true);
     // TraceL<<"ack number "<<ack.ack_number;
 }
@@ -447,12 +459,17 @@ void SrtTransport::handleNAK(uint8_t *buf, int len, struct sockaddr_storage *add
             flush = true;
         }
         empty = true;
-        auto re_list = _send_buf->findPacketBySeq(it.first, it.second - 1);
-        for (auto& pkt : re_list) {
+        _retrans_pkt_list.clear();
+        _send_buf->findPacketBySeq(it.first, it.second - 1, _retrans_pkt_list);
+        for (auto& pkt : _retrans_pkt_list) {
             pkt->R = 1;
             pkt->storeToHeader();
             sendPacket(pkt, flush);
             empty = false;
+            ++_retrans_pkts;
+            if (_pacer) {
+                _pacer->onRetransmit();
+            }
         }
         if (empty) {
             sendMsgDropReq(it.first, it.second - 1);
@@ -472,7 +489,8 @@ void SrtTransport::handleShutDown(uint8_t *buf, int len, struct sockaddr_storage
 void SrtTransport::handleDropReq(uint8_t *buf, int len, struct sockaddr_storage *addr) {
     MsgDropReqPacket pkt;
     pkt.loadFromData(buf, len);
-    std::list<DataPacket::Ptr> list;
+    auto &list = _recv_pkt_list;
+    list.clear();
     // TraceL<<"drop "<<pkt.first_pkt_seq_num<<" last "<<pkt.last_pkt_seq_num;
     _recv_buf->drop(pkt.first_pkt_seq_num, pkt.last_pkt_seq_num, list);
     //checkAndSendAckNak();
@@ -509,9 +527,9 @@ void SrtTransport::checkAndSendAckNak(){
         nak_interval = 20 * 1000;
     }
     if (_nak_ticker.elapsedTime(_now) > nak_interval) {
-        auto lost = _recv_buf->getLostSeq();
-        if (!lost.empty()) {
-            sendNAKPacket(lost);
+        _recv_buf->getLostSeq(_lost_list);
+        if (!_lost_list.empty()) {
+            sendNAKPacket(_lost_list);
         }
         _nak_ticker.resetTime(_now);
     }
@@ -679,35 +697,21 @@ void SrtTransport::sendLightACKPacket() {
     TraceL << "send  ack " << pkt->dump();
 }
 
-void SrtTransport::sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list) {
+void SrtTransport::sendNAKPacket(const PacketQueueInterface::LostList &lost_list) {
     NAKPacket::Ptr pkt = std::make_shared<NAKPacket>();
-    std::list<PacketQueue::LostPair> tmp;
     auto size = NAKPacket::getCIFSize(lost_list);
     size_t paylaod_size = getPayloadSize();
     if (size > paylaod_size) {
         WarnL << "loss report cif size " << size;
         size_t num = paylaod_size / 8;
-
-        size_t msgNum = (lost_list.size() + num - 1) / num;
-        decltype(lost_list.begin()) cur, next;
-        for (size_t i = 0; i < msgNum; ++i) {
-            cur = lost_list.begin();
-            std::advance(cur, i * num);
-
-            if (i == msgNum - 1) {
-                next = lost_list.end();
-            } else {
-                next = lost_list.begin();
-                std::advance(next, (i + 1) * num);
-            }
-            tmp.assign(cur, next);
+        for (size_t i = 0; i < lost_list.size(); i += num) {
+            auto next = std::min(i + num, lost_list.size());
             pkt->dst_socket_id = _peer_socket_id;
             pkt->timestamp = DurationCountMicroseconds(_now - _start_timestamp);
-            pkt->lost_list = tmp;
+            pkt->lost_list.assign(lost_list.begin() + i, lost_list.begin() + next);
             pkt->storeToData();
             sendControlPacket(pkt, true);
         }
-
     } else {
         pkt->dst_socket_id = _peer_socket_id;
         pkt->timestamp = DurationCountMicroseconds(_now - _start_timestamp);
@@ -750,22 +754,20 @@ void SrtTransport::handleDataPacket(uint8_t *buf, int len, struct sockaddr_stora
     DataPacket::Ptr pkt = std::make_shared<DataPacket>();
     pkt->loadFromData(buf, len);
 
-    if (_crypto) {
-        auto payload = _crypto->decrypt(pkt, pkt->payloadData(), pkt->payloadSize());
-        if (!payload) {
-            WarnL << "decrypt pkt->packet_seq_number: " << pkt->packet_seq_number << ", timestamp: " << "pkt->timestamp " << " fail";
-            return;
-        }
-
-        pkt->reloadPayload((uint8_t*)payload->data(), payload->size());
-    }
-
     _estimated_link_capacity_context->inputPacket(_now,pkt);
 
-    std::list<DataPacket::Ptr> list;
+    auto &list = _recv_pkt_list;
+    list.clear();
     //TraceL<<" seq="<< pkt->packet_seq_number<<" ts="<<pkt->timestamp<<" size="<<pkt->payloadSize()<<\
     //" PP="<<(int)pkt->PP<<" O="<<(int)pkt->O<<" kK="<<(int)pkt->KK<<" R="<<(int)pkt->R;
+    ++_recv_pkts;
+    _recv_bytes += len;
     _recv_buf->inputPacket(pkt, list);
+    if (_crypto && !list.empty()) {
+        // 只解密排序后交付的包，重复或过期丢弃的包不再解密
+        // Only decrypt the packets delivered in order, duplicated or dropped packets are never decrypted
+        _crypto->decrypt(list);
+    }
     if (list.empty()) {
         // when no data ok send nack to sender immediately
     } else {
@@ -774,6 +776,7 @@ void SrtTransport::handleDataPacket(uint8_t *buf, int len, struct sockaddr_stora
             // last_seq = data->packet_seq_number;
             if (_last_pkt_seq + 1 != data->packet_seq_number) {
                 TraceL << "pkt lost " << _last_pkt_seq + 1 << "->" << data->packet_seq_number;
+                _recv_lost_pkts += (data->packet_seq_number - _last_pkt_seq - 1) & MAX_SEQ;
             }
             _last_pkt_seq = data->packet_seq_number;
             onSRTData(std::move(data));
@@ -829,26 +832,41 @@ void SrtTransport::handleDataPacket(uint8_t *buf, int len, struct sockaddr_stora
 }
 
 void SrtTransport::sendDataPacket(DataPacket::Ptr pkt, char *buf, int len, bool flush) {
-    auto data = buf;
-    auto size = len;
-    BufferLikeString::Ptr payload;
+    pkt->storeToData((uint8_t *)buf, len);
     if (_crypto) {
-        payload = _crypto->encrypt(pkt, const_cast<char*>(buf), len);
-        if (!payload) {
+        if (!_crypto->encrypt(pkt)) {
             WarnL << "encrypt pkt->packet_seq_number: " << pkt->packet_seq_number << ", timestamp: " << "pkt->timestamp " << " fail";
             return;
         }
 
-        data = payload->data();
-        size = payload->size();
-
         tryAnnounceKeyMaterial();
     }
 
-    pkt->storeToData((uint8_t *)data, size);
-    sendPacket(pkt, flush);
     _send_buf->inputPacket(pkt);
-    return;
+    if (_pacer) {
+        _pacer->inputPacket(std::move(pkt), len, flush);
+        return;
+    }
+    onSendDataPacket(pkt, flush);
+}
+
+void SrtTransport::createPacer() {
+    // 发送端码率控制，排队超过延时的包被丢弃
+    // Sender pacing, packets queued longer than the latency are dropped
+    _pacer = std::make_shared<SendPacer>(getPoller(), getMaxBandwidth(), getOverheadBandwidth(), _start_timestamp, _buf_delay);
+    _pacer->setOnSend([this](const DataPacket::Ptr &pkt, bool flush) { onSendDataPacket(pkt, flush); });
+    _pacer->setOnDrop([this](uint32_t first, uint32_t last, size_t count) {
+        WarnL << "pacing queue overflow, drop " << count << " packets, seq:" << first << "->" << last;
+        _send_drop_pkts += count;
+        sendMsgDropReq(first, last);
+    });
+}
+
+void SrtTransport::onSendDataPacket(const DataPacket::Ptr &pkt, bool flush) {
+    ++_sent_pkts;
+    _sent_bytes += pkt->size();
+    _send_speed += pkt->size();
+    sendPacket(pkt, flush);
 }
 
 void SrtTransport::sendControlPacket(ControlPacket::Ptr pkt, bool flush) {
@@ -866,6 +884,75 @@ void SrtTransport::sendPacket(Buffer::Ptr pkt, bool flush) {
     }
 }
 
+void SrtTransport::getTransportInfo(const std::function<void(Json::Value)> &callback) {
+    if (!callback) {
+        return;
+    }
+
+    std::weak_ptr<SrtTransport> weak_self = shared_from_this();
+    _poller->async([weak_self, callback]() {
+        Json::Value result;
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            result["error"] = "Transport object destroyed";
+            callback(std::move(result));
+            return;
+        }
+
+        result["socket_id"] = strong_self->_socket_id;
+        result["peer_socket_id"] = strong_self->_peer_socket_id;
+        result["stream_id"] = strong_self->_stream_id;
+        result["identifier"] = strong_self->getIdentifier();
+        result["is_caller"] = false;
+        result["is_pusher"] = strong_self->isPusher();
+        if (strong_self->_selected_session) {
+            result["peer_ip"] = strong_self->_selected_session->get_peer_ip();
+            result["peer_port"] = strong_self->_selected_session->get_peer_port();
+        }
+        result["latency_ms"] = strong_self->_buf_delay;
+
+        auto &pacer = strong_self->_pacer;
+        // 推流端我们是接收者，rtt由ACKACK测得；拉流端我们是发送者，rtt来自对端ACK
+        // For pushers we are the receiver and measure rtt with ACKACK, for players the rtt comes from the peer's ACK
+        bool use_ack_rtt = !strong_self->isPusher() && pacer;
+        result["rtt_us"] = use_ack_rtt ? pacer->getLiveCC().getRtt() : strong_self->_rtt;
+        result["rtt_variance_us"] = use_ack_rtt ? pacer->getLiveCC().getRttVariance() : strong_self->_rtt_variance;
+
+        Json::Value send;
+        send["speed"] = strong_self->_send_speed.getSpeed();
+        send["packets"] = (Json::UInt64)strong_self->_sent_pkts;
+        send["bytes"] = (Json::UInt64)strong_self->_sent_bytes;
+        send["retransmits"] = (Json::UInt64)strong_self->_retrans_pkts;
+        send["drops"] = (Json::UInt64)strong_self->_send_drop_pkts;
+        if (pacer) {
+            dumpPacer(*pacer, send);
+        }
+        result["send"] = std::move(send);
+
+        Json::Value recv;
+        recv["packets"] = (Json::UInt64)strong_self->_recv_pkts;
+        recv["bytes"] = (Json::UInt64)strong_self->_recv_bytes;
+        recv["lost"] = (Json::UInt64)strong_self->_recv_lost_pkts;
+        if (strong_self->_recv_buf) {
+            recv["buffer_size"] = (Json::UInt64)strong_self->_recv_buf->getSize();
+        }
+        result["recv"] = std::move(recv);
+
+        callback(std::move(result));
+    });
+}
+
+void dumpPacer(const SendPacer &pacer, Json::Value &send) {
+    auto &live_cc = pacer.getLiveCC();
+    send["pacing_queue"] = (Json::UInt64)pacer.getQueueSize();
+    send["pacing_enabled"] = live_cc.enabled();
+    send["pacing_bandwidth"] = (Json::UInt64)live_cc.getBandwidth();
+    send["pkt_send_period_us"] = (Json::Int64)live_cc.getPktSndPeriod();
+    send["input_rate"] = (Json::UInt64)live_cc.getInputRate();
+    send["peer_recv_rate_pkts"] = live_cc.getPeerRecvRate();
+    send["link_capacity"] = (Json::UInt64)live_cc.getLinkCapacity();
+}
+
 std::string SrtTransport::getIdentifier() const {
     return _selected_session ? _selected_session->getIdentifier() : "";
 }
@@ -894,6 +981,9 @@ void SrtTransport::unregisterSelf() {
 
 void SrtTransport::onShutdown(const SockException &ex) {
     sendShutDown();
+    if (_pacer) {
+        _pacer->clear();
+    }
     WarnL << ex.what();
     unregisterSelfHandshake();
     unregisterSelf();
@@ -958,6 +1048,24 @@ SrtTransportManager &SrtTransportManager::Instance() {
     return s_instance;
 }
 
+void SrtTransportManager::for_each(const std::function<void(const SrtTransport::Ptr &)> &cb) {
+    std::vector<SrtTransport::Ptr> items;
+    {
+        std::lock_guard<std::mutex> lck(_mtx);
+        items.reserve(_map.size());
+        for (auto &pr : _map) {
+            if (auto transport = pr.second.lock()) {
+                items.emplace_back(std::move(transport));
+            }
+        }
+    }
+    // 锁外回调，避免回调中访问管理器造成死锁
+    // Invoke the callback outside the lock so it may use the manager again
+    for (auto &transport : items) {
+        cb(transport);
+    }
+}
+
 void SrtTransportManager::addItem(const uint32_t key, const SrtTransport::Ptr &ptr) {
     std::lock_guard<std::mutex> lck(_mtx);
     _map[key] = ptr;
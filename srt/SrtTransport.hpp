@@ -3,6 +3,8 @@
 
 #include <atomic>
 #include <chrono>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 
@@ -10,6 +12,7 @@
 #include "Poller/EventPoller.h"
 #include "Poller/Timer.h"
 #include "Common/Stamp.h"
+#include "json/json.h"
 #include "Common.hpp"
 #include "NackContext.hpp"
 #include "Packet.hpp"
@@ -26,6 +29,8 @@ extern const std::string kTimeOutSec;
 extern const std::string kLatencyMul;
 extern const std::string kPktBufSize;
 extern const std::string kPassPhrase;
+extern const std::string kMaxBandwidth;
+extern const std::string kOverheadBandwidth;
 
 class SrtTransport : public std::enable_shared_from_this<SrtTransport> {
 public:
@@ -48,9 +53,16 @@ public:
     virtual void onSendTSData(const Buffer::Ptr &buffer, bool flush);
 
     std::string getIdentifier() const;
+    uint32_t getSocketId() const { return _socket_id; }
     void unregisterSelf();
     void unregisterSelfHandshake();
 
+    /**
+     * 在所属线程获取连接统计信息(发送码率、rtt、重传与丢包等)
+     * Get the connection statistics (send rate, rtt, retransmits, drops...) on the owner thread
+     */
+    void getTransportInfo(const std::function<void(Json::Value)> &callback);
+
 protected:
     virtual bool isPusher() { return true; };
     virtual void onSRTData(DataPacket::Ptr pkt) {};
@@ -63,6 +75,10 @@ protected:
     virtual int getPktBufSize() { return 8192; };
     virtual float getTimeOutSec(){return 5.0;};
     virtual std::string getPassphrase() {return "";};
+    // 最大发送带宽(字节/秒)，0为按输入码率自动计算，小于0为不限速
+    // Max send bandwidth in bytes/s, 0 follows the input rate, negative disables pacing
+    virtual int64_t getMaxBandwidth() { return -1; };
+    virtual int getOverheadBandwidth() { return 25; };
 
 private:
     void registerSelf();
@@ -87,7 +103,7 @@ private:
     void handlePeerError(uint8_t *buf, int len, struct sockaddr_storage *addr);
     void handleDataPacket(uint8_t *buf, int len, struct sockaddr_storage *addr);
 
-    void sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list);
+    void sendNAKPacket(const PacketQueueInterface::LostList &lost_list);
     void sendACKPacket();
     void sendRejectPacket(SRT_REJECT_REASON reason, struct sockaddr_storage *addr);
     void sendLightACKPacket();
@@ -102,6 +118,9 @@ private:
 
     void checkAndSendAckNak();
 
+    void createPacer();
+    void onSendDataPacket(const DataPacket::Ptr &pkt, bool flush);
+
 protected:
     void sendDataPacket(DataPacket::Ptr pkt, char *buf, int len, bool flush = false);
     void sendControlPacket(ControlPacket::Ptr pkt, bool flush = true);
@@ -135,6 +154,11 @@ private:
     PacketSendQueue::Ptr _send_buf;
     uint32_t _buf_delay = 120;
     PacketQueueInterface::Ptr _recv_buf;
+    // 收包、重传与丢包统计的复用缓存
+    // Reusable storage for delivered packets, retransmission and loss reports
+    PacketQueueInterface::PacketList _recv_pkt_list;
+    PacketSendQueue::PacketList _retrans_pkt_list;
+    PacketQueueInterface::LostList _lost_list;
     // NackContext _recv_nack;
     uint32_t _rtt = 100 * 1000;
     uint32_t _rtt_variance = 50 * 1000;
@@ -171,8 +195,28 @@ private:
     Crypto::Ptr            _crypto;
     Timer::Ptr             _announce_timer;
     KeyMaterialPacket::Ptr _announce_req;
+
+    // 发送端码率控制，避免关键帧突发导致丢包与重传风暴
+    // Sender pacing, avoids keyframe bursts that cause losses and retransmission storms
+    SendPacer::Ptr _pacer;
+
+    // 发送统计 / send statistics
+    BytesSpeed _send_speed;
+    uint64_t _sent_pkts = 0;
+    uint64_t _sent_bytes = 0;
+    uint64_t _retrans_pkts = 0;
+    uint64_t _send_drop_pkts = 0;
+    uint64_t _recv_pkts = 0;
+    uint64_t _recv_bytes = 0;
+    uint64_t _recv_lost_pkts = 0;
 };
 
+/**
+ * 把发送端码率控制的状态写入getSrtInfo的send字段
+ * Write the sender pacing state into the send field of getSrtInfo
+ */
+void dumpPacer(const SendPacer &pacer, Json::Value &send);
+
 class SrtTransportManager {
 public:
     static SrtTransportManager &Instance();
@@ -184,6 +228,8 @@ public:
     void removeHandshakeItem(const uint32_t key);
     SrtTransport::Ptr getHandshakeItem(const uint32_t key);
 
+    void for_each(const std::function<void(const SrtTransport::Ptr &)> &cb);
+
 private:
     SrtTransportManager() = default;
 
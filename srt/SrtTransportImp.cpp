@@ -378,4 +378,20 @@ int SrtTransportImp::getPktBufSize() {
     return pktBufSize;
 }
 
+int64_t SrtTransportImp::getMaxBandwidth() {
+    GET_CONFIG(int64_t, maxBW, kMaxBandwidth);
+    return maxBW;
+}
+
+int SrtTransportImp::getOverheadBandwidth() {
+    GET_CONFIG(int, oheadBW, kOverheadBandwidth);
+    if (oheadBW < 5 || oheadBW > 100) {
+        // libsrt限定overhead取值范围为5%~100%
+        // libsrt limits the overhead to 5%~100%
+        WarnL << "config srt " << kOverheadBandwidth << " not vaild";
+        return 25;
+    }
+    return oheadBW;
+}
+
 } // namespace SRT
@@ -39,6 +39,8 @@ protected:
     int getPktBufSize() override;
     float getTimeOutSec() override;
     std::string getPassphrase() override;
+    int64_t getMaxBandwidth() override;
+    int getOverheadBandwidth() override;
     void onSRTData(DataPacket::Ptr pkt) override;
     void onShutdown(const SockException &ex) override;
     void onHandShakeFinished(std::string &streamid, struct sockaddr_storage *addr) override;
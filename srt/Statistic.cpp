@@ -225,4 +225,166 @@ uint32_t RecvRateContext::getRecvRate() {
     return (uint32_t)rate;
 }
 */
+
+// libsrt的输入码率采样周期：启动阶段500ms，之后1s
+// Input rate sampling period as libsrt: 500ms during fast start, 1s afterwards
+static constexpr int64_t kInputRateFastStartUs = 500 * 1000;
+static constexpr int64_t kInputRateRunningUs = 1000 * 1000;
+
+LiveCC::LiveCC(int64_t max_bw, uint32_t overhead)
+    : _max_bw(max_bw)
+    , _overhead(overhead) {
+    updatePktSndPeriod();
+}
+
+void LiveCC::onInput(const TimePoint &ts, size_t payload_size) {
+    // 平均包大小按1/8权重平滑 / smooth the average packet size with a 1/8 weight
+    _avg_payload_size = (_avg_payload_size * 7 + payload_size) / 8;
+    if (_max_bw != 0) {
+        // 固定带宽或不限速时无需采样输入码率 / no input sampling with a fixed bandwidth or pacing disabled
+        if (_max_bw > 0) {
+            updatePktSndPeriod();
+        }
+        return;
+    }
+    if (!_input_started) {
+        _input_started = true;
+        _input_start = ts;
+    }
+    ++_input_pkts;
+    _input_bytes += payload_size;
+
+    auto period = _input_rate ? kInputRateRunningUs : kInputRateFastStartUs;
+    auto elapsed = DurationCountMicroseconds(ts - _input_start);
+    if (elapsed < period) {
+        return;
+    }
+    // 带宽计算包含udp与srt头部 / the bandwidth accounts for udp and srt headers
+    _input_rate = (_input_bytes + _input_pkts * SRT_DATA_HDR_SIZE) * 1000000 / elapsed;
+    _input_pkts = 0;
+    _input_bytes = 0;
+    _input_start = ts;
+    updatePktSndPeriod();
+}
+
+void LiveCC::onAck(uint32_t rtt, uint32_t rtt_variance, uint32_t pkt_recv_rate, uint32_t link_capacity) {
+    _rtt = rtt;
+    _rtt_variance = rtt_variance;
+    if (pkt_recv_rate) {
+        _pkt_recv_rate = pkt_recv_rate;
+    }
+    if (link_capacity) {
+        _link_capacity = link_capacity;
+    }
+}
+
+void LiveCC::updatePktSndPeriod() {
+    if (_max_bw > 0) {
+        _bandwidth = _max_bw;
+    } else if (_max_bw == 0) {
+        _bandwidth = _input_rate * (100 + _overhead) / 100;
+    } else {
+        _bandwidth = 0;
+    }
+    // 带宽未知时不限速 / no pacing until the bandwidth is known
+    _pkt_snd_period = _bandwidth ? (_avg_payload_size + SRT_DATA_HDR_SIZE) * 1000000 / _bandwidth : 0;
+}
+
+SendPacer::SendPacer(toolkit::EventPoller::Ptr poller, int64_t max_bw, uint32_t overhead, const TimePoint &start, uint32_t latency_ms)
+    : _latency_us(latency_ms * 1000)
+    , _start(start)
+    , _live_cc(max_bw, overhead)
+    , _poller(std::move(poller)) {}
+
+SendPacer::~SendPacer() {
+    clear();
+}
+
+void SendPacer::inputPacket(DataPacket::Ptr pkt, size_t payload_size, bool flush) {
+    _live_cc.onInput(SteadyClock::now(), payload_size);
+    if (!_live_cc.getPktSndPeriod() && _queue.empty()) {
+        // 未开启码率控制，直接发送
+        // Pacing is off, send right away
+        _on_send(pkt, flush);
+        return;
+    }
+    _queue.emplace_back(std::move(pkt));
+    sendPacedPackets();
+}
+
+void SendPacer::onRetransmit() {
+    _next_send_time += std::chrono::microseconds(_live_cc.getPktSndPeriod());
+}
+
+void SendPacer::onAck(uint32_t rtt, uint32_t rtt_variance, uint32_t pkt_recv_rate, uint32_t link_capacity) {
+    _live_cc.onAck(rtt, rtt_variance, pkt_recv_rate, link_capacity);
+}
+
+void SendPacer::clear() {
+    if (_task) {
+        _task->cancel();
+        _task = nullptr;
+    }
+    _queue.clear();
+}
+
+void SendPacer::sendPacedPackets() {
+    auto now = SteadyClock::now();
+    auto period = std::chrono::microseconds(_live_cc.getPktSndPeriod());
+    // 空闲期间最多积累1ms的发送额度，定时器精度为1ms
+    // At most 1ms of send credit is accumulated while idle, matching the 1ms timer resolution
+    auto min_next = now - std::chrono::milliseconds(1);
+    if (_next_send_time < min_next) {
+        _next_send_time = min_next;
+    }
+
+    uint32_t ts_now = DurationCountMicroseconds(now - _start);
+    uint32_t drop_first = 0, drop_last = 0;
+    size_t drop_count = 0;
+    while (!_queue.empty() && _next_send_time <= now) {
+        auto pkt = std::move(_queue.front());
+        _queue.pop_front();
+        if (ts_now - pkt->timestamp > _latency_us) {
+            // 排队超过延时的包对端已无法播放，丢弃并通知对端不再等待
+            // Packets queued longer than the latency are useless for the peer, drop them and tell the peer
+            if (!drop_count++) {
+                drop_first = pkt->packet_seq_number;
+            }
+            drop_last = pkt->packet_seq_number;
+            continue;
+        }
+        _next_send_time += period;
+        _on_send(pkt, _queue.empty() || _next_send_time > now);
+    }
+
+    if (drop_count && _on_drop) {
+        _on_drop(drop_first, drop_last, drop_count);
+    }
+
+    if (_queue.empty() || _task) {
+        return;
+    }
+    std::weak_ptr<SendPacer> weak_self = shared_from_this();
+    _task = _poller->doDelayTask(getPacingDelay(), [weak_self]() -> uint64_t {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return 0;
+        }
+        strong_self->sendPacedPackets();
+        auto delay = strong_self->getPacingDelay();
+        if (!delay) {
+            strong_self->_task = nullptr;
+        }
+        return delay;
+    });
+}
+
+uint64_t SendPacer::getPacingDelay() const {
+    if (_queue.empty()) {
+        return 0;
+    }
+    auto us = DurationCountMicroseconds(_next_send_time - SteadyClock::now());
+    return std::max<int64_t>(1, (us + 999) / 1000);
+}
+
 } // namespace SRT
\ No newline at end of file
@@ -1,7 +1,10 @@
 ﻿#ifndef ZLMEDIAKIT_SRT_STATISTIC_H
 #define ZLMEDIAKIT_SRT_STATISTIC_H
 #include <map>
+#include <deque>
+#include <functional>
 
+#include "Poller/EventPoller.h"
 #include "Common.hpp"
 #include "Packet.hpp"
 
@@ -45,6 +48,116 @@ private:
     //std::map<int64_t, int64_t> _pkt_map;
 };
 
+/**
+ * 仿libsrt LiveCC的发送速率控制，根据最大发送带宽计算包发送间隔
+ * LiveCC style sender rate control like libsrt, computes the inter-packet interval from the max send bandwidth
+ */
+class LiveCC {
+public:
+    using Ptr = std::shared_ptr<LiveCC>;
+
+    /**
+     * @param max_bw 最大发送带宽，单位字节/秒；0为按输入码率加overhead自动计算，小于0为不限速
+     *               Max send bandwidth in bytes/s; 0 follows the input rate plus overhead, negative disables pacing
+     * @param overhead 自动模式下在输入码率之上预留给重传的带宽百分比
+     *                 Percent of bandwidth reserved above the input rate for retransmission in auto mode
+     */
+    LiveCC(int64_t max_bw, uint32_t overhead);
+    ~LiveCC() = default;
+
+    // 业务层输入一个数据包 / a data packet is produced by the upper layer
+    void onInput(const TimePoint &ts, size_t payload_size);
+    // 收到对端ACK，记录rtt与带宽估计，仅用于统计；与libsrt的LiveCC一致，发送间隔只由maxBW或输入码率决定
+    // The peer acknowledged, record rtt and bandwidth estimation for statistics only;
+    // like libsrt's LiveCC, the send period only follows maxBW or the input rate
+    void onAck(uint32_t rtt, uint32_t rtt_variance, uint32_t pkt_recv_rate, uint32_t link_capacity);
+
+    bool enabled() const { return _max_bw >= 0; }
+    // 包发送间隔，单位微秒，0表示不限速 / inter-packet interval in microseconds, 0 means no pacing
+    int64_t getPktSndPeriod() const { return _pkt_snd_period; }
+    // 当前限速带宽，单位字节/秒 / current pacing bandwidth in bytes/s
+    uint64_t getBandwidth() const { return _bandwidth; }
+    // 输入码率，单位字节/秒 / input rate in bytes/s
+    uint64_t getInputRate() const { return _input_rate; }
+    // 对端估计的链路容量，单位字节/秒 / link capacity estimated by the peer in bytes/s
+    uint64_t getLinkCapacity() const { return (uint64_t)_link_capacity * (_avg_payload_size + SRT_DATA_HDR_SIZE); }
+    uint32_t getPeerRecvRate() const { return _pkt_recv_rate; }
+    uint32_t getRtt() const { return _rtt; }
+    uint32_t getRttVariance() const { return _rtt_variance; }
+
+private:
+    void updatePktSndPeriod();
+
+private:
+    int64_t _max_bw;
+    uint32_t _overhead;
+    int64_t _pkt_snd_period = 0;
+    uint64_t _bandwidth = 0;
+
+    // 输入码率采样 / input rate sampling
+    bool _input_started = false;
+    TimePoint _input_start;
+    size_t _input_pkts = 0;
+    size_t _input_bytes = 0;
+    uint64_t _input_rate = 0;
+    size_t _avg_payload_size = SRT_MAX_PAYLOAD_SIZE;
+
+    // 来自ACK的网络状态 / network state reported by ACK
+    uint32_t _rtt = 100 * 1000;
+    uint32_t _rtt_variance = 50 * 1000;
+    uint32_t _pkt_recv_rate = 0;
+    uint32_t _link_capacity = 0;
+};
+
+/**
+ * 按LiveCC的包发送间隔排队发送数据包，SrtTransport与SrtCaller共用
+ * Queues data packets and sends them at the LiveCC inter-packet interval, shared by SrtTransport and SrtCaller
+ */
+class SendPacer : public std::enable_shared_from_this<SendPacer> {
+public:
+    using Ptr = std::shared_ptr<SendPacer>;
+    // 数据包出队发送 / a data packet leaves the queue to be sent
+    using onSend = std::function<void(const DataPacket::Ptr &pkt, bool flush)>;
+    // 排队超过延时的包被丢弃，序号范围[first, last] / packets queued longer than the latency were dropped, seq range [first, last]
+    using onDrop = std::function<void(uint32_t first, uint32_t last, size_t count)>;
+
+    /**
+     * @param start 数据包时间戳的起点 / origin of the data packet timestamps
+     * @param latency_ms 包在队列中的最长等待时间 / the longest time a packet may wait in the queue
+     */
+    SendPacer(toolkit::EventPoller::Ptr poller, int64_t max_bw, uint32_t overhead, const TimePoint &start, uint32_t latency_ms);
+    ~SendPacer();
+
+    void setOnSend(onSend cb) { _on_send = std::move(cb); }
+    void setOnDrop(onDrop cb) { _on_drop = std::move(cb); }
+
+    // 输入一个数据包，未开启限速且队列为空时直接发送 / input a data packet, sent right away if pacing is off and nothing is queued
+    void inputPacket(DataPacket::Ptr pkt, size_t payload_size, bool flush);
+    // 重传不排队，但占用新包的发送额度 / retransmissions bypass the queue but consume the send credit of new packets
+    void onRetransmit();
+    void onAck(uint32_t rtt, uint32_t rtt_variance, uint32_t pkt_recv_rate, uint32_t link_capacity);
+    // 停止定时器并清空队列 / stop the timer and clear the queue
+    void clear();
+
+    const LiveCC &getLiveCC() const { return _live_cc; }
+    size_t getQueueSize() const { return _queue.size(); }
+
+private:
+    void sendPacedPackets();
+    uint64_t getPacingDelay() const;
+
+private:
+    uint32_t _latency_us;
+    TimePoint _start;
+    TimePoint _next_send_time;
+    LiveCC _live_cc;
+    std::deque<DataPacket::Ptr> _queue;
+    toolkit::EventPoller::Ptr _poller;
+    toolkit::EventPoller::DelayTask::Ptr _task;
+    onSend _on_send;
+    onDrop _on_drop;
+};
+
 /*
 class RecvRateContext {
 public:
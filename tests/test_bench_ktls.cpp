@@ -0,0 +1,215 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <ctime>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Util/TimeTicker.h"
+#include "Util/NoticeCenter.h"
+#include "Common/config.h"
+#include "Common/KTlsBox.h"
+#include "Common/TlsContext.h"
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__)
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__)
+using namespace mediakit;
+
+// 每次向所有观看者发送的共享缓存大小
+// The size of the shared buffer sent to all the viewers each time
+static constexpr size_t kChunkSize = 64 * 1024;
+
+struct Viewer {
+    int fd = -1;
+    std::unique_ptr<KTlsBox> box;
+};
+
+static bool sendAll(int fd, const char *data, size_t size) {
+    while (size) {
+        auto sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+// 发送线程消耗的cpu时间(用户态+内核态)，单位秒
+// The cpu time consumed by the sending thread (user + kernel), in seconds
+static double threadCpuTime() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 播放端：握手完成后发送一行数据通知服务端，然后只接收不解密，直到连接关闭
+// The player: after the handshake it sends a line to notify the server, then only receives without decrypting until the connection is closed
+static void play(uint16_t port, SSL_CTX *ctx) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0) {
+        auto ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+        if (SSL_connect(ssl) == 1 && SSL_write(ssl, "play\n", 5) == 5) {
+            char buf[64 * 1024];
+            while (recv(fd, buf, sizeof(buf), 0) > 0) {
+            }
+        }
+        SSL_free(ssl);
+    }
+    close(fd);
+}
+
+// 服务端完成握手，收到播放端的明文后返回
+// The server does the handshake and returns after the plain data of the player arrives
+static bool acceptViewer(int listen_fd, Viewer &viewer) {
+    viewer.fd = ::accept(listen_fd, nullptr, nullptr);
+    if (viewer.fd == -1) {
+        return false;
+    }
+    auto fd = viewer.fd;
+    bool ready = false;
+    viewer.box.reset(new KTlsBox());
+    viewer.box->setOnEncData([fd](const Buffer::Ptr &buf) { sendAll(fd, buf->data(), buf->size()); });
+    viewer.box->setOnDecData([&ready](const Buffer::Ptr &) { ready = true; });
+    char buf[4096];
+    while (!ready) {
+        auto size = recv(fd, buf, sizeof(buf), 0);
+        if (size <= 0) {
+            return false;
+        }
+        viewer.box->onRecv(std::make_shared<BufferString>(string(buf, size)));
+    }
+    if (viewer.box->offloadable()) {
+        viewer.box->offload(fd);
+    }
+    return true;
+}
+
+// 向所有观看者发送相同的数据，返回发送线程每核能支撑的总码率(Mbps)
+// Send the same data to all the viewers, returns the total bitrate (Mbps) one core of the sending thread can sustain
+static double bench(bool ktls, size_t count, size_t bytes, SSL_CTX *client_ctx) {
+    mINI::Instance()[General::kEnableKTLS] = ktls;
+    NOTICE_EMIT(BroadcastReloadConfigArgs, Broadcast::kBroadcastReloadConfig);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    socklen_t addr_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, (int)count) || getsockname(listen_fd, (sockaddr *)&addr, &addr_len)) {
+        ErrorL << "listen failed: " << get_uv_errmsg();
+        close(listen_fd);
+        return 0;
+    }
+
+    vector<std::thread> players;
+    for (size_t i = 0; i < count; ++i) {
+        players.emplace_back(play, ntohs(addr.sin_port), client_ctx);
+    }
+    vector<Viewer> viewers(count);
+    size_t offloaded = 0;
+    for (auto &viewer : viewers) {
+        if (!acceptViewer(listen_fd, viewer)) {
+            ErrorL << "handshake failed";
+            break;
+        }
+        offloaded += viewer.box->offloaded();
+    }
+    close(listen_fd);
+    if (ktls && offloaded != count) {
+        WarnL << offloaded << "/" << count << " viewers offloaded to kTLS, the others use userspace tls, check `modprobe tls`";
+    }
+
+    auto chunk = std::make_shared<BufferString>(makeRandStr(kChunkSize, false));
+    size_t sent = 0;
+    auto start = threadCpuTime();
+    Ticker ticker;
+    for (; sent < bytes; sent += kChunkSize) {
+        for (auto &viewer : viewers) {
+            if (!viewer.box) {
+                continue;
+            }
+            if (viewer.box->offloaded()) {
+                // 内核加密，所有观看者直接发送同一份明文
+                // Encrypted by the kernel, the same plain buffer is sent to all the viewers directly
+                sendAll(viewer.fd, chunk->data(), chunk->size());
+            } else {
+                viewer.box->onSend(chunk);
+            }
+        }
+    }
+    auto cpu = threadCpuTime() - start;
+    auto ms = ticker.elapsedTime();
+
+    for (auto &viewer : viewers) {
+        viewer.box.reset();
+        if (viewer.fd != -1) {
+            ::shutdown(viewer.fd, SHUT_RDWR);
+            close(viewer.fd);
+        }
+    }
+    for (auto &player : players) {
+        player.join();
+    }
+    auto mbps = cpu > 0 ? count * sent * 8.0 / cpu / 1e6 : 0;
+    InfoL << (ktls ? "kTLS     " : "userspace") << ": " << count << " viewers, " << sent / 1024 / 1024 << " MB each, cpu " << cpu << " s, wall " << ms << " ms, "
+          << mbps << " Mbps/core";
+    return mbps;
+}
+#endif
+
+// 此程序用于对比用户态tls与kTLS下，单个发送线程每核能支撑的观看者数量；kTLS需要加载内核tls模块(modprobe tls)
+// This program compares how many viewers one core of the sending thread can serve with userspace tls and with kTLS;
+// kTLS requires the kernel tls module (modprobe tls)
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+#if defined(ENABLE_OPENSSL) && defined(__linux__)
+    size_t count = argc > 1 ? atoi(argv[1]) : 100;
+    size_t bytes = (argc > 2 ? atoi(argv[2]) : 16) * 1024 * 1024;
+    double bitrate = (argc > 3 ? atoi(argv[3]) : 4000) / 1000.0;
+    string cert = argc > 4 ? argv[4] : exeDir() + "ssl.p12";
+    if (!count || !bytes || bitrate <= 0) {
+        ErrorL << "usage: " << argv[0] << " [viewers] [MB per viewer] [bitrate kbps] [certificate]";
+        return -1;
+    }
+    if (!TlsContext::loadCertificate(cert)) {
+        ErrorL << "load certificate failed: " << cert;
+        return -1;
+    }
+
+    std::shared_ptr<SSL_CTX> client_ctx(SSL_CTX_new(TLS_client_method()), SSL_CTX_free);
+    auto userspace = bench(false, count, bytes, client_ctx.get());
+    auto ktls = bench(true, count, bytes, client_ctx.get());
+    InfoL << "viewers per core at " << bitrate << " Mbps, userspace: " << userspace / bitrate << ", kTLS: " << ktls / bitrate;
+#else
+    ErrorL << "ENABLE_OPENSSL is disabled or not linux";
+#endif
+    return 0;
+}
@@ -0,0 +1,124 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Util/File.h"
+#include "Network/Buffer.h"
+
+#if defined(ENABLE_RTPPROXY)
+#include "mpeg-ps.h"
+#include "Rtp/PSDecoder.h"
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+#if defined(ENABLE_RTPPROXY)
+using namespace mediakit;
+
+// gb28181常见的rtp负载大小
+// A common gb28181 rtp payload size
+static constexpr size_t kRtpPayloadSize = 1400;
+
+struct Result {
+    size_t frames = 0;
+    size_t bytes = 0;
+    uint64_t ms = 0;
+};
+
+// 原有流程：rtp负载先按32KB拼接，再经过剩余数据缓存交给media-server的ps_demuxer
+// The previous pipeline: rtp payloads are spliced into 32KB chunks and handed to the media-server ps_demuxer with the remaining data cached
+static Result benchLegacy(const vector<Buffer::Ptr> &packets, size_t loops) {
+    Result ret;
+    auto demuxer = ps_demuxer_create([](void *param, int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes) {
+        auto result = (Result *)param;
+        ++result->frames;
+        result->bytes += bytes;
+        return 0;
+    }, &ret);
+    Ticker ticker;
+    string merged, remain;
+    for (size_t i = 0; i < loops; ++i) {
+        for (auto &pkt : packets) {
+            merged.append(pkt->data(), pkt->size());
+            if (merged.size() < 32 * 1024 && &pkt != &packets.back()) {
+                continue;
+            }
+            remain.append(merged);
+            merged.clear();
+            auto used = ps_demuxer_input(demuxer, (const uint8_t *)remain.data(), remain.size());
+            if (used < 0 || used > (int)remain.size()) {
+                used = remain.size();
+            }
+            remain.erase(0, used);
+        }
+    }
+    ret.ms = ticker.elapsedTime();
+    ps_demuxer_destroy(demuxer);
+    return ret;
+}
+
+// 新流程：直接在rtp负载上增量解析
+// The new pipeline: parse incrementally on the rtp payloads directly
+static Result benchNative(const vector<Buffer::Ptr> &packets, size_t loops) {
+    Result ret;
+    PSDecoder decoder;
+    decoder.setOnDecodeBuffer([&](int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        ++ret.frames;
+        ret.bytes += buffer->size();
+    });
+    Ticker ticker;
+    for (size_t i = 0; i < loops; ++i) {
+        for (auto &pkt : packets) {
+            decoder.input(pkt, (const uint8_t *)pkt->data(), pkt->size());
+        }
+    }
+    decoder.flush();
+    ret.ms = ticker.elapsedTime();
+    return ret;
+}
+#endif
+
+// 此程序对比ps解析的新旧实现，输入为rtp_proxy.dumpDir导出的.mpeg文件(即rtp负载拼接后的ps流)
+// This program compares the old and new ps parsers, the input is a .mpeg file exported by rtp_proxy.dumpDir (the ps stream of the spliced rtp payloads)
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+#if defined(ENABLE_RTPPROXY)
+    if (argc < 2) {
+        ErrorL << "usage: " << argv[0] << " <file.mpeg> [loop_count=10]";
+        return -1;
+    }
+    size_t loops = argc > 2 ? atoi(argv[2]) : 10;
+    auto content = File::loadFile(argv[1]);
+    if (content.empty()) {
+        ErrorL << "load file failed: " << argv[1];
+        return -1;
+    }
+    vector<Buffer::Ptr> packets;
+    for (size_t pos = 0; pos < content.size(); pos += kRtpPayloadSize) {
+        auto pkt = BufferRaw::create();
+        pkt->assign(content.data() + pos, std::min(kRtpPayloadSize, content.size() - pos));
+        packets.emplace_back(std::move(pkt));
+    }
+
+    auto legacy = benchLegacy(packets, loops);
+    auto native = benchNative(packets, loops);
+    auto mbps = [&](const Result &result) { return result.ms ? content.size() * loops * 8 / 1000 / result.ms : 0; };
+    InfoL << "legacy ps_demuxer: " << legacy.frames << " frames, " << legacy.bytes << " bytes, " << legacy.ms << " ms, " << mbps(legacy) << " Mbps";
+    InfoL << "native PSDecoder : " << native.frames << " frames, " << native.bytes << " bytes, " << native.ms << " ms, " << mbps(native) << " Mbps";
+#else
+    ErrorL << "ENABLE_RTPPROXY is disabled";
+#endif
+    return 0;
+}
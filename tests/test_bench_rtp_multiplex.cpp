@@ -0,0 +1,194 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <pcap.h>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Network/sockutil.h"
+
+using namespace std;
+using namespace toolkit;
+
+struct RtpItem {
+    // 相对第一个包的发送时间
+    // Send time relative to the first packet
+    uint64_t stamp_ms;
+    std::string rtp;
+};
+
+static size_t getLinkHeaderSize(int link_type) {
+    switch (link_type) {
+        case DLT_EN10MB: return 14;
+        case DLT_LINUX_SLL: return 16;
+        case DLT_NULL: return 4;
+        case DLT_RAW: return 0;
+        default: return (size_t)-1;
+    }
+}
+
+// 从pcap文件中提取第一个ssrc的udp rtp包
+// Extract the udp rtp packets of the first ssrc from a pcap file
+static bool loadPcap(const char *path, std::vector<RtpItem> &out) {
+    char errbuf[PCAP_ERRBUF_SIZE] = {'\0'};
+    std::shared_ptr<pcap_t> handle(pcap_open_offline(path, errbuf), [](pcap_t *handle) {
+        if (handle) {
+            pcap_close(handle);
+        }
+    });
+    if (!handle) {
+        WarnL << "open file failed:" << path << " error: " << errbuf;
+        return false;
+    }
+    auto link_size = getLinkHeaderSize(pcap_datalink(handle.get()));
+    if (link_size == (size_t)-1) {
+        WarnL << "unsupported link type:" << pcap_datalink(handle.get());
+        return false;
+    }
+
+    uint32_t ssrc = 0;
+    uint64_t first_ms = 0;
+    struct pcap_pkthdr *header;
+    const u_char *data;
+    while (pcap_next_ex(handle.get(), &header, &data) == 1) {
+        if (header->caplen < link_size + 20) {
+            continue;
+        }
+        auto ip = data + link_size;
+        size_t ip_len;
+        if ((ip[0] >> 4) == 4) {
+            // ipv4, 17为udp
+            // ipv4, 17 is udp
+            if (ip[9] != 17) {
+                continue;
+            }
+            ip_len = (ip[0] & 0x0F) * 4;
+        } else if ((ip[0] >> 4) == 6) {
+            if (ip[6] != 17) {
+                continue;
+            }
+            ip_len = 40;
+        } else {
+            continue;
+        }
+        size_t udp_offset = link_size + ip_len;
+        if (header->caplen < udp_offset + 8 + 12) {
+            continue;
+        }
+        auto rtp = (const char *)data + udp_offset + 8;
+        auto rtp_len = std::min<size_t>(((data[udp_offset + 4] << 8) | data[udp_offset + 5]) - 8, header->caplen - udp_offset - 8);
+        // rtp版本号必须为2
+        // The rtp version must be 2
+        if (rtp_len < 12 || ((uint8_t)rtp[0] >> 6) != 2) {
+            continue;
+        }
+        uint32_t rtp_ssrc;
+        memcpy(&rtp_ssrc, rtp + 8, 4);
+        rtp_ssrc = ntohl(rtp_ssrc);
+        if (!ssrc) {
+            ssrc = rtp_ssrc;
+            first_ms = header->ts.tv_sec * 1000ULL + header->ts.tv_usec / 1000;
+        }
+        if (rtp_ssrc != ssrc) {
+            continue;
+        }
+        auto stamp_ms = header->ts.tv_sec * 1000ULL + header->ts.tv_usec / 1000 - first_ms;
+        out.emplace_back(RtpItem { stamp_ms, std::string(rtp, rtp_len) });
+    }
+    InfoL << "loaded " << out.size() << " rtp packets of ssrc " << ssrc << " from " << path;
+    return !out.empty();
+}
+
+// 此程序把pcap中的一路GB28181 rtp流改写成多个ssrc，每一路使用独立的本地端口按原始时间戳并发回放到同一个多路复用端口，
+// 用于压测openRtpServerMultiplex(需带re_use_port=1才会按ssrc分流到各poller)，服务器端的cpu分布可通过getThreadsLoad接口观察
+// This program rewrites one GB28181 rtp stream from a pcap into many ssrcs and replays them concurrently at the captured pace,
+// each from its own local port, to a single multiplexed port; it stress tests openRtpServerMultiplex
+// (pass re_use_port=1 to get the per-poller ssrc steering),
+// and the server side cpu spread can be watched with the getThreadsLoad api
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    if (argc < 4) {
+        ErrorL << "usage: " << argv[0] << " <file.pcap> <server_ip> <server_port> [stream_count=100] [thread_count=4] [loop_count=1]";
+        return -1;
+    }
+    size_t stream_count = argc > 4 ? atoi(argv[4]) : 100;
+    size_t thread_count = argc > 5 ? atoi(argv[5]) : 4;
+    size_t loop_count = argc > 6 ? atoi(argv[6]) : 1;
+
+    std::vector<RtpItem> items;
+    if (!loadPcap(argv[1], items)) {
+        return -1;
+    }
+    auto peer = SockUtil::make_sockaddr(argv[2], atoi(argv[3]));
+    auto peer_len = SockUtil::get_sock_len((struct sockaddr *)&peer);
+
+    std::atomic<uint64_t> total_pkts { 0 };
+    std::atomic<uint64_t> total_bytes { 0 };
+    std::atomic<size_t> running { thread_count };
+    std::vector<std::thread> threads;
+    Ticker ticker;
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            // 每一路流使用独立的本地端口，模拟多台设备
+            // Each stream uses its own local port to simulate separate devices
+            std::vector<std::pair<int, uint32_t>> streams;
+            for (size_t i = t; i < stream_count; i += thread_count) {
+                auto fd = SockUtil::bindUdpSock(0, peer.ss_family == AF_INET ? "0.0.0.0" : "::");
+                if (fd == -1) {
+                    WarnL << "create udp socket failed";
+                    continue;
+                }
+                streams.emplace_back(fd, htonl((uint32_t)(0x10000000 + i)));
+            }
+            std::string rtp;
+            for (size_t loop = 0; loop < loop_count; ++loop) {
+                Ticker loop_ticker;
+                for (auto &item : items) {
+                    auto elapsed = loop_ticker.elapsedTime();
+                    if (item.stamp_ms > elapsed) {
+                        usleep((item.stamp_ms - elapsed) * 1000);
+                    }
+                    rtp = item.rtp;
+                    for (auto &stream : streams) {
+                        memcpy(&rtp[8], &stream.second, 4);
+                        if (::sendto(stream.first, rtp.data(), rtp.size(), 0, (struct sockaddr *)&peer, peer_len) > 0) {
+                            ++total_pkts;
+                            total_bytes += rtp.size();
+                        }
+                    }
+                }
+            }
+            for (auto &stream : streams) {
+                close(stream.first);
+            }
+            --running;
+        });
+    }
+
+    uint64_t last_pkts = 0, last_bytes = 0;
+    while (running) {
+        sleep(1);
+        uint64_t pkts = total_pkts, bytes = total_bytes;
+        InfoL << "streams: " << stream_count << ", " << (pkts - last_pkts) << " pkts/s, " << (bytes - last_bytes) * 8 / 1024 / 1024 << " Mbps";
+        last_pkts = pkts;
+        last_bytes = bytes;
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    InfoL << "total " << total_pkts << " pkts, " << total_bytes << " bytes in " << ticker.elapsedTime() << " ms";
+    return 0;
+}
@@ -0,0 +1,99 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <iostream>
+#include <vector>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "srt/Crypto.hpp"
+
+using namespace std;
+using namespace toolkit;
+using namespace SRT;
+
+// 7个ts包，srt默认的payload大小
+// 7 ts packets, the default srt payload size
+static constexpr size_t kPayloadSize = 1316;
+
+// 模拟SrtTransport的发送与接收路径，返回Mbps
+// Simulate the send and receive path of SrtTransport, returns Mbps
+static double bench(Crypto *sender, Crypto *receiver, size_t count, size_t batch) {
+    string payload = makeRandStr(kPayloadSize, false);
+    vector<DataPacket::Ptr> recv_list;
+    size_t bytes = 0;
+
+    Ticker ticker;
+    for (size_t seq = 0; seq < count; ++seq) {
+        auto pkt = std::make_shared<DataPacket>();
+        pkt->f = 0;
+        pkt->packet_seq_number = seq & 0x7fffffff;
+        pkt->PP = 3;
+        pkt->O = 0;
+        pkt->KK = 0;
+        pkt->R = 0;
+        pkt->msg_number = seq;
+        pkt->dst_socket_id = 0;
+        pkt->timestamp = 0;
+        pkt->storeToData((uint8_t *)payload.data(), payload.size());
+        if (sender && !sender->encrypt(pkt)) {
+            WarnL << "encrypt failed";
+            return 0;
+        }
+
+        // 接收端重新解析网络数据
+        // The receiver parses the wire data again
+        auto recv = std::make_shared<DataPacket>();
+        recv->loadFromData((uint8_t *)pkt->data(), pkt->size());
+        recv_list.emplace_back(std::move(recv));
+        if (recv_list.size() < batch) {
+            continue;
+        }
+        if (receiver) {
+            receiver->decrypt(recv_list);
+        }
+        for (auto &data : recv_list) {
+            bytes += data->payloadSize();
+        }
+        recv_list.clear();
+    }
+    auto ms = ticker.elapsedTime();
+    return ms ? bytes * 8.0 / (ms * 1000.0) : 0;
+}
+
+// 此程序用于对比srt加密与不加密时的单核吞吐量
+// This program compares the single core srt throughput with and without encryption
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+    size_t batch = argc > 2 ? atoi(argv[2]) : 32;
+    string passphrase = "ZLMediaKit-srt-bench";
+
+    try {
+        Crypto sender(passphrase);
+        Crypto receiver(passphrase);
+        auto km = sender.generateKeyMaterialExt(HSExt::SRT_CMD_KMREQ);
+        if (!receiver.loadFromKeyMaterial(km)) {
+            ErrorL << "load key material failed";
+            return -1;
+        }
+
+        auto plain = bench(nullptr, nullptr, count, batch);
+        auto encrypted = bench(&sender, &receiver, count, batch);
+        InfoL << "packets:" << count << ", payload:" << kPayloadSize << ", batch:" << batch
+              << ", plain:" << plain << " Mbps/core, encrypted:" << encrypted << " Mbps/core";
+    } catch (std::exception &ex) {
+        ErrorL << ex.what();
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <iostream>
+#include <random>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "srt/PacketQueue.hpp"
+#include "srt/PacketSendQueue.hpp"
+
+using namespace std;
+using namespace toolkit;
+using namespace SRT;
+
+// 7个ts包，srt默认的payload大小
+// 7 ts packets, the default srt payload size
+static constexpr size_t kPayloadSize = 1316;
+
+// 此程序在进程内模拟srt发送与接收窗口的回环：按比例随机丢包，接收端周期性上报NAK，发送端按序号查找并重传
+// This program runs an in-process srt loopback of the send and receive windows: packets are lost at random,
+// the receiver reports NAKs periodically and the sender looks up the lost seqs and retransmits them
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+    double loss = argc > 2 ? atof(argv[2]) : 0.02;
+    // 50Mbps码率，120ms延时
+    // 50Mbps bitrate with 120ms latency
+    uint32_t mbps = argc > 3 ? atoi(argv[3]) : 50;
+    uint32_t latency = 120 * 1000;
+    uint32_t interval = std::max<uint32_t>(kPayloadSize * 8 / mbps, 1);
+    // 窗口大小与SrtTransport::getPktBufSize保持一致的算法
+    // Window size derived the same way as SrtTransport::getPktBufSize
+    uint32_t cap = std::max<uint32_t>(latency / interval * 2, 8192);
+    // 从回环附近开始，覆盖序号回环的情况
+    // Start right before the wrap around to cover seq wrapping
+    uint32_t init_seq = MAX_SEQ - 1000;
+
+    PacketSendQueue send_queue(cap, latency);
+    PacketRecvQueue recv_queue(cap, init_seq, latency);
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> dist(0, 1);
+    auto payload = makeRandStr(kPayloadSize, false);
+
+    PacketQueueInterface::PacketList delivered;
+    PacketQueueInterface::LostList lost_list;
+    PacketSendQueue::PacketList retrans;
+    size_t delivered_count = 0, holes = 0, retrans_count = 0, dropped = 0;
+    uint32_t last_seq = init_seq - 1;
+    // NAK每20ms一次，ACK每10ms一次
+    // A NAK every 20ms and an ACK every 10ms
+    size_t nak_every = std::max<uint32_t>(20 * 1000 / interval, 1);
+    size_t ack_every = std::max<uint32_t>(10 * 1000 / interval, 1);
+
+    auto onDelivered = [&]() {
+        for (auto &pkt : delivered) {
+            if (genExpectedSeq(last_seq + 1) != pkt->packet_seq_number) {
+                ++holes;
+            }
+            last_seq = pkt->packet_seq_number;
+            ++delivered_count;
+        }
+        delivered.clear();
+    };
+
+    Ticker ticker;
+    for (size_t i = 0; i < count; ++i) {
+        auto pkt = std::make_shared<DataPacket>();
+        pkt->f = 0;
+        pkt->packet_seq_number = genExpectedSeq(init_seq + i);
+        pkt->PP = 3;
+        pkt->O = 0;
+        pkt->KK = 0;
+        pkt->R = 0;
+        pkt->msg_number = i;
+        pkt->dst_socket_id = 0;
+        pkt->timestamp = i * interval;
+        pkt->storeToData((uint8_t *)payload.data(), payload.size());
+        send_queue.inputPacket(pkt);
+
+        if (dist(rng) >= loss) {
+            recv_queue.inputPacket(pkt, delivered);
+            onDelivered();
+        } else {
+            ++dropped;
+        }
+
+        if (i % nak_every == 0) {
+            recv_queue.getLostSeq(lost_list);
+            for (auto &range : lost_list) {
+                retrans.clear();
+                send_queue.findPacketBySeq(range.first, range.second - 1, retrans);
+                for (auto &re : retrans) {
+                    ++retrans_count;
+                    // 重传包也会丢
+                    // Retransmitted packets may be lost too
+                    if (dist(rng) >= loss) {
+                        recv_queue.inputPacket(re, delivered);
+                        onDelivered();
+                    }
+                }
+            }
+        }
+
+        if (i % ack_every == 0) {
+            send_queue.drop(recv_queue.getExpectedSeq());
+        }
+    }
+    auto ms = ticker.elapsedTime();
+
+    InfoL << "packets:" << count << ", loss:" << loss * 100 << "%, window:" << cap << ", lost:" << dropped
+          << ", retransmitted:" << retrans_count << ", delivered:" << delivered_count << ", unrecovered holes:" << holes
+          << ", send window:" << send_queue.getSize() << ", recv window:" << recv_queue.getSize()
+          << ", cost:" << ms << "ms, " << (ms ? count * 1000 / ms : 0) << " pkts/s, "
+          << (ms ? count * kPayloadSize * 8.0 / (ms * 1000.0) : 0) << " Mbps/core";
+    return 0;
+}
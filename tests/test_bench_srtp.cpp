@@ -0,0 +1,108 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "../webrtc/SrtpSession.hpp"
+
+using namespace std;
+using namespace toolkit;
+using namespace RTC;
+
+// srtp加密后追加的字节数(tag + mki)不会超过该值
+// Enough room for the srtp trailer (SRTP_MAX_TRAILER_LEN)
+static constexpr size_t kTrailerRoom = 256;
+
+struct SuiteInfo {
+    SrtpSession::CryptoSuite suite;
+    const char *name;
+    size_t key_len;
+};
+
+static void makeRtp(uint8_t *buf, size_t len, uint16_t seq) {
+    memset(buf, 0xAB, len);
+    buf[0] = 0x80;
+    buf[1] = 96;
+    buf[2] = seq >> 8;
+    buf[3] = seq & 0xFF;
+    // timestamp
+    memset(buf + 4, 0, 4);
+    // ssrc
+    buf[8] = 0x12;
+    buf[9] = 0x34;
+    buf[10] = 0x56;
+    buf[11] = 0x78;
+}
+
+// 返回Gbps
+// Returns Gbps
+static double benchSuite(const SuiteInfo &info, size_t pkt_size, size_t count, size_t batch) {
+    vector<uint8_t> key(info.key_len);
+    for (auto &ch : key) {
+        ch = rand() & 0xFF;
+    }
+    SrtpSession session(SrtpSession::Type::OUTBOUND, info.suite, key.data(), key.size());
+
+    vector<vector<uint8_t>> pkts(batch, vector<uint8_t>(pkt_size + kTrailerRoom));
+    vector<uint8_t *> data(batch);
+    vector<int> lens(batch);
+    uint16_t seq = 0;
+    size_t bytes = 0;
+
+    Ticker ticker;
+    for (size_t done = 0; done < count; done += batch) {
+        for (size_t i = 0; i < batch; ++i) {
+            makeRtp(pkts[i].data(), pkt_size, seq++);
+            data[i] = pkts[i].data();
+            lens[i] = (int)pkt_size;
+        }
+        if (batch == 1) {
+            session.EncryptRtp(data[0], &lens[0]);
+            bytes += pkt_size;
+        } else {
+            bytes += pkt_size * session.EncryptRtpBatch(data.data(), lens.data(), batch);
+        }
+    }
+    auto ms = ticker.elapsedTime();
+    return ms ? bytes * 8.0 / (ms * 1000.0 * 1000.0) : 0;
+}
+
+// 此程序用于测试单核srtp加密吞吐量
+// This program measures the single core srtp protect throughput of every crypto suite
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+    size_t pkt_size = argc > 2 ? atoi(argv[2]) : 1200;
+    size_t batch = argc > 3 ? atoi(argv[3]) : 64;
+
+    vector<SuiteInfo> suites = {
+        { SrtpSession::CryptoSuite::AES_CM_128_HMAC_SHA1_80, "AES_CM_128_HMAC_SHA1_80", 30 },
+        { SrtpSession::CryptoSuite::AES_CM_128_HMAC_SHA1_32, "AES_CM_128_HMAC_SHA1_32", 30 },
+        { SrtpSession::CryptoSuite::AEAD_AES_128_GCM, "AEAD_AES_128_GCM", 28 },
+        { SrtpSession::CryptoSuite::AEAD_AES_256_GCM, "AEAD_AES_256_GCM", 44 },
+    };
+
+    for (auto &info : suites) {
+        if (!SrtpSession::IsCryptoSuiteSupported(info.suite)) {
+            WarnL << info.name << " not supported by libsrtp, skipped";
+            continue;
+        }
+        auto single = benchSuite(info, pkt_size, count, 1);
+        auto batched = benchSuite(info, pkt_size, count, batch);
+        InfoL << info.name << ", packet size:" << pkt_size << ", count:" << count
+              << ", single: " << single << " Gbps/core, batch(" << batch << "): " << batched << " Gbps/core";
+    }
+    return 0;
+}
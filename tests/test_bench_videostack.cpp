@@ -0,0 +1,119 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+
+#if defined(ENABLE_FFMPEG)
+#include "Codec/VideoCompositor.h"
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+#if defined(ENABLE_FFMPEG)
+using namespace mediakit;
+
+static FFmpegFrame::Ptr makeFrame(int width, int height, uint8_t seed) {
+    auto frame = std::make_shared<FFmpegFrame>();
+    frame->fillPicture(AV_PIX_FMT_YUV420P, width, height);
+    frame->get()->width = width;
+    frame->get()->height = height;
+    frame->get()->format = AV_PIX_FMT_YUV420P;
+    // 合成的渐变图案
+    // A synthetic gradient pattern
+    for (int plane = 0; plane < 3; ++plane) {
+        auto rows = plane ? (height + 1) / 2 : height;
+        for (int i = 0; i < rows; ++i) {
+            memset(frame->get()->data[plane] + (size_t)frame->get()->linesize[plane] * i, (uint8_t)(seed + i + plane * 64), frame->get()->linesize[plane]);
+        }
+    }
+    return frame;
+}
+
+// 原有流程：单线程逐个格子逐行拷贝
+// The previous pipeline: copy tile by tile and row by row in a single thread
+static void composeLegacy(const FFmpegFrame::Ptr &canvas, const vector<VideoCompositor::Tile> &tiles) {
+    auto dst = canvas->get();
+    for (auto &tile : tiles) {
+        auto src = tile.frame->get();
+        for (int i = 0; i < src->height; ++i) {
+            memcpy(dst->data[0] + dst->linesize[0] * (i + tile.y) + tile.x, src->data[0] + src->linesize[0] * i, src->width);
+        }
+        for (int i = 0; i < (src->height + 1) / 2; ++i) {
+            memcpy(dst->data[1] + dst->linesize[1] * (i + tile.y / 2) + tile.x / 2, src->data[1] + src->linesize[1] * i, src->width / 2);
+            memcpy(dst->data[2] + dst->linesize[2] * (i + tile.y / 2) + tile.x / 2, src->data[2] + src->linesize[2] * i, src->width / 2);
+        }
+    }
+}
+
+static uint64_t bench(size_t loops, const function<void()> &func) {
+    Ticker ticker;
+    for (size_t i = 0; i < loops; ++i) {
+        func();
+    }
+    return MAX(ticker.elapsedTime(), (uint64_t)1);
+}
+#endif
+
+// 此程序测试拼接屏合成N路格子的速度
+// This program measures the speed of compositing N tiles for the video stack
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+#if defined(ENABLE_FFMPEG)
+    if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+        ErrorL << "usage: " << argv[0] << " [tile_count=16] [width=1920] [height=1080] [loop_count=500]";
+        return -1;
+    }
+    int count = argc > 1 ? atoi(argv[1]) : 16;
+    int width = argc > 2 ? atoi(argv[2]) : 1920;
+    int height = argc > 3 ? atoi(argv[3]) : 1080;
+    size_t loops = argc > 4 ? atoi(argv[4]) : 500;
+    if (count <= 0 || width <= 0 || height <= 0) {
+        ErrorL << "invalid arguments";
+        return -1;
+    }
+
+    auto cols = (int)ceil(sqrt(count));
+    auto rows = (count + cols - 1) / cols;
+    auto tile_width = width / cols & ~1;
+    auto tile_height = height / rows & ~1;
+    vector<VideoCompositor::Tile> tiles;
+    for (int i = 0; i < count; ++i) {
+        tiles.push_back({ i % cols * tile_width, i / cols * tile_height, makeFrame(tile_width, tile_height, (uint8_t)(i * 16)) });
+    }
+    auto canvas = makeFrame(width, height, 0);
+
+    auto legacy = bench(loops, [&]() {
+        memset(canvas->get()->data[0], 20, canvas->get()->linesize[0] * height);
+        memset(canvas->get()->data[1], 128, canvas->get()->linesize[1] * ((height + 1) / 2));
+        memset(canvas->get()->data[2], 128, canvas->get()->linesize[2] * ((height + 1) / 2));
+        composeLegacy(canvas, tiles);
+    });
+    auto compositor = bench(loops, [&]() {
+        VideoCompositor::fill(canvas, 20, 128, 128);
+        VideoCompositor::compose(canvas, tiles);
+    });
+
+    auto cores = VideoCompositor::concurrency();
+    auto fps = [&](uint64_t ms) { return loops * 1000.0 / ms; };
+    InfoL << count << " tiles of " << tile_width << "x" << tile_height << " into " << width << "x" << height << ", " << loops << " frames";
+    InfoL << "legacy single thread: " << legacy << " ms, " << fps(legacy) << " fps";
+    InfoL << "VideoCompositor     : " << compositor << " ms, " << fps(compositor) << " fps, " << fps(compositor) / cores << " fps per core (" << cores << " cores)";
+#else
+    ErrorL << "ENABLE_FFMPEG is disabled";
+#endif
+    return 0;
+}
@@ -0,0 +1,119 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <vector>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Http/HlsParser.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class HlsParserCollector : public HlsParser {
+public:
+    vector<ts_segment> segments;
+
+protected:
+    bool onParsed(bool is_m3u8_inner, int64_t sequence, const map<int, ts_segment> &ts_list) override {
+        for (auto &pr : ts_list) {
+            segments.emplace_back(pr.second);
+        }
+        return true;
+    }
+};
+
+struct Expect {
+    const char *url;
+    const char *range;
+};
+
+static bool check(const char *name, const string &m3u8, const vector<Expect> &expect) {
+    HlsParserCollector parser;
+    if (!parser.parse("http://127.0.0.1/live/test/index.m3u8", m3u8)) {
+        ErrorL << name << ": parse failed";
+        return false;
+    }
+    if (parser.segments.size() != expect.size()) {
+        ErrorL << name << ": segment count mismatched: " << parser.segments.size() << " != " << expect.size();
+        return false;
+    }
+    for (size_t i = 0; i < expect.size(); ++i) {
+        auto &segment = parser.segments[i];
+        if (segment.url != expect[i].url || segment.range != expect[i].range) {
+            ErrorL << name << ": segment " << i << " mismatched, url: " << segment.url << "/" << expect[i].url << ", range: " << segment.range << "/"
+                   << expect[i].range;
+            return false;
+        }
+    }
+    InfoL << name << ": " << expect.size() << " segments ok";
+    return true;
+}
+
+// 此程序校验HlsParser对#EXT-X-BYTERANGE的解析：指定与省略偏移量、同一文件连续切片、切换文件与无Range切片
+// This program checks how HlsParser parses #EXT-X-BYTERANGE: with and without an offset, consecutive segments of one file,
+// switching files and segments without a Range
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+
+    // 省略偏移量时紧接同一文件上个切片的结束位置，标签可在#EXTINF之前或之后
+    // Without an offset it follows the end of the previous segment of the same file, the tag may come before or after #EXTINF
+    auto consecutive = "#EXTM3U\n"
+                       "#EXT-X-VERSION:4\n"
+                       "#EXT-X-TARGETDURATION:2\n"
+                       "#EXTINF:2.000,\n"
+                       "#EXT-X-BYTERANGE:1000@0\n"
+                       "main.ts\n"
+                       "#EXT-X-BYTERANGE:500\n"
+                       "#EXTINF:2.000,\n"
+                       "main.ts\n"
+                       "#EXTINF:2.000,\n"
+                       "#EXT-X-BYTERANGE:700\n"
+                       "main.ts\n"
+                       "#EXT-X-ENDLIST\n";
+    // 切换到另一个文件时从0开始，没有标签的切片下载整个文件，显式偏移量之后继续累加
+    // Switching to another file starts from 0, a segment without the tag downloads the whole file,
+    // an explicit offset is followed by consecutive ranges as well
+    auto switching = "#EXTM3U\n"
+                     "#EXT-X-VERSION:4\n"
+                     "#EXT-X-TARGETDURATION:2\n"
+                     "#EXTINF:2.000,\n"
+                     "#EXT-X-BYTERANGE:1000\n"
+                     "a.ts\n"
+                     "#EXTINF:2.000,\n"
+                     "#EXT-X-BYTERANGE:300\n"
+                     "b.ts\n"
+                     "#EXTINF:2.000,\n"
+                     "c.ts\n"
+                     "#EXTINF:2.000,\n"
+                     "#EXT-X-BYTERANGE:200@5000\n"
+                     "http://127.0.0.1/vod/d.ts\n"
+                     "#EXTINF:2.000,\n"
+                     "#EXT-X-BYTERANGE:100\n"
+                     "http://127.0.0.1/vod/d.ts\n"
+                     "#EXT-X-ENDLIST\n";
+
+    if (!check("consecutive", consecutive,
+               { { "http://127.0.0.1/live/test/main.ts", "bytes=0-999" },
+                 { "http://127.0.0.1/live/test/main.ts", "bytes=1000-1499" },
+                 { "http://127.0.0.1/live/test/main.ts", "bytes=1500-2199" } })
+        || !check("switching", switching,
+                  { { "http://127.0.0.1/live/test/a.ts", "bytes=0-999" },
+                    { "http://127.0.0.1/live/test/b.ts", "bytes=0-299" },
+                    { "http://127.0.0.1/live/test/c.ts", "" },
+                    { "http://127.0.0.1/vod/d.ts", "bytes=5000-5199" },
+                    { "http://127.0.0.1/vod/d.ts", "bytes=5200-5299" } })) {
+        return -1;
+    }
+    return 0;
+}
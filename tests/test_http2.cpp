@@ -0,0 +1,354 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Http/Hpack.h"
+#include "Http/Http2Splitter.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+using HeaderList = HpackDecoder::HeaderList;
+
+static string fromHex(const string &hex) {
+    string ret;
+    for (size_t i = 0; i + 1 < hex.size();) {
+        if (hex[i] == ' ') {
+            ++i;
+            continue;
+        }
+        ret.push_back((char)stoi(hex.substr(i, 2), nullptr, 16));
+        i += 2;
+    }
+    return ret;
+}
+
+static bool checkHeaders(const string &name, const HeaderList &headers, const HeaderList &expected) {
+    if (headers == expected) {
+        return true;
+    }
+    ErrorL << name << " mismatch, got:";
+    for (auto &pr : headers) {
+        ErrorL << "  " << pr.first << ": " << pr.second;
+    }
+    return false;
+}
+
+// RFC 7541 附录C的一组连续头部块，共用同一个解压器(动态表)
+// A sequence of header blocks of RFC 7541 Appendix C sharing one decoder (dynamic table)
+static bool testHpackVectors(const string &name, size_t table_size, const vector<pair<string, HeaderList>> &blocks) {
+    HpackDecoder decoder;
+    decoder.setMaxTableSize(table_size);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        auto data = fromHex(blocks[i].first);
+        HeaderList headers;
+        if (!decoder.decode((const uint8_t *)data.data(), data.size(), headers)) {
+            ErrorL << name << "." << i + 1 << " decode failed";
+            return false;
+        }
+        if (!checkHeaders(name + "." + to_string(i + 1), headers, blocks[i].second)) {
+            return false;
+        }
+    }
+    InfoL << name << " passed";
+    return true;
+}
+
+static bool testHpack() {
+    HeaderList req1 { { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" }, { ":authority", "www.example.com" } };
+    HeaderList req2 = req1;
+    req2.emplace_back("cache-control", "no-cache");
+    HeaderList req3 { { ":method", "GET" }, { ":scheme", "https" }, { ":path", "/index.html" }, { ":authority", "www.example.com" }, { "custom-key", "custom-value" } };
+
+    HeaderList rsp1 { { ":status", "302" }, { "cache-control", "private" }, { "date", "Mon, 21 Oct 2013 20:13:21 GMT" }, { "location", "https://www.example.com" } };
+    HeaderList rsp2 { { ":status", "307" }, { "cache-control", "private" }, { "date", "Mon, 21 Oct 2013 20:13:21 GMT" }, { "location", "https://www.example.com" } };
+    HeaderList rsp3 { { ":status", "200" },
+                      { "cache-control", "private" },
+                      { "date", "Mon, 21 Oct 2013 20:13:22 GMT" },
+                      { "location", "https://www.example.com" },
+                      { "content-encoding", "gzip" },
+                      { "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1" } };
+
+    // C.3 不使用huffman的请求
+    // C.3 Requests without huffman coding
+    if (!testHpackVectors("C.3", 4096, {
+        { "828684410f7777772e6578616d706c652e636f6d", req1 },
+        { "828684be58086e6f2d6361636865", req2 },
+        { "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565", req3 } })) {
+        return false;
+    }
+    // C.4 使用huffman的请求
+    // C.4 Requests with huffman coding
+    if (!testHpackVectors("C.4", 4096, {
+        { "828684418cf1e3c2e5f23a6ba0ab90f4ff", req1 },
+        { "828684be5886a8eb10649cbf", req2 },
+        { "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf", req3 } })) {
+        return false;
+    }
+    // C.5 不使用huffman的响应，动态表大小为256，会发生淘汰
+    // C.5 Responses without huffman coding, the dynamic table size is 256 so entries are evicted
+    if (!testHpackVectors("C.5", 256, {
+        { "4803333032580770726976617465611d4d6f6e2c203231204f637420323031332032303a31333a323120474d546e1768747470733a2f2f7777772e6578616d706c652e636f6d", rsp1 },
+        { "4803333037c1c0bf", rsp2 },
+        { "88c1611d4d6f6e2c203231204f637420323031332032303a31333a323220474d54c05a04677a69707738666f6f3d4153444a4b48514b425a584f5157454f50495541585157454f49553b206d61782d6167653d333630303b2076657273696f6e3d31", rsp3 } })) {
+        return false;
+    }
+    // C.6 使用huffman的响应，动态表大小为256
+    // C.6 Responses with huffman coding, the dynamic table size is 256
+    if (!testHpackVectors("C.6", 256, {
+        { "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3", rsp1 },
+        { "4883640effc1c0bf", rsp2 },
+        { "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007", rsp3 } })) {
+        return false;
+    }
+
+    // 编码器只使用静态表，解压后应与原头部一致(名称转为小写)
+    // The encoder only uses the static table, decoding must give back the original headers (names in lower case)
+    HeaderList headers { { ":status", "200" }, { "Content-Type", "video/x-flv" }, { "server", "ZLMediaKit" }, { "x-custom", "value" } };
+    HpackEncoder encoder;
+    string block;
+    for (auto &pr : headers) {
+        encoder.encode(pr.first, pr.second, block);
+    }
+    if ((uint8_t)block[0] != 0x88) {
+        ErrorL << ":status: 200 should be encoded as a single byte 0x88";
+        return false;
+    }
+    HpackDecoder decoder;
+    HeaderList decoded;
+    headers[1].first = "content-type";
+    if (!decoder.decode((const uint8_t *)block.data(), block.size(), decoded) || !checkHeaders("encoder", decoded, headers)) {
+        return false;
+    }
+    InfoL << "encoder passed";
+    return true;
+}
+
+struct Http2Frame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream_id;
+    string payload;
+};
+
+static string makeFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const string &payload) {
+    string ret;
+    ret.push_back((char)(payload.size() >> 16));
+    ret.push_back((char)(payload.size() >> 8));
+    ret.push_back((char)payload.size());
+    ret.push_back((char)type);
+    ret.push_back((char)flags);
+    ret.push_back((char)(stream_id >> 24));
+    ret.push_back((char)(stream_id >> 16));
+    ret.push_back((char)(stream_id >> 8));
+    ret.push_back((char)stream_id);
+    return ret + payload;
+}
+
+static string makeWindowUpdate(uint32_t stream_id, uint32_t increment) {
+    string payload;
+    for (int i = 3; i >= 0; --i) {
+        payload.push_back((char)(increment >> (8 * i)));
+    }
+    return makeFrame(0x8, 0, stream_id, payload);
+}
+
+class TestSplitter : public Http2Splitter {
+public:
+    // 按字节逐个输入，覆盖帧被拆分的情况
+    // Input byte by byte to cover frames split across reads
+    void inputBytes(const string &data) {
+        for (auto ch : data) {
+            inputHttp2(&ch, 1);
+        }
+    }
+
+    // 把已发送的数据解析为帧
+    // Parse the sent data into frames
+    vector<Http2Frame> takeFrames() {
+        vector<Http2Frame> ret;
+        size_t offset = 0;
+        while (sent.size() - offset >= 9) {
+            auto ptr = (const uint8_t *)sent.data() + offset;
+            size_t size = (ptr[0] << 16) | (ptr[1] << 8) | ptr[2];
+            Http2Frame frame;
+            frame.type = ptr[3];
+            frame.flags = ptr[4];
+            frame.stream_id = ((ptr[5] & 0x7F) << 24) | (ptr[6] << 16) | (ptr[7] << 8) | ptr[8];
+            frame.payload = sent.substr(offset + 9, size);
+            ret.emplace_back(std::move(frame));
+            offset += 9 + size;
+        }
+        sent.erase(0, offset);
+        return ret;
+    }
+
+    string sent;
+    string error;
+    vector<uint32_t> closed;
+    vector<tuple<uint32_t, HeaderList, string>> requests;
+
+protected:
+    void onHttp2Request(uint32_t stream_id, HeaderList &headers, string &content) override { requests.emplace_back(stream_id, headers, content); }
+    void onHttp2StreamClosed(uint32_t stream_id, ErrorCode error_code) override {
+        if (error_code == kNoError) {
+            closed.emplace_back(stream_id);
+        }
+    }
+    void onHttp2Error(const string &err) override { error = err; }
+    void onHttp2SendData(Buffer::Ptr buffer) override { sent.append(buffer->data(), buffer->size()); }
+};
+
+#define CHECK_TEST(exp) \
+    if (!(exp)) { \
+        ErrorL << "check failed: " << #exp << ", error: " << splitter.error; \
+        return false; \
+    }
+
+// 客户端依次发送连接前言、SETTINGS、HEADERS、DATA，之后用WINDOW_UPDATE放开被流控阻塞的响应
+// The client sends the connection preface, SETTINGS, HEADERS and DATA, then WINDOW_UPDATE releases the response blocked by flow control
+static bool testSplitter() {
+    TestSplitter splitter;
+    splitter.startHttp2(0);
+    auto frames = splitter.takeFrames();
+    CHECK_TEST(frames.size() == 1 && frames[0].type == 0x4 && frames[0].flags == 0);
+
+    HpackEncoder encoder;
+    string block;
+    encoder.encode(":method", "POST", block);
+    encoder.encode(":scheme", "https", block);
+    encoder.encode(":path", "/index/api/getServerConfig", block);
+    encoder.encode(":authority", "127.0.0.1", block);
+    encoder.encode("content-type", "application/json", block);
+
+    string input = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    input += makeFrame(0x4, 0, 0, "");
+    // END_HEADERS
+    input += makeFrame(0x1, 0x4, 1, block);
+    // END_STREAM
+    input += makeFrame(0x0, 0x1, 1, "{\"secret\":\"test\"}");
+    splitter.inputBytes(input);
+
+    frames = splitter.takeFrames();
+    CHECK_TEST(splitter.error.empty());
+    CHECK_TEST(frames.size() == 1 && frames[0].type == 0x4 && frames[0].flags == 0x1);
+    CHECK_TEST(splitter.requests.size() == 1);
+    auto &request = splitter.requests[0];
+    CHECK_TEST(get<0>(request) == 1);
+    CHECK_TEST(get<1>(request).size() == 5 && get<1>(request)[0] == make_pair(string(":method"), string("POST")));
+    CHECK_TEST(get<1>(request)[2].second == "/index/api/getServerConfig");
+    CHECK_TEST(get<2>(request) == "{\"secret\":\"test\"}");
+
+    // 响应大于65535字节的初始窗口，超出部分必须等待WINDOW_UPDATE
+    // The response is larger than the 65535 bytes initial window, the rest must wait for WINDOW_UPDATE
+    string body(100000, 0);
+    for (size_t i = 0; i < body.size(); ++i) {
+        body[i] = (char)(i * 7);
+    }
+    auto buffer = BufferRaw::create();
+    buffer->assign(body.data(), body.size());
+    splitter.sendHttp2Headers(1, { { ":status", "200" } }, false);
+    splitter.sendHttp2Data(1, buffer, true);
+
+    frames = splitter.takeFrames();
+    CHECK_TEST(frames.size() >= 2 && frames[0].type == 0x1 && frames[0].flags == 0x4 && frames[0].payload == "\x88");
+    string received;
+    for (size_t i = 1; i < frames.size(); ++i) {
+        CHECK_TEST(frames[i].type == 0x0 && frames[i].stream_id == 1 && frames[i].flags == 0 && frames[i].payload.size() <= 16384);
+        received += frames[i].payload;
+    }
+    CHECK_TEST(received.size() == 65535);
+    CHECK_TEST(splitter.getHttp2PendingSize(1) == body.size() - 65535);
+
+    // 只放开连接窗口时流窗口仍为0，不能发送
+    // Only the connection window is opened, the stream window is still 0 so nothing can be sent
+    splitter.inputBytes(makeWindowUpdate(0, 100000));
+    CHECK_TEST(splitter.takeFrames().empty());
+
+    splitter.inputBytes(makeWindowUpdate(1, 100000));
+    frames = splitter.takeFrames();
+    CHECK_TEST(!frames.empty());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        auto last = i + 1 == frames.size();
+        CHECK_TEST(frames[i].type == 0x0 && frames[i].stream_id == 1 && frames[i].flags == (last ? 0x1 : 0));
+        received += frames[i].payload;
+    }
+    CHECK_TEST(received == body);
+    CHECK_TEST(splitter.closed.size() == 1 && splitter.closed[0] == 1);
+    CHECK_TEST(splitter.error.empty());
+    InfoL << "splitter passed";
+    return true;
+}
+
+// 对端NO_ERROR的GOAWAY: 拒绝新的流，已有的流完成后才关闭连接
+// A NO_ERROR GOAWAY from the peer: new streams are refused and the connection is closed only after the existing streams finish
+static bool testGoAway() {
+    TestSplitter splitter;
+    splitter.startHttp2(0);
+    splitter.takeFrames();
+
+    HpackEncoder encoder;
+    string block;
+    encoder.encode(":method", "GET", block);
+    encoder.encode(":scheme", "http", block);
+    encoder.encode(":path", "/live/test.live.flv", block);
+    encoder.encode(":authority", "127.0.0.1", block);
+
+    string input = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    input += makeFrame(0x4, 0, 0, "");
+    // END_HEADERS | END_STREAM
+    input += makeFrame(0x1, 0x5, 1, block);
+    input += makeFrame(0x7, 0, 0, string(8, '\0'));
+    splitter.inputBytes(input);
+    CHECK_TEST(splitter.error.empty() && splitter.requests.size() == 1);
+    splitter.takeFrames();
+
+    // GOAWAY之后的新流被拒绝
+    // A new stream after GOAWAY is refused
+    string block2;
+    encoder.encode(":method", "GET", block2);
+    encoder.encode(":scheme", "http", block2);
+    encoder.encode(":path", "/index.html", block2);
+    encoder.encode(":authority", "127.0.0.1", block2);
+    splitter.inputBytes(makeFrame(0x1, 0x5, 3, block2));
+    auto frames = splitter.takeFrames();
+    CHECK_TEST(splitter.error.empty() && splitter.requests.size() == 1);
+    CHECK_TEST(frames.size() == 1 && frames[0].type == 0x3 && frames[0].stream_id == 3 && frames[0].payload == string("\0\0\0\x7", 4));
+
+    // 已有的流仍可发送响应，结束后连接关闭
+    // The existing stream can still send its response, the connection is closed after it ends
+    auto buffer = BufferRaw::create();
+    buffer->assign("flv", 3);
+    splitter.sendHttp2Headers(1, { { ":status", "200" } }, false);
+    splitter.sendHttp2Data(1, buffer, false);
+    CHECK_TEST(splitter.error.empty());
+    splitter.sendHttp2Data(1, nullptr, true);
+    frames = splitter.takeFrames();
+    CHECK_TEST(!splitter.error.empty() && splitter.closed.size() == 1 && splitter.closed[0] == 1);
+    CHECK_TEST(frames.size() == 4 && frames[2].type == 0x0 && frames[2].flags == 0x1 && frames[3].type == 0x7);
+    CHECK_TEST(frames[3].payload == string("\0\0\0\x3\0\0\0\0", 8));
+    InfoL << "goaway passed";
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+    if (!testHpack() || !testSplitter() || !testGoAway()) {
+        return -1;
+    }
+    return 0;
+}
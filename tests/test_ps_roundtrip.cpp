@@ -0,0 +1,196 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <random>
+#include <vector>
+#include <iostream>
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Network/Buffer.h"
+
+#if defined(ENABLE_RTPPROXY)
+#include "mpeg-proto.h"
+#include "Rtp/PSEncoder.h"
+#include "Rtp/PSDecoder.h"
+#include "Extension/Factory.h"
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+#if defined(ENABLE_RTPPROXY)
+using namespace mediakit;
+
+struct EsFrame {
+    int64_t pts;
+    int64_t dts;
+    string data;
+
+    bool operator==(const EsFrame &that) const { return pts == that.pts && dts == that.dts && data == that.data; }
+    bool operator!=(const EsFrame &that) const { return !(*this == that); }
+};
+
+class RtpCollector : public PSEncoderImp {
+public:
+    RtpCollector() : PSEncoderImp(0x12345678) {}
+    vector<RtpPacket::Ptr> rtps;
+
+protected:
+    void onRTP(Buffer::Ptr rtp, bool is_key) override { rtps.emplace_back(static_pointer_cast<RtpPacket>(std::move(rtp))); }
+};
+
+// 生成不含起始码竞争的随机负载
+// Random payload without start code emulation
+static string makePayload(mt19937 &rng, size_t size) {
+    string ret;
+    ret.reserve(size);
+    while (ret.size() < size) {
+        ret.push_back((char)(0x10 + rng() % 0x60));
+    }
+    return ret;
+}
+
+static string makeNalu(bool h265, int type, const string &payload) {
+    string ret("\x00\x00\x00\x01", 4);
+    if (h265) {
+        ret.push_back((char)(type << 1));
+        ret.push_back(0x01);
+    } else {
+        ret.push_back((char)(0x60 | type));
+    }
+    // 首个slice标记(first_mb_in_slice为0或first_slice_segment_in_pic_flag)
+    // The first slice marker (first_mb_in_slice of 0 or first_slice_segment_in_pic_flag)
+    ret.push_back((char)0x80);
+    return ret + payload;
+}
+
+static string makeAdts(const string &payload) {
+    auto size = payload.size() + 7;
+    // aac lc, 44100hz, 2 channels
+    uint8_t adts[7] = { 0xFF, 0xF1, 0x50, (uint8_t)(0x80 | ((size >> 11) & 0x03)), (uint8_t)(size >> 3), (uint8_t)(((size & 0x07) << 5) | 0x1F), 0xFC };
+    return string((char *)adts, sizeof(adts)) + payload;
+}
+
+static bool inputFrame(RtpCollector &encoder, CodecId codec, int index, const string &data, uint64_t dts, uint64_t pts) {
+    auto frame = Factory::getFrameFromPtr(codec, data.data(), data.size(), dts, pts);
+    frame->setIndex(index);
+    return encoder.inputFrame(frame);
+}
+
+// 编码h264/h265 + aac为ps rtp，再用PSDecoder解析，比较解析出的帧与原始帧
+// Encode h264/h265 + aac into ps rtp, parse it back with PSDecoder and compare the frames with the original ones
+static bool testRoundTrip(CodecId video_codec, size_t frame_count) {
+    bool h265 = video_codec == CodecH265;
+    mt19937 rng(h265 ? 265 : 264);
+    RtpCollector encoder;
+    auto video = Factory::getTrackByCodecId(video_codec);
+    auto audio = Factory::getTrackByCodecId(CodecAAC, 44100, 2, 16);
+    video->setIndex(0);
+    audio->setIndex(1);
+    encoder.addTrack(video);
+    encoder.addTrack(audio);
+
+    vector<EsFrame> expect_video, expect_audio;
+    for (size_t i = 0; i < frame_count; ++i) {
+        // 毫秒时间戳，带b帧的pts顺序
+        // Timestamps in milliseconds, with a b-frame style pts order
+        uint64_t dts = 40 * i;
+        uint64_t pts = dts + 40 * (i % 3);
+        string access_unit;
+        bool key = i % 25 == 0;
+        if (key) {
+            vector<string> configs;
+            if (h265) {
+                configs.emplace_back(makeNalu(true, 32, makePayload(rng, 20)));
+            }
+            configs.emplace_back(makeNalu(h265, h265 ? 33 : 7, makePayload(rng, 30)));
+            configs.emplace_back(makeNalu(h265, h265 ? 34 : 8, makePayload(rng, 8)));
+            for (auto &config : configs) {
+                inputFrame(encoder, video_codec, 0, config, dts, pts);
+                access_unit += config;
+            }
+        }
+        // 关键帧超过pes长度上限，会被拆分为多个pes
+        // Key frames exceed the pes length limit and are split into several pes
+        auto size = key ? 100000 + rng() % 150000 : 200 + rng() % 30000;
+        auto slice = makeNalu(h265, key ? (h265 ? 19 : 5) : 1, makePayload(rng, size));
+        inputFrame(encoder, video_codec, 0, slice, dts, pts);
+        access_unit += slice;
+        expect_video.emplace_back(EsFrame { (int64_t)pts * 90, (int64_t)dts * 90, std::move(access_unit) });
+
+        auto aac = makeAdts(makePayload(rng, 100 + rng() % 500));
+        inputFrame(encoder, CodecAAC, 1, aac, dts + 5, dts + 5);
+        expect_audio.emplace_back(EsFrame { (int64_t)(dts + 5) * 90, (int64_t)(dts + 5) * 90, std::move(aac) });
+    }
+    encoder.flush();
+
+    PSDecoder decoder;
+    map<int, int> codecs;
+    vector<EsFrame> got_video, got_audio;
+    decoder.setOnStream([&](int stream, int codecid, const void *extra, size_t bytes, int finish) { codecs[stream] = codecid; });
+    decoder.setOnDecodeBuffer([&](int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        auto &frames = codecid == PSI_STREAM_AAC ? got_audio : got_video;
+        frames.emplace_back(EsFrame { pts, dts, string(buffer->data(), buffer->size()) });
+    });
+    uint16_t seq = encoder.rtps.empty() ? 0 : encoder.rtps.front()->getSeq();
+    for (auto &rtp : encoder.rtps) {
+        if (rtp->getSeq() != seq++) {
+            ErrorL << "rtp seq discontinuous: " << rtp->getSeq();
+            return false;
+        }
+        decoder.input(rtp, rtp->getPayload(), rtp->getPayloadSize());
+    }
+    decoder.flush();
+
+    auto video_codecid = h265 ? PSI_STREAM_H265 : PSI_STREAM_H264;
+    // PSEncoderImp的视频流id从0xE0开始，音频从0xC0开始
+    // The stream ids of PSEncoderImp start from 0xE0 for video and 0xC0 for audio
+    if (codecs.size() != 2 || codecs[0xE0] != video_codecid || codecs[0xC0] != PSI_STREAM_AAC) {
+        ErrorL << "psm mismatched, streams: " << codecs.size();
+        return false;
+    }
+    auto compare = [](const char *name, const vector<EsFrame> &got, const vector<EsFrame> &expect) {
+        if (got.size() != expect.size()) {
+            ErrorL << name << " frame count mismatched: " << got.size() << " != " << expect.size();
+            return false;
+        }
+        for (size_t i = 0; i < got.size(); ++i) {
+            if (got[i] != expect[i]) {
+                ErrorL << name << " frame " << i << " mismatched, pts: " << got[i].pts << "/" << expect[i].pts << ", dts: " << got[i].dts << "/"
+                       << expect[i].dts << ", size: " << got[i].data.size() << "/" << expect[i].data.size();
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!compare("video", got_video, expect_video) || !compare("audio", got_audio, expect_audio)) {
+        return false;
+    }
+    InfoL << getCodecName(video_codec) << " + aac: " << frame_count << " frames, " << encoder.rtps.size() << " rtp packets, round trip ok";
+    return true;
+}
+#endif
+
+// 此程序校验PSEncoderImp与PSDecoder的往返一致性：h264/h265与aac帧编码为ps rtp后解析，帧数据与时间戳应与输入一致
+// This program checks the round trip of PSEncoderImp and PSDecoder: h264/h265 and aac frames are encoded into ps rtp and parsed back,
+// the frame data and timestamps must equal the input
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    Logger::Instance().setWriter(std::make_shared<AsyncLogWriter>());
+#if defined(ENABLE_RTPPROXY)
+    if (!testRoundTrip(CodecH264, 100) || !testRoundTrip(CodecH265, 100)) {
+        return -1;
+    }
+#else
+    ErrorL << "ENABLE_RTPPROXY is disabled";
+#endif
+    return 0;
+}
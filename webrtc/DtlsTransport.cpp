@@ -406,10 +406,16 @@ namespace RTC
              it != DtlsTransport::srtpCryptoSuites.end();
              ++it)
         {
-            if (it != DtlsTransport::srtpCryptoSuites.begin())
+            SrtpCryptoSuiteMapEntry* cryptoSuiteEntry = std::addressof(*it);
+
+            // Do not offer AEAD_AES_*_GCM if libsrtp was built without it, otherwise
+            // the session fails after a successful DTLS handshake.
+            if (!RTC::SrtpSession::IsCryptoSuiteSupported(cryptoSuiteEntry->cryptoSuite))
+                continue;
+
+            if (!dtlsSrtpCryptoSuites.empty())
                 dtlsSrtpCryptoSuites += ":";
 
-            SrtpCryptoSuiteMapEntry* cryptoSuiteEntry = std::addressof(*it);
             dtlsSrtpCryptoSuites += cryptoSuiteEntry->name;
         }
 
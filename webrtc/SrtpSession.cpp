@@ -142,17 +142,8 @@ DepLibSRTP::~DepLibSRTP() {
 
 /////////////////////////////////////////////////////////////////////////////////////
 
-/* Instance methods. */
-
-SrtpSession::SrtpSession(Type type, CryptoSuite cryptoSuite, uint8_t *key, size_t keyLen) {
-    _env = DepLibSRTP::Instance().shared_from_this();
-    MS_TRACE();
-
-    srtp_policy_t policy; // NOLINT(cppcoreguidelines-pro-type-member-init)
-
-    // Set all policy fields to 0.
-    std::memset(&policy, 0, sizeof(srtp_policy_t));
-
+static void SetCryptoPolicy(SrtpSession::CryptoSuite cryptoSuite, srtp_policy_t &policy) {
+    using CryptoSuite = SrtpSession::CryptoSuite;
     switch (cryptoSuite) {
     case CryptoSuite::AES_CM_128_HMAC_SHA1_80: {
         srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
@@ -187,6 +178,45 @@ SrtpSession::SrtpSession(Type type, CryptoSuite cryptoSuite, uint8_t *key, size_
         MS_ABORT("unknown SRTP crypto suite");
     }
     }
+}
+
+/* Class methods. */
+
+bool SrtpSession::IsCryptoSuiteSupported(CryptoSuite cryptoSuite) {
+    auto env = DepLibSRTP::Instance().shared_from_this();
+
+    srtp_policy_t policy; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    std::memset(&policy, 0, sizeof(srtp_policy_t));
+    SetCryptoPolicy(cryptoSuite, policy);
+
+    // libsrtp only reports missing cipher types (eg: GCM without OpenSSL) when the session is created.
+    std::vector<uint8_t> key(policy.rtp.cipher_key_len, 0);
+    policy.ssrc.type = ssrc_any_outbound;
+    policy.key = key.data();
+    policy.window_size = 1024;
+
+    srtp_t session { nullptr };
+    srtp_err_status_t err = srtp_create(&session, &policy);
+    if (DepLibSRTP::IsError(err)) {
+        WarnL << "SRTP crypto suite " << (int)cryptoSuite << " is not supported by libsrtp: " << DepLibSRTP::GetErrorString(err);
+        return false;
+    }
+    srtp_dealloc(session);
+    return true;
+}
+
+/* Instance methods. */
+
+SrtpSession::SrtpSession(Type type, CryptoSuite cryptoSuite, uint8_t *key, size_t keyLen) {
+    _env = DepLibSRTP::Instance().shared_from_this();
+    MS_TRACE();
+
+    srtp_policy_t policy; // NOLINT(cppcoreguidelines-pro-type-member-init)
+
+    // Set all policy fields to 0.
+    std::memset(&policy, 0, sizeof(srtp_policy_t));
+
+    SetCryptoPolicy(cryptoSuite, policy);
 
     MS_ASSERT((int)keyLen == policy.rtp.cipher_key_len, "given keyLen does not match policy.rtp.cipher_keyLen");
 
@@ -241,6 +271,27 @@ bool SrtpSession::EncryptRtp(uint8_t *data, int *len) {
     return true;
 }
 
+size_t SrtpSession::EncryptRtpBatch(uint8_t **data, int *lens, size_t count) {
+    MS_TRACE();
+    size_t protected_count = 0;
+    srtp_err_status_t last_err = srtp_err_status_ok;
+    for (size_t i = 0; i < count; ++i) {
+        srtp_err_status_t err = srtp_protect(this->session, static_cast<void *>(data[i]), reinterpret_cast<int *>(&lens[i]));
+        if (DepLibSRTP::IsError(err)) {
+            last_err = err;
+            lens[i] = 0;
+            continue;
+        }
+        ++protected_count;
+    }
+
+    if (protected_count != count) {
+        // Log once per batch instead of once per packet.
+        WarnL << "srtp_protect() failed " << count - protected_count << "/" << count << ":" << DepLibSRTP::GetErrorString(last_err);
+    }
+    return protected_count;
+}
+
 bool SrtpSession::DecryptSrtp(uint8_t *data, int *len) {
     MS_TRACE();
 
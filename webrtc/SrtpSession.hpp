@@ -43,12 +43,20 @@ public:
 public:
     enum class Type { INBOUND = 1, OUTBOUND };
 
+public:
+    // Whether the linked libsrtp can create a session with the given crypto suite
+    // (AEAD_AES_*_GCM requires libsrtp built with OpenSSL).
+    static bool IsCryptoSuiteSupported(CryptoSuite cryptoSuite);
+
 public:
     SrtpSession(Type type, CryptoSuite cryptoSuite, uint8_t *key, size_t keyLen);
     ~SrtpSession();
 
 public:
     bool EncryptRtp(uint8_t *data, int *len);
+    // Protect count packets in one pass, every data[i] must have room for SRTP_MAX_TRAILER_LEN.
+    // lens[i] is updated in place, failed packets get lens[i] = 0. Returns the number of protected packets.
+    size_t EncryptRtpBatch(uint8_t **data, int *lens, size_t count);
     bool DecryptSrtp(uint8_t *data, int *len);
     bool EncryptRtcp(uint8_t *data, int *len);
     bool DecryptSrtcp(uint8_t *data, int *len);
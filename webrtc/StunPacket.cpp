@@ -466,6 +466,32 @@ StunPacket::Ptr StunPacket::parse(const uint8_t *data, size_t len) {
     return packet;
 }
 
+std::string StunPacket::peekUsername(const uint8_t *data, size_t len) {
+    if (!StunPacket::isStun(data, len)) {
+        return "";
+    }
+    size_t msgLength = Byte::Get2Bytes(data, 2);
+    if (msgLength + HEADER_SIZE > len) {
+        return "";
+    }
+    auto ptr = data + HEADER_SIZE;
+    auto end = ptr + msgLength;
+    while (ptr + StunAttribute::ATTR_HEADER_SIZE <= end) {
+        auto type = Byte::Get2Bytes(ptr, 0);
+        size_t attr_len = Byte::Get2Bytes(ptr, 2);
+        if (ptr + StunAttribute::ATTR_HEADER_SIZE + attr_len > end) {
+            break;
+        }
+        if (type == (uint16_t)StunAttribute::Type::USERNAME) {
+            return std::string((const char *)ptr + StunAttribute::ATTR_HEADER_SIZE, attr_len);
+        }
+        // 属性按4字节对齐
+        // Attributes are padded to 4 bytes
+        ptr += StunAttribute::ATTR_HEADER_SIZE + ((attr_len + 3) & ~3);
+    }
+    return "";
+}
+
 std::string StunPacket::mappingClassEnum2Str(Class klass) {
     switch (klass) {
         case StunPacket::Class::REQUEST: return "REQUEST";
@@ -525,6 +525,9 @@ public:
     static Class getClass(const uint8_t *data, size_t len);
     static Method getMethod(const uint8_t *data, size_t len);
     static StunPacket::Ptr parse(const uint8_t *data, size_t len);
+    // 仅扫描USERNAME属性，不解析整个stun包，用于udp收包分发
+    // Scan the USERNAME attribute only without parsing the whole packet, used by the udp demux
+    static std::string peekUsername(const uint8_t *data, size_t len);
     static std::string mappingClassEnum2Str(Class klass);
     static std::string mappingMethodEnum2Str(Method method);
 
@@ -21,18 +21,14 @@ using namespace toolkit;
 namespace mediakit {
 
 static string getUserName(const char *buf, size_t len) {
-    if (!RTC::StunPacket::isStun((const uint8_t *) buf, len)) {
-        return "";
-    }
-    auto packet = RTC::StunPacket::parse((const uint8_t *) buf, len);
-    if (!packet) {
-        return "";
-    }
-
     // 收到binding request请求  [AUTO-TRANSLATED:eff4d773]
     // Received binding request
-    auto vec = split(packet->getUsername(), ":");
-    return vec[0];
+    auto user_name = RTC::StunPacket::peekUsername((const uint8_t *) buf, len);
+    auto pos = user_name.find(':');
+    if (pos != string::npos) {
+        user_name.resize(pos);
+    }
+    return user_name;
 }
 
 EventPoller::Ptr WebRtcSession::queryPoller(const Buffer::Ptr &buffer) {
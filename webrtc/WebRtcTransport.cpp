@@ -109,6 +109,9 @@ static onceToken token([]() {
 } // namespace Rtc
 
 static atomic<uint64_t> s_key { 0 };
+// 单次批量srtp加密的最大rtp包个数
+// Max rtp packets protected in one srtp batch
+static constexpr size_t kMaxSrtpBatchSize = 128;
 
 static std::string getServerPrefix() {
     // stun_user_name格式: base64(ip+udp_port+tcp_port) + _ + number  [AUTO-TRANSLATED:cc3c5902]
@@ -272,7 +275,7 @@ WebRtcTransport::WebRtcTransport(const EventPoller::Ptr &poller) {
     _poller = poller;
     static auto prefix = getServerPrefix();
     _identifier = prefix + to_string(++s_key);
-    _packet_pool.setSize(64);
+    _packet_pool.setSize(kMaxSrtpBatchSize);
 }
 
 void WebRtcTransport::onCreate() {
@@ -782,15 +785,47 @@ void WebRtcTransport::sendRtpPacket(const char *buf, int len, bool flush, void *
         pkt->setCapacity((size_t)len + SRTP_MAX_TRAILER_LEN + 2);
         memcpy(pkt->data(), buf, len);
         onBeforeEncryptRtp(pkt->data(), len, ctx);
-        if (_srtp_session_send->EncryptRtp(reinterpret_cast<uint8_t *>(pkt->data()), &len)) {
-            pkt->setSize(len);
-            onSendSockData(std::move(pkt), flush);
+        pkt->setSize(len);
+        // 先缓存明文rtp，等到flush时再批量加密发送
+        // Cache plain rtp, protect and send them in one pass when flushed
+        _srtp_send_batch.emplace_back(std::move(pkt));
+        if (flush || _srtp_send_batch.size() >= kMaxSrtpBatchSize) {
+            flushRtpBatch(flush);
         }
     }
 }
 
+void WebRtcTransport::flushRtpBatch(bool flush) {
+    if (_srtp_send_batch.empty()) {
+        return;
+    }
+    auto count = _srtp_send_batch.size();
+    uint8_t *data[kMaxSrtpBatchSize];
+    int lens[kMaxSrtpBatchSize];
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = reinterpret_cast<uint8_t *>(_srtp_send_batch[i]->data());
+        lens[i] = (int)_srtp_send_batch[i]->size();
+    }
+    _srtp_session_send->EncryptRtpBatch(data, lens, count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!lens[i]) {
+            // 加密失败
+            // Encryption failed
+            continue;
+        }
+        _srtp_send_batch[i]->setSize(lens[i]);
+        onSendSockData(std::move(_srtp_send_batch[i]), flush && i + 1 == count);
+    }
+    // clear不释放容量，下一批复用
+    // clear keeps the capacity, it is reused by the next batch
+    _srtp_send_batch.clear();
+}
+
 void WebRtcTransport::sendRtcpPacket(const char *buf, int len, bool flush, void *ctx) {
     if (_srtp_session_send) {
+        // 保证rtcp(如sr)不会越过之前未发送的rtp
+        // Make sure rtcp (such as sr) does not overtake the pending rtp
+        flushRtpBatch(false);
         auto pkt = _packet_pool.obtain2();
         // 预留rtx加入的两个字节  [AUTO-TRANSLATED:d1eb5cd7]
         // Reserve two bytes for rtx joining
@@ -1600,26 +1635,33 @@ WebRtcTransportManager &WebRtcTransportManager::Instance() {
     return s_instance;
 }
 
+WebRtcTransportManager::Shard &WebRtcTransportManager::getShard(const string &key) {
+    return _shards[std::hash<string>()(key) % kShardCount];
+}
+
 void WebRtcTransportManager::addItem(const string &key, const WebRtcTransportImp::Ptr &ptr) {
-    lock_guard<mutex> lck(_mtx);
-    _map[key] = ptr;
+    auto &shard = getShard(key);
+    lock_guard<mutex> lck(shard.mtx);
+    shard.map[key] = ptr;
 }
 
 WebRtcTransportImp::Ptr WebRtcTransportManager::getItem(const string &key) {
     if (key.empty()) {
         return nullptr;
     }
-    lock_guard<mutex> lck(_mtx);
-    auto it = _map.find(key);
-    if (it == _map.end()) {
+    auto &shard = getShard(key);
+    lock_guard<mutex> lck(shard.mtx);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
         return nullptr;
     }
     return it->second.lock();
 }
 
 void WebRtcTransportManager::removeItem(const string &key) {
-    lock_guard<mutex> lck(_mtx);
-    _map.erase(key);
+    auto &shard = getShard(key);
+    lock_guard<mutex> lck(shard.mtx);
+    shard.map.erase(key);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -13,6 +13,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <functional>
 #include "DtlsTransport.hpp"
 #include "IceTransport.hpp"
@@ -227,6 +228,7 @@ protected:
 private:
     void sendSockData(const char *buf, size_t len, const IceTransport::Pair::Ptr& pair = nullptr);
     void setRemoteDtlsFingerprint(SdpType type, const RtcSession &remote);
+    void flushRtpBatch(bool flush);
 
 protected:
     SignalingProtocols  _signaling_protocols = SignalingProtocols::WHEP_WHIP;
@@ -248,6 +250,9 @@ private:
     // 循环池  [AUTO-TRANSLATED:b7059f37]
     // Cycle pool
     toolkit::ResourcePool<toolkit::BufferRaw> _packet_pool;
+    // 待批量srtp加密的rtp包
+    // Rtp packets waiting for batched srtp protection
+    std::vector<toolkit::BufferRaw::Ptr> _srtp_send_batch;
 
     //超时功能实现
     toolkit::Ticker _recv_ticker;
@@ -413,8 +418,17 @@ private:
     void removeItem(const std::string &key);
 
 private:
-    mutable std::mutex _mtx;
-    std::unordered_map<std::string, std::weak_ptr<WebRtcTransportImp> > _map;
+    // 按ufrag哈希分片，避免所有poller线程的stun/udp收包分发竞争同一把锁
+    // Sharded by ufrag hash, so the stun/udp demux on every poller does not contend on one lock
+    static constexpr size_t kShardCount = 64;
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::weak_ptr<WebRtcTransportImp> > map;
+    };
+    Shard &getShard(const std::string &key);
+
+private:
+    Shard _shards[kShardCount];
 };
 
 class WebRtcArgs : public std::enable_shared_from_this<WebRtcArgs> {